@@ -1781,7 +1781,8 @@ gst_dash_demux_update_manifest_data (GstAdaptiveDemux * demux,
   new_client->mpd_base_uri = g_strdup (demux->manifest_base_uri);
   gst_buffer_map (buffer, &mapinfo, GST_MAP_READ);
 
-  if (gst_mpd_parse (new_client, (gchar *) mapinfo.data, mapinfo.size)) {
+  if (gst_mpd_parse_update (new_client, dashdemux->client,
+          (gchar *) mapinfo.data, mapinfo.size)) {
     const gchar *period_id;
     guint period_idx;
     GList *iter;
@@ -1790,7 +1791,9 @@ gst_dash_demux_update_manifest_data (GstAdaptiveDemux * demux,
     /* prepare the new manifest and try to transfer the stream position
      * status from the old manifest client  */
 
-    GST_DEBUG_OBJECT (demux, "Updating manifest");
+    GST_DEBUG_OBJECT (demux, "Updating manifest, parsed %" G_GUINT64_FORMAT
+        " bytes and %u nodes, reused %u nodes", new_client->parsed_bytes,
+        new_client->parsed_nodes, new_client->reused_nodes);
 
     period_id = gst_mpd_client_get_period_id (dashdemux->client);
     period_idx = gst_mpd_client_get_period_index (dashdemux->client);
@@ -1868,6 +1871,15 @@ gst_dash_demux_update_manifest_data (GstAdaptiveDemux * demux,
     dashdemux->client = new_client;
 
     GST_DEBUG_OBJECT (demux, "Manifest file successfully updated");
+    gst_element_post_message (GST_ELEMENT_CAST (demux),
+        gst_message_new_element (GST_OBJECT_CAST (demux),
+            gst_structure_new (GST_ADAPTIVE_DEMUX_STATISTICS_MESSAGE_NAME,
+                "manifest-uri", G_TYPE_STRING, demux->manifest_uri,
+                "manifest-parsed-bytes", G_TYPE_UINT64,
+                dashdemux->client->parsed_bytes, "manifest-parsed-nodes",
+                G_TYPE_UINT, dashdemux->client->parsed_nodes,
+                "manifest-reused-nodes", G_TYPE_UINT,
+                dashdemux->client->reused_nodes, NULL)));
     if (dashdemux->clock_drift) {
       gst_dash_demux_poll_clock_drift (dashdemux);
     }
@@ -27,11 +27,22 @@
 #include <string.h>
 #include <libxml/parser.h>
 #include <libxml/tree.h>
+#include <libxml/xmlreader.h>
 #include "gstmpdparser.h"
 #include "gstdash_debug.h"
 
 #define GST_CAT_DEFAULT gst_dash_demux_debug
 
+/* Period, AdaptationSet and Representation nodes of the previous MPD that
+ * can be shared with the one being parsed, indexed by their hash. The nodes
+ * are not hashed if NULL */
+typedef struct
+{
+  GHashTable *nodes;
+  guint parsed;
+  guint reused;
+} GstMpdReuseContext;
+
 /* Property parsing */
 static gboolean gst_mpdparser_get_xml_prop_validated_string (xmlNode * a_node,
     const gchar * property_name, gchar ** property_value,
@@ -111,22 +122,26 @@ gst_mpdparser_parse_representation_base_type (GstRepresentationBaseType **
     pointer, xmlNode * a_node);
 static gboolean gst_mpdparser_parse_representation_node (GList ** list,
     xmlNode * a_node, GstAdaptationSetNode * parent,
-    GstPeriodNode * period_node);
+    GstPeriodNode * period_node, GstMpdReuseContext * reuse,
+    guint64 inherited);
 static gboolean gst_mpdparser_parse_adaptation_set_node (GList ** list,
-    xmlNode * a_node, GstPeriodNode * parent);
+    xmlNode * a_node, GstPeriodNode * parent, GstMpdReuseContext * reuse,
+    guint64 inherited);
 static void gst_mpdparser_parse_subset_node (GList ** list, xmlNode * a_node);
 static gboolean
 gst_mpdparser_parse_segment_template_node (GstSegmentTemplateNode ** pointer,
     xmlNode * a_node, GstSegmentTemplateNode * parent);
 static gboolean gst_mpdparser_parse_period_node (GList ** list,
-    xmlNode * a_node);
+    xmlNode * a_node, GstMpdReuseContext * reuse);
 static void gst_mpdparser_parse_program_info_node (GList ** list,
     xmlNode * a_node);
 static void gst_mpdparser_parse_metrics_range_node (GList ** list,
     xmlNode * a_node);
 static void gst_mpdparser_parse_metrics_node (GList ** list, xmlNode * a_node);
-static gboolean gst_mpdparser_parse_root_node (GstMPDNode ** pointer,
-    xmlNode * a_node);
+static GstMPDNode *gst_mpdparser_parse_root_node_attributes (xmlNode *
+    a_node);
+static gboolean gst_mpdparser_parse_root_child_node (GstMPDNode * new_mpd,
+    xmlNode * cur_node, GstMpdReuseContext * reuse);
 static void gst_mpdparser_parse_utctiming_node (GList ** list,
     xmlNode * a_node);
 
@@ -1832,14 +1847,222 @@ gst_mpdparser_parse_representation_base_type (GstRepresentationBaseType **
   }
 }
 
+/* node reuse: a Period, AdaptationSet or Representation node is shared with
+ * the previous MPD if the hash of its XML subtree and of the elements it
+ * inherits from its parents is the same. The hashes are 64 bit FNV-1a */
+#define GST_MPD_HASH_INIT G_GUINT64_CONSTANT (0xcbf29ce484222325)
+
+static inline guint64
+gst_mpdparser_hash_byte (guint64 hash, guint8 byte)
+{
+  return (hash ^ byte) * G_GUINT64_CONSTANT (0x100000001b3);
+}
+
+static guint64
+gst_mpdparser_hash_string (guint64 hash, const xmlChar * str)
+{
+  if (str) {
+    for (; *str; str++)
+      hash = gst_mpdparser_hash_byte (hash, *str);
+  }
+
+  /* 0xff never appears in UTF-8 text */
+  return gst_mpdparser_hash_byte (hash, 0xff);
+}
+
+static gboolean
+gst_mpdparser_hash_attributes (xmlNode * a_node, guint64 * hash)
+{
+  xmlAttr *attr;
+  xmlNode *cur_node;
+  guint64 h = *hash;
+
+  for (attr = a_node->properties; attr; attr = attr->next) {
+    /* xlink references are resolved after parsing by replacing the parsed
+     * nodes, these can't be shared */
+    if (attr->ns && xmlStrcmp (attr->name, (xmlChar *) "href") == 0
+        && xmlStrcmp (attr->ns->href,
+            (xmlChar *) "http://www.w3.org/1999/xlink") == 0)
+      return FALSE;
+
+    h = gst_mpdparser_hash_string (h, attr->ns ? attr->ns->href : NULL);
+    h = gst_mpdparser_hash_string (h, attr->name);
+    for (cur_node = attr->children; cur_node; cur_node = cur_node->next)
+      h = gst_mpdparser_hash_string (h, cur_node->content);
+  }
+
+  *hash = gst_mpdparser_hash_byte (h, 0xfe);
+  return TRUE;
+}
+
+static gboolean
+gst_mpdparser_hash_subtree (xmlNode * a_node, guint64 * hash)
+{
+  xmlNode *cur_node;
+
+  *hash = gst_mpdparser_hash_string (*hash, a_node->name);
+  if (!gst_mpdparser_hash_attributes (a_node, hash))
+    return FALSE;
+
+  for (cur_node = a_node->children; cur_node; cur_node = cur_node->next) {
+    switch (cur_node->type) {
+      case XML_ELEMENT_NODE:
+        if (!gst_mpdparser_hash_subtree (cur_node, hash))
+          return FALSE;
+        break;
+      case XML_TEXT_NODE:
+      case XML_CDATA_SECTION_NODE:
+        *hash = gst_mpdparser_hash_string (*hash, cur_node->content);
+        break;
+      case XML_COMMENT_NODE:
+        break;
+      default:
+        /* entity references and the like, don't bother */
+        return FALSE;
+    }
+  }
+
+  *hash = gst_mpdparser_hash_byte (*hash, 0xfd);
+  return TRUE;
+}
+
+static gboolean
+gst_mpdparser_is_segment_node (xmlNode * a_node)
+{
+  return a_node->type == XML_ELEMENT_NODE
+      && (xmlStrcmp (a_node->name, (xmlChar *) "SegmentBase") == 0
+      || xmlStrcmp (a_node->name, (xmlChar *) "SegmentList") == 0
+      || xmlStrcmp (a_node->name, (xmlChar *) "SegmentTemplate") == 0);
+}
+
+/* Returns the hash of the SegmentBase, SegmentList and SegmentTemplate
+ * nodes that the children of @a_node inherit from it and from its parents,
+ * @inherited. 0 means that the children can't be shared */
+static guint64
+gst_mpdparser_get_inherited_hash (GstMpdReuseContext * reuse,
+    xmlNode * a_node, guint64 inherited)
+{
+  xmlNode *cur_node;
+
+  if (reuse == NULL || reuse->nodes == NULL || inherited == 0)
+    return 0;
+
+  for (cur_node = a_node->children; cur_node; cur_node = cur_node->next) {
+    if (gst_mpdparser_is_segment_node (cur_node)
+        && !gst_mpdparser_hash_subtree (cur_node, &inherited))
+      return 0;
+  }
+
+  return inherited;
+}
+
+/* Returns TRUE if @a_node or any of its descendants has a SegmentBase,
+ * SegmentList or SegmentTemplate child, which copies the values it inherits
+ * from the parents of that node */
+static gboolean
+gst_mpdparser_has_segment_node (xmlNode * a_node)
+{
+  xmlNode *cur_node;
+
+  for (cur_node = a_node->children; cur_node; cur_node = cur_node->next) {
+    if (gst_mpdparser_is_segment_node (cur_node))
+      return TRUE;
+  }
+  for (cur_node = a_node->children; cur_node; cur_node = cur_node->next) {
+    if (cur_node->type == XML_ELEMENT_NODE
+        && gst_mpdparser_has_segment_node (cur_node))
+      return TRUE;
+  }
+
+  return FALSE;
+}
+
+/* Returns the node of the previous MPD to share instead of parsing @a_node,
+ * or NULL. @hash is set to the hash of @a_node, or 0 if it can't be shared.
+ * Only the SegmentBase, SegmentList and SegmentTemplate nodes inherit from
+ * their parents, so the inherited nodes are only part of the hash if there
+ * are any in the subtree of @a_node: an AdaptationSet without segment
+ * information of its own still passes the one of its Period down to its
+ * Representations. @inherited_flag is the other value inherited from the
+ * parent */
+static gpointer
+gst_mpdparser_find_reusable_node (GstMpdReuseContext * reuse,
+    xmlNode * a_node, guint64 inherited, guint8 inherited_flag,
+    guint64 * hash)
+{
+  guint64 h = GST_MPD_HASH_INIT;
+
+  *hash = 0;
+  if (reuse == NULL || reuse->nodes == NULL)
+    return NULL;
+
+  if (gst_mpdparser_has_segment_node (a_node)) {
+    if (inherited == 0)
+      return NULL;
+    h = inherited;
+  }
+
+  h = gst_mpdparser_hash_byte (h, inherited_flag);
+  if (!gst_mpdparser_hash_subtree (a_node, &h))
+    return NULL;
+
+  *hash = h != 0 ? h : 1;
+  return g_hash_table_lookup (reuse->nodes, hash);
+}
+
+static void
+gst_mpdparser_add_reusable_nodes (GHashTable * nodes, GstMPDNode * mpd_node)
+{
+  GList *list, *adapt_list, *rep_list;
+
+  for (list = mpd_node->Periods; list; list = g_list_next (list)) {
+    GstPeriodNode *period = list->data;
+
+    if (period->hash)
+      g_hash_table_insert (nodes, &period->hash, period);
+
+    for (adapt_list = period->AdaptationSets; adapt_list;
+        adapt_list = g_list_next (adapt_list)) {
+      GstAdaptationSetNode *adapt_set = adapt_list->data;
+
+      if (adapt_set->hash)
+        g_hash_table_insert (nodes, &adapt_set->hash, adapt_set);
+
+      for (rep_list = adapt_set->Representations; rep_list;
+          rep_list = g_list_next (rep_list)) {
+        GstRepresentationNode *representation = rep_list->data;
+
+        if (representation->hash)
+          g_hash_table_insert (nodes, &representation->hash, representation);
+      }
+    }
+  }
+}
+
 static gboolean
 gst_mpdparser_parse_representation_node (GList ** list, xmlNode * a_node,
-    GstAdaptationSetNode * parent, GstPeriodNode * period_node)
+    GstAdaptationSetNode * parent, GstPeriodNode * period_node,
+    GstMpdReuseContext * reuse, guint64 inherited)
 {
   xmlNode *cur_node;
   GstRepresentationNode *new_representation;
+  guint64 hash;
+
+  new_representation =
+      gst_mpdparser_find_reusable_node (reuse, a_node, inherited, 0, &hash);
+  if (new_representation) {
+    GST_LOG ("reusing unchanged Representation node");
+    g_atomic_int_inc (&new_representation->ref_count);
+    *list = g_list_append (*list, new_representation);
+    reuse->reused++;
+    return TRUE;
+  }
 
   new_representation = g_slice_new0 (GstRepresentationNode);
+  new_representation->ref_count = 1;
+  new_representation->hash = hash;
+  if (reuse)
+    reuse->parsed++;
 
   GST_LOG ("attributes of Representation node:");
   if (!gst_mpdparser_get_xml_prop_string_no_whitespace (a_node, "id",
@@ -1905,13 +2128,28 @@ error:
 
 static gboolean
 gst_mpdparser_parse_adaptation_set_node (GList ** list, xmlNode * a_node,
-    GstPeriodNode * parent)
+    GstPeriodNode * parent, GstMpdReuseContext * reuse, guint64 inherited)
 {
   xmlNode *cur_node;
   GstAdaptationSetNode *new_adap_set;
   gchar *actuate;
+  guint64 hash;
+
+  new_adap_set = gst_mpdparser_find_reusable_node (reuse, a_node, inherited,
+      parent->bitstreamSwitching, &hash);
+  if (new_adap_set) {
+    GST_LOG ("reusing unchanged AdaptationSet node");
+    g_atomic_int_inc (&new_adap_set->ref_count);
+    *list = g_list_append (*list, new_adap_set);
+    reuse->reused++;
+    return TRUE;
+  }
 
   new_adap_set = g_slice_new0 (GstAdaptationSetNode);
+  new_adap_set->ref_count = 1;
+  new_adap_set->hash = hash;
+  if (reuse)
+    reuse->parsed++;
 
   GST_LOG ("attributes of AdaptationSet node:");
 
@@ -2007,11 +2245,13 @@ gst_mpdparser_parse_adaptation_set_node (GList ** list, xmlNode * a_node,
    * has been parsed because certain Representation child elements can inherit
    * attributes specified by the same element in the AdaptationSet
    */
+  inherited = gst_mpdparser_get_inherited_hash (reuse, a_node, inherited);
   for (cur_node = a_node->children; cur_node; cur_node = cur_node->next) {
     if (cur_node->type == XML_ELEMENT_NODE) {
       if (xmlStrcmp (cur_node->name, (xmlChar *) "Representation") == 0) {
         if (!gst_mpdparser_parse_representation_node
-            (&new_adap_set->Representations, cur_node, new_adap_set, parent))
+            (&new_adap_set->Representations, cur_node, new_adap_set, parent,
+                reuse, inherited))
           goto error;
       }
     }
@@ -2091,13 +2331,29 @@ error:
 }
 
 static gboolean
-gst_mpdparser_parse_period_node (GList ** list, xmlNode * a_node)
+gst_mpdparser_parse_period_node (GList ** list, xmlNode * a_node,
+    GstMpdReuseContext * reuse)
 {
   xmlNode *cur_node;
   GstPeriodNode *new_period;
   gchar *actuate;
+  guint64 hash, inherited;
+
+  new_period = gst_mpdparser_find_reusable_node (reuse, a_node,
+      GST_MPD_HASH_INIT, 0, &hash);
+  if (new_period) {
+    GST_LOG ("reusing unchanged Period node");
+    g_atomic_int_inc (&new_period->ref_count);
+    *list = g_list_append (*list, new_period);
+    reuse->reused++;
+    return TRUE;
+  }
 
   new_period = g_slice_new0 (GstPeriodNode);
+  new_period->ref_count = 1;
+  new_period->hash = hash;
+  if (reuse)
+    reuse->parsed++;
 
   GST_LOG ("attributes of Period node:");
 
@@ -2145,11 +2401,14 @@ gst_mpdparser_parse_period_node (GList ** list, xmlNode * a_node)
    * parsed because certain AdaptationSet child elements can inherit attributes
    * specified by the same element in the Period
    */
+  inherited =
+      gst_mpdparser_get_inherited_hash (reuse, a_node, GST_MPD_HASH_INIT);
   for (cur_node = a_node->children; cur_node; cur_node = cur_node->next) {
     if (cur_node->type == XML_ELEMENT_NODE) {
       if (xmlStrcmp (cur_node->name, (xmlChar *) "AdaptationSet") == 0) {
         if (!gst_mpdparser_parse_adaptation_set_node
-            (&new_period->AdaptationSets, cur_node, new_period))
+            (&new_period->AdaptationSets, cur_node, new_period, reuse,
+                inherited))
           goto error;
       }
     }
@@ -2284,14 +2543,13 @@ gst_mpdparser_parse_utctiming_node (GList ** list, xmlNode * a_node)
   }
 }
 
-static gboolean
-gst_mpdparser_parse_root_node (GstMPDNode ** pointer, xmlNode * a_node)
+/* the children of the root node are parsed one after another, without
+ * keeping the nodes of the whole document */
+static GstMPDNode *
+gst_mpdparser_parse_root_node_attributes (xmlNode * a_node)
 {
-  xmlNode *cur_node;
   GstMPDNode *new_mpd;
 
-  gst_mpdparser_free_mpd_node (*pointer);
-  *pointer = NULL;
   new_mpd = g_slice_new0 (GstMPDNode);
 
   GST_LOG ("namespaces of root MPD node:");
@@ -2325,34 +2583,29 @@ gst_mpdparser_parse_root_node (GstMPDNode ** pointer, xmlNode * a_node)
   gst_mpdparser_get_xml_prop_duration (a_node, "maxSubsegmentDuration",
       GST_MPD_DURATION_NONE, &new_mpd->maxSubsegmentDuration);
 
-  /* explore children Period nodes */
-  for (cur_node = a_node->children; cur_node; cur_node = cur_node->next) {
-    if (cur_node->type == XML_ELEMENT_NODE) {
-      if (xmlStrcmp (cur_node->name, (xmlChar *) "Period") == 0) {
-        if (!gst_mpdparser_parse_period_node (&new_mpd->Periods, cur_node))
-          goto error;
-      } else if (xmlStrcmp (cur_node->name,
-              (xmlChar *) "ProgramInformation") == 0) {
-        gst_mpdparser_parse_program_info_node (&new_mpd->ProgramInfo, cur_node);
-      } else if (xmlStrcmp (cur_node->name, (xmlChar *) "BaseURL") == 0) {
-        gst_mpdparser_parse_baseURL_node (&new_mpd->BaseURLs, cur_node);
-      } else if (xmlStrcmp (cur_node->name, (xmlChar *) "Location") == 0) {
-        gst_mpdparser_parse_location_node (&new_mpd->Locations, cur_node);
-      } else if (xmlStrcmp (cur_node->name, (xmlChar *) "Metrics") == 0) {
-        gst_mpdparser_parse_metrics_node (&new_mpd->Metrics, cur_node);
-      } else if (xmlStrcmp (cur_node->name, (xmlChar *) "UTCTiming") == 0) {
-        gst_mpdparser_parse_utctiming_node (&new_mpd->UTCTiming, cur_node);
-      }
-    }
+  return new_mpd;
+}
+
+static gboolean
+gst_mpdparser_parse_root_child_node (GstMPDNode * new_mpd, xmlNode * cur_node,
+    GstMpdReuseContext * reuse)
+{
+  if (xmlStrcmp (cur_node->name, (xmlChar *) "Period") == 0) {
+    if (!gst_mpdparser_parse_period_node (&new_mpd->Periods, cur_node, reuse))
+      return FALSE;
+  } else if (xmlStrcmp (cur_node->name, (xmlChar *) "ProgramInformation") == 0) {
+    gst_mpdparser_parse_program_info_node (&new_mpd->ProgramInfo, cur_node);
+  } else if (xmlStrcmp (cur_node->name, (xmlChar *) "BaseURL") == 0) {
+    gst_mpdparser_parse_baseURL_node (&new_mpd->BaseURLs, cur_node);
+  } else if (xmlStrcmp (cur_node->name, (xmlChar *) "Location") == 0) {
+    gst_mpdparser_parse_location_node (&new_mpd->Locations, cur_node);
+  } else if (xmlStrcmp (cur_node->name, (xmlChar *) "Metrics") == 0) {
+    gst_mpdparser_parse_metrics_node (&new_mpd->Metrics, cur_node);
+  } else if (xmlStrcmp (cur_node->name, (xmlChar *) "UTCTiming") == 0) {
+    gst_mpdparser_parse_utctiming_node (&new_mpd->UTCTiming, cur_node);
   }
 
-  gst_mpdparser_free_mpd_node (*pointer);
-  *pointer = new_mpd;
   return TRUE;
-
-error:
-  gst_mpdparser_free_mpd_node (new_mpd);
-  return FALSE;
 }
 
 /* comparison functions */
@@ -2785,7 +3038,7 @@ gst_mpdparser_free_metrics_range_node (GstMetricsRangeNode * metrics_range_node)
 static void
 gst_mpdparser_free_period_node (GstPeriodNode * period_node)
 {
-  if (period_node) {
+  if (period_node && g_atomic_int_dec_and_test (&period_node->ref_count)) {
     if (period_node->id)
       xmlFree (period_node->id);
     gst_mpdparser_free_seg_base_type_ext (period_node->SegmentBase);
@@ -2868,7 +3121,8 @@ static void
 gst_mpdparser_free_adaptation_set_node (GstAdaptationSetNode *
     adaptation_set_node)
 {
-  if (adaptation_set_node) {
+  if (adaptation_set_node
+      && g_atomic_int_dec_and_test (&adaptation_set_node->ref_count)) {
     if (adaptation_set_node->lang)
       xmlFree (adaptation_set_node->lang);
     if (adaptation_set_node->contentType)
@@ -2908,7 +3162,8 @@ static void
 gst_mpdparser_free_representation_node (GstRepresentationNode *
     representation_node)
 {
-  if (representation_node) {
+  if (representation_node
+      && g_atomic_int_dec_and_test (&representation_node->ref_count)) {
     if (representation_node->id)
       xmlFree (representation_node->id);
     g_strfreev (representation_node->dependencyId);
@@ -3779,48 +4034,119 @@ gst_mpd_client_fetch_on_load_external_resources (GstMpdClient * client)
 
 gboolean
 gst_mpd_parse (GstMpdClient * client, const gchar * data, gint size)
+{
+  return gst_mpd_parse_update (client, NULL, data, size);
+}
+
+/* Parses an update of the MPD of @previous into @client. The Period,
+ * AdaptationSet and Representation nodes that did not change are shared
+ * with @previous instead of being parsed again */
+gboolean
+gst_mpd_parse_update (GstMpdClient * client, GstMpdClient * previous,
+    const gchar * data, gint size)
 {
   gboolean ret = FALSE;
 
+  g_return_val_if_fail (previous != client, FALSE);
+
   if (data) {
-    xmlDocPtr doc;
-    xmlNode *root_element = NULL;
+    xmlTextReaderPtr reader;
+    xmlNode *root_element;
+    GstMPDNode *new_mpd = NULL;
+    GstMpdReuseContext reuse = { NULL, 0, 0 };
+    gint res;
 
     GST_DEBUG ("MPD file fully buffered, start parsing...");
 
-    /* parse the complete MPD file into a tree (using the libxml2 default parser API) */
-
     /* this initialize the library and check potential ABI mismatches
      * between the version it was compiled for and the actual shared
      * library used
      */
     LIBXML_TEST_VERSION;
 
-    /* parse "data" into a document (which is a libxml2 tree structure xmlDoc) */
-    doc = xmlReadMemory (data, size, "noname.xml", NULL, XML_PARSE_NONET);
-    if (doc == NULL) {
+    /* read "data" with the libxml2 reader API. Only the subtree of one child
+     * of the root MPD node at a time is built, handed to the node parsers
+     * and freed again when skipping to the next one, so the nodes of large
+     * live MPDs are never all in memory at once */
+    reader = xmlReaderForMemory (data, size, "noname.xml", NULL,
+        XML_PARSE_NONET);
+    if (reader == NULL) {
       GST_ERROR ("failed to parse the MPD file");
-      ret = FALSE;
-    } else {
-      /* get the root element node */
-      root_element = xmlDocGetRootElement (doc);
-
-      if (root_element->type != XML_ELEMENT_NODE
-          || xmlStrcmp (root_element->name, (xmlChar *) "MPD") != 0) {
-        GST_ERROR
-            ("can not find the root element MPD, failed to parse the MPD file");
-        ret = FALSE;            /* used to return TRUE before, but this seems wrong */
-      } else {
-        /* now we can parse the MPD root node and all children nodes, recursively */
-        ret = gst_mpdparser_parse_root_node (&client->mpd_node, root_element);
+      return FALSE;
+    }
+
+    /* get the root element node */
+    while ((res = xmlTextReaderRead (reader)) == 1
+        && xmlTextReaderNodeType (reader) != XML_READER_TYPE_ELEMENT);
+
+    if (res != 1) {
+      GST_ERROR ("failed to parse the MPD file");
+      xmlFreeTextReader (reader);
+      return FALSE;
+    }
+
+    root_element = xmlTextReaderCurrentNode (reader);
+    if (xmlStrcmp (root_element->name, (xmlChar *) "MPD") != 0) {
+      GST_ERROR
+          ("can not find the root element MPD, failed to parse the MPD file");
+      xmlFreeTextReader (reader);
+      return FALSE;             /* used to return TRUE before, but this seems wrong */
+    }
+
+    gst_mpdparser_free_mpd_node (client->mpd_node);
+    client->mpd_node = NULL;
+
+    /* now we can parse the MPD root node and all children nodes, recursively */
+    new_mpd = gst_mpdparser_parse_root_node_attributes (root_element);
+    ret = TRUE;
+
+    /* only dynamic MPDs are updated, don't bother hashing static ones */
+    if (new_mpd->type == GST_MPD_FILE_TYPE_DYNAMIC) {
+      reuse.nodes = g_hash_table_new (g_int64_hash, g_int64_equal);
+      if (previous && previous->mpd_node)
+        gst_mpdparser_add_reusable_nodes (reuse.nodes, previous->mpd_node);
+    }
+
+    if (!xmlTextReaderIsEmptyElement (reader)) {
+      res = xmlTextReaderRead (reader);
+      while (res == 1 && xmlTextReaderDepth (reader) > 0) {
+        if (xmlTextReaderNodeType (reader) == XML_READER_TYPE_ELEMENT) {
+          xmlNode *cur_node = xmlTextReaderExpand (reader);
+
+          if (cur_node == NULL
+              || !gst_mpdparser_parse_root_child_node (new_mpd, cur_node,
+                  &reuse)) {
+            ret = FALSE;
+            break;
+          }
+        }
+        res = xmlTextReaderNext (reader);
       }
-      /* free the document */
-      xmlFreeDoc (doc);
     }
 
+    /* the rest of the document must still be well-formed */
+    while (ret && res == 1)
+      res = xmlTextReaderRead (reader);
+    if (res == -1) {
+      GST_ERROR ("failed to parse the MPD file");
+      ret = FALSE;
+    }
+
+    xmlFreeTextReader (reader);
+    if (reuse.nodes)
+      g_hash_table_unref (reuse.nodes);
+
     if (ret) {
+      GST_DEBUG ("parsed %u nodes, reused %u nodes of the previous MPD",
+          reuse.parsed, reuse.reused);
+      client->parsed_bytes = size;
+      client->parsed_nodes = reuse.parsed;
+      client->reused_nodes = reuse.reused;
+      client->mpd_node = new_mpd;
       gst_mpd_client_check_profiles (client);
       gst_mpd_client_fetch_on_load_external_resources (client);
+    } else {
+      gst_mpdparser_free_mpd_node (new_mpd);
     }
   }
 
@@ -4273,7 +4599,7 @@ gst_mpd_client_fetch_external_period (GstMpdClient * client,
     for (iter = root_element->children; iter; iter = iter->next) {
       if (iter->type == XML_ELEMENT_NODE) {
         if (xmlStrcmp (iter->name, (xmlChar *) "Period") == 0) {
-          gst_mpdparser_parse_period_node (&new_periods, iter);
+          gst_mpdparser_parse_period_node (&new_periods, iter, NULL);
         } else {
           goto error;
         }
@@ -4618,7 +4944,7 @@ gst_mpd_client_fetch_external_adaptation_set (GstMpdClient * client,
     }
 
     gst_mpdparser_parse_adaptation_set_node (&new_adapt_sets, root_element,
-        period);
+        period, NULL, 0);
   } else {
     goto error;
   }
@@ -4770,6 +5096,34 @@ gst_mpd_client_setup_streaming (GstMpdClient * client,
   return TRUE;
 }
 
+/* Returns the index of the first segment that ends after ts, or at ts if
+ * not forward, or the number of segments if there is none. The segments
+ * are sorted by time, each one standing for a run of repeats of the same
+ * duration, so only these runs are searched */
+static guint
+gst_mpdparser_find_segment (GstMpdClient * client, GPtrArray * segments,
+    GstClockTime ts, gboolean forward)
+{
+  guint lower = 0, upper = segments->len;
+
+  while (lower < upper) {
+    guint middle = lower + (upper - lower) / 2;
+    GstMediaSegment *segment = g_ptr_array_index (segments, middle);
+    GstClockTime end_time;
+
+    end_time =
+        gst_mpdparser_get_segment_end_time (client, segments, segment, middle);
+
+    /* avoid downloading another fragment just for 1ns in reverse mode */
+    if (forward ? ts < end_time : ts <= end_time)
+      upper = middle;
+    else
+      lower = middle + 1;
+  }
+
+  return lower;
+}
+
 gboolean
 gst_mpd_client_stream_seek (GstMpdClient * client, GstActiveStream * stream,
     gboolean forward, GstSeekFlags flags, GstClockTime ts,
@@ -4782,67 +5136,52 @@ gst_mpd_client_stream_seek (GstMpdClient * client, GstActiveStream * stream,
   g_return_val_if_fail (stream != NULL, 0);
 
   if (stream->segments) {
-    for (index = 0; index < stream->segments->len; index++) {
-      gboolean in_segment = FALSE;
+    index = gst_mpdparser_find_segment (client, stream->segments, ts, forward);
+    if (index < stream->segments->len) {
       GstMediaSegment *segment = g_ptr_array_index (stream->segments, index);
-      GstClockTime end_time;
+      GstClockTime chunk_time;
 
       GST_DEBUG ("Looking at fragment sequence chunk %d / %d", index,
           stream->segments->len);
 
-      end_time =
-          gst_mpdparser_get_segment_end_time (client, stream->segments,
-          segment, index);
-
-      /* avoid downloading another fragment just for 1ns in reverse mode */
-      if (forward)
-        in_segment = ts < end_time;
-      else
-        in_segment = ts <= end_time;
-
-      if (in_segment) {
-        GstClockTime chunk_time;
-
-        selectedChunk = segment;
-        repeat_index = (ts - segment->start) / segment->duration;
+      selectedChunk = segment;
+      repeat_index = (ts - segment->start) / segment->duration;
 
-        chunk_time = segment->start + segment->duration * repeat_index;
+      chunk_time = segment->start + segment->duration * repeat_index;
 
-        /* At the end of a segment in reverse mode, start from the previous fragment */
-        if (!forward && repeat_index > 0
-            && ((ts - segment->start) % segment->duration == 0))
-          repeat_index--;
+      /* At the end of a segment in reverse mode, start from the previous fragment */
+      if (!forward && repeat_index > 0
+          && ((ts - segment->start) % segment->duration == 0))
+        repeat_index--;
 
-        if ((flags & GST_SEEK_FLAG_SNAP_NEAREST) == GST_SEEK_FLAG_SNAP_NEAREST) {
-          if (repeat_index + 1 < segment->repeat) {
-            if (ts - chunk_time > chunk_time + segment->duration - ts)
-              repeat_index++;
-          } else if (index + 1 < stream->segments->len) {
-            GstMediaSegment *next_segment =
-                g_ptr_array_index (stream->segments, index + 1);
+      if ((flags & GST_SEEK_FLAG_SNAP_NEAREST) == GST_SEEK_FLAG_SNAP_NEAREST) {
+        if (repeat_index + 1 < segment->repeat) {
+          if (ts - chunk_time > chunk_time + segment->duration - ts)
+            repeat_index++;
+        } else if (index + 1 < stream->segments->len) {
+          GstMediaSegment *next_segment =
+              g_ptr_array_index (stream->segments, index + 1);
 
-            if (ts - chunk_time > next_segment->start - ts) {
-              repeat_index = 0;
-              selectedChunk = next_segment;
-              index++;
-            }
+          if (ts - chunk_time > next_segment->start - ts) {
+            repeat_index = 0;
+            selectedChunk = next_segment;
+            index++;
           }
-        } else if (((forward && flags & GST_SEEK_FLAG_SNAP_AFTER) ||
-                (!forward && flags & GST_SEEK_FLAG_SNAP_BEFORE)) &&
-            ts != chunk_time) {
+        }
+      } else if (((forward && flags & GST_SEEK_FLAG_SNAP_AFTER) ||
+              (!forward && flags & GST_SEEK_FLAG_SNAP_BEFORE)) &&
+          ts != chunk_time) {
 
-          if (repeat_index + 1 < segment->repeat) {
-            repeat_index++;
+        if (repeat_index + 1 < segment->repeat) {
+          repeat_index++;
+        } else {
+          repeat_index = 0;
+          if (index + 1 >= stream->segments->len) {
+            selectedChunk = NULL;
           } else {
-            repeat_index = 0;
-            if (index + 1 >= stream->segments->len) {
-              selectedChunk = NULL;
-            } else {
-              selectedChunk = g_ptr_array_index (stream->segments, ++index);
-            }
+            selectedChunk = g_ptr_array_index (stream->segments, ++index);
           }
         }
-        break;
       }
     }
 
@@ -272,6 +272,10 @@ struct _GstRepresentationNode
   GstSegmentTemplateNode *SegmentTemplate;
   /* SegmentList node */
   GstSegmentListNode *SegmentList;
+
+  /* shared with the previous MPD on updates if its hash is not 0 */
+  gint ref_count;
+  guint64 hash;
 };
 
 struct _GstDescriptorType
@@ -338,6 +342,10 @@ struct _GstAdaptationSetNode
 
   gchar *xlink_href;
   GstXLinkActuate actuate;
+
+  /* shared with the previous MPD on updates if its hash is not 0 */
+  gint ref_count;
+  guint64 hash;
 };
 
 struct _GstSubsetNode
@@ -367,6 +375,10 @@ struct _GstPeriodNode
 
   gchar *xlink_href;
   GstXLinkActuate actuate;
+
+  /* shared with the previous MPD on updates if its hash is not 0 */
+  gint ref_count;
+  guint64 hash;
 };
 
 struct _GstProgramInformationNode
@@ -520,6 +532,11 @@ struct _GstMpdClient
   gboolean profile_isoff_ondemand;
 
   GstUriDownloader * downloader;
+
+  /* statistics of the last parsed MPD */
+  guint64 parsed_bytes;                       /* size of the MPD file */
+  guint parsed_nodes;                         /* Period, AdaptationSet and Representation nodes parsed */
+  guint reused_nodes;                         /* nodes shared with the previous MPD instead */
 };
 
 /* Basic initialization/deinitialization functions */
@@ -532,6 +549,7 @@ void gst_mpd_client_set_uri_downloader (GstMpdClient * client, GstUriDownloader
 
 /* MPD file parsing */
 gboolean gst_mpd_parse (GstMpdClient *client, const gchar *data, gint size);
+gboolean gst_mpd_parse_update (GstMpdClient *client, GstMpdClient *previous, const gchar *data, gint size);
 
 /* Streaming management */
 gboolean gst_mpd_client_setup_media_presentation (GstMpdClient *client, GstClockTime time, gint period_index, const gchar *period_id);
@@ -107,6 +107,8 @@ static GstFlowReturn gst_hls_demux_advance_fragment (GstAdaptiveDemuxStream *
     stream);
 static GstFlowReturn gst_hls_demux_update_fragment_info (GstAdaptiveDemuxStream
     * stream);
+static gboolean gst_hls_demux_stream_peek_fragment (GstAdaptiveDemuxStream *
+    stream, guint n, GstAdaptiveDemuxStreamFragment * fragment);
 static gboolean gst_hls_demux_select_bitrate (GstAdaptiveDemuxStream * stream,
     guint64 bitrate);
 static void gst_hls_demux_reset (GstAdaptiveDemux * demux);
@@ -174,6 +176,8 @@ gst_hls_demux_class_init (GstHLSDemuxClass * klass)
   adaptivedemux_class->stream_advance_fragment = gst_hls_demux_advance_fragment;
   adaptivedemux_class->stream_update_fragment_info =
       gst_hls_demux_update_fragment_info;
+  adaptivedemux_class->stream_peek_fragment =
+      gst_hls_demux_stream_peek_fragment;
   adaptivedemux_class->stream_select_bitrate = gst_hls_demux_select_bitrate;
   adaptivedemux_class->stream_free = gst_hls_demux_stream_free;
 
@@ -401,15 +405,15 @@ gst_hls_demux_stream_seek (GstAdaptiveDemuxStream * stream, gboolean forward,
     GstSeekFlags flags, GstClockTime ts, GstClockTime * final_ts)
 {
   GstHLSDemuxStream *hls_stream = GST_HLS_DEMUX_STREAM_CAST (stream);
-  GList *walk;
+  GstM3U8 *playlist = hls_stream->playlist;
   GstClockTime current_pos;
   gint64 current_sequence;
   gboolean snap_after, snap_nearest;
   GstM3U8MediaFile *file = NULL;
+  guint i = 0;
 
   current_sequence = 0;
-  current_pos = gst_m3u8_is_live (hls_stream->playlist) ?
-      hls_stream->playlist->first_file_start : 0;
+  current_pos = gst_m3u8_is_live (playlist) ? playlist->first_file_start : 0;
 
   /* Snap to segment boundary. Improves seek performance on slow machines. */
   snap_nearest =
@@ -417,9 +421,23 @@ gst_hls_demux_stream_seek (GstAdaptiveDemuxStream * stream, gboolean forward,
   snap_after = ! !(flags & GST_SEEK_FLAG_SNAP_AFTER);
 
   GST_M3U8_CLIENT_LOCK (hlsdemux->client);
+  /* Start looking from the fragment before the one containing the target
+   * position, the snapping below might select that one */
+  if (playlist->files->len > 0 && ts > current_pos) {
+    GstM3U8MediaFile *first = g_ptr_array_index (playlist->files, 0);
+    gint idx;
+
+    idx = gst_m3u8_find_fragment_at (playlist, ts - current_pos);
+    if (idx == -1)
+      idx = playlist->files->len - 1;
+    i = MAX (idx, 1) - 1;
+    current_pos += GST_M3U8_MEDIA_FILE (g_ptr_array_index (playlist->files,
+            i))->start - first->start;
+  }
+
   /* FIXME: Here we need proper discont handling */
-  for (walk = hls_stream->playlist->files; walk; walk = walk->next) {
-    file = walk->data;
+  for (; i < playlist->files->len; i++) {
+    file = g_ptr_array_index (playlist->files, i);
 
     current_sequence = file->sequence;
     if ((forward && snap_after) || snap_nearest) {
@@ -441,7 +459,7 @@ gst_hls_demux_stream_seek (GstAdaptiveDemuxStream * stream, gboolean forward,
     current_pos += file->duration;
   }
 
-  if (walk == NULL) {
+  if (i == playlist->files->len) {
     GST_DEBUG_OBJECT (stream->pad, "seeking further than track duration");
     current_sequence++;
   }
@@ -449,9 +467,9 @@ gst_hls_demux_stream_seek (GstAdaptiveDemuxStream * stream, gboolean forward,
   GST_DEBUG_OBJECT (stream->pad, "seeking to sequence %u",
       (guint) current_sequence);
   hls_stream->reset_pts = TRUE;
-  hls_stream->playlist->sequence = current_sequence;
-  hls_stream->playlist->current_file = walk;
-  hls_stream->playlist->sequence_position = current_pos;
+  playlist->sequence = current_sequence;
+  playlist->current_file = i < playlist->files->len ? i : -1;
+  playlist->sequence_position = current_pos;
   GST_M3U8_CLIENT_UNLOCK (hlsdemux->client);
 
   /* Play from the end of the current selected segment */
@@ -1126,6 +1144,32 @@ gst_hls_demux_update_fragment_info (GstAdaptiveDemuxStream * stream)
   return GST_FLOW_OK;
 }
 
+static gboolean
+gst_hls_demux_stream_peek_fragment (GstAdaptiveDemuxStream * stream, guint n,
+    GstAdaptiveDemuxStreamFragment * fragment)
+{
+  GstM3U8MediaFile *file;
+  GstM3U8 *m3u8;
+
+  m3u8 = gst_hls_demux_stream_get_m3u8 (GST_HLS_DEMUX_STREAM_CAST (stream));
+
+  file = gst_m3u8_peek_fragment (m3u8, stream->demux->segment.rate > 0, n);
+  if (file == NULL)
+    return FALSE;
+
+  fragment->uri = g_strdup (file->uri);
+  fragment->range_start = file->offset;
+  if (file->size != -1)
+    fragment->range_end = file->offset + file->size - 1;
+  else
+    fragment->range_end = -1;
+  fragment->duration = file->duration;
+
+  gst_m3u8_media_file_unref (file);
+
+  return TRUE;
+}
+
 static gboolean
 gst_hls_demux_select_bitrate (GstAdaptiveDemuxStream * stream, guint64 bitrate)
 {
@@ -1493,10 +1537,10 @@ retry:
     gint64 last_sequence, first_sequence;
 
     GST_M3U8_CLIENT_LOCK (demux->client);
-    last_sequence =
-        GST_M3U8_MEDIA_FILE (g_list_last (m3u8->files)->data)->sequence;
+    last_sequence = GST_M3U8_MEDIA_FILE (g_ptr_array_index (m3u8->files,
+            m3u8->files->len - 1))->sequence;
     first_sequence =
-        GST_M3U8_MEDIA_FILE (g_list_first (m3u8->files)->data)->sequence;
+        GST_M3U8_MEDIA_FILE (g_ptr_array_index (m3u8->files, 0))->sequence;
 
     GST_DEBUG_OBJECT (demux,
         "sequence:%" G_GINT64_FORMAT " , first_sequence:%" G_GINT64_FORMAT
@@ -1514,7 +1558,7 @@ retry:
   } else if (!gst_m3u8_is_live (m3u8)) {
     GstClockTime current_pos, target_pos;
     guint sequence = 0;
-    GList *walk;
+    gint idx;
 
     /* Sequence numbers are not guaranteed to be the same in different
      * playlists, so get the correct fragment here based on the current
@@ -1538,19 +1582,24 @@ retry:
         GST_TIME_FORMAT " in updated playlist", GST_TIME_ARGS (target_pos));
 
     current_pos = 0;
-    for (walk = m3u8->files; walk; walk = walk->next) {
-      GstM3U8MediaFile *file = walk->data;
+    idx = gst_m3u8_find_fragment_at (m3u8, target_pos);
+    if (idx != -1) {
+      GstM3U8MediaFile *first = g_ptr_array_index (m3u8->files, 0);
+      GstM3U8MediaFile *file = g_ptr_array_index (m3u8->files, idx);
 
       sequence = file->sequence;
-      if (current_pos <= target_pos
-          && target_pos < current_pos + file->duration) {
-        break;
-      }
-      current_pos += file->duration;
+      current_pos = file->start - first->start;
+    } else if (m3u8->files->len > 0) {
+      GstM3U8MediaFile *first = g_ptr_array_index (m3u8->files, 0);
+      GstM3U8MediaFile *last =
+          g_ptr_array_index (m3u8->files, m3u8->files->len - 1);
+
+      /* End of playlist */
+      sequence = last->sequence + 1;
+      current_pos = last->start + last->duration - first->start;
+    } else {
+      sequence = 1;
     }
-    /* End of playlist */
-    if (!walk)
-      sequence++;
     m3u8->sequence = sequence;
     m3u8->sequence_position = current_pos;
     GST_M3U8_CLIENT_UNLOCK (demux->client);
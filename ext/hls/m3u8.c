@@ -42,7 +42,10 @@ gst_m3u8_new (void)
 
   m3u8 = g_new0 (GstM3U8, 1);
 
-  m3u8->current_file = NULL;
+  m3u8->files = g_ptr_array_new_with_free_func ((GDestroyNotify)
+      gst_m3u8_media_file_unref);
+  m3u8->current_file = -1;
+  m3u8->file_offsets = g_array_new (FALSE, FALSE, sizeof (gsize));
   m3u8->current_file_duration = GST_CLOCK_TIME_NONE;
   m3u8->sequence = -1;
   m3u8->sequence_position = 0;
@@ -61,6 +64,12 @@ gst_m3u8_take_uri (GstM3U8 * self, gchar * uri, gchar * base_uri, gchar * name)
 {
   g_return_if_fail (self != NULL);
 
+  /* the URIs of the media files are resolved against another base URI in
+   * the next update, so the previous ones can't be reused */
+  if (g_strcmp0 (self->base_uri ? self->base_uri : self->uri,
+          base_uri ? base_uri : uri) != 0)
+    self->files_end = 0;
+
   if (self->uri != uri) {
     g_free (self->uri);
     self->uri = uri;
@@ -104,8 +113,8 @@ gst_m3u8_unref (GstM3U8 * self)
     g_free (self->base_uri);
     g_free (self->name);
 
-    g_list_foreach (self->files, (GFunc) gst_m3u8_media_file_unref, NULL);
-    g_list_free (self->files);
+    g_ptr_array_unref (self->files);
+    g_array_unref (self->file_offsets);
 
     g_free (self->last_data);
     g_free (self);
@@ -308,9 +317,9 @@ gst_hls_variant_stream_compare_by_bitrate (gconstpointer a, gconstpointer b)
 
 static gboolean
 gst_m3u8_update_check_consistent_media_seqnums (GstM3U8 * self,
-    gboolean have_mediasequence, GList * previous_files)
+    gboolean have_mediasequence, GPtrArray * previous_files)
 {
-  if (!previous_files)
+  if (previous_files->len == 0)
     return TRUE;
 
   /* If we have MEDIA-SEQUENCE, ensure that it's consistent. If it is not,
@@ -321,17 +330,17 @@ gst_m3u8_update_check_consistent_media_seqnums (GstM3U8 * self,
    * playlist in relation to the old. That is, same URIs get the same number
    * and later URIs get higher numbers */
   if (have_mediasequence) {
-    GList *l, *m;
+    guint l, m = 0;
     GstM3U8MediaFile *f1 = NULL, *f2 = NULL;
 
     /* Find first case of higher/equal sequence number in new playlist or
      * same URI. From there on we can linearly step ahead */
-    for (l = self->files; l; l = l->next) {
+    for (l = 0; l < self->files->len; l++) {
       gboolean match = FALSE;
 
-      f1 = l->data;
-      for (m = previous_files; m; m = m->next) {
-        f2 = m->data;
+      f1 = g_ptr_array_index (self->files, l);
+      for (m = 0; m < previous_files->len; m++) {
+        f2 = g_ptr_array_index (previous_files, m);
 
         if (f1->sequence >= f2->sequence || g_str_equal (f1->uri, f2->uri)) {
           match = TRUE;
@@ -342,7 +351,7 @@ gst_m3u8_update_check_consistent_media_seqnums (GstM3U8 * self,
         break;
     }
 
-    if (!l) {
+    if (l == self->files->len) {
       /* No match, no sequence in the new playlist was higher than
        * any in the old, and no URI was found again. This is bad! */
       GST_ERROR ("Media sequences inconsistent, ignoring");
@@ -351,9 +360,9 @@ gst_m3u8_update_check_consistent_media_seqnums (GstM3U8 * self,
       g_assert (f1 != NULL);
       g_assert (f2 != NULL);
 
-      for (; l && m; l = l->next, m = m->next) {
-        f1 = l->data;
-        f2 = m->data;
+      for (; l < self->files->len && m < previous_files->len; l++, m++) {
+        f1 = g_ptr_array_index (self->files, l);
+        f2 = g_ptr_array_index (previous_files, m);
 
         if (f1->sequence == f2->sequence) {
           if (!g_str_equal (f1->uri, f2->uri)) {
@@ -382,16 +391,16 @@ gst_m3u8_update_check_consistent_media_seqnums (GstM3U8 * self,
       /* All good if we're getting here */
     }
   } else {
-    GList *l, *m;
+    guint l, m = 0;
     GstM3U8MediaFile *f1 = NULL, *f2 = NULL;
     gint64 mediasequence;
 
-    for (l = self->files; l; l = l->next) {
+    for (l = 0; l < self->files->len; l++) {
       gboolean match = FALSE;
 
-      f1 = l->data;
-      for (m = previous_files; m; m = m->next) {
-        f2 = m->data;
+      f1 = g_ptr_array_index (self->files, l);
+      for (m = 0; m < previous_files->len; m++) {
+        f2 = g_ptr_array_index (previous_files, m);
 
         if (g_str_equal (f1->uri, f2->uri)) {
           match = TRUE;
@@ -403,13 +412,13 @@ gst_m3u8_update_check_consistent_media_seqnums (GstM3U8 * self,
         break;
     }
 
-    if (!l) {
+    if (l == self->files->len) {
       /* No match, this means f2 is the last item in the previous playlist
        * and we have to start our new playlist at that sequence */
       mediasequence = f2->sequence + 1;
 
-      for (l = self->files; l; l = l->next) {
-        f1 = l->data;
+      for (l = 0; l < self->files->len; l++) {
+        f1 = g_ptr_array_index (self->files, l);
         f1->sequence = mediasequence;
         mediasequence++;
       }
@@ -419,9 +428,10 @@ gst_m3u8_update_check_consistent_media_seqnums (GstM3U8 * self,
 
       mediasequence = f2->sequence;
 
-      for (; l; l = l->next) {
-        f1 = l->data;
-        f2 = m ? m->data : NULL;
+      for (; l < self->files->len; l++) {
+        f1 = g_ptr_array_index (self->files, l);
+        f2 = m < previous_files->len ?
+            g_ptr_array_index (previous_files, m) : NULL;
 
         f1->sequence = mediasequence;
         mediasequence++;
@@ -432,8 +442,7 @@ gst_m3u8_update_check_consistent_media_seqnums (GstM3U8 * self,
           }
         }
 
-        if (m)
-          m = m->next;
+        m++;
       }
     }
   }
@@ -441,23 +450,269 @@ gst_m3u8_update_check_consistent_media_seqnums (GstM3U8 * self,
   return TRUE;
 }
 
+/* State of the media playlist parser between two lines */
+typedef struct
+{
+  GstClockTime duration;
+  gchar *title;
+  gboolean discontinuity;
+  gchar *current_key;
+  gboolean have_iv;
+  guint8 iv[16];
+  gint64 size, offset;
+  gint64 mediasequence;
+  gboolean have_mediasequence;
+} GstM3U8ParseState;
+
+/* call with M3U8_LOCK held.
+ * Parses one line of a media playlist, @end points to the end of @data.
+ * Returns %TRUE if the line was the URI of a new media file */
+static gboolean
+gst_m3u8_parse_line (GstM3U8 * self, GstM3U8ParseState * state, gchar * data,
+    gchar * end)
+{
+  gint val;
+
+  if (data[0] != '#' && data[0] != '\0') {
+    GstM3U8MediaFile *file, *prev;
+
+    if (state->duration <= 0) {
+      GST_LOG ("%s: got line without EXTINF, dropping", data);
+      return FALSE;
+    }
+
+    data = uri_join (self->base_uri ? self->base_uri : self->uri, data);
+    if (data == NULL)
+      return FALSE;
+
+    prev = self->files->len ?
+        g_ptr_array_index (self->files, self->files->len - 1) : NULL;
+
+    file = gst_m3u8_media_file_new (data, state->title, state->duration,
+        state->mediasequence++);
+    file->start = prev ? prev->start + prev->duration : 0;
+
+    /* set encryption params */
+    file->key = state->current_key ? g_strdup (state->current_key) : NULL;
+    if (file->key) {
+      if (state->have_iv) {
+        memcpy (file->iv, state->iv, sizeof (state->iv));
+      } else {
+        guint8 *iv = file->iv + 12;
+        GST_WRITE_UINT32_BE (iv, file->sequence);
+      }
+    }
+
+    if (state->size != -1) {
+      file->size = state->size;
+      if (state->offset != -1) {
+        file->offset = state->offset;
+      } else {
+        if (!prev) {
+          state->offset = 0;
+        } else {
+          state->offset = prev->offset + prev->size;
+        }
+        file->offset = state->offset;
+      }
+    } else {
+      file->size = -1;
+      file->offset = 0;
+    }
+
+    file->discont = state->discontinuity;
+
+    state->duration = 0;
+    state->title = NULL;
+    state->discontinuity = FALSE;
+    state->size = state->offset = -1;
+    g_ptr_array_add (self->files, file);
+
+    return TRUE;
+  } else if (g_str_has_prefix (data, "#EXTINF:")) {
+    gdouble fval;
+    if (!double_from_string (data + 8, &data, &fval)) {
+      GST_WARNING ("Can't read EXTINF duration");
+      return FALSE;
+    }
+    state->duration = fval * (gdouble) GST_SECOND;
+    if (self->targetduration > 0 && state->duration > self->targetduration) {
+      GST_WARNING ("EXTINF duration (%" GST_TIME_FORMAT
+          ") > TARGETDURATION (%" GST_TIME_FORMAT ")",
+          GST_TIME_ARGS (state->duration),
+          GST_TIME_ARGS (self->targetduration));
+    }
+    if (!data || *data != ',')
+      return FALSE;
+    data = g_utf8_next_char (data);
+    if (data != end) {
+      g_free (state->title);
+      state->title = g_strdup (data);
+    }
+  } else if (g_str_has_prefix (data, "#EXT-X-")) {
+    gchar *data_ext_x = data + 7;
+
+    /* All these entries start with #EXT-X- */
+    if (g_str_has_prefix (data_ext_x, "ENDLIST")) {
+      self->endlist = TRUE;
+    } else if (g_str_has_prefix (data_ext_x, "VERSION:")) {
+      if (int_from_string (data + 15, &data, &val))
+        self->version = val;
+    } else if (g_str_has_prefix (data_ext_x, "TARGETDURATION:")) {
+      if (int_from_string (data + 22, &data, &val))
+        self->targetduration = val * GST_SECOND;
+    } else if (g_str_has_prefix (data_ext_x, "MEDIA-SEQUENCE:")) {
+      if (int_from_string (data + 22, &data, &val)) {
+        state->mediasequence = val;
+        state->have_mediasequence = TRUE;
+      }
+    } else if (g_str_has_prefix (data_ext_x, "DISCONTINUITY-SEQUENCE:")) {
+      if (int_from_string (data + 30, &data, &val)
+          && val != self->discont_sequence) {
+        self->discont_sequence = val;
+        state->discontinuity = TRUE;
+      }
+    } else if (g_str_has_prefix (data_ext_x, "DISCONTINUITY")) {
+      self->discont_sequence++;
+      state->discontinuity = TRUE;
+    } else if (g_str_has_prefix (data_ext_x, "PROGRAM-DATE-TIME:")) {
+      /* <YYYY-MM-DDThh:mm:ssZ> */
+      GST_DEBUG ("FIXME parse date");
+    } else if (g_str_has_prefix (data_ext_x, "ALLOW-CACHE:")) {
+      self->allowcache = g_ascii_strcasecmp (data + 19, "YES") == 0;
+    } else if (g_str_has_prefix (data_ext_x, "KEY:")) {
+      gchar *v, *a;
+
+      data = data + 11;
+
+      /* IV and KEY are only valid until the next #EXT-X-KEY */
+      state->have_iv = FALSE;
+      g_free (state->current_key);
+      state->current_key = NULL;
+      while (data && parse_attributes (&data, &a, &v)) {
+        if (g_str_equal (a, "URI")) {
+          state->current_key =
+              uri_join (self->base_uri ? self->base_uri : self->uri, v);
+        } else if (g_str_equal (a, "IV")) {
+          gchar *ivp = v;
+          gint i;
+
+          if (strlen (ivp) < 32 + 2 || (!g_str_has_prefix (ivp, "0x")
+                  && !g_str_has_prefix (ivp, "0X"))) {
+            GST_WARNING ("Can't read IV");
+            continue;
+          }
+
+          ivp += 2;
+          for (i = 0; i < 16; i++) {
+            gint h, l;
+
+            h = g_ascii_xdigit_value (*ivp);
+            ivp++;
+            l = g_ascii_xdigit_value (*ivp);
+            ivp++;
+            if (h == -1 || l == -1) {
+              i = -1;
+              break;
+            }
+            state->iv[i] = (h << 4) | l;
+          }
+
+          if (i == -1) {
+            GST_WARNING ("Can't read IV");
+            continue;
+          }
+          state->have_iv = TRUE;
+        } else if (g_str_equal (a, "METHOD")) {
+          if (!g_str_equal (v, "AES-128")) {
+            GST_WARNING ("Encryption method %s not supported", v);
+            continue;
+          }
+        }
+      }
+    } else if (g_str_has_prefix (data_ext_x, "BYTERANGE:")) {
+      gchar *v = data + 17;
+
+      if (int64_from_string (v, &v, &state->size)) {
+        if (*v == '@' && !int64_from_string (v + 1, &v, &state->offset))
+          return FALSE;
+      } else {
+        return FALSE;
+      }
+    } else {
+      GST_LOG ("Ignored line: %s", data);
+    }
+  } else {
+    GST_LOG ("Ignored line: %s", data);
+  }
+
+  return FALSE;
+}
+
+/* The previous media files, kept during an update to reuse them */
+typedef struct
+{
+  GPtrArray *files;
+  GArray *file_offsets;
+  gchar *data;
+  gsize files_end;
+  gboolean have_iv;
+  guint8 iv[16];
+} GstM3U8Previous;
+
+static void
+gst_m3u8_previous_clear (GstM3U8Previous * previous)
+{
+  if (previous->files)
+    g_ptr_array_unref (previous->files);
+  if (previous->file_offsets)
+    g_array_unref (previous->file_offsets);
+  g_free (previous->data);
+}
+
+/* call with M3U8_LOCK held.
+ * If the text at @pos is the same as the lines of the previous playlist from
+ * the start of its media file @k to the end of its last media file, append
+ * these previous media files instead of parsing the lines again. Returns
+ * the position after the reused lines or %NULL */
+static const gchar *
+gst_m3u8_reuse_files (GstM3U8 * self, const GstM3U8Previous * previous,
+    guint k, const gchar * data, gsize data_len, const gchar * pos)
+{
+  gsize start, len, offset;
+  guint i;
+
+  start = g_array_index (previous->file_offsets, gsize, k);
+  len = previous->files_end - start;
+
+  if (data_len - (pos - data) < len
+      || memcmp (pos, previous->data + start, len) != 0)
+    return NULL;
+
+  for (i = k; i < previous->files->len; i++) {
+    offset = g_array_index (previous->file_offsets, gsize, i) - start +
+        (pos - data);
+    g_ptr_array_add (self->files,
+        gst_m3u8_media_file_ref (g_ptr_array_index (previous->files, i)));
+    g_array_append_val (self->file_offsets, offset);
+  }
+
+  return pos + len;
+}
+
 /*
  * @data: a m3u8 playlist text data, taking ownership
  */
 gboolean
 gst_m3u8_update (GstM3U8 * self, gchar * data)
 {
-  gint val;
-  GstClockTime duration;
-  gchar *title, *end;
-  gboolean discontinuity = FALSE;
-  gchar *current_key = NULL;
-  gboolean have_iv = FALSE;
-  guint8 iv[16] = { 0, };
-  gint64 size = -1, offset = -1;
-  gint64 mediasequence;
-  GList *previous_files = NULL;
-  gboolean have_mediasequence = FALSE;
+  GstM3U8ParseState state = { 0, };
+  GstM3U8Previous previous;
+  GString *line;
+  const gchar *pos, *first_line_end;
+  gsize data_len, chunk_start;
+  guint reused = 0, first_new = 0;
+  gboolean allowcache;
 
   g_return_val_if_fail (self != NULL, FALSE);
   g_return_val_if_fail (data != NULL, FALSE);
@@ -487,252 +742,186 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
 
   GST_TRACE ("data:\n%s", data);
 
-  g_free (self->last_data);
-  self->last_data = data;
+  /* the text is kept unmodified to find the lines of the next update that
+   * did not change, so each line is parsed from a copy */
+  previous.files = self->files;
+  previous.file_offsets = self->file_offsets;
+  previous.data = self->last_data;
+  previous.files_end = self->files_end;
+  previous.have_iv = self->last_have_iv;
+  memcpy (previous.iv, self->last_iv, sizeof (previous.iv));
 
-  self->current_file = NULL;
-  previous_files = self->files;
-  self->files = NULL;
+  self->last_data = data;
+  self->files = g_ptr_array_new_with_free_func ((GDestroyNotify)
+      gst_m3u8_media_file_unref);
+  self->file_offsets = g_array_new (FALSE, FALSE, sizeof (gsize));
+  self->files_end = 0;
+  self->current_file = -1;
   self->duration = GST_CLOCK_TIME_NONE;
-  mediasequence = 0;
 
   /* By default, allow caching */
+  allowcache = self->allowcache;
   self->allowcache = TRUE;
 
-  duration = 0;
-  title = NULL;
-  data += 7;
-  while (TRUE) {
-    gchar *r;
-
-    end = g_utf8_strchr (data, -1, '\n');
-    if (end)
-      *end = '\0';
-
-    r = g_utf8_strchr (data, -1, '\r');
-    if (r)
-      *r = '\0';
+  state.size = state.offset = -1;
+  line = g_string_sized_new (256);
+  data_len = strlen (data);
 
-    if (data[0] != '#' && data[0] != '\0') {
-      if (duration <= 0) {
-        GST_LOG ("%s: got line without EXTINF, dropping", data);
-        goto next_line;
-      }
+  /* the lines of each media file start after the URI of the previous one,
+   * the ones of the first media file after the #EXTM3U line */
+  first_line_end = strchr (data, '\n');
+  chunk_start = first_line_end ? first_line_end + 1 - data : data_len;
 
-      data = uri_join (self->base_uri ? self->base_uri : self->uri, data);
-      if (data != NULL) {
-        GstM3U8MediaFile *file;
-        file = gst_m3u8_media_file_new (data, title, duration, mediasequence++);
+  pos = data + 7;
+  while (pos) {
+    const gchar *end, *next;
+    gchar *r;
 
-        /* set encryption params */
-        file->key = current_key ? g_strdup (current_key) : NULL;
-        if (file->key) {
-          if (have_iv) {
-            memcpy (file->iv, iv, sizeof (iv));
-          } else {
-            guint8 *iv = file->iv + 12;
-            GST_WRITE_UINT32_BE (iv, file->sequence);
+    /* If the start of the playlist did not change, all previous media files
+     * can be reused up to the lines appended to it. If the window of a live
+     * playlist moved, the first media file is somewhere in the previous
+     * playlist and the ones after it can be reused if their lines did not
+     * change. The parser state must be the same as before these lines in
+     * the previous update, which is only known if there is a media
+     * sequence number to find them */
+    if (reused == 0 && previous.files_end > 0 && pos == data + chunk_start) {
+      const gchar *after = NULL;
+      guint n_parsed = self->files->len;
+
+      if (self->files->len == 0) {
+        if (chunk_start == g_array_index (previous.file_offsets, gsize, 0)
+            && memcmp (data, previous.data, chunk_start) == 0) {
+          after = gst_m3u8_reuse_files (self, &previous, 0, data, data_len,
+              pos);
+          if (after) {
+            /* the header of the playlist is part of the reused lines */
+            state.have_mediasequence = self->have_mediasequence;
+            self->allowcache = allowcache;
           }
         }
-
-        if (size != -1) {
-          file->size = size;
-          if (offset != -1) {
-            file->offset = offset;
-          } else {
-            GstM3U8MediaFile *prev = self->files ? self->files->data : NULL;
-
-            if (!prev) {
-              offset = 0;
-            } else {
-              offset = prev->offset + prev->size;
-            }
-            file->offset = offset;
+      } else if (self->files->len == 1 && state.have_mediasequence
+          && self->have_mediasequence) {
+        GstM3U8MediaFile *file, *prev;
+        gint64 k;
+
+        file = g_ptr_array_index (self->files, 0);
+        prev = g_ptr_array_index (previous.files, 0);
+        k = file->sequence + 1 - prev->sequence;
+
+        if (k >= 1 && k < previous.files->len) {
+          prev = g_ptr_array_index (previous.files, k - 1);
+          if (prev->sequence == file->sequence
+              && g_str_equal (prev->uri, file->uri)
+              && prev->duration == file->duration
+              && prev->offset == file->offset && prev->size == file->size
+              && g_strcmp0 (prev->key, file->key) == 0
+              && (!file->key || memcmp (prev->iv, file->iv, 16) == 0)) {
+            after = gst_m3u8_reuse_files (self, &previous, k, data, data_len,
+                pos);
+            if (after)
+              file->start = prev->start;
           }
-        } else {
-          file->size = -1;
-          file->offset = 0;
         }
+      }
 
-        file->discont = discontinuity;
+      if (after) {
+        GstM3U8MediaFile *last;
 
-        duration = 0;
-        title = NULL;
-        discontinuity = FALSE;
-        size = offset = -1;
-        self->files = g_list_prepend (self->files, file);
-      }
+        first_new = self->files->len;
+        reused = first_new - n_parsed;
+        last = g_ptr_array_index (self->files, self->files->len - 1);
 
-    } else if (g_str_has_prefix (data, "#EXTINF:")) {
-      gdouble fval;
-      if (!double_from_string (data + 8, &data, &fval)) {
-        GST_WARNING ("Can't read EXTINF duration");
-        goto next_line;
-      }
-      duration = fval * (gdouble) GST_SECOND;
-      if (self->targetduration > 0 && duration > self->targetduration) {
-        GST_WARNING ("EXTINF duration (%" GST_TIME_FORMAT
-            ") > TARGETDURATION (%" GST_TIME_FORMAT ")",
-            GST_TIME_ARGS (duration), GST_TIME_ARGS (self->targetduration));
-      }
-      if (!data || *data != ',')
-        goto next_line;
-      data = g_utf8_next_char (data);
-      if (data != end) {
-        g_free (title);
-        title = g_strdup (data);
+        /* continue with the state after the last reused media file */
+        state.mediasequence = last->sequence + 1;
+        g_free (state.current_key);
+        state.current_key = g_strdup (last->key);
+        state.have_iv = previous.have_iv;
+        memcpy (state.iv, previous.iv, sizeof (state.iv));
+        self->last_have_iv = state.have_iv;
+        memcpy (self->last_iv, state.iv, sizeof (state.iv));
+
+        chunk_start = self->files_end = after - data;
+        pos = after;
       }
-    } else if (g_str_has_prefix (data, "#EXT-X-")) {
-      gchar *data_ext_x = data + 7;
-
-      /* All these entries start with #EXT-X- */
-      if (g_str_has_prefix (data_ext_x, "ENDLIST")) {
-        self->endlist = TRUE;
-      } else if (g_str_has_prefix (data_ext_x, "VERSION:")) {
-        if (int_from_string (data + 15, &data, &val))
-          self->version = val;
-      } else if (g_str_has_prefix (data_ext_x, "TARGETDURATION:")) {
-        if (int_from_string (data + 22, &data, &val))
-          self->targetduration = val * GST_SECOND;
-      } else if (g_str_has_prefix (data_ext_x, "MEDIA-SEQUENCE:")) {
-        if (int_from_string (data + 22, &data, &val)) {
-          mediasequence = val;
-          have_mediasequence = TRUE;
-        }
-      } else if (g_str_has_prefix (data_ext_x, "DISCONTINUITY-SEQUENCE:")) {
-        if (int_from_string (data + 30, &data, &val)
-            && val != self->discont_sequence) {
-          self->discont_sequence = val;
-          discontinuity = TRUE;
-        }
-      } else if (g_str_has_prefix (data_ext_x, "DISCONTINUITY")) {
-        self->discont_sequence++;
-        discontinuity = TRUE;
-      } else if (g_str_has_prefix (data_ext_x, "PROGRAM-DATE-TIME:")) {
-        /* <YYYY-MM-DDThh:mm:ssZ> */
-        GST_DEBUG ("FIXME parse date");
-      } else if (g_str_has_prefix (data_ext_x, "ALLOW-CACHE:")) {
-        self->allowcache = g_ascii_strcasecmp (data + 19, "YES") == 0;
-      } else if (g_str_has_prefix (data_ext_x, "KEY:")) {
-        gchar *v, *a;
-
-        data = data + 11;
-
-        /* IV and KEY are only valid until the next #EXT-X-KEY */
-        have_iv = FALSE;
-        g_free (current_key);
-        current_key = NULL;
-        while (data && parse_attributes (&data, &a, &v)) {
-          if (g_str_equal (a, "URI")) {
-            current_key =
-                uri_join (self->base_uri ? self->base_uri : self->uri, v);
-          } else if (g_str_equal (a, "IV")) {
-            gchar *ivp = v;
-            gint i;
-
-            if (strlen (ivp) < 32 + 2 || (!g_str_has_prefix (ivp, "0x")
-                    && !g_str_has_prefix (ivp, "0X"))) {
-              GST_WARNING ("Can't read IV");
-              continue;
-            }
+    }
 
-            ivp += 2;
-            for (i = 0; i < 16; i++) {
-              gint h, l;
-
-              h = g_ascii_xdigit_value (*ivp);
-              ivp++;
-              l = g_ascii_xdigit_value (*ivp);
-              ivp++;
-              if (h == -1 || l == -1) {
-                i = -1;
-                break;
-              }
-              iv[i] = (h << 4) | l;
-            }
+    end = strchr (pos, '\n');
+    next = end ? end + 1 : NULL;
 
-            if (i == -1) {
-              GST_WARNING ("Can't read IV");
-              continue;
-            }
-            have_iv = TRUE;
-          } else if (g_str_equal (a, "METHOD")) {
-            if (!g_str_equal (v, "AES-128")) {
-              GST_WARNING ("Encryption method %s not supported", v);
-              continue;
-            }
-          }
-        }
-      } else if (g_str_has_prefix (data_ext_x, "BYTERANGE:")) {
-        gchar *v = data + 17;
+    g_string_truncate (line, 0);
+    g_string_append_len (line, pos, end ? end - pos : strlen (pos));
+    r = strchr (line->str, '\r');
+    if (r)
+      g_string_truncate (line, r - line->str);
 
-        if (int64_from_string (v, &v, &size)) {
-          if (*v == '@' && !int64_from_string (v + 1, &v, &offset))
-            goto next_line;
-        } else {
-          goto next_line;
-        }
-      } else {
-        GST_LOG ("Ignored line: %s", data);
-      }
-    } else {
-      GST_LOG ("Ignored line: %s", data);
+    if (gst_m3u8_parse_line (self, &state, line->str, line->str + line->len)) {
+      g_array_append_val (self->file_offsets, chunk_start);
+
+      /* the lines of the last media file can only be compared with the next
+       * update if its URI line is complete */
+      chunk_start = self->files_end = next ? next - data : 0;
+      self->last_have_iv = state.have_iv;
+      memcpy (self->last_iv, state.iv, sizeof (state.iv));
     }
 
-  next_line:
-    if (!end)
-      break;
-    data = g_utf8_next_char (end);      /* skip \n */
+    pos = next;
   }
 
-  g_free (current_key);
-  current_key = NULL;
+  g_string_free (line, TRUE);
+  g_free (state.title);
+  g_free (state.current_key);
 
-  self->files = g_list_reverse (self->files);
+  self->have_mediasequence = state.have_mediasequence;
 
-  if (previous_files) {
+  if (previous.files->len > 0 && reused == 0) {
     gboolean consistent = gst_m3u8_update_check_consistent_media_seqnums (self,
-        have_mediasequence, previous_files);
-
-    g_list_foreach (previous_files, (GFunc) gst_m3u8_media_file_unref, NULL);
-    g_list_free (previous_files);
-    previous_files = NULL;
+        state.have_mediasequence, previous.files);
 
     /* error was reported above already */
     if (!consistent) {
+      gst_m3u8_previous_clear (&previous);
+      self->files_end = 0;
       GST_M3U8_UNLOCK (self);
       return FALSE;
     }
   }
+  gst_m3u8_previous_clear (&previous);
 
-  if (self->files == NULL) {
+  if (self->files->len == 0) {
     GST_ERROR ("Invalid media playlist, it does not contain any media files");
+    self->files_end = 0;
     GST_M3U8_UNLOCK (self);
     return FALSE;
   }
 
-  /* calculate the start and end times of this media playlist. */
+  /* calculate the start and end times of this media playlist. The reused
+   * media files were already checked by the previous update */
   {
-    GList *walk;
-    GstM3U8MediaFile *file;
-    GstClockTime duration = 0;
+    GstM3U8MediaFile *file, *first, *last;
+    gint64 mediasequence;
+    guint i;
 
-    mediasequence = -1;
+    if (first_new > 0) {
+      file = g_ptr_array_index (self->files, first_new - 1);
+      mediasequence = file->sequence;
+    } else {
+      mediasequence = -1;
+    }
 
-    for (walk = self->files; walk; walk = walk->next) {
-      file = walk->data;
+    for (i = first_new; i < self->files->len; i++) {
+      file = g_ptr_array_index (self->files, i);
 
       if (mediasequence == -1) {
         mediasequence = file->sequence;
       } else if (mediasequence >= file->sequence) {
         GST_ERROR ("Non-increasing media sequence");
+        self->files_end = 0;
         GST_M3U8_UNLOCK (self);
         return FALSE;
       } else {
         mediasequence = file->sequence;
       }
 
-      duration += file->duration;
       if (file->sequence > self->highest_sequence_number) {
         if (self->highest_sequence_number >= 0) {
           /* if an update of the media playlist has been missed, there
@@ -748,86 +937,96 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
         self->highest_sequence_number = file->sequence;
       }
     }
+
+    first = g_ptr_array_index (self->files, 0);
+    last = g_ptr_array_index (self->files, self->files->len - 1);
+    self->duration = last->start + last->duration - first->start;
+
     if (GST_M3U8_IS_LIVE (self)) {
-      self->first_file_start = self->last_file_end - duration;
+      self->first_file_start = self->last_file_end - self->duration;
       GST_DEBUG ("Live playlist range %" GST_TIME_FORMAT " -> %"
           GST_TIME_FORMAT, GST_TIME_ARGS (self->first_file_start),
           GST_TIME_ARGS (self->last_file_end));
     }
-    self->duration = duration;
   }
 
   /* first-time setup */
-  if (self->files && self->sequence == -1) {
-    GList *file;
+  if (self->sequence == -1) {
+    GstM3U8MediaFile *file;
+    gint idx;
 
     if (GST_M3U8_IS_LIVE (self)) {
       gint i;
       GstClockTime sequence_pos = 0;
 
-      file = g_list_last (self->files);
+      idx = self->files->len - 1;
+      file = g_ptr_array_index (self->files, idx);
 
-      if (self->last_file_end >= GST_M3U8_MEDIA_FILE (file->data)->duration) {
-        sequence_pos =
-            self->last_file_end - GST_M3U8_MEDIA_FILE (file->data)->duration;
+      if (self->last_file_end >= file->duration) {
+        sequence_pos = self->last_file_end - file->duration;
       }
 
       /* for live streams, start GST_M3U8_LIVE_MIN_FRAGMENT_DISTANCE from
        * the end of the playlist. See section 6.3.3 of HLS draft */
-      for (i = 0; i < GST_M3U8_LIVE_MIN_FRAGMENT_DISTANCE && file->prev &&
-          GST_M3U8_MEDIA_FILE (file->prev->data)->duration <= sequence_pos;
-          ++i) {
-        file = file->prev;
-        sequence_pos -= GST_M3U8_MEDIA_FILE (file->data)->duration;
+      for (i = 0; i < GST_M3U8_LIVE_MIN_FRAGMENT_DISTANCE && idx > 0 &&
+          GST_M3U8_MEDIA_FILE (g_ptr_array_index (self->files,
+                  idx - 1))->duration <= sequence_pos; ++i) {
+        idx--;
+        file = g_ptr_array_index (self->files, idx);
+        sequence_pos -= file->duration;
       }
       self->sequence_position = sequence_pos;
     } else {
-      file = g_list_first (self->files);
+      idx = 0;
+      file = g_ptr_array_index (self->files, idx);
       self->sequence_position = 0;
     }
-    self->current_file = file;
-    self->sequence = GST_M3U8_MEDIA_FILE (file->data)->sequence;
+    self->current_file = idx;
+    self->sequence = file->sequence;
     GST_DEBUG ("first sequence: %u", (guint) self->sequence);
   }
 
-  GST_LOG ("processed media playlist %s, %u fragments", self->name,
-      g_list_length (self->files));
+  GST_LOG ("processed media playlist %s, %u fragments, %u reused",
+      self->name, self->files->len, reused);
 
   GST_M3U8_UNLOCK (self);
 
   return TRUE;
 }
 
+/* call with M3U8_LOCK held.
+ * Returns the index of the first media file with a sequence number not lower
+ * than @sequence, or the number of media files if there is none */
+static guint
+m3u8_lower_bound (GstM3U8 * m3u8, gint64 sequence)
+{
+  guint low = 0, high = m3u8->files->len, mid;
+
+  while (low < high) {
+    mid = low + (high - low) / 2;
+    if (GST_M3U8_MEDIA_FILE (g_ptr_array_index (m3u8->files,
+                mid))->sequence < sequence)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+
+  return low;
+}
+
 /* call with M3U8_LOCK held */
-static GList *
+static gint
 m3u8_find_next_fragment (GstM3U8 * m3u8, gboolean forward)
 {
-  GstM3U8MediaFile *file;
-  GList *l = m3u8->files;
+  guint idx;
 
   if (forward) {
-    while (l) {
-      file = l->data;
-
-      if (file->sequence >= m3u8->sequence)
-        break;
-
-      l = l->next;
-    }
+    idx = m3u8_lower_bound (m3u8, m3u8->sequence);
+    return idx < m3u8->files->len ? idx : -1;
   } else {
-    l = g_list_last (l);
-
-    while (l) {
-      file = l->data;
-
-      if (file->sequence <= m3u8->sequence)
-        break;
-
-      l = l->prev;
-    }
+    idx = m3u8_lower_bound (m3u8, m3u8->sequence + 1);
+    return (gint) idx - 1;
   }
-
-  return l;
 }
 
 GstM3U8MediaFile *
@@ -845,13 +1044,14 @@ gst_m3u8_get_next_fragment (GstM3U8 * m3u8, gboolean forward,
   if (m3u8->sequence < 0)       /* can't happen really */
     goto out;
 
-  if (m3u8->current_file == NULL)
+  if (m3u8->current_file == -1)
     m3u8->current_file = m3u8_find_next_fragment (m3u8, forward);
 
-  if (m3u8->current_file == NULL)
+  if (m3u8->current_file == -1)
     goto out;
 
-  file = gst_m3u8_media_file_ref (m3u8->current_file->data);
+  file = gst_m3u8_media_file_ref (g_ptr_array_index (m3u8->files,
+          m3u8->current_file));
 
   GST_DEBUG ("Got fragment with sequence %u (current sequence %u)",
       (guint) file->sequence, (guint) m3u8->sequence);
@@ -871,11 +1071,39 @@ out:
   return file;
 }
 
+/* Returns the fragment @n positions after the current one in the playback
+ * direction, without changing the current fragment */
+GstM3U8MediaFile *
+gst_m3u8_peek_fragment (GstM3U8 * m3u8, gboolean forward, guint n)
+{
+  GstM3U8MediaFile *file = NULL;
+  gint64 idx;
+
+  g_return_val_if_fail (m3u8 != NULL, NULL);
+
+  GST_M3U8_LOCK (m3u8);
+
+  if (m3u8->current_file != -1)
+    idx = m3u8->current_file;
+  else
+    idx = m3u8_find_next_fragment (m3u8, forward);
+
+  if (idx != -1) {
+    idx += forward ? (gint64) n : -(gint64) n;
+    if (idx >= 0 && idx < m3u8->files->len)
+      file = gst_m3u8_media_file_ref (g_ptr_array_index (m3u8->files, idx));
+  }
+
+  GST_M3U8_UNLOCK (m3u8);
+
+  return file;
+}
+
 gboolean
 gst_m3u8_has_next_fragment (GstM3U8 * m3u8, gboolean forward)
 {
   gboolean have_next;
-  GList *cur;
+  gint cur;
 
   g_return_val_if_fail (m3u8 != NULL, FALSE);
 
@@ -884,13 +1112,14 @@ gst_m3u8_has_next_fragment (GstM3U8 * m3u8, gboolean forward)
   GST_DEBUG ("Checking next fragment %" G_GINT64_FORMAT,
       m3u8->sequence + (forward ? 1 : -1));
 
-  if (m3u8->current_file) {
+  if (m3u8->current_file != -1) {
     cur = m3u8->current_file;
   } else {
     cur = m3u8_find_next_fragment (m3u8, forward);
   }
 
-  have_next = cur && ((forward && cur->next) || (!forward && cur->prev));
+  have_next = cur != -1 && ((forward && cur + 1 < m3u8->files->len)
+      || (!forward && cur > 0));
 
   GST_M3U8_UNLOCK (m3u8);
 
@@ -902,8 +1131,8 @@ static void
 m3u8_alternate_advance (GstM3U8 * m3u8, gboolean forward)
 {
   gint targetnum = m3u8->sequence;
-  GList *tmp;
-  GstM3U8MediaFile *mf;
+  GstM3U8MediaFile *mf = NULL;
+  guint idx;
 
   /* figure out the target seqnum */
   if (forward)
@@ -911,18 +1140,16 @@ m3u8_alternate_advance (GstM3U8 * m3u8, gboolean forward)
   else
     targetnum -= 1;
 
-  for (tmp = m3u8->files; tmp; tmp = tmp->next) {
-    mf = (GstM3U8MediaFile *) tmp->data;
-    if (mf->sequence == targetnum)
-      break;
-  }
-  if (tmp == NULL) {
+  idx = m3u8_lower_bound (m3u8, targetnum);
+  if (idx < m3u8->files->len)
+    mf = g_ptr_array_index (m3u8->files, idx);
+  if (mf == NULL || mf->sequence != targetnum) {
     GST_WARNING ("Can't find next fragment");
     return;
   }
-  m3u8->current_file = tmp;
+  m3u8->current_file = idx;
   m3u8->sequence = targetnum;
-  m3u8->current_file_duration = GST_M3U8_MEDIA_FILE (tmp->data)->duration;
+  m3u8->current_file_duration = mf->duration;
 }
 
 void
@@ -948,30 +1175,31 @@ gst_m3u8_advance_fragment (GstM3U8 * m3u8, gboolean forward)
     GST_DEBUG ("Sequence position now %" GST_TIME_FORMAT,
         GST_TIME_ARGS (m3u8->sequence_position));
   }
-  if (!m3u8->current_file) {
-    GList *l;
+  if (m3u8->current_file == -1) {
+    guint idx;
 
     GST_DEBUG ("Looking for fragment %" G_GINT64_FORMAT, m3u8->sequence);
-    for (l = m3u8->files; l != NULL; l = l->next) {
-      if (GST_M3U8_MEDIA_FILE (l->data)->sequence == m3u8->sequence) {
-        m3u8->current_file = l;
-        break;
-      }
-    }
-    if (m3u8->current_file == NULL) {
+    idx = m3u8_lower_bound (m3u8, m3u8->sequence);
+    if (idx < m3u8->files->len
+        && GST_M3U8_MEDIA_FILE (g_ptr_array_index (m3u8->files,
+                idx))->sequence == m3u8->sequence)
+      m3u8->current_file = idx;
+
+    if (m3u8->current_file == -1) {
       GST_DEBUG
           ("Could not find current fragment, trying next fragment directly");
       m3u8_alternate_advance (m3u8, forward);
 
       /* Resync sequence number if the above has failed for live streams */
-      if (m3u8->current_file == NULL && GST_M3U8_IS_LIVE (m3u8)) {
+      if (m3u8->current_file == -1 && GST_M3U8_IS_LIVE (m3u8)
+          && m3u8->files->len > 0) {
         /* for live streams, start GST_M3U8_LIVE_MIN_FRAGMENT_DISTANCE from
            the end of the playlist. See section 6.3.3 of HLS draft */
-        gint pos =
-            g_list_length (m3u8->files) - GST_M3U8_LIVE_MIN_FRAGMENT_DISTANCE;
-        m3u8->current_file = g_list_nth (m3u8->files, pos >= 0 ? pos : 0);
+        gint pos = m3u8->files->len - GST_M3U8_LIVE_MIN_FRAGMENT_DISTANCE;
+        m3u8->current_file = pos >= 0 ? pos : 0;
         m3u8->current_file_duration =
-            GST_M3U8_MEDIA_FILE (m3u8->current_file->data)->duration;
+            GST_M3U8_MEDIA_FILE (g_ptr_array_index (m3u8->files,
+                m3u8->current_file))->duration;
 
         GST_WARNING ("Resyncing live playlist");
       }
@@ -979,28 +1207,33 @@ gst_m3u8_advance_fragment (GstM3U8 * m3u8, gboolean forward)
     }
   }
 
-  file = GST_M3U8_MEDIA_FILE (m3u8->current_file->data);
+  file = g_ptr_array_index (m3u8->files, m3u8->current_file);
   GST_DEBUG ("Advancing from sequence %u", (guint) file->sequence);
   if (forward) {
-    m3u8->current_file = m3u8->current_file->next;
-    if (m3u8->current_file) {
-      m3u8->sequence = GST_M3U8_MEDIA_FILE (m3u8->current_file->data)->sequence;
+    if (m3u8->current_file + 1 < m3u8->files->len) {
+      m3u8->current_file++;
+      m3u8->sequence = GST_M3U8_MEDIA_FILE (g_ptr_array_index (m3u8->files,
+              m3u8->current_file))->sequence;
     } else {
+      m3u8->current_file = -1;
       m3u8->sequence = file->sequence + 1;
     }
   } else {
-    m3u8->current_file = m3u8->current_file->prev;
-    if (m3u8->current_file) {
-      m3u8->sequence = GST_M3U8_MEDIA_FILE (m3u8->current_file->data)->sequence;
+    if (m3u8->current_file > 0) {
+      m3u8->current_file--;
+      m3u8->sequence = GST_M3U8_MEDIA_FILE (g_ptr_array_index (m3u8->files,
+              m3u8->current_file))->sequence;
     } else {
+      m3u8->current_file = -1;
       m3u8->sequence = file->sequence - 1;
     }
   }
-  if (m3u8->current_file) {
+  if (m3u8->current_file != -1) {
     /* Store duration of the fragment we're using to update the position 
      * the next time we advance */
     m3u8->current_file_duration =
-        GST_M3U8_MEDIA_FILE (m3u8->current_file->data)->duration;
+        GST_M3U8_MEDIA_FILE (g_ptr_array_index (m3u8->files,
+            m3u8->current_file))->duration;
   }
 
 out:
@@ -1008,6 +1241,48 @@ out:
   GST_M3U8_UNLOCK (m3u8);
 }
 
+/* Returns the index of the media file that contains @position, counted from
+ * the start of the first media file, or -1 if @position is after the end of
+ * the last one */
+gint
+gst_m3u8_find_fragment_at (GstM3U8 * m3u8, GstClockTime position)
+{
+  GstM3U8MediaFile *first, *file;
+  guint low, high, mid;
+  gint idx = -1;
+
+  g_return_val_if_fail (m3u8 != NULL, -1);
+
+  GST_M3U8_LOCK (m3u8);
+
+  if (m3u8->files->len == 0)
+    goto out;
+
+  first = g_ptr_array_index (m3u8->files, 0);
+  position += first->start;
+
+  /* find the last media file that starts before @position */
+  low = 0;
+  high = m3u8->files->len;
+  while (high - low > 1) {
+    mid = low + (high - low) / 2;
+    file = g_ptr_array_index (m3u8->files, mid);
+    if (file->start <= position)
+      low = mid;
+    else
+      high = mid;
+  }
+
+  file = g_ptr_array_index (m3u8->files, low);
+  if (position < file->start + file->duration)
+    idx = low;
+
+out:
+  GST_M3U8_UNLOCK (m3u8);
+
+  return idx;
+}
+
 GstClockTime
 gst_m3u8_get_duration (GstM3U8 * m3u8)
 {
@@ -1021,12 +1296,12 @@ gst_m3u8_get_duration (GstM3U8 * m3u8)
   if (!m3u8->endlist)
     goto out;
 
-  if (!GST_CLOCK_TIME_IS_VALID (m3u8->duration) && m3u8->files != NULL) {
-    GList *f;
+  if (!GST_CLOCK_TIME_IS_VALID (m3u8->duration) && m3u8->files->len > 0) {
+    GstM3U8MediaFile *first, *last;
 
-    m3u8->duration = 0;
-    for (f = m3u8->files; f != NULL; f = f->next)
-      m3u8->duration += GST_M3U8_MEDIA_FILE (f)->duration;
+    first = g_ptr_array_index (m3u8->files, 0);
+    last = g_ptr_array_index (m3u8->files, m3u8->files->len - 1);
+    m3u8->duration = last->start + last->duration - first->start;
   }
   duration = m3u8->duration;
 
@@ -1137,31 +1412,26 @@ gboolean
 gst_m3u8_get_seek_range (GstM3U8 * m3u8, gint64 * start, gint64 * stop)
 {
   GstClockTime duration = 0;
-  GList *walk;
-  GstM3U8MediaFile *file;
-  guint count;
+  GstM3U8MediaFile *first, *last;
   guint min_distance = 0;
 
   g_return_val_if_fail (m3u8 != NULL, FALSE);
 
   GST_M3U8_LOCK (m3u8);
 
-  if (m3u8->files == NULL)
-    goto out;
-
   if (GST_M3U8_IS_LIVE (m3u8)) {
     /* min_distance is used to make sure the seek range is never closer than
        GST_M3U8_LIVE_MIN_FRAGMENT_DISTANCE fragments from the end of a live
        playlist - see 6.3.3. "Playing the Playlist file" of the HLS draft */
     min_distance = GST_M3U8_LIVE_MIN_FRAGMENT_DISTANCE;
   }
-  count = g_list_length (m3u8->files);
 
-  for (walk = m3u8->files; walk && count > min_distance; walk = walk->next) {
-    file = walk->data;
-    --count;
-    duration += file->duration;
-  }
+  if (m3u8->files->len <= min_distance)
+    goto out;
+
+  first = g_ptr_array_index (m3u8->files, 0);
+  last = g_ptr_array_index (m3u8->files, m3u8->files->len - min_distance - 1);
+  duration = last->start + last->duration - first->start;
 
   if (duration <= 0)
     goto out;
@@ -63,10 +63,10 @@ struct _GstM3U8
   GstClockTime targetduration;  /* last EXT-X-TARGETDURATION */
   gboolean allowcache;          /* last EXT-X-ALLOWCACHE */
 
-  GList *files;
+  GPtrArray *files;             /* GstM3U8MediaFile, by sequence */
 
   /* state */
-  GList *current_file;
+  gint current_file;                  /* index in files or -1 */
   GstClockTime current_file_duration; /* Duration of current fragment */
   gint64 sequence;                    /* the next sequence for this client */
   GstClockTime sequence_position;     /* position of this sequence */
@@ -78,6 +78,11 @@ struct _GstM3U8
 
   /*< private > */
   gchar *last_data;
+  GArray *file_offsets;         /* start of the lines of each file in last_data */
+  gsize files_end;              /* end of the last URI line in last_data or 0 */
+  gboolean have_mediasequence;
+  gboolean last_have_iv;        /* EXT-X-KEY IV state after the last file */
+  guint8 last_iv[16];
   GMutex lock;
 
   gint ref_count;               /* ATOMIC */
@@ -98,6 +103,7 @@ struct _GstM3U8MediaFile
   gchar *key;
   guint8 iv[16];
   gint64 offset, size;
+  GstClockTime start;           /* start relative to earlier files of the playlist */
   gint ref_count;               /* ATOMIC */
 };
 
@@ -120,12 +126,19 @@ GstM3U8MediaFile * gst_m3u8_get_next_fragment    (GstM3U8      * m3u8,
                                                   GstClockTime * sequence_position,
                                                   gboolean     * discont);
 
+GstM3U8MediaFile * gst_m3u8_peek_fragment        (GstM3U8 * m3u8,
+                                                  gboolean  forward,
+                                                  guint     n);
+
 gboolean           gst_m3u8_has_next_fragment    (GstM3U8 * m3u8,
                                                   gboolean  forward);
 
 void               gst_m3u8_advance_fragment     (GstM3U8 * m3u8,
                                                   gboolean  forward);
 
+gint               gst_m3u8_find_fragment_at     (GstM3U8      * m3u8,
+                                                  GstClockTime   position);
+
 GstClockTime       gst_m3u8_get_duration         (GstM3U8 * m3u8);
 
 GstClockTime       gst_m3u8_get_target_duration  (GstM3U8 * m3u8);
@@ -136,6 +136,9 @@ GST_DEBUG_CATEGORY (adaptivedemux_debug);
 #define DEFAULT_BITRATE_LIMIT 0.8f
 #define SRC_QUEUE_MAX_BYTES 20 * 1024 * 1024    /* For safety. Large enough to hold a segment. */
 #define NUM_LOOKBACK_FRAGMENTS 3
+#define DEFAULT_PREFETCH_FRAGMENTS 0
+#define DEFAULT_MAX_PREFETCH_BYTES (32 * 1024 * 1024)
+#define MAX_PREFETCH_FRAGMENTS 16
 
 #define GST_MANIFEST_GET_LOCK(d) (&(GST_ADAPTIVE_DEMUX_CAST(d)->priv->manifest_lock))
 #define GST_MANIFEST_LOCK(d) G_STMT_START { \
@@ -162,6 +165,8 @@ enum
   PROP_0,
   PROP_CONNECTION_SPEED,
   PROP_BITRATE_LIMIT,
+  PROP_PREFETCH_FRAGMENTS,
+  PROP_MAX_PREFETCH_BYTES,
   PROP_LAST
 };
 
@@ -210,8 +215,48 @@ struct _GstAdaptiveDemuxPrivate
    * without needing to stop tasks when they just want to
    * update the segment boundaries */
   GMutex segment_lock;
+
+  /* Properties, protected by manifest_lock */
+  guint prefetch_fragments;
+  guint max_prefetch_bytes;
+
+  /* Downloads of the next fragments, see
+   * gst_adaptive_demux_stream_prefetch() */
+  GThreadPool *prefetch_pool;   /* protected by manifest_lock */
+  GMutex prefetch_lock;
+  GCond prefetch_cond;
+  GSList *idle_downloaders;     /* protected by prefetch_lock */
+  guint64 prefetch_bytes;       /* protected by prefetch_lock */
 };
 
+typedef enum
+{
+  PREFETCH_PENDING,
+  PREFETCH_RUNNING,
+  PREFETCH_DONE,
+  PREFETCH_FAILED,
+  PREFETCH_CANCELLED
+} GstAdaptiveDemuxPrefetchState;
+
+/* A fragment downloaded ahead of time. It is owned by the prefetch queue of
+ * its stream and by the prefetch thread downloading it. */
+typedef struct _GstAdaptiveDemuxPrefetch
+{
+  volatile gint ref_count;
+
+  gchar *uri;
+  gchar *referer;
+  gint64 range_start;
+  gint64 range_end;
+
+  /* protected by prefetch_lock */
+  GstAdaptiveDemuxPrefetchState state;
+  GstUriDownloader *downloader;
+  GstBuffer *buffer;
+  GstClockTime request_time;
+  GstClockTime finish_time;
+} GstAdaptiveDemuxPrefetch;
+
 typedef struct _GstAdaptiveDemuxTimer
 {
   volatile gint ref_count;
@@ -295,6 +340,8 @@ gst_adaptive_demux_stream_data_received_default (GstAdaptiveDemux * demux,
 static GstFlowReturn
 gst_adaptive_demux_stream_finish_fragment_default (GstAdaptiveDemux * demux,
     GstAdaptiveDemuxStream * stream);
+static void gst_adaptive_demux_stream_clear_prefetch (GstAdaptiveDemuxStream *
+    stream);
 static GstFlowReturn
 gst_adaptive_demux_stream_advance_fragment_unlocked (GstAdaptiveDemux * demux,
     GstAdaptiveDemuxStream * stream, GstClockTime duration);
@@ -353,6 +400,12 @@ gst_adaptive_demux_set_property (GObject * object, guint prop_id,
     case PROP_BITRATE_LIMIT:
       demux->bitrate_limit = g_value_get_float (value);
       break;
+    case PROP_PREFETCH_FRAGMENTS:
+      demux->priv->prefetch_fragments = g_value_get_uint (value);
+      break;
+    case PROP_MAX_PREFETCH_BYTES:
+      demux->priv->max_prefetch_bytes = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -377,6 +430,12 @@ gst_adaptive_demux_get_property (GObject * object, guint prop_id,
     case PROP_BITRATE_LIMIT:
       g_value_set_float (value, demux->bitrate_limit);
       break;
+    case PROP_PREFETCH_FRAGMENTS:
+      g_value_set_uint (value, demux->priv->prefetch_fragments);
+      break;
+    case PROP_MAX_PREFETCH_BYTES:
+      g_value_set_uint (value, demux->priv->max_prefetch_bytes);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -420,6 +479,20 @@ gst_adaptive_demux_class_init (GstAdaptiveDemuxClass * klass)
           0, 1, DEFAULT_BITRATE_LIMIT,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_PREFETCH_FRAGMENTS,
+      g_param_spec_uint ("prefetch-fragments", "Prefetch fragments",
+          "Number of fragments after the current one to download "
+          "concurrently ahead of time (0 = disabled)",
+          0, MAX_PREFETCH_FRAGMENTS, DEFAULT_PREFETCH_FRAGMENTS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_MAX_PREFETCH_BYTES,
+      g_param_spec_uint ("max-prefetch-bytes", "Max prefetch bytes",
+          "Maximum amount of prefetched data kept in memory, no new "
+          "fragments are requested above it",
+          0, G_MAXUINT, DEFAULT_MAX_PREFETCH_BYTES,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gstelement_class->change_state = gst_adaptive_demux_change_state;
 
   gstbin_class->handle_message = gst_adaptive_demux_handle_message;
@@ -499,6 +572,9 @@ gst_adaptive_demux_init (GstAdaptiveDemux * demux,
   g_cond_init (&demux->priv->preroll_cond);
   g_mutex_init (&demux->priv->preroll_lock);
 
+  g_cond_init (&demux->priv->prefetch_cond);
+  g_mutex_init (&demux->priv->prefetch_lock);
+
   pad_template =
       gst_element_class_get_pad_template (GST_ELEMENT_CLASS (klass), "sink");
   g_return_if_fail (pad_template != NULL);
@@ -512,6 +588,8 @@ gst_adaptive_demux_init (GstAdaptiveDemux * demux,
   /* Properties */
   demux->bitrate_limit = DEFAULT_BITRATE_LIMIT;
   demux->connection_speed = DEFAULT_CONNECTION_SPEED;
+  demux->priv->prefetch_fragments = DEFAULT_PREFETCH_FRAGMENTS;
+  demux->priv->max_prefetch_bytes = DEFAULT_MAX_PREFETCH_BYTES;
 
   gst_element_add_pad (GST_ELEMENT (demux), demux->sinkpad);
 }
@@ -544,6 +622,13 @@ gst_adaptive_demux_finalize (GObject * object)
   g_cond_clear (&demux->priv->preroll_cond);
   g_mutex_clear (&demux->priv->preroll_lock);
 
+  /* all the streams were freed, so any remaining job was cancelled */
+  if (priv->prefetch_pool)
+    g_thread_pool_free (priv->prefetch_pool, FALSE, TRUE);
+  g_slist_free_full (priv->idle_downloaders, g_object_unref);
+  g_cond_clear (&priv->prefetch_cond);
+  g_mutex_clear (&priv->prefetch_lock);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -1312,6 +1397,7 @@ gst_adaptive_demux_stream_new (GstAdaptiveDemux * demux, GstPad * pad)
   gst_segment_init (&stream->segment, GST_FORMAT_TIME);
   g_cond_init (&stream->fragment_download_cond);
   g_mutex_init (&stream->fragment_download_lock);
+  g_queue_init (&stream->prefetch);
 
   demux->next_streams = g_list_append (demux->next_streams, stream);
 
@@ -1377,6 +1463,7 @@ gst_adaptive_demux_stream_free (GstAdaptiveDemuxStream * stream)
   }
 
   gst_adaptive_demux_stream_fragment_clear (&stream->fragment);
+  gst_adaptive_demux_stream_clear_prefetch (stream);
 
   if (stream->pending_segment) {
     gst_event_unref (stream->pending_segment);
@@ -1950,6 +2037,8 @@ gst_adaptive_demux_stop_tasks (GstAdaptiveDemux * demux)
     gst_task_stop (stream->download_task);
     g_cond_signal (&stream->fragment_download_cond);
     g_mutex_unlock (&stream->fragment_download_lock);
+
+    gst_adaptive_demux_stream_clear_prefetch (stream);
   }
 
   g_mutex_lock (&demux->priv->preroll_lock);
@@ -2359,18 +2448,15 @@ gst_adaptive_demux_requires_periodical_playlist_update_default (GstAdaptiveDemux
   return TRUE;
 }
 
+/* Passes the downloaded data to the subclass, either from the source element
+ * of the stream or from the prefetch cache */
 static GstFlowReturn
-_src_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+gst_adaptive_demux_stream_push_data (GstAdaptiveDemux * demux,
+    GstAdaptiveDemuxStream * stream, GstBuffer * buffer)
 {
-  GstAdaptiveDemuxStream *stream;
-  GstAdaptiveDemux *demux;
-  GstAdaptiveDemuxClass *klass;
+  GstAdaptiveDemuxClass *klass = GST_ADAPTIVE_DEMUX_GET_CLASS (demux);
   GstFlowReturn ret = GST_FLOW_OK;
 
-  demux = GST_ADAPTIVE_DEMUX_CAST (parent);
-  stream = gst_pad_get_element_private (pad);
-  klass = GST_ADAPTIVE_DEMUX_GET_CLASS (demux);
-
   GST_MANIFEST_LOCK (demux);
 
   /* do not make any changes if the stream is cancelled */
@@ -2507,6 +2593,13 @@ error:
   return ret;
 }
 
+static GstFlowReturn
+_src_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  return gst_adaptive_demux_stream_push_data (GST_ADAPTIVE_DEMUX_CAST (parent),
+      gst_pad_get_element_private (pad), buffer);
+}
+
 /* must be called with manifest_lock taken */
 static void
 gst_adaptive_demux_stream_fragment_download_finish (GstAdaptiveDemuxStream *
@@ -3121,6 +3214,328 @@ gst_adaptive_demux_stream_download_header_fragment (GstAdaptiveDemuxStream *
   return ret;
 }
 
+/* must be called with manifest_lock taken, the manifest uri is copied as
+ * the referer for the prefetch pool threads */
+static GstAdaptiveDemuxPrefetch *
+gst_adaptive_demux_prefetch_new (GstAdaptiveDemux * demux, const gchar * uri,
+    gint64 range_start, gint64 range_end)
+{
+  GstAdaptiveDemuxPrefetch *prefetch = g_slice_new0 (GstAdaptiveDemuxPrefetch);
+
+  prefetch->ref_count = 1;
+  prefetch->uri = g_strdup (uri);
+  prefetch->referer = g_strdup (demux->manifest_uri);
+  prefetch->range_start = range_start;
+  prefetch->range_end = range_end;
+  prefetch->state = PREFETCH_PENDING;
+  prefetch->request_time = GST_CLOCK_TIME_NONE;
+  prefetch->finish_time = GST_CLOCK_TIME_NONE;
+
+  return prefetch;
+}
+
+static GstAdaptiveDemuxPrefetch *
+gst_adaptive_demux_prefetch_ref (GstAdaptiveDemuxPrefetch * prefetch)
+{
+  g_atomic_int_inc (&prefetch->ref_count);
+  return prefetch;
+}
+
+static void
+gst_adaptive_demux_prefetch_unref (GstAdaptiveDemuxPrefetch * prefetch)
+{
+  if (g_atomic_int_dec_and_test (&prefetch->ref_count)) {
+    g_free (prefetch->uri);
+    g_free (prefetch->referer);
+    if (prefetch->buffer)
+      gst_buffer_unref (prefetch->buffer);
+    g_slice_free (GstAdaptiveDemuxPrefetch, prefetch);
+  }
+}
+
+/* Runs in the threads of the prefetch pool. The prefetch downloads use their
+ * own GstUriDownloader, they are kept around in the idle list between the
+ * downloads to reuse the connections of the source elements */
+static void
+gst_adaptive_demux_prefetch_func (gpointer data, gpointer user_data)
+{
+  GstAdaptiveDemuxPrefetch *prefetch = data;
+  GstAdaptiveDemux *demux = user_data;
+  GstAdaptiveDemuxPrivate *priv = demux->priv;
+  GstUriDownloader *downloader;
+  GstFragment *download;
+  GError *err = NULL;
+
+  g_mutex_lock (&priv->prefetch_lock);
+  if (prefetch->state == PREFETCH_CANCELLED) {
+    g_mutex_unlock (&priv->prefetch_lock);
+    gst_adaptive_demux_prefetch_unref (prefetch);
+    return;
+  }
+
+  if (priv->idle_downloaders) {
+    downloader = priv->idle_downloaders->data;
+    priv->idle_downloaders =
+        g_slist_delete_link (priv->idle_downloaders, priv->idle_downloaders);
+  } else {
+    downloader = gst_uri_downloader_new ();
+    gst_uri_downloader_set_parent (downloader, GST_ELEMENT_CAST (demux));
+  }
+  prefetch->downloader = downloader;
+  prefetch->state = PREFETCH_RUNNING;
+  prefetch->request_time = gst_adaptive_demux_get_monotonic_time (demux);
+  g_mutex_unlock (&priv->prefetch_lock);
+
+  GST_DEBUG_OBJECT (demux, "Prefetching %s range %" G_GINT64_FORMAT " - %"
+      G_GINT64_FORMAT, prefetch->uri, prefetch->range_start,
+      prefetch->range_end);
+
+  download = gst_uri_downloader_fetch_uri_with_range (downloader,
+      prefetch->uri, prefetch->referer, FALSE, FALSE, TRUE,
+      prefetch->range_start, prefetch->range_end, &err);
+
+  g_mutex_lock (&priv->prefetch_lock);
+  prefetch->downloader = NULL;
+  gst_uri_downloader_reset (downloader);
+  priv->idle_downloaders = g_slist_prepend (priv->idle_downloaders, downloader);
+
+  prefetch->finish_time = gst_adaptive_demux_get_monotonic_time (demux);
+  if (prefetch->state == PREFETCH_CANCELLED) {
+    GST_DEBUG_OBJECT (demux, "Prefetch of %s cancelled", prefetch->uri);
+  } else if (download == NULL) {
+    GST_INFO_OBJECT (demux, "Failed to prefetch %s: %s", prefetch->uri,
+        err ? err->message : "unknown error");
+    prefetch->state = PREFETCH_FAILED;
+  } else {
+    prefetch->buffer = gst_fragment_get_buffer (download);
+    if (prefetch->buffer) {
+      priv->prefetch_bytes += gst_buffer_get_size (prefetch->buffer);
+      prefetch->state = PREFETCH_DONE;
+    } else {
+      prefetch->state = PREFETCH_FAILED;
+    }
+  }
+  g_cond_broadcast (&priv->prefetch_cond);
+  g_mutex_unlock (&priv->prefetch_lock);
+
+  if (download)
+    g_object_unref (download);
+  g_clear_error (&err);
+  gst_adaptive_demux_prefetch_unref (prefetch);
+}
+
+/* must be called with manifest_lock taken.
+ * Cancels the prefetch downloads of @stream and drops the data downloaded so
+ * far, the fragments will be downloaded again when needed */
+static void
+gst_adaptive_demux_stream_clear_prefetch (GstAdaptiveDemuxStream * stream)
+{
+  GstAdaptiveDemuxPrivate *priv = stream->demux->priv;
+  GstAdaptiveDemuxPrefetch *prefetch;
+
+  if (g_queue_is_empty (&stream->prefetch))
+    return;
+
+  g_mutex_lock (&priv->prefetch_lock);
+  while ((prefetch = g_queue_pop_head (&stream->prefetch))) {
+    if (prefetch->state == PREFETCH_RUNNING && prefetch->downloader)
+      gst_uri_downloader_cancel (prefetch->downloader);
+    if (prefetch->buffer) {
+      priv->prefetch_bytes -= gst_buffer_get_size (prefetch->buffer);
+      gst_buffer_unref (prefetch->buffer);
+      prefetch->buffer = NULL;
+    }
+    prefetch->state = PREFETCH_CANCELLED;
+    gst_adaptive_demux_prefetch_unref (prefetch);
+  }
+  g_cond_broadcast (&priv->prefetch_cond);
+  g_mutex_unlock (&priv->prefetch_lock);
+}
+
+/* must be called with manifest_lock taken.
+ * Requests the fragments following the current one, up to the
+ * prefetch-fragments property and as long as the data already prefetched
+ * stays below max-prefetch-bytes. The head of the prefetch queue is the
+ * current fragment if it was prefetched, so the queue holds the fragments
+ * 0 to length - 1 positions after the current one */
+static void
+gst_adaptive_demux_stream_prefetch (GstAdaptiveDemuxStream * stream)
+{
+  GstAdaptiveDemux *demux = stream->demux;
+  GstAdaptiveDemuxClass *klass = GST_ADAPTIVE_DEMUX_GET_CLASS (demux);
+  GstAdaptiveDemuxPrivate *priv = demux->priv;
+  guint n;
+
+  if (priv->prefetch_fragments == 0 || !klass->stream_peek_fragment)
+    return;
+
+  if (!priv->prefetch_pool) {
+    priv->prefetch_pool = g_thread_pool_new (gst_adaptive_demux_prefetch_func,
+        demux, priv->prefetch_fragments, FALSE, NULL);
+  } else if (g_thread_pool_get_max_threads (priv->prefetch_pool) !=
+      (gint) priv->prefetch_fragments) {
+    g_thread_pool_set_max_threads (priv->prefetch_pool,
+        priv->prefetch_fragments, NULL);
+  }
+
+  for (n = MAX (g_queue_get_length (&stream->prefetch), 1);
+      n <= priv->prefetch_fragments; n++) {
+    GstAdaptiveDemuxStreamFragment fragment = { 0, };
+    GstAdaptiveDemuxPrefetch *prefetch;
+    gboolean full;
+
+    g_mutex_lock (&priv->prefetch_lock);
+    full = priv->prefetch_bytes >= priv->max_prefetch_bytes;
+    g_mutex_unlock (&priv->prefetch_lock);
+    if (full) {
+      GST_LOG_OBJECT (stream->pad, "Prefetch cache full");
+      break;
+    }
+
+    fragment.range_end = -1;
+    if (!klass->stream_peek_fragment (stream, n, &fragment)
+        || fragment.uri == NULL) {
+      gst_adaptive_demux_stream_fragment_clear (&fragment);
+      break;
+    }
+
+    GST_DEBUG_OBJECT (stream->pad, "Prefetching fragment %u: %s", n,
+        fragment.uri);
+
+    prefetch = gst_adaptive_demux_prefetch_new (demux, fragment.uri,
+        fragment.range_start, fragment.range_end);
+    g_queue_push_tail (&stream->prefetch, prefetch);
+    g_thread_pool_push (priv->prefetch_pool,
+        gst_adaptive_demux_prefetch_ref (prefetch), NULL);
+
+    gst_adaptive_demux_stream_fragment_clear (&fragment);
+  }
+}
+
+/* must be called with manifest_lock taken.
+ * Returns the prefetch of the current fragment of @stream, if any. After a
+ * seek or a bitrate switch, the prefetched fragments don't follow the
+ * current one anymore and are dropped */
+static GstAdaptiveDemuxPrefetch *
+gst_adaptive_demux_stream_take_prefetch (GstAdaptiveDemuxStream * stream)
+{
+  GstAdaptiveDemuxPrefetch *prefetch = g_queue_peek_head (&stream->prefetch);
+
+  if (prefetch == NULL)
+    return NULL;
+
+  if (g_strcmp0 (prefetch->uri, stream->fragment.uri) == 0
+      && prefetch->range_start == stream->fragment.range_start
+      && prefetch->range_end == stream->fragment.range_end)
+    return gst_adaptive_demux_prefetch_ref (prefetch);
+
+  GST_DEBUG_OBJECT (stream->pad, "Dropping %u prefetched fragments",
+      g_queue_get_length (&stream->prefetch));
+  gst_adaptive_demux_stream_clear_prefetch (stream);
+
+  return NULL;
+}
+
+/* must be called with manifest_lock taken.
+ * Can temporarily release manifest_lock.
+ * Waits for the prefetch of the current fragment and pushes its data to the
+ * subclass like if the source element of the stream had downloaded it */
+static GstFlowReturn
+gst_adaptive_demux_stream_download_prefetched (GstAdaptiveDemux * demux,
+    GstAdaptiveDemuxStream * stream, GstAdaptiveDemuxPrefetch * prefetch)
+{
+  GstAdaptiveDemuxPrivate *priv = demux->priv;
+  GstClockTime wait_start, start;
+  GstBuffer *buffer;
+  GstFlowReturn ret;
+  gboolean failed;
+
+  wait_start = gst_adaptive_demux_get_monotonic_time (demux);
+
+  GST_MANIFEST_UNLOCK (demux);
+  g_mutex_lock (&priv->prefetch_lock);
+  while (prefetch->state == PREFETCH_PENDING
+      || prefetch->state == PREFETCH_RUNNING)
+    g_cond_wait (&priv->prefetch_cond, &priv->prefetch_lock);
+  g_mutex_unlock (&priv->prefetch_lock);
+  GST_MANIFEST_LOCK (demux);
+
+  g_mutex_lock (&stream->fragment_download_lock);
+  if (G_UNLIKELY (stream->cancelled)) {
+    g_mutex_unlock (&stream->fragment_download_lock);
+    return stream->last_ret = GST_FLOW_FLUSHING;
+  }
+  g_mutex_unlock (&stream->fragment_download_lock);
+
+  /* a seek could have replaced the queue while the lock was released */
+  if (g_queue_peek_head (&stream->prefetch) != prefetch)
+    return gst_adaptive_demux_stream_download_uri (demux, stream,
+        stream->fragment.uri, stream->fragment.range_start,
+        stream->fragment.range_end, NULL);
+
+  g_queue_pop_head (&stream->prefetch);
+  gst_adaptive_demux_prefetch_unref (prefetch);
+
+  g_mutex_lock (&priv->prefetch_lock);
+  buffer = prefetch->buffer;
+  prefetch->buffer = NULL;
+  if (buffer)
+    priv->prefetch_bytes -= gst_buffer_get_size (buffer);
+  failed = prefetch->state != PREFETCH_DONE;
+  g_mutex_unlock (&priv->prefetch_lock);
+
+  if (failed) {
+    GST_DEBUG_OBJECT (stream->pad, "Prefetch failed, downloading %s again",
+        stream->fragment.uri);
+    return gst_adaptive_demux_stream_download_uri (demux, stream,
+        stream->fragment.uri, stream->fragment.range_start,
+        stream->fragment.range_end, NULL);
+  }
+
+  GST_DEBUG_OBJECT (stream->pad, "Using prefetched %s, %" G_GSIZE_FORMAT
+      " bytes", stream->fragment.uri, gst_buffer_get_size (buffer));
+
+  /* The prefetches of a stream are running in parallel, so the time between
+   * request and completion of each overlaps with the others. Only count the
+   * time since the previous fragment was completed to not overestimate the
+   * bandwidth, what the bitrate selection sees is the rate at which the
+   * fragments can be downloaded one after the other. The downloads can
+   * finish in any order, a fragment finished before the previous one is
+   * counted from its own request */
+  start = MAX (prefetch->request_time, stream->prefetch_last_finish);
+  if (start > prefetch->finish_time)
+    start = prefetch->request_time;
+  stream->prefetch_last_finish =
+      MAX (stream->prefetch_last_finish, prefetch->finish_time);
+
+  stream->fragment_prefetched = TRUE;
+  stream->fragment_bytes_downloaded = gst_buffer_get_size (buffer);
+  stream->last_latency = gst_adaptive_demux_get_monotonic_time (demux) -
+      wait_start;
+  stream->last_download_time = MAX (prefetch->finish_time - start, 1);
+  stream->last_bitrate = gst_util_uint64_scale (gst_buffer_get_size (buffer),
+      8 * GST_SECOND, stream->last_download_time);
+  stream->download_start_time = GST_TIME_AS_USECONDS (start);
+
+  if (stream->fragment.bitrate == 0 && stream->fragment.duration != 0)
+    stream->fragment.bitrate = MIN (G_MAXUINT,
+        gst_util_uint64_scale (gst_buffer_get_size (buffer), 8 * GST_SECOND,
+            stream->fragment.duration));
+
+  g_mutex_lock (&stream->fragment_download_lock);
+  stream->download_finished = FALSE;
+  stream->downloading_first_buffer = TRUE;
+  g_mutex_unlock (&stream->fragment_download_lock);
+
+  ret = gst_adaptive_demux_stream_push_data (demux, stream, buffer);
+
+  /* the source element would push EOS after the data */
+  if (ret != GST_FLOW_FLUSHING)
+    gst_adaptive_demux_eos_handling (stream);
+
+  return stream->last_ret;
+}
+
 /* must be called with manifest_lock taken.
  * Can temporarily release manifest_lock
  */
@@ -3138,6 +3553,7 @@ gst_adaptive_demux_stream_download_fragment (GstAdaptiveDemuxStream * stream)
   stream->starting_fragment = TRUE;
   stream->last_ret = GST_FLOW_OK;
   stream->first_fragment_buffer = TRUE;
+  stream->fragment_prefetched = FALSE;
 
   if (stream->fragment.uri == NULL && stream->fragment.header_uri == NULL &&
       stream->fragment.index_uri == NULL)
@@ -3230,9 +3646,26 @@ again:
         chunk_end = MIN (chunk_end, range_end);
     }
   } else {
-    ret =
-        gst_adaptive_demux_stream_download_uri (demux, stream, url,
-        stream->fragment.range_start, stream->fragment.range_end, &http_status);
+    GstAdaptiveDemuxPrefetch *prefetch = NULL;
+
+    /* a retry always goes through the source element */
+    if (!retried_once) {
+      prefetch = gst_adaptive_demux_stream_take_prefetch (stream);
+      gst_adaptive_demux_stream_prefetch (stream);
+    }
+
+    if (prefetch) {
+      ret = gst_adaptive_demux_stream_download_prefetched (demux, stream,
+          prefetch);
+      gst_adaptive_demux_prefetch_unref (prefetch);
+      if (ret != GST_FLOW_OK)
+        http_status = stream->last_status_code;
+    } else {
+      ret =
+          gst_adaptive_demux_stream_download_uri (demux, stream, url,
+          stream->fragment.range_start, stream->fragment.range_end,
+          &http_status);
+    }
     GST_DEBUG_OBJECT (stream->pad, "Fragment download result: %d (%d) %s",
         stream->last_ret, http_status, gst_flow_get_name (stream->last_ret));
   }
@@ -3952,7 +4385,10 @@ gst_adaptive_demux_stream_advance_fragment_unlocked (GstAdaptiveDemux * demux,
               "fragment-stop-time", GST_TYPE_CLOCK_TIME,
               gst_util_get_timestamp (), "fragment-size", G_TYPE_UINT64,
               stream->download_total_bytes, "fragment-download-time",
-              GST_TYPE_CLOCK_TIME, stream->last_download_time, NULL)));
+              GST_TYPE_CLOCK_TIME, stream->last_download_time,
+              "fragment-latency", GST_TYPE_CLOCK_TIME, stream->last_latency,
+              "fragment-prefetched", G_TYPE_BOOLEAN,
+              stream->fragment_prefetched, NULL)));
 
   /* Don't update to the end of the segment if in reverse playback */
   GST_ADAPTIVE_DEMUX_SEGMENT_LOCK (demux);
@@ -187,6 +187,13 @@ struct _GstAdaptiveDemuxStream
   gboolean eos;
 
   gboolean do_block; /* TRUE if stream should block on preroll */
+
+  /* fragments requested ahead of the current one, the head of the queue is
+   * the fragment being downloaded if it was prefetched. Protected by the
+   * manifest_lock */
+  GQueue prefetch;
+  GstClockTime prefetch_last_finish;
+  gboolean fragment_prefetched;
 };
 
 /**
@@ -474,6 +481,21 @@ struct _GstAdaptiveDemuxClass
    * Return: %TRUE if the playlist needs to be refreshed periodically by the demuxer.
    */
   gboolean (*requires_periodical_playlist_update) (GstAdaptiveDemux * demux);
+
+  /**
+   * stream_peek_fragment:
+   * @stream: #GstAdaptiveDemuxStream
+   * @n: the position of the fragment after the current one, 1 for the next
+   * @fragment: the #GstAdaptiveDemuxStreamFragment to fill
+   *
+   * Optional. Sets the uri and range of the fragment @n positions after the
+   * current one in @fragment, without changing the current fragment. This
+   * allows the base class to download the next fragments ahead of time when
+   * the prefetch-fragments property is set.
+   *
+   * Returns: #TRUE if the fragment is known
+   */
+  gboolean      (*stream_peek_fragment) (GstAdaptiveDemuxStream * stream, guint n, GstAdaptiveDemuxStreamFragment * fragment);
 };
 
 GType    gst_adaptive_demux_get_type (void);
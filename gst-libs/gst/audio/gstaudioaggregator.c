@@ -160,6 +160,10 @@ struct _GstAudioAggregatorPrivate
   /* Readable with object lock, writable with both aag lock and object lock */
 
   gint64 offset;                /* Sample offset starting from 0 at segment.start */
+
+  /* Inputs of the current output buffer to pass to aggregate_buffers,
+   * protected by the aagg lock */
+  GArray *inputs;
 };
 
 #define GST_AUDIO_AGGREGATOR_LOCK(self)   g_mutex_lock (&(self)->priv->mutex);
@@ -295,6 +299,9 @@ gst_audio_aggregator_init (GstAudioAggregator * aagg)
   aagg->current_caps = NULL;
   gst_audio_info_init (&aagg->info);
 
+  aagg->priv->inputs = g_array_new (FALSE, FALSE,
+      sizeof (GstAudioAggregatorInput));
+
   gst_aggregator_set_latency (GST_AGGREGATOR (aagg),
       aagg->priv->output_buffer_duration, aagg->priv->output_buffer_duration);
 }
@@ -306,6 +313,11 @@ gst_audio_aggregator_dispose (GObject * object)
 
   gst_caps_replace (&aagg->current_caps, NULL);
 
+  if (aagg->priv->inputs) {
+    g_array_free (aagg->priv->inputs, TRUE);
+    aagg->priv->inputs = NULL;
+  }
+
   g_mutex_clear (&aagg->priv->mutex);
 
   G_OBJECT_CLASS (gst_audio_aggregator_parent_class)->dispose (object);
@@ -999,11 +1011,24 @@ gst_audio_aggregator_mix_buffer (GstAudioAggregator * aagg,
     return FALSE;
   }
 
-  filled = GST_AUDIO_AGGREGATOR_GET_CLASS (aagg)->aggregate_one_buffer (aagg,
-      pad, inbuf, pad->priv->position, outbuf, out_start, overlap);
+  if (GST_AUDIO_AGGREGATOR_GET_CLASS (aagg)->aggregate_buffers) {
+    GstAudioAggregatorInput input;
 
-  if (filled)
-    GST_BUFFER_FLAG_UNSET (outbuf, GST_BUFFER_FLAG_GAP);
+    /* aggregated with the inputs of the other pads once all are known */
+    input.pad = pad;
+    input.buffer = gst_buffer_ref (inbuf);
+    input.in_offset = pad->priv->position;
+    input.out_offset = out_start;
+    input.num_frames = overlap;
+    g_array_append_val (aagg->priv->inputs, input);
+  } else {
+    filled =
+        GST_AUDIO_AGGREGATOR_GET_CLASS (aagg)->aggregate_one_buffer (aagg, pad,
+        inbuf, pad->priv->position, outbuf, out_start, overlap);
+
+    if (filled)
+      GST_BUFFER_FLAG_UNSET (outbuf, GST_BUFFER_FLAG_GAP);
+  }
 
   pad->priv->position += overlap;
   pad->priv->output_offset += overlap;
@@ -1291,6 +1316,22 @@ gst_audio_aggregator_aggregate (GstAggregator * agg, gboolean timeout)
       gst_aggregator_pad_drop_buffer (aggpad);
 
   }
+
+  if (aagg->priv->inputs->len > 0) {
+    GstAudioAggregatorInput *inputs =
+        (GstAudioAggregatorInput *) aagg->priv->inputs->data;
+    guint i;
+
+    /* the pads are kept alive by the sinkpads list while the object lock is
+     * held, their buffers by the references taken when collecting them */
+    if (GST_AUDIO_AGGREGATOR_GET_CLASS (aagg)->aggregate_buffers (aagg, inputs,
+            aagg->priv->inputs->len, outbuf))
+      GST_BUFFER_FLAG_UNSET (outbuf, GST_BUFFER_FLAG_GAP);
+
+    for (i = 0; i < aagg->priv->inputs->len; i++)
+      gst_buffer_unref (inputs[i].buffer);
+    g_array_set_size (aagg->priv->inputs, 0);
+  }
   GST_OBJECT_UNLOCK (agg);
 
   if (dropped) {
@@ -131,6 +131,25 @@ struct _GstAudioAggregator
   gpointer                 _gst_reserved[GST_PADDING];
 };
 
+/**
+ * GstAudioAggregatorInput:
+ * @pad: The pad @buffer was received on
+ * @buffer: The input buffer
+ * @in_offset: The first frame of @buffer to aggregate
+ * @out_offset: The frame of the output buffer to aggregate it to
+ * @num_frames: The number of frames to aggregate
+ *
+ * A part of an input buffer to aggregate to the output buffer, see
+ * the aggregate_buffers virtual method of #GstAudioAggregatorClass
+ */
+typedef struct {
+  GstAudioAggregatorPad *pad;
+  GstBuffer *buffer;
+  guint in_offset;
+  guint out_offset;
+  guint num_frames;
+} GstAudioAggregatorInput;
+
 /**
  * GstAudioAggregatorClass:
  * @create_output_buffer: Create a new output buffer contains num_frames frames.
@@ -138,6 +157,11 @@ struct _GstAudioAggregator
  *  buffer.  The in_offset and out_offset are in "frames", which is
  *  the size of a sample times the number of channels. Returns TRUE if
  *  any non-silence was added to the buffer
+ * @aggregate_buffers: Optional. Aggregates the inputs of all pads that
+ *  have data for the output buffer at once, in the order of the pads. Used
+ *  instead of @aggregate_one_buffer if set. Called with the object lock
+ *  held, but not the pad object locks. Returns TRUE if any non-silence was
+ *  added to the buffer
  */
 struct _GstAudioAggregatorClass {
   GstAggregatorClass   parent_class;
@@ -147,9 +171,12 @@ struct _GstAudioAggregatorClass {
   gboolean (* aggregate_one_buffer) (GstAudioAggregator * aagg,
       GstAudioAggregatorPad * pad, GstBuffer * inbuf, guint in_offset,
       GstBuffer * outbuf, guint out_offset, guint num_frames);
+  gboolean (* aggregate_buffers) (GstAudioAggregator * aagg,
+      const GstAudioAggregatorInput * inputs, guint n_inputs,
+      GstBuffer * outbuf);
 
   /*< private >*/
-  gpointer          _gst_reserved[GST_PADDING];
+  gpointer          _gst_reserved[GST_PADDING - 1];
 };
 
 /*************************
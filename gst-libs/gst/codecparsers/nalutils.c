@@ -63,50 +63,100 @@ ceil_log2 (guint32 v)
 
 /****** Nal parser ******/
 
+/* The NAL unit is unescaped into a window of NAL_READER_WINDOW_SIZE bytes
+ * at a time, copying the runs of bytes between the emulation prevention
+ * bytes, and the bits are read from a 64 bits cache filled from the window.
+ * The cache is only filled with the bytes needed by a read so the position
+ * and the number of emulation prevention bytes are the ones of the bytes
+ * read so far, except in nal_reader_get_ue() which takes the bits of the
+ * window it needs from the cache. */
+
 void
 nal_reader_init (NalReader * nr, const guint8 * data, guint size)
 {
   nr->data = data;
   nr->size = size;
-  nr->n_epb = 0;
 
   nr->byte = 0;
+  nr->zeros = 0;
+
+  nr->window_start = 0;
+  nr->window_size = 0;
+  nr->window_pos = 0;
+  nr->window_n_epb = 0;
+  nr->n_epb = 0;
+
   nr->bits_in_cache = 0;
-  /* fill with something other than 0 to detect emulation prevention bytes */
-  nr->first_byte = 0xff;
-  nr->cache = 0xff;
+  nr->cache = 0;
 }
 
-gboolean
-nal_reader_read (NalReader * nr, guint nbits)
+/* Unescapes the next bytes of the NAL unit into the window. A 0x03 byte
+ * after two 0x00 bytes is an emulation_prevention_three_byte, unless it
+ * follows another one. Returns the number of bytes in the window */
+static guint
+nal_reader_fill_window (NalReader * nr)
 {
-  if (G_UNLIKELY (nr->byte * 8 + (nbits - nr->bits_in_cache) > nr->size * 8)) {
-    GST_DEBUG ("Can not read %u bits, bits in cache %u, Byte * 8 %u, size in "
-        "bits %u", nbits, nr->bits_in_cache, nr->byte * 8, nr->size * 8);
-    return FALSE;
-  }
+  const guint8 *data = nr->data;
+  guint size = nr->size;
+  guint byte = nr->byte;
+  guint zeros = nr->zeros;
+  guint n = 0;
+
+  nr->n_epb += nr->window_n_epb;
+  nr->window_start += nr->window_size;
+  nr->window_n_epb = 0;
+
+  while (n < NAL_READER_WINDOW_SIZE && byte < size) {
+    const guint8 *three;
+    guint len, i;
+
+    if (zeros == 2 && data[byte] == 0x03) {
+      byte++;
+      zeros = 3;
+      /* the next byte goes unconditionally to the window, even if it's 0x03 */
+      if (byte < size)
+        nr->window_epb[nr->window_n_epb++] = n;
+      continue;
+    }
 
-  while (nr->bits_in_cache < nbits) {
-    guint8 byte;
-    gboolean check_three_byte;
+    /* copy the bytes up to the next possible emulation prevention byte */
+    len = MIN (size - byte, NAL_READER_WINDOW_SIZE - n);
+    three = memchr (data + byte + 1, 0x03, len - 1);
+    if (three)
+      len = three - (data + byte);
+    memcpy (nr->window + n, data + byte, len);
+
+    for (i = len; i > 0 && data[byte + i - 1] == 0x00; i--);
+    if (i > 0)
+      zeros = MIN (len - i, 2);
+    else
+      zeros = MIN ((zeros == 3 ? 2 : zeros) + len, 2);
+
+    byte += len;
+    n += len;
+  }
 
-    check_three_byte = TRUE;
-  next_byte:
-    if (G_UNLIKELY (nr->byte >= nr->size))
-      return FALSE;
+  nr->byte = byte;
+  nr->zeros = zeros;
+  nr->window_size = n;
+  nr->window_pos = 0;
 
-    byte = nr->data[nr->byte++];
+  return n;
+}
 
-    /* check if the byte is a emulation_prevention_three_byte */
-    if (check_three_byte && byte == 0x03 && nr->first_byte == 0x00 &&
-        ((nr->cache & 0xff) == 0)) {
-      /* next byte goes unconditionally to the cache, even if it's 0x03 */
-      check_three_byte = FALSE;
-      nr->n_epb++;
-      goto next_byte;
+/* Fills the cache with at least @nbits bits, up to 57 bits */
+gboolean
+nal_reader_read (NalReader * nr, guint nbits)
+{
+  while (nr->bits_in_cache < nbits) {
+    if (G_UNLIKELY (nr->window_pos == nr->window_size)
+        && !nal_reader_fill_window (nr)) {
+      GST_DEBUG ("Can not read %u bits, bits in cache %u, size in bits %u",
+          nbits, nr->bits_in_cache, nr->size * 8);
+      return FALSE;
     }
-    nr->cache = (nr->cache << 8) | nr->first_byte;
-    nr->first_byte = byte;
+
+    nr->cache = (nr->cache << 8) | nr->window[nr->window_pos++];
     nr->bits_in_cache += 8;
   }
 
@@ -120,6 +170,12 @@ nal_reader_skip (NalReader * nr, guint nbits)
 {
   g_assert (nbits <= 8 * sizeof (nr->cache));
 
+  if (nbits > 32) {
+    if (G_UNLIKELY (!nal_reader_skip (nr, 32)))
+      return FALSE;
+    nbits -= 32;
+  }
+
   if (G_UNLIKELY (!nal_reader_read (nr, nbits)))
     return FALSE;
 
@@ -146,44 +202,61 @@ nal_reader_skip_long (NalReader * nr, guint nbits)
   return TRUE;
 }
 
+/* Returns the number of bits read without the emulation prevention bytes */
+static inline guint
+nal_reader_get_unescaped_pos (const NalReader * nr)
+{
+  return (nr->window_start + nr->window_pos) * 8 - nr->bits_in_cache;
+}
+
+/* Returns the number of emulation prevention bytes before the last byte
+ * read from */
+static guint
+nal_reader_count_epb (const NalReader * nr)
+{
+  gint end = (nal_reader_get_unescaped_pos (nr) + 7) / 8;
+  guint i, n_epb = nr->n_epb;
+
+  end -= nr->window_start;
+  for (i = 0; i < nr->window_n_epb && nr->window_epb[i] < end; i++)
+    n_epb++;
+
+  return n_epb;
+}
+
 guint
 nal_reader_get_pos (const NalReader * nr)
 {
-  return nr->byte * 8 - nr->bits_in_cache;
+  return nal_reader_get_unescaped_pos (nr) + nal_reader_count_epb (nr) * 8;
 }
 
 guint
 nal_reader_get_remaining (const NalReader * nr)
 {
-  return (nr->size - nr->byte) * 8 + nr->bits_in_cache;
+  return nr->size * 8 - nal_reader_get_pos (nr);
 }
 
 guint
 nal_reader_get_epb_count (const NalReader * nr)
 {
-  return nr->n_epb;
+  return nal_reader_count_epb (nr);
 }
 
 #define NAL_READER_READ_BITS(bits) \
 gboolean \
 nal_reader_get_bits_uint##bits (NalReader *nr, guint##bits *val, guint nbits) \
 { \
-  guint shift; \
-  \
   if (!nal_reader_read (nr, nbits)) \
     return FALSE; \
   \
   /* bring the required bits down and truncate */ \
-  shift = nr->bits_in_cache - nbits; \
-  *val = nr->first_byte >> shift; \
+  nr->bits_in_cache -= nbits; \
+  *val = nr->cache >> nr->bits_in_cache; \
   \
-  *val |= nr->cache << (8 - shift); \
   /* mask out required bits */ \
   if (nbits < bits) \
     *val &= ((guint##bits)1 << nbits) - 1; \
   \
-  nr->bits_in_cache = shift; \
-  \
   return TRUE; \
 } \
 
@@ -203,6 +276,22 @@ nal_reader_peek_bits_uint##bits (const NalReader *nr, guint##bits *val, guint nb
 
 NAL_READER_PEEK_BITS (8);
 
+static inline guint
+nal_reader_clz64 (guint64 v)
+{
+#if defined (__GNUC__)
+  return __builtin_clzll (v);
+#else
+  guint n = 0;
+
+  while (!(v & G_GUINT64_CONSTANT (0x8000000000000000))) {
+    v <<= 1;
+    n++;
+  }
+  return n;
+#endif
+}
+
 gboolean
 nal_reader_get_ue (NalReader * nr, guint32 * val)
 {
@@ -210,6 +299,27 @@ nal_reader_get_ue (NalReader * nr, guint32 * val)
   guint8 bit;
   guint32 value;
 
+  /* take up to 56 bits of the window, the codes in headers are short */
+  while (nr->bits_in_cache <= 48 && nr->window_pos < nr->window_size) {
+    nr->cache = (nr->cache << 8) | nr->window[nr->window_pos++];
+    nr->bits_in_cache += 8;
+  }
+
+  /* count the leading zero bits at once if the whole code is in the cache */
+  if (G_LIKELY (nr->bits_in_cache > 0)) {
+    guint64 code = nr->cache << (64 - nr->bits_in_cache);
+
+    if (code != 0) {
+      i = nal_reader_clz64 (code);
+      if (2 * i + 1 <= nr->bits_in_cache) {
+        nr->bits_in_cache -= 2 * i + 1;
+        *val = (code >> (63 - 2 * i)) - 1;
+        return TRUE;
+      }
+      i = 0;
+    }
+  }
+
   if (G_UNLIKELY (!nal_reader_get_bits_uint8 (nr, &bit, 1)))
     return FALSE;
 
@@ -249,7 +359,7 @@ nal_reader_get_se (NalReader * nr, gint32 * val)
 gboolean
 nal_reader_is_byte_aligned (NalReader * nr)
 {
-  if (nr->bits_in_cache != 0)
+  if (nr->bits_in_cache % 8 != 0)
     return FALSE;
   return TRUE;
 }
@@ -297,13 +407,161 @@ nal_reader_has_more_data (NalReader * nr)
 
 /***********  end of nal parser ***************/
 
+/* The start code scanners return the offset of the first 00 00 01 sequence
+ * in @data that is followed by at least one more byte, as
+ * gst_byte_reader_masked_scan_uint32() with a 0xffffff00 mask and a
+ * 0x00000100 pattern would, or -1 */
+
+static gint
+scan_for_start_codes_c (const guint8 * data, guint size)
+{
+  guint i = 0;
+
+  /* Look at the third byte of the candidate: if it is neither 0 nor 1, no
+   * start code can begin at the candidate or at the two next bytes. If it is
+   * 1, only the candidate can be a start code */
+  while (i + 3 < size) {
+    guint8 b = data[i + 2];
+
+    if (b > 1) {
+      i += 3;
+    } else if (b == 1) {
+      if (data[i + 1] == 0 && data[i] == 0)
+        return i;
+      i += 3;
+    } else {
+      i++;
+    }
+  }
+
+  return -1;
+}
+
+typedef gint (*ScanForStartCodesFunc) (const guint8 * data, guint size);
+
+#if defined (__SSE2__)
+#include <emmintrin.h>
+
+static gint
+scan_for_start_codes_sse2 (const guint8 * data, guint size)
+{
+  const __m128i zero = _mm_setzero_si128 ();
+  const __m128i one = _mm_set1_epi8 (1);
+  guint i = 0;
+  gint ret;
+
+  /* 16 candidates at a time, the byte after the start code of the last one
+   * must be in @data too */
+  for (; i + 19 <= size; i += 16) {
+    __m128i b0 = _mm_loadu_si128 ((const __m128i *) (data + i));
+    __m128i b1 = _mm_loadu_si128 ((const __m128i *) (data + i + 1));
+    __m128i b2 = _mm_loadu_si128 ((const __m128i *) (data + i + 2));
+    gint mask;
+
+    mask = _mm_movemask_epi8 (_mm_and_si128 (_mm_and_si128 (_mm_cmpeq_epi8 (b0,
+                    zero), _mm_cmpeq_epi8 (b1, zero)), _mm_cmpeq_epi8 (b2,
+                one)));
+    if (mask)
+      return i + g_bit_nth_lsf (mask, -1);
+  }
+
+  ret = scan_for_start_codes_c (data + i, size - i);
+  return ret < 0 ? -1 : i + ret;
+}
+
+/* AVX2 is only used if the CPU running the code supports it */
+#if defined (__clang__) || (defined (__GNUC__) && (__GNUC__ > 4 || \
+    (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#define HAVE_SCAN_FOR_START_CODES_AVX2 1
+#include <immintrin.h>
+
+__attribute__ ((target ("avx2")))
+static gint
+scan_for_start_codes_avx2 (const guint8 * data, guint size)
+{
+  const __m256i zero = _mm256_setzero_si256 ();
+  const __m256i one = _mm256_set1_epi8 (1);
+  guint i = 0;
+
+  for (; i + 35 <= size; i += 32) {
+    __m256i b0 = _mm256_loadu_si256 ((const __m256i *) (data + i));
+    __m256i b1 = _mm256_loadu_si256 ((const __m256i *) (data + i + 1));
+    __m256i b2 = _mm256_loadu_si256 ((const __m256i *) (data + i + 2));
+    guint32 mask;
+
+    mask = _mm256_movemask_epi8 (_mm256_and_si256 (_mm256_and_si256
+            (_mm256_cmpeq_epi8 (b0, zero), _mm256_cmpeq_epi8 (b1, zero)),
+            _mm256_cmpeq_epi8 (b2, one)));
+    if (mask)
+      return i + __builtin_ctz (mask);
+  }
+
+  if (i < size) {
+    gint ret = scan_for_start_codes_sse2 (data + i, size - i);
+    return ret < 0 ? -1 : i + ret;
+  }
+
+  return -1;
+}
+#endif
+
+#elif defined (__ARM_NEON__) || defined (__ARM_NEON)
+#include <arm_neon.h>
+
+static gint
+scan_for_start_codes_neon (const guint8 * data, guint size)
+{
+  const uint8x16_t zero = vdupq_n_u8 (0);
+  const uint8x16_t one = vdupq_n_u8 (1);
+  guint i = 0;
+  gint ret;
+
+  for (; i + 19 <= size; i += 16) {
+    uint8x16_t m;
+    uint8x8_t m8;
+
+    m = vandq_u8 (vandq_u8 (vceqq_u8 (vld1q_u8 (data + i), zero),
+            vceqq_u8 (vld1q_u8 (data + i + 1), zero)),
+        vceqq_u8 (vld1q_u8 (data + i + 2), one));
+    m8 = vorr_u8 (vget_low_u8 (m), vget_high_u8 (m));
+    if (vget_lane_u64 (vreinterpret_u64_u8 (m8), 0) != 0)
+      break;
+  }
+
+  /* the start code, if any, is in the first 16 candidates left */
+  ret = scan_for_start_codes_c (data + i, size - i);
+  return ret < 0 ? -1 : i + ret;
+}
+#endif
+
+static gpointer
+scan_for_start_codes_select (gpointer data)
+{
+  ScanForStartCodesFunc func = scan_for_start_codes_c;
+
+#if defined (__SSE2__)
+  func = scan_for_start_codes_sse2;
+#ifdef HAVE_SCAN_FOR_START_CODES_AVX2
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("avx2"))
+    func = scan_for_start_codes_avx2;
+#endif
+#elif defined (__ARM_NEON__) || defined (__ARM_NEON)
+  func = scan_for_start_codes_neon;
+#endif
+
+  return (gpointer) func;
+}
+
 gint
 scan_for_start_codes (const guint8 * data, guint size)
 {
-  GstByteReader br;
-  gst_byte_reader_init (&br, data, size);
+  static GOnce select_once = G_ONCE_INIT;
+  ScanForStartCodesFunc func;
 
   /* NALU not empty, so we can at least expect 1 (even 2) bytes following sc */
-  return gst_byte_reader_masked_scan_uint32 (&br, 0xffffff00, 0x00000100,
-      0, size);
+  func = (ScanForStartCodesFunc) g_once (&select_once,
+      scan_for_start_codes_select, NULL);
+
+  return func (data, size);
 }
@@ -41,16 +41,31 @@
 
 guint ceil_log2 (guint32 v);
 
+/* Number of bytes unescaped at once, enough for most headers */
+#define NAL_READER_WINDOW_SIZE 64
+
 typedef struct
 {
   const guint8 *data;
   guint size;
 
-  guint n_epb;                  /* Number of emulation prevention bytes */
-  guint byte;                   /* Byte position */
-  guint bits_in_cache;          /* bitpos in the cache of next bit */
-  guint8 first_byte;
-  guint64 cache;                /* cached bytes */
+  guint byte;                   /* Position of the next byte to unescape */
+  guint zeros;                  /* Number of 0x00 bytes before it, 3 after an
+                                 * emulation prevention byte */
+
+  /* Window of bytes without the emulation prevention bytes */
+  guint8 window[NAL_READER_WINDOW_SIZE];
+  guint window_start;           /* Index of the window in the unescaped data */
+  guint window_size;
+  guint window_pos;             /* Position of the next byte to cache */
+  /* Window positions of the bytes following an emulation prevention byte */
+  guint8 window_epb[NAL_READER_WINDOW_SIZE];
+  guint window_n_epb;
+  guint n_epb;                  /* Emulation prevention bytes before the window */
+
+  guint bits_in_cache;          /* Number of bits left in the cache */
+  guint64 cache;                /* cached bytes, the next bit is the bit
+                                 * bits_in_cache - 1 */
 } NalReader;
 
 G_GNUC_INTERNAL
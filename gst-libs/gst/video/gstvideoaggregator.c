@@ -56,13 +56,19 @@ static void gst_video_aggregator_reset_qos (GstVideoAggregator * vagg);
 
 #define DEFAULT_PAD_ZORDER 0
 #define DEFAULT_PAD_IGNORE_EOS FALSE
+#define DEFAULT_PAD_CONVERTER_THREADS 1
 enum
 {
   PROP_PAD_0,
   PROP_PAD_ZORDER,
   PROP_PAD_IGNORE_EOS,
+  PROP_PAD_CONVERTER_THREADS,
+  PROP_PAD_N_CONVERTED_ALLOCATIONS,
 };
 
+/* Set on the buffers allocated by the pool of converted frames */
+static GQuark converted_buffer_quark;
+
 
 struct _GstVideoAggregatorPadPrivate
 {
@@ -73,6 +79,14 @@ struct _GstVideoAggregatorPadPrivate
   GstVideoInfo conversion_info;
   GstBuffer *converted_buffer;
 
+  /* pool of converted frames, of buffers of converted_pool_size bytes */
+  GstBufferPool *converted_pool;
+  gsize converted_pool_size;
+  guint64 n_converted_allocations;
+
+  /* the number of threads of the converter, 0 for one per processor */
+  guint converter_threads;
+
   GstClockTime start_time;
   GstClockTime end_time;
 };
@@ -94,6 +108,14 @@ gst_video_aggregator_pad_get_property (GObject * object, guint prop_id,
     case PROP_PAD_IGNORE_EOS:
       g_value_set_boolean (value, pad->ignore_eos);
       break;
+    case PROP_PAD_CONVERTER_THREADS:
+      g_value_set_uint (value, pad->priv->converter_threads);
+      break;
+    case PROP_PAD_N_CONVERTED_ALLOCATIONS:
+      GST_OBJECT_LOCK (pad);
+      g_value_set_uint64 (value, pad->priv->n_converted_allocations);
+      GST_OBJECT_UNLOCK (pad);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -126,6 +148,9 @@ gst_video_aggregator_pad_set_property (GObject * object, guint prop_id,
     case PROP_PAD_IGNORE_EOS:
       pad->ignore_eos = g_value_get_boolean (value);
       break;
+    case PROP_PAD_CONVERTER_THREADS:
+      pad->priv->converter_threads = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -148,6 +173,99 @@ _flush_pad (GstAggregatorPad * aggpad, GstAggregator * aggregator)
   return GST_FLOW_OK;
 }
 
+/**
+ * gst_video_aggregator_pad_get_converter_config:
+ * @pad: a #GstVideoAggregatorPad
+ *
+ * Returns the configuration to use for a #GstVideoConverter converting the
+ * frames of @pad, for subclasses that create their own converters.
+ *
+ * Returns: (transfer full): a new #GstStructure to pass to
+ * gst_video_converter_new()
+ */
+GstStructure *
+gst_video_aggregator_pad_get_converter_config (GstVideoAggregatorPad * pad)
+{
+  guint n_threads = pad->priv->converter_threads;
+
+  if (n_threads == 0)
+    n_threads = g_get_num_processors ();
+
+  return gst_structure_new ("GstVideoConverter",
+      GST_VIDEO_CONVERTER_OPT_THREADS, G_TYPE_UINT, n_threads, NULL);
+}
+
+static void
+gst_video_aggregator_pad_free_converted_pool (GstVideoAggregatorPad * pad)
+{
+  if (pad->priv->converted_pool) {
+    gst_buffer_pool_set_active (pad->priv->converted_pool, FALSE);
+    gst_object_unref (pad->priv->converted_pool);
+    pad->priv->converted_pool = NULL;
+  }
+}
+
+/**
+ * gst_video_aggregator_pad_acquire_converted_buffer:
+ * @pad: a #GstVideoAggregatorPad
+ * @size: the size of the buffer
+ *
+ * Returns a buffer of @size bytes to convert the current frame of @pad into,
+ * from a pool of buffers that is kept on the pad. The buffer goes back to
+ * the pool once it is unreffed, so subclasses implementing prepare_frame
+ * should release it in clean_frame.
+ *
+ * Returns: (transfer full): a #GstBuffer of @size bytes
+ */
+GstBuffer *
+gst_video_aggregator_pad_acquire_converted_buffer (GstVideoAggregatorPad *
+    pad, gsize size)
+{
+  static GstAllocationParams params = { 0, 15, 0, 0, };
+  GstVideoAggregatorPadPrivate *priv = pad->priv;
+  GstBuffer *buf = NULL;
+
+  if (priv->converted_pool && priv->converted_pool_size != size)
+    gst_video_aggregator_pad_free_converted_pool (pad);
+
+  if (!priv->converted_pool) {
+    GstBufferPool *pool = gst_buffer_pool_new ();
+    GstStructure *config = gst_buffer_pool_get_config (pool);
+
+    gst_buffer_pool_config_set_params (config, NULL, size, 0, 0);
+    gst_buffer_pool_config_set_allocator (config, NULL, &params);
+    if (gst_buffer_pool_set_config (pool, config) &&
+        gst_buffer_pool_set_active (pool, TRUE)) {
+      GST_DEBUG_OBJECT (pad, "created pool of converted frames of %"
+          G_GSIZE_FORMAT " bytes", size);
+      priv->converted_pool = pool;
+      priv->converted_pool_size = size;
+    } else {
+      GST_WARNING_OBJECT (pad, "Could not set up pool of converted frames");
+      gst_object_unref (pool);
+    }
+  }
+
+  if (priv->converted_pool)
+    gst_buffer_pool_acquire_buffer (priv->converted_pool, &buf, NULL);
+  if (!buf)
+    return gst_buffer_new_allocate (NULL, size, &params);
+
+  if (!gst_mini_object_get_qdata (GST_MINI_OBJECT_CAST (buf),
+          converted_buffer_quark)) {
+    gst_mini_object_set_qdata (GST_MINI_OBJECT_CAST (buf),
+        converted_buffer_quark, GINT_TO_POINTER (TRUE), NULL);
+
+    GST_OBJECT_LOCK (pad);
+    priv->n_converted_allocations++;
+    GST_OBJECT_UNLOCK (pad);
+    GST_LOG_OBJECT (pad, "pool of converted frames grew, %" G_GUINT64_FORMAT
+        " buffers allocated", priv->n_converted_allocations);
+  }
+
+  return buf;
+}
+
 static gboolean
 gst_video_aggregator_pad_set_info (GstVideoAggregatorPad * pad,
     GstVideoAggregator * vagg G_GNUC_UNUSED,
@@ -166,6 +284,7 @@ gst_video_aggregator_pad_set_info (GstVideoAggregatorPad * pad,
     gst_video_converter_free (pad->priv->convert);
 
   pad->priv->convert = NULL;
+  gst_video_aggregator_pad_free_converted_pool (pad);
 
   colorimetry = gst_video_colorimetry_to_string (&(current_info->colorimetry));
   chroma = gst_video_chroma_to_string (current_info->chroma_site);
@@ -200,7 +319,8 @@ gst_video_aggregator_pad_set_info (GstVideoAggregatorPad * pad,
         GST_VIDEO_INFO_FORMAT (current_info),
         GST_VIDEO_INFO_FORMAT (&tmp_info));
     pad->priv->convert =
-        gst_video_converter_new (current_info, &tmp_info, NULL);
+        gst_video_converter_new (current_info, &tmp_info,
+        gst_video_aggregator_pad_get_converter_config (pad));
     pad->priv->conversion_info = tmp_info;
     if (!pad->priv->convert) {
       g_free (colorimetry);
@@ -225,6 +345,7 @@ gst_video_aggregator_pad_finalize (GObject * o)
   if (vaggpad->priv->convert)
     gst_video_converter_free (vaggpad->priv->convert);
   vaggpad->priv->convert = NULL;
+  gst_video_aggregator_pad_free_converted_pool (vaggpad);
 
   G_OBJECT_CLASS (gst_video_aggregator_pad_parent_class)->finalize (o);
 }
@@ -237,7 +358,6 @@ gst_video_aggregator_pad_prepare_frame (GstVideoAggregatorPad * pad,
   GstVideoFrame *converted_frame;
   GstBuffer *converted_buf = NULL;
   GstVideoFrame *frame;
-  static GstAllocationParams params = { 0, 15, 0, 0, };
 
   if (!pad->buffer)
     return TRUE;
@@ -259,12 +379,14 @@ gst_video_aggregator_pad_prepare_frame (GstVideoAggregatorPad * pad,
     converted_size = pad->priv->conversion_info.size;
     outsize = GST_VIDEO_INFO_SIZE (&vagg->info);
     converted_size = converted_size > outsize ? converted_size : outsize;
-    converted_buf = gst_buffer_new_allocate (NULL, converted_size, &params);
+    converted_buf =
+        gst_video_aggregator_pad_acquire_converted_buffer (pad, converted_size);
 
     if (!gst_video_frame_map (converted_frame, &(pad->priv->conversion_info),
             converted_buf, GST_MAP_READWRITE)) {
       GST_WARNING_OBJECT (vagg, "Could not map converted frame");
 
+      gst_buffer_unref (converted_buf);
       g_slice_free (GstVideoFrame, converted_frame);
       gst_video_frame_unmap (frame);
       g_slice_free (GstVideoFrame, frame);
@@ -319,6 +441,23 @@ gst_video_aggregator_pad_class_init (GstVideoAggregatorPadClass * klass)
           "frame on pads that are EOS till they are released",
           DEFAULT_PAD_IGNORE_EOS,
           G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_PAD_CONVERTER_THREADS,
+      g_param_spec_uint ("converter-threads", "Converter threads",
+          "Number of threads used to convert the frames of this pad to the "
+          "output format, applied when the converter is created "
+          "(0 = number of processors)", 0, G_MAXINT,
+          DEFAULT_PAD_CONVERTER_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class,
+      PROP_PAD_N_CONVERTED_ALLOCATIONS,
+      g_param_spec_uint64 ("n-converted-allocations",
+          "Converted frame allocations",
+          "Number of times the pool of converted frames of this pad had to "
+          "grow by allocating a new buffer", 0, G_MAXUINT64, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  converted_buffer_quark =
+      g_quark_from_static_string ("GstVideoAggregatorConvertedBuffer");
 
   g_type_class_add_private (klass, sizeof (GstVideoAggregatorPadPrivate));
 
@@ -338,6 +477,7 @@ gst_video_aggregator_pad_init (GstVideoAggregatorPad * vaggpad)
 
   vaggpad->zorder = DEFAULT_PAD_ZORDER;
   vaggpad->ignore_eos = DEFAULT_PAD_IGNORE_EOS;
+  vaggpad->priv->converter_threads = DEFAULT_PAD_CONVERTER_THREADS;
   vaggpad->aggregated_frame = NULL;
   vaggpad->priv->converted_buffer = NULL;
 
@@ -430,6 +570,24 @@ struct _GstVideoAggregatorPrivate
   GstCaps *current_caps;
 
   gboolean live;
+
+  /* Parallel preparation of the pad frames. The pads are taken in order by
+   * the aggregating thread and the prepare_pool threads, with prepare_lock
+   * protecting prepare_pending */
+  guint prepare_threads;
+  GThreadPool *prepare_pool;
+  GPtrArray *prepare_pads;
+  volatile gint prepare_next;
+  guint prepare_pending;
+  GMutex prepare_lock;
+  GCond prepare_cond;
+};
+
+#define DEFAULT_PREPARE_THREADS 1
+enum
+{
+  PROP_0,
+  PROP_PREPARE_THREADS,
 };
 
 /* Can't use the G_DEFINE_TYPE macros because we need the
@@ -1321,6 +1479,98 @@ prepare_frames (GstVideoAggregator * vagg, GstVideoAggregatorPad * pad)
   return vaggpad_class->prepare_frame (pad, vagg);
 }
 
+static void
+prepare_next_frames (GstVideoAggregator * vagg)
+{
+  GstVideoAggregatorPrivate *priv = vagg->priv;
+  gint i;
+
+  while ((i = g_atomic_int_add (&priv->prepare_next, 1)) <
+      (gint) priv->prepare_pads->len) {
+    GstVideoAggregatorPad *pad = g_ptr_array_index (priv->prepare_pads, i);
+
+    /* like the iteration over the pads, don't prepare the pads that are
+     * not started yet once one failed */
+    if (!prepare_frames (vagg, pad))
+      g_atomic_int_set (&priv->prepare_next, priv->prepare_pads->len);
+  }
+}
+
+static void
+prepare_frames_func (gpointer data, gpointer user_data)
+{
+  GstVideoAggregator *vagg = user_data;
+  GstVideoAggregatorPrivate *priv = vagg->priv;
+
+  prepare_next_frames (vagg);
+
+  g_mutex_lock (&priv->prepare_lock);
+  if (--priv->prepare_pending == 0)
+    g_cond_signal (&priv->prepare_cond);
+  g_mutex_unlock (&priv->prepare_lock);
+}
+
+/* Runs prepare_frame on up to prepare-threads pads at once, the aggregating
+ * thread being one of them. Returns FALSE if the pads should be prepared one
+ * after another instead */
+static gboolean
+prepare_frames_parallel (GstVideoAggregator * vagg)
+{
+  GstVideoAggregatorPrivate *priv = vagg->priv;
+  guint n_threads, i;
+  GList *l;
+
+  GST_OBJECT_LOCK (vagg);
+  n_threads = priv->prepare_threads;
+  if (n_threads == 0)
+    n_threads = g_get_num_processors ();
+
+  if (n_threads > 1) {
+    for (l = GST_ELEMENT (vagg)->sinkpads; l; l = l->next) {
+      GstVideoAggregatorPad *pad = l->data;
+
+      if (pad->buffer != NULL)
+        g_ptr_array_add (priv->prepare_pads, gst_object_ref (pad));
+    }
+  }
+  GST_OBJECT_UNLOCK (vagg);
+
+  if (priv->prepare_pads->len <= 1) {
+    g_ptr_array_set_size (priv->prepare_pads, 0);
+    return FALSE;
+  }
+
+  n_threads = MIN (n_threads, priv->prepare_pads->len);
+
+  if (!priv->prepare_pool) {
+    priv->prepare_pool = g_thread_pool_new (prepare_frames_func, vagg,
+        n_threads - 1, FALSE, NULL);
+  } else if (g_thread_pool_get_max_threads (priv->prepare_pool) <
+      (gint) n_threads - 1) {
+    g_thread_pool_set_max_threads (priv->prepare_pool, n_threads - 1, NULL);
+  }
+
+  GST_LOG_OBJECT (vagg, "preparing %u pads with %u threads",
+      priv->prepare_pads->len, n_threads);
+
+  priv->prepare_next = 0;
+  priv->prepare_pending = n_threads - 1;
+  for (i = 1; i < n_threads; i++) {
+    if (!g_thread_pool_push (priv->prepare_pool, vagg, NULL))
+      prepare_frames_func (vagg, vagg);
+  }
+  prepare_next_frames (vagg);
+
+  g_mutex_lock (&priv->prepare_lock);
+  while (priv->prepare_pending > 0)
+    g_cond_wait (&priv->prepare_cond, &priv->prepare_lock);
+  g_mutex_unlock (&priv->prepare_lock);
+
+  g_ptr_array_set_size (priv->prepare_pads, 0);
+
+  return TRUE;
+}
+
 static gboolean
 clean_pad (GstVideoAggregator * vagg, GstVideoAggregatorPad * pad)
 {
@@ -1364,8 +1614,9 @@ gst_video_aggregator_do_aggregate (GstVideoAggregator * vagg,
       (GstAggregatorPadForeachFunc) sync_pad_values, NULL);
 
   /* Convert all the frames the subclass has before aggregating */
-  gst_aggregator_iterate_sinkpads (GST_AGGREGATOR (vagg),
-      (GstAggregatorPadForeachFunc) prepare_frames, NULL);
+  if (!prepare_frames_parallel (vagg))
+    gst_aggregator_iterate_sinkpads (GST_AGGREGATOR (vagg),
+        (GstAggregatorPadForeachFunc) prepare_frames, NULL);
 
   ret = vagg_klass->aggregate_frames (vagg, *outbuf);
 
@@ -2072,6 +2323,11 @@ gst_video_aggregator_finalize (GObject * o)
 {
   GstVideoAggregator *vagg = GST_VIDEO_AGGREGATOR (o);
 
+  if (vagg->priv->prepare_pool)
+    g_thread_pool_free (vagg->priv->prepare_pool, FALSE, TRUE);
+  g_ptr_array_free (vagg->priv->prepare_pads, TRUE);
+  g_mutex_clear (&vagg->priv->prepare_lock);
+  g_cond_clear (&vagg->priv->prepare_cond);
   g_mutex_clear (&vagg->priv->lock);
 
   G_OBJECT_CLASS (gst_video_aggregator_parent_class)->finalize (o);
@@ -2091,7 +2347,14 @@ static void
 gst_video_aggregator_get_property (GObject * object,
     guint prop_id, GValue * value, GParamSpec * pspec)
 {
+  GstVideoAggregator *vagg = GST_VIDEO_AGGREGATOR (object);
+
   switch (prop_id) {
+    case PROP_PREPARE_THREADS:
+      GST_OBJECT_LOCK (vagg);
+      g_value_set_uint (value, vagg->priv->prepare_threads);
+      GST_OBJECT_UNLOCK (vagg);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -2102,7 +2365,14 @@ static void
 gst_video_aggregator_set_property (GObject * object,
     guint prop_id, const GValue * value, GParamSpec * pspec)
 {
+  GstVideoAggregator *vagg = GST_VIDEO_AGGREGATOR (object);
+
   switch (prop_id) {
+    case PROP_PREPARE_THREADS:
+      GST_OBJECT_LOCK (vagg);
+      vagg->priv->prepare_threads = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (vagg);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -2151,6 +2421,20 @@ gst_video_aggregator_class_init (GstVideoAggregatorClass * klass)
   klass->update_caps = gst_video_aggregator_default_update_caps;
   klass->fixate_caps = gst_video_aggregator_default_fixate_caps;
 
+  /**
+   * GstVideoAggregator:prepare-threads:
+   *
+   * Maximum number of sink pads whose frames are prepared (mapped and
+   * converted to the output format) at the same time before aggregating.
+   * The prepare_frame vmethod of the pads may then be called from several
+   * threads at once. 0 uses one thread per processor.
+   */
+  g_object_class_install_property (gobject_class, PROP_PREPARE_THREADS,
+      g_param_spec_uint ("prepare-threads", "Prepare threads",
+          "Maximum number of pads prepared for aggregation in parallel "
+          "(0 = number of processors)", 0, G_MAXINT, DEFAULT_PREPARE_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   /* Register the pad class */
   g_type_class_ref (GST_TYPE_VIDEO_AGGREGATOR_PAD);
 }
@@ -2240,6 +2524,11 @@ gst_video_aggregator_init (GstVideoAggregator * vagg,
 
   g_mutex_init (&vagg->priv->lock);
 
+  vagg->priv->prepare_threads = DEFAULT_PREPARE_THREADS;
+  vagg->priv->prepare_pads = g_ptr_array_new_with_free_func (gst_object_unref);
+  g_mutex_init (&vagg->priv->prepare_lock);
+  g_cond_init (&vagg->priv->prepare_cond);
+
   /* initialize variables */
   g_mutex_lock (&sink_caps_mutex);
   if (klass->sink_non_alpha_caps == NULL) {
@@ -108,5 +108,10 @@ struct _GstVideoAggregatorPadClass
 
 GType gst_video_aggregator_pad_get_type (void);
 
+GstStructure * gst_video_aggregator_pad_get_converter_config (GstVideoAggregatorPad * pad);
+
+GstBuffer *    gst_video_aggregator_pad_acquire_converted_buffer (GstVideoAggregatorPad * pad,
+                                                                  gsize                   size);
+
 G_END_DECLS
 #endif /* __GST_VIDEO_AGGREGATOR_PAD_H__ */
@@ -205,10 +205,32 @@ static GstPad *gst_audiomixer_request_new_pad (GstElement * element,
     GstPadTemplate * temp, const gchar * req_name, const GstCaps * caps);
 static void gst_audiomixer_release_pad (GstElement * element, GstPad * pad);
 
+/* A part of an input buffer that is mixed, with the volume of its pad */
+typedef struct
+{
+  GstBuffer *buffer;
+  GstMapInfo map;
+  const guint8 *data;
+  guint out_offset;
+  guint num_frames;
+
+  gdouble volume;
+  gint volume_i32;
+  gint volume_i16;
+  gint volume_i8;
+} GstAudioMixerInput;
+
+/* Mix the inputs of all pads in blocks of this many bytes of the output
+ * buffer, so that the output stays in the cache while the inputs are added */
+#define MIX_BLOCK_SIZE 4096
+
 static gboolean
 gst_audiomixer_aggregate_one_buffer (GstAudioAggregator * aagg,
     GstAudioAggregatorPad * aaggpad, GstBuffer * inbuf, guint in_offset,
     GstBuffer * outbuf, guint out_offset, guint num_samples);
+static gboolean gst_audiomixer_aggregate_buffers (GstAudioAggregator * aagg,
+    const GstAudioAggregatorInput * inputs, guint n_inputs,
+    GstBuffer * outbuf);
 
 
 /* we can only accept caps that we and downstream can handle.
@@ -497,12 +519,15 @@ gst_audiomixer_class_init (GstAudioMixerClass * klass)
   agg_class->sink_event = GST_DEBUG_FUNCPTR (gst_audiomixer_sink_event);
 
   aagg_class->aggregate_one_buffer = gst_audiomixer_aggregate_one_buffer;
+  aagg_class->aggregate_buffers = gst_audiomixer_aggregate_buffers;
 }
 
 static void
 gst_audiomixer_init (GstAudioMixer * audiomixer)
 {
   audiomixer->filter_caps = NULL;
+  audiomixer->mix_inputs = g_array_new (FALSE, FALSE,
+      sizeof (GstAudioMixerInput));
 }
 
 static void
@@ -512,6 +537,11 @@ gst_audiomixer_dispose (GObject * object)
 
   gst_caps_replace (&audiomixer->filter_caps, NULL);
 
+  if (audiomixer->mix_inputs) {
+    g_array_free (audiomixer->mix_inputs, TRUE);
+    audiomixer->mix_inputs = NULL;
+  }
+
   G_OBJECT_CLASS (parent_class)->dispose (object);
 }
 
@@ -608,129 +638,205 @@ gst_audiomixer_release_pad (GstElement * element, GstPad * pad)
 }
 
 
-/* Called with object lock and pad object lock held */
-static gboolean
-gst_audiomixer_aggregate_one_buffer (GstAudioAggregator * aagg,
-    GstAudioAggregatorPad * aaggpad, GstBuffer * inbuf, guint in_offset,
-    GstBuffer * outbuf, guint out_offset, guint num_frames)
+/* Adds n_samples samples at in with the volume of input to the ones at out */
+static void
+gst_audiomixer_mix_samples (GstAudioFormat format,
+    const GstAudioMixerInput * input, guint8 * out, const guint8 * in,
+    guint n_samples)
 {
-  GstAudioMixerPad *pad = GST_AUDIO_MIXER_PAD (aaggpad);
-  GstMapInfo inmap;
-  GstMapInfo outmap;
-  gint bpf;
-
-  if (pad->mute || pad->volume < G_MINDOUBLE) {
-    GST_DEBUG_OBJECT (pad, "Skipping muted pad");
-    return FALSE;
-  }
-
-  bpf = GST_AUDIO_INFO_BPF (&aagg->info);
-
-  gst_buffer_map (outbuf, &outmap, GST_MAP_READWRITE);
-  gst_buffer_map (inbuf, &inmap, GST_MAP_READ);
-  GST_LOG_OBJECT (pad, "mixing %u bytes at offset %u from offset %u",
-      num_frames * bpf, out_offset * bpf, in_offset * bpf);
-
-  /* further buffers, need to add them */
-  if (pad->volume == 1.0) {
-    switch (aagg->info.finfo->format) {
+  if (input->volume == 1.0) {
+    switch (format) {
       case GST_AUDIO_FORMAT_U8:
-        audiomixer_orc_add_u8 ((gpointer) (outmap.data + out_offset * bpf),
-            (gpointer) (inmap.data + in_offset * bpf),
-            num_frames * aagg->info.channels);
+        audiomixer_orc_add_u8 ((gpointer) out, (gpointer) in, n_samples);
         break;
       case GST_AUDIO_FORMAT_S8:
-        audiomixer_orc_add_s8 ((gpointer) (outmap.data + out_offset * bpf),
-            (gpointer) (inmap.data + in_offset * bpf),
-            num_frames * aagg->info.channels);
+        audiomixer_orc_add_s8 ((gpointer) out, (gpointer) in, n_samples);
         break;
       case GST_AUDIO_FORMAT_U16:
-        audiomixer_orc_add_u16 ((gpointer) (outmap.data + out_offset * bpf),
-            (gpointer) (inmap.data + in_offset * bpf),
-            num_frames * aagg->info.channels);
+        audiomixer_orc_add_u16 ((gpointer) out, (gpointer) in, n_samples);
         break;
       case GST_AUDIO_FORMAT_S16:
-        audiomixer_orc_add_s16 ((gpointer) (outmap.data + out_offset * bpf),
-            (gpointer) (inmap.data + in_offset * bpf),
-            num_frames * aagg->info.channels);
+        audiomixer_orc_add_s16 ((gpointer) out, (gpointer) in, n_samples);
         break;
       case GST_AUDIO_FORMAT_U32:
-        audiomixer_orc_add_u32 ((gpointer) (outmap.data + out_offset * bpf),
-            (gpointer) (inmap.data + in_offset * bpf),
-            num_frames * aagg->info.channels);
+        audiomixer_orc_add_u32 ((gpointer) out, (gpointer) in, n_samples);
         break;
       case GST_AUDIO_FORMAT_S32:
-        audiomixer_orc_add_s32 ((gpointer) (outmap.data + out_offset * bpf),
-            (gpointer) (inmap.data + in_offset * bpf),
-            num_frames * aagg->info.channels);
+        audiomixer_orc_add_s32 ((gpointer) out, (gpointer) in, n_samples);
         break;
       case GST_AUDIO_FORMAT_F32:
-        audiomixer_orc_add_f32 ((gpointer) (outmap.data + out_offset * bpf),
-            (gpointer) (inmap.data + in_offset * bpf),
-            num_frames * aagg->info.channels);
+        audiomixer_orc_add_f32 ((gpointer) out, (gpointer) in, n_samples);
         break;
       case GST_AUDIO_FORMAT_F64:
-        audiomixer_orc_add_f64 ((gpointer) (outmap.data + out_offset * bpf),
-            (gpointer) (inmap.data + in_offset * bpf),
-            num_frames * aagg->info.channels);
+        audiomixer_orc_add_f64 ((gpointer) out, (gpointer) in, n_samples);
         break;
       default:
         g_assert_not_reached ();
         break;
     }
   } else {
-    switch (aagg->info.finfo->format) {
+    switch (format) {
       case GST_AUDIO_FORMAT_U8:
-        audiomixer_orc_add_volume_u8 ((gpointer) (outmap.data +
-                out_offset * bpf), (gpointer) (inmap.data + in_offset * bpf),
-            pad->volume_i8, num_frames * aagg->info.channels);
+        audiomixer_orc_add_volume_u8 ((gpointer) out, (gpointer) in,
+            input->volume_i8, n_samples);
         break;
       case GST_AUDIO_FORMAT_S8:
-        audiomixer_orc_add_volume_s8 ((gpointer) (outmap.data +
-                out_offset * bpf), (gpointer) (inmap.data + in_offset * bpf),
-            pad->volume_i8, num_frames * aagg->info.channels);
+        audiomixer_orc_add_volume_s8 ((gpointer) out, (gpointer) in,
+            input->volume_i8, n_samples);
         break;
       case GST_AUDIO_FORMAT_U16:
-        audiomixer_orc_add_volume_u16 ((gpointer) (outmap.data +
-                out_offset * bpf), (gpointer) (inmap.data + in_offset * bpf),
-            pad->volume_i16, num_frames * aagg->info.channels);
+        audiomixer_orc_add_volume_u16 ((gpointer) out, (gpointer) in,
+            input->volume_i16, n_samples);
         break;
       case GST_AUDIO_FORMAT_S16:
-        audiomixer_orc_add_volume_s16 ((gpointer) (outmap.data +
-                out_offset * bpf), (gpointer) (inmap.data + in_offset * bpf),
-            pad->volume_i16, num_frames * aagg->info.channels);
+        audiomixer_orc_add_volume_s16 ((gpointer) out, (gpointer) in,
+            input->volume_i16, n_samples);
         break;
       case GST_AUDIO_FORMAT_U32:
-        audiomixer_orc_add_volume_u32 ((gpointer) (outmap.data +
-                out_offset * bpf), (gpointer) (inmap.data + in_offset * bpf),
-            pad->volume_i32, num_frames * aagg->info.channels);
+        audiomixer_orc_add_volume_u32 ((gpointer) out, (gpointer) in,
+            input->volume_i32, n_samples);
         break;
       case GST_AUDIO_FORMAT_S32:
-        audiomixer_orc_add_volume_s32 ((gpointer) (outmap.data +
-                out_offset * bpf), (gpointer) (inmap.data + in_offset * bpf),
-            pad->volume_i32, num_frames * aagg->info.channels);
+        audiomixer_orc_add_volume_s32 ((gpointer) out, (gpointer) in,
+            input->volume_i32, n_samples);
         break;
       case GST_AUDIO_FORMAT_F32:
-        audiomixer_orc_add_volume_f32 ((gpointer) (outmap.data +
-                out_offset * bpf), (gpointer) (inmap.data + in_offset * bpf),
-            pad->volume, num_frames * aagg->info.channels);
+        audiomixer_orc_add_volume_f32 ((gpointer) out, (gpointer) in,
+            input->volume, n_samples);
         break;
       case GST_AUDIO_FORMAT_F64:
-        audiomixer_orc_add_volume_f64 ((gpointer) (outmap.data +
-                out_offset * bpf), (gpointer) (inmap.data + in_offset * bpf),
-            pad->volume, num_frames * aagg->info.channels);
+        audiomixer_orc_add_volume_f64 ((gpointer) out, (gpointer) in,
+            input->volume, n_samples);
         break;
       default:
         g_assert_not_reached ();
         break;
     }
   }
+}
+
+/* Called with object lock and pad object lock held */
+static gboolean
+gst_audiomixer_aggregate_one_buffer (GstAudioAggregator * aagg,
+    GstAudioAggregatorPad * aaggpad, GstBuffer * inbuf, guint in_offset,
+    GstBuffer * outbuf, guint out_offset, guint num_frames)
+{
+  GstAudioMixerPad *pad = GST_AUDIO_MIXER_PAD (aaggpad);
+  GstAudioMixerInput input;
+  GstMapInfo inmap;
+  GstMapInfo outmap;
+  gint bpf;
+
+  if (pad->mute || pad->volume < G_MINDOUBLE) {
+    GST_DEBUG_OBJECT (pad, "Skipping muted pad");
+    return FALSE;
+  }
+
+  bpf = GST_AUDIO_INFO_BPF (&aagg->info);
+
+  gst_buffer_map (outbuf, &outmap, GST_MAP_READWRITE);
+  gst_buffer_map (inbuf, &inmap, GST_MAP_READ);
+  GST_LOG_OBJECT (pad, "mixing %u bytes at offset %u from offset %u",
+      num_frames * bpf, out_offset * bpf, in_offset * bpf);
+
+  input.volume = pad->volume;
+  input.volume_i32 = pad->volume_i32;
+  input.volume_i16 = pad->volume_i16;
+  input.volume_i8 = pad->volume_i8;
+
+  /* further buffers, need to add them */
+  gst_audiomixer_mix_samples (aagg->info.finfo->format, &input,
+      outmap.data + out_offset * bpf, inmap.data + in_offset * bpf,
+      num_frames * aagg->info.channels);
+
   gst_buffer_unmap (inbuf, &inmap);
   gst_buffer_unmap (outbuf, &outmap);
 
   return TRUE;
 }
 
+/* Called with object lock held */
+static gboolean
+gst_audiomixer_aggregate_buffers (GstAudioAggregator * aagg,
+    const GstAudioAggregatorInput * inputs, guint n_inputs, GstBuffer * outbuf)
+{
+  GstAudioMixer *audiomixer = GST_AUDIO_MIXER (aagg);
+  GstAudioMixerInput *mix_inputs;
+  GstMapInfo outmap;
+  guint i, n_mix_inputs = 0;
+  guint bpf, block_frames, start, end;
+
+  bpf = GST_AUDIO_INFO_BPF (&aagg->info);
+
+  /* take the volume of each pad and map the buffers of the ones that are
+   * not muted once for all blocks */
+  g_array_set_size (audiomixer->mix_inputs, n_inputs);
+  mix_inputs = (GstAudioMixerInput *) audiomixer->mix_inputs->data;
+  end = 0;
+
+  for (i = 0; i < n_inputs; i++) {
+    GstAudioMixerPad *pad = GST_AUDIO_MIXER_PAD (inputs[i].pad);
+    GstAudioMixerInput *input = &mix_inputs[n_mix_inputs];
+
+    GST_OBJECT_LOCK (pad);
+    input->volume = pad->volume;
+    input->volume_i32 = pad->volume_i32;
+    input->volume_i16 = pad->volume_i16;
+    input->volume_i8 = pad->volume_i8;
+    if (pad->mute || pad->volume < G_MINDOUBLE) {
+      GST_OBJECT_UNLOCK (pad);
+      GST_DEBUG_OBJECT (pad, "Skipping muted pad");
+      continue;
+    }
+    GST_OBJECT_UNLOCK (pad);
+
+    GST_LOG_OBJECT (pad, "mixing %u bytes at offset %u from offset %u",
+        inputs[i].num_frames * bpf, inputs[i].out_offset * bpf,
+        inputs[i].in_offset * bpf);
+
+    input->buffer = inputs[i].buffer;
+    gst_buffer_map (input->buffer, &input->map, GST_MAP_READ);
+    input->data = input->map.data + inputs[i].in_offset * bpf;
+    input->out_offset = inputs[i].out_offset;
+    input->num_frames = inputs[i].num_frames;
+    end = MAX (end, input->out_offset + input->num_frames);
+    n_mix_inputs++;
+  }
+
+  if (n_mix_inputs == 0)
+    return FALSE;
+
+  gst_buffer_map (outbuf, &outmap, GST_MAP_READWRITE);
+
+  /* the inputs are added in the order of the pads for each block, which
+   * gives the same result as adding them one after another */
+  block_frames = MAX (1, MIX_BLOCK_SIZE / bpf);
+  for (start = 0; start < end; start += block_frames) {
+    guint block_end = MIN (start + block_frames, end);
+
+    for (i = 0; i < n_mix_inputs; i++) {
+      const GstAudioMixerInput *input = &mix_inputs[i];
+      guint first, last;
+
+      first = MAX (start, input->out_offset);
+      last = MIN (block_end, input->out_offset + input->num_frames);
+      if (first >= last)
+        continue;
+
+      gst_audiomixer_mix_samples (aagg->info.finfo->format, input,
+          outmap.data + first * bpf,
+          input->data + (first - input->out_offset) * bpf,
+          (last - first) * aagg->info.channels);
+    }
+  }
+
+  gst_buffer_unmap (outbuf, &outmap);
+  for (i = 0; i < n_mix_inputs; i++)
+    gst_buffer_unmap (mix_inputs[i].buffer, &mix_inputs[i].map);
+
+  return TRUE;
+}
+
 
 /* GstChildProxy implementation */
 static GObject *
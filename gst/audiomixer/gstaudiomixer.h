@@ -53,6 +53,10 @@ struct _GstAudioMixer {
 
   /* target caps (set via property) */
   GstCaps *filter_caps;
+
+  /* GstAudioMixerInput of the buffers mixed at once, reused for each output
+   * buffer */
+  GArray *mix_inputs;
 };
 
 struct _GstAudioMixerClass {
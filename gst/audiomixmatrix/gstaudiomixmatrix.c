@@ -73,6 +73,10 @@
 #include <string.h>
 #include <math.h>
 
+#if defined (__SSE2__)
+#include <emmintrin.h>
+#endif
+
 GST_DEBUG_CATEGORY_STATIC (audiomixmatrix_debug);
 #define GST_CAT_DEFAULT audiomixmatrix_debug
 
@@ -224,12 +228,38 @@ gst_audio_mix_matrix_init (GstAudioMixMatrix * self)
   self->in_channels = 0;
   self->out_channels = 0;
   self->matrix = NULL;
+  self->matrix_in_channels = 0;
+  self->matrix_out_channels = 0;
   self->channel_mask = 0;
+  self->f32_conv_matrix = NULL;
+  self->f64_conv_matrix = NULL;
   self->s16_conv_matrix = NULL;
   self->s32_conv_matrix = NULL;
+  self->accumulator = NULL;
+  self->sparse_offsets = NULL;
+  self->sparse_inputs = NULL;
   self->mode = GST_AUDIO_MIX_MATRIX_MODE_MANUAL;
 }
 
+static void
+gst_audio_mix_matrix_free_conv_matrices (GstAudioMixMatrix * self)
+{
+  g_free (self->f32_conv_matrix);
+  self->f32_conv_matrix = NULL;
+  g_free (self->f64_conv_matrix);
+  self->f64_conv_matrix = NULL;
+  g_free (self->s16_conv_matrix);
+  self->s16_conv_matrix = NULL;
+  g_free (self->s32_conv_matrix);
+  self->s32_conv_matrix = NULL;
+  g_free (self->accumulator);
+  self->accumulator = NULL;
+  g_free (self->sparse_offsets);
+  self->sparse_offsets = NULL;
+  g_free (self->sparse_inputs);
+  self->sparse_inputs = NULL;
+}
+
 static void
 gst_audio_mix_matrix_dispose (GObject * object)
 {
@@ -239,46 +269,146 @@ gst_audio_mix_matrix_dispose (GObject * object)
     g_free (self->matrix);
     self->matrix = NULL;
   }
+  gst_audio_mix_matrix_free_conv_matrices (self);
 
   G_OBJECT_CLASS (gst_audio_mix_matrix_parent_class)->dispose (object);
 }
 
+static void
+gst_audio_mix_matrix_convert_f32_matrix (GstAudioMixMatrix * self)
+{
+  guint in, out;
+
+  self->f32_conv_matrix = g_new0 (gfloat,
+      self->in_channels * self->conv_stride);
+  for (out = 0; out < self->out_channels; out++) {
+    for (in = 0; in < self->in_channels; in++) {
+      self->f32_conv_matrix[in * self->conv_stride + out] =
+          (gfloat) self->matrix[out * self->in_channels + in];
+    }
+  }
+}
+
+static void
+gst_audio_mix_matrix_convert_f64_matrix (GstAudioMixMatrix * self)
+{
+  guint in, out;
+
+  self->f64_conv_matrix = g_new0 (gdouble,
+      self->in_channels * self->conv_stride);
+  for (out = 0; out < self->out_channels; out++) {
+    for (in = 0; in < self->in_channels; in++) {
+      self->f64_conv_matrix[in * self->conv_stride + out] =
+          self->matrix[out * self->in_channels + in];
+    }
+  }
+}
+
 static void
 gst_audio_mix_matrix_convert_s16_matrix (GstAudioMixMatrix * self)
 {
-  gint i;
+  guint in, out;
 
   /* converted bits - input bits - sign - bits needed for channel */
   self->shift_bytes = 32 - 16 - 1 - ceil (log (self->in_channels) / log (2));
 
-  if (self->s16_conv_matrix)
-    g_free (self->s16_conv_matrix);
-  self->s16_conv_matrix =
-      g_new (gint32, self->in_channels * self->out_channels);
-  for (i = 0; i < self->in_channels * self->out_channels; i++) {
-    self->s16_conv_matrix[i] =
-        (gint32) ((self->matrix[i]) * (1 << self->shift_bytes));
+  self->s16_conv_matrix = g_new0 (gint32,
+      self->in_channels * self->conv_stride);
+  for (out = 0; out < self->out_channels; out++) {
+    for (in = 0; in < self->in_channels; in++) {
+      self->s16_conv_matrix[in * self->conv_stride + out] =
+          (gint32) ((self->matrix[out * self->in_channels + in]) *
+          (1 << self->shift_bytes));
+    }
   }
 }
 
 static void
 gst_audio_mix_matrix_convert_s32_matrix (GstAudioMixMatrix * self)
 {
-  gint i;
+  guint in, out;
 
   /* converted bits - input bits - sign - bits needed for channel */
   self->shift_bytes = 64 - 32 - 1 - (gint) (log (self->in_channels) / log (2));
 
-  if (self->s32_conv_matrix)
-    g_free (self->s32_conv_matrix);
-  self->s32_conv_matrix =
-      g_new (gint64, self->in_channels * self->out_channels);
-  for (i = 0; i < self->in_channels * self->out_channels; i++) {
-    self->s32_conv_matrix[i] =
-        (gint64) ((self->matrix[i]) * (1 << self->shift_bytes));
+  self->s32_conv_matrix = g_new0 (gint64,
+      self->in_channels * self->conv_stride);
+  for (out = 0; out < self->out_channels; out++) {
+    for (in = 0; in < self->in_channels; in++) {
+      self->s32_conv_matrix[in * self->conv_stride + out] =
+          (gint64) ((self->matrix[out * self->in_channels + in]) *
+          (G_GINT64_CONSTANT (1) << self->shift_bytes));
+    }
   }
 }
 
+/* Lists the non-zero coefficients of each output channel and converts the
+ * matrix to the sample type of the negotiated format. Nothing is prepared
+ * while the matrix doesn't have the size given by the channel properties,
+ * set_caps() refuses such a matrix. Called with the object lock held. */
+static void
+gst_audio_mix_matrix_prepare (GstAudioMixMatrix * self)
+{
+  guint in, out, n_coefficients = 0;
+
+  gst_audio_mix_matrix_free_conv_matrices (self);
+
+  if (!self->matrix || self->in_channels == 0 || self->out_channels == 0)
+    return;
+  if (self->matrix_in_channels != self->in_channels ||
+      self->matrix_out_channels != self->out_channels)
+    return;
+
+  self->conv_stride = GST_ROUND_UP_4 (self->out_channels);
+  self->accumulator = g_new (gint64, self->conv_stride);
+
+  self->sparse_offsets = g_new (guint, self->out_channels + 1);
+  self->sparse_inputs = g_new (guint, self->in_channels * self->out_channels);
+  self->permutation = TRUE;
+
+  for (out = 0; out < self->out_channels; out++) {
+    self->sparse_offsets[out] = n_coefficients;
+    for (in = 0; in < self->in_channels; in++) {
+      gdouble coefficient = self->matrix[out * self->in_channels + in];
+
+      if (coefficient == 0.0)
+        continue;
+
+      /* a coefficient of 1 is exact in all the converted matrices, so
+       * outputs with only such a coefficient are copies of their input */
+      if (coefficient != 1.0 || n_coefficients > self->sparse_offsets[out])
+        self->permutation = FALSE;
+      self->sparse_inputs[n_coefficients++] = in;
+    }
+  }
+  self->sparse_offsets[self->out_channels] = n_coefficients;
+  self->sparse = n_coefficients * 2 <= self->in_channels * self->out_channels;
+
+  GST_DEBUG_OBJECT (self, "%u of %u coefficients are non-zero%s",
+      n_coefficients, self->in_channels * self->out_channels,
+      self->permutation ? ", permutation matrix" : "");
+
+  switch (self->format) {
+    case GST_AUDIO_FORMAT_F32LE:
+    case GST_AUDIO_FORMAT_F32BE:
+      gst_audio_mix_matrix_convert_f32_matrix (self);
+      break;
+    case GST_AUDIO_FORMAT_F64LE:
+    case GST_AUDIO_FORMAT_F64BE:
+      gst_audio_mix_matrix_convert_f64_matrix (self);
+      break;
+    case GST_AUDIO_FORMAT_S16LE:
+    case GST_AUDIO_FORMAT_S16BE:
+      gst_audio_mix_matrix_convert_s16_matrix (self);
+      break;
+    case GST_AUDIO_FORMAT_S32LE:
+    case GST_AUDIO_FORMAT_S32BE:
+      gst_audio_mix_matrix_convert_s32_matrix (self);
+      break;
+    default:
+      break;
+  }
+}
 
 static void
 gst_audio_mix_matrix_set_property (GObject * object, guint prop_id,
@@ -288,42 +418,53 @@ gst_audio_mix_matrix_set_property (GObject * object, guint prop_id,
 
   switch (prop_id) {
     case PROP_IN_CHANNELS:
+      GST_OBJECT_LOCK (self);
       self->in_channels = g_value_get_uint (value);
-      if (self->matrix) {
-        gst_audio_mix_matrix_convert_s16_matrix (self);
-        gst_audio_mix_matrix_convert_s32_matrix (self);
-      }
+      gst_audio_mix_matrix_prepare (self);
+      GST_OBJECT_UNLOCK (self);
       break;
     case PROP_OUT_CHANNELS:
+      GST_OBJECT_LOCK (self);
       self->out_channels = g_value_get_uint (value);
-      if (self->matrix) {
-        gst_audio_mix_matrix_convert_s16_matrix (self);
-        gst_audio_mix_matrix_convert_s32_matrix (self);
-      }
+      gst_audio_mix_matrix_prepare (self);
+      GST_OBJECT_UNLOCK (self);
       break;
     case PROP_MATRIX:{
-      gint in, out;
+      guint in_channels, out_channels, in, out;
+      gdouble *matrix;
 
-      if (self->matrix)
-        g_free (self->matrix);
-      self->matrix = g_new (gdouble, self->in_channels * self->out_channels);
+      GST_OBJECT_LOCK (self);
+      in_channels = self->in_channels;
+      out_channels = self->out_channels;
+      GST_OBJECT_UNLOCK (self);
 
-      g_return_if_fail (gst_value_array_get_size (value) == self->out_channels);
-      for (out = 0; out < self->out_channels; out++) {
+      /* check the whole matrix before replacing the current one */
+      g_return_if_fail (gst_value_array_get_size (value) == out_channels);
+      for (out = 0; out < out_channels; out++) {
         const GValue *row = gst_value_array_get_value (value, out);
-        g_return_if_fail (gst_value_array_get_size (row) == self->in_channels);
-        for (in = 0; in < self->in_channels; in++) {
-          const GValue *itm;
-          gdouble coefficient;
-
-          itm = gst_value_array_get_value (row, in);
+        g_return_if_fail (gst_value_array_get_size (row) == in_channels);
+        for (in = 0; in < in_channels; in++) {
+          const GValue *itm = gst_value_array_get_value (row, in);
           g_return_if_fail (G_VALUE_HOLDS_DOUBLE (itm));
-          coefficient = g_value_get_double (itm);
-          self->matrix[out * self->in_channels + in] = coefficient;
         }
       }
-      gst_audio_mix_matrix_convert_s16_matrix (self);
-      gst_audio_mix_matrix_convert_s32_matrix (self);
+
+      matrix = g_new (gdouble, in_channels * out_channels);
+      for (out = 0; out < out_channels; out++) {
+        const GValue *row = gst_value_array_get_value (value, out);
+        for (in = 0; in < in_channels; in++) {
+          const GValue *itm = gst_value_array_get_value (row, in);
+          matrix[out * in_channels + in] = g_value_get_double (itm);
+        }
+      }
+
+      GST_OBJECT_LOCK (self);
+      g_free (self->matrix);
+      self->matrix = matrix;
+      self->matrix_in_channels = in_channels;
+      self->matrix_out_channels = out_channels;
+      gst_audio_mix_matrix_prepare (self);
+      GST_OBJECT_UNLOCK (self);
       break;
     }
     case PROP_CHANNEL_MASK:
@@ -354,8 +495,11 @@ gst_audio_mix_matrix_get_property (GObject * object, guint prop_id,
     case PROP_MATRIX:{
       gint in, out;
 
-      if (self->matrix == NULL)
+      GST_OBJECT_LOCK (self);
+      if (self->matrix == NULL) {
+        GST_OBJECT_UNLOCK (self);
         break;
+      }
 
       for (out = 0; out < self->out_channels; out++) {
         GValue row = G_VALUE_INIT;
@@ -370,6 +514,7 @@ gst_audio_mix_matrix_get_property (GObject * object, guint prop_id,
         gst_value_array_append_value (value, &row);
         g_value_unset (&row);
       }
+      GST_OBJECT_UNLOCK (self);
       break;
     }
     case PROP_CHANNEL_MASK:
@@ -395,20 +540,181 @@ gst_audio_mix_matrix_change_state (GstElement * element,
       (element, transition);
 
   if (transition == GST_STATE_CHANGE_PAUSED_TO_READY) {
-    if (self->s16_conv_matrix) {
-      g_free (self->s16_conv_matrix);
-      self->s16_conv_matrix = NULL;
-    }
+    GST_OBJECT_LOCK (self);
+    gst_audio_mix_matrix_free_conv_matrices (self);
+    GST_OBJECT_UNLOCK (self);
+  }
+
+  return s;
+}
+
+/* Each output sample is the sum of the input samples of its frame multiplied
+ * by the coefficients of its output channel, in the order of the input
+ * channels. Outputs of a permutation matrix are copied from their input.
+ * If at most half of the coefficients are non-zero, only those are
+ * multiplied. Otherwise each input sample is accumulated into all output
+ * channels at once, which can be vectorized over the output channels.
+ * F32 is mixed with float coefficients and sums, so it can differ from a mix
+ * in double precision in the last bits */
+#define DEFINE_MIX_SPARSE_FUNCS(name,type,ctype,atype,finish)                  \
+static void                                                                   \
+gst_audio_mix_matrix_mix_##name##_permutation (GstAudioMixMatrix * self,      \
+    const type * inarray, type * outarray, guint n_samples)                   \
+{                                                                             \
+  const guint *offsets = self->sparse_offsets;                                \
+  const guint *inputs = self->sparse_inputs;                                  \
+  guint inchannels = self->in_channels;                                       \
+  guint outchannels = self->out_channels;                                     \
+  guint sample, out;                                                          \
+                                                                              \
+  for (sample = 0; sample < n_samples; sample++) {                            \
+    for (out = 0; out < outchannels; out++) {                                 \
+      if (offsets[out] < offsets[out + 1])                                    \
+        outarray[out] = inarray[inputs[offsets[out]]];                        \
+      else                                                                    \
+        outarray[out] = 0;                                                    \
+    }                                                                         \
+    inarray += inchannels;                                                    \
+    outarray += outchannels;                                                  \
+  }                                                                           \
+}                                                                             \
+                                                                              \
+static void                                                                   \
+gst_audio_mix_matrix_mix_##name##_sparse (GstAudioMixMatrix * self,           \
+    const type * inarray, type * outarray, guint n_samples)                   \
+{                                                                             \
+  const ctype *conv_matrix = self->name##_conv_matrix;                        \
+  const guint *offsets = self->sparse_offsets;                                \
+  const guint *inputs = self->sparse_inputs;                                  \
+  guint inchannels = self->in_channels;                                       \
+  guint outchannels = self->out_channels;                                     \
+  guint stride = self->conv_stride;                                           \
+  guint sample, out, i;                                                       \
+                                                                              \
+  for (sample = 0; sample < n_samples; sample++) {                            \
+    for (out = 0; out < outchannels; out++) {                                 \
+      atype outval = 0;                                                       \
+      for (i = offsets[out]; i < offsets[out + 1]; i++) {                     \
+        guint in = inputs[i];                                                 \
+        outval += (atype) (inarray[in] * conv_matrix[in * stride + out]);     \
+      }                                                                       \
+      outarray[out] = (type) finish (outval);                                 \
+    }                                                                         \
+    inarray += inchannels;                                                    \
+    outarray += outchannels;                                                  \
+  }                                                                           \
+}
+
+#define DEFINE_MIX_DENSE_FUNC(name,type,ctype,atype,finish)                    \
+static void                                                                   \
+gst_audio_mix_matrix_mix_##name##_dense (GstAudioMixMatrix * self,            \
+    const type * inarray, type * outarray, guint n_samples)                   \
+{                                                                             \
+  const ctype *conv_matrix = self->name##_conv_matrix;                        \
+  atype *outvals = self->accumulator;                                         \
+  guint inchannels = self->in_channels;                                       \
+  guint outchannels = self->out_channels;                                     \
+  guint stride = self->conv_stride;                                           \
+  guint sample, out, in;                                                      \
+                                                                              \
+  for (sample = 0; sample < n_samples; sample++) {                            \
+    for (out = 0; out < outchannels; out++)                                   \
+      outvals[out] = 0;                                                       \
+    for (in = 0; in < inchannels; in++) {                                     \
+      const ctype *coefficients = conv_matrix + in * stride;                  \
+      type inval = inarray[in];                                               \
+      for (out = 0; out < outchannels; out++)                                 \
+        outvals[out] += (atype) (inval * coefficients[out]);                  \
+    }                                                                         \
+    for (out = 0; out < outchannels; out++)                                   \
+      outarray[out] = (type) finish (outvals[out]);                           \
+    inarray += inchannels;                                                    \
+    outarray += outchannels;                                                  \
+  }                                                                           \
+}
+
+#define FINISH_FLOAT(outval) (outval)
+#define FINISH_INT(outval) ((outval) >> self->shift_bytes)
 
-    if (self->s32_conv_matrix) {
-      g_free (self->s32_conv_matrix);
-      self->s32_conv_matrix = NULL;
+DEFINE_MIX_SPARSE_FUNCS (f32, gfloat, gfloat, gfloat, FINISH_FLOAT)
+DEFINE_MIX_SPARSE_FUNCS (f64, gdouble, gdouble, gdouble, FINISH_FLOAT)
+DEFINE_MIX_SPARSE_FUNCS (s16, gint16, gint32, gint32, FINISH_INT)
+DEFINE_MIX_SPARSE_FUNCS (s32, gint32, gint64, gint64, FINISH_INT)
+DEFINE_MIX_DENSE_FUNC (s16, gint16, gint32, gint32, FINISH_INT)
+DEFINE_MIX_DENSE_FUNC (s32, gint32, gint64, gint64, FINISH_INT)
+
+#if defined (__SSE2__)
+/* the converted matrices are padded to a multiple of 4 output channels, so
+ * the coefficients of 4 float or 2 double output channels can be loaded at
+ * once */
+static void
+gst_audio_mix_matrix_mix_f32_dense (GstAudioMixMatrix * self,
+    const gfloat * inarray, gfloat * outarray, guint n_samples)
+{
+  const gfloat *conv_matrix = self->f32_conv_matrix;
+  gfloat *outvals = self->accumulator;
+  guint inchannels = self->in_channels;
+  guint outchannels = self->out_channels;
+  guint stride = self->conv_stride;
+  guint sample, out, in;
+
+  for (sample = 0; sample < n_samples; sample++) {
+    for (out = 0; out < stride; out += 4) {
+      __m128 outval = _mm_setzero_ps ();
+
+      for (in = 0; in < inchannels; in++)
+        outval = _mm_add_ps (outval, _mm_mul_ps (_mm_set1_ps (inarray[in]),
+                _mm_loadu_ps (conv_matrix + in * stride + out)));
+      _mm_storeu_ps (outvals + out, outval);
     }
+    memcpy (outarray, outvals, outchannels * sizeof (gfloat));
+    inarray += inchannels;
+    outarray += outchannels;
   }
+}
 
-  return s;
+static void
+gst_audio_mix_matrix_mix_f64_dense (GstAudioMixMatrix * self,
+    const gdouble * inarray, gdouble * outarray, guint n_samples)
+{
+  const gdouble *conv_matrix = self->f64_conv_matrix;
+  gdouble *outvals = self->accumulator;
+  guint inchannels = self->in_channels;
+  guint outchannels = self->out_channels;
+  guint stride = self->conv_stride;
+  guint sample, out, in;
+
+  for (sample = 0; sample < n_samples; sample++) {
+    for (out = 0; out < stride; out += 2) {
+      __m128d outval = _mm_setzero_pd ();
+
+      for (in = 0; in < inchannels; in++)
+        outval = _mm_add_pd (outval, _mm_mul_pd (_mm_set1_pd (inarray[in]),
+                _mm_loadu_pd (conv_matrix + in * stride + out)));
+      _mm_storeu_pd (outvals + out, outval);
+    }
+    memcpy (outarray, outvals, outchannels * sizeof (gdouble));
+    inarray += inchannels;
+    outarray += outchannels;
+  }
 }
+#else
+DEFINE_MIX_DENSE_FUNC (f32, gfloat, gfloat, gfloat, FINISH_FLOAT)
+DEFINE_MIX_DENSE_FUNC (f64, gdouble, gdouble, gdouble, FINISH_FLOAT)
+#endif
 
+#define MIX(name,type)                                                         \
+  G_STMT_START {                                                              \
+    if (self->permutation)                                                    \
+      gst_audio_mix_matrix_mix_##name##_permutation (self,                    \
+          (const type *) inmap.data, (type *) outmap.data, n_samples);        \
+    else if (self->sparse)                                                    \
+      gst_audio_mix_matrix_mix_##name##_sparse (self,                         \
+          (const type *) inmap.data, (type *) outmap.data, n_samples);        \
+    else                                                                      \
+      gst_audio_mix_matrix_mix_##name##_dense (self,                          \
+          (const type *) inmap.data, (type *) outmap.data, n_samples);        \
+  } G_STMT_END
 
 static GstFlowReturn
 gst_audio_mix_matrix_transform (GstBaseTransform * vfilter,
@@ -416,10 +722,8 @@ gst_audio_mix_matrix_transform (GstBaseTransform * vfilter,
 {
   GstMapInfo inmap, outmap;
   GstAudioMixMatrix *self = GST_AUDIO_MIX_MATRIX (vfilter);
-  gint in, out, sample;
-  guint inchannels = self->in_channels;
-  guint outchannels = self->out_channels;
-  gdouble *matrix = self->matrix;
+  const GstAudioFormatInfo *finfo;
+  gsize n_samples, sample_size;
 
   if (!gst_buffer_map (inbuf, &inmap, GST_MAP_READ)) {
     return GST_FLOW_ERROR;
@@ -429,109 +733,57 @@ gst_audio_mix_matrix_transform (GstBaseTransform * vfilter,
     return GST_FLOW_ERROR;
   }
 
+  /* the properties can change the matrix and the channels meanwhile */
+  GST_OBJECT_LOCK (self);
+
+  finfo = gst_audio_format_get_info (self->format);
+  sample_size = GST_AUDIO_FORMAT_INFO_WIDTH (finfo) / 8;
+  n_samples = self->out_channels && sample_size ?
+      outmap.size / (sample_size * self->out_channels) : 0;
+  if (!self->sparse_offsets ||
+      inmap.size < n_samples * sample_size * self->in_channels) {
+    GST_OBJECT_UNLOCK (self);
+    gst_buffer_unmap (inbuf, &inmap);
+    gst_buffer_unmap (outbuf, &outmap);
+    GST_ELEMENT_ERROR (self, CORE, NEGOTIATION, (NULL),
+        ("The matrix doesn't match the negotiated channels"));
+    return GST_FLOW_NOT_NEGOTIATED;
+  }
+
   switch (self->format) {
     case GST_AUDIO_FORMAT_F32LE:
-    case GST_AUDIO_FORMAT_F32BE:{
-      const gfloat *inarray;
-      gfloat *outarray;
-      guint n_samples = outmap.size / (sizeof (gfloat) * outchannels);
-
-      inarray = (gfloat *) inmap.data;
-      outarray = (gfloat *) outmap.data;
-
-      for (sample = 0; sample < n_samples; sample++) {
-        for (out = 0; out < outchannels; out++) {
-          gfloat outval = 0;
-          for (in = 0; in < inchannels; in++) {
-            outval +=
-                inarray[sample * inchannels +
-                in] * matrix[out * inchannels + in];
-          }
-          outarray[sample * outchannels + out] = outval;
-        }
-      }
+    case GST_AUDIO_FORMAT_F32BE:
+      MIX (f32, gfloat);
       break;
-    }
     case GST_AUDIO_FORMAT_F64LE:
-    case GST_AUDIO_FORMAT_F64BE:{
-      const gdouble *inarray;
-      gdouble *outarray;
-      guint n_samples = outmap.size / (sizeof (gdouble) * outchannels);
-
-      inarray = (gdouble *) inmap.data;
-      outarray = (gdouble *) outmap.data;
-
-      for (sample = 0; sample < n_samples; sample++) {
-        for (out = 0; out < outchannels; out++) {
-          gdouble outval = 0;
-          for (in = 0; in < inchannels; in++) {
-            outval +=
-                inarray[sample * inchannels +
-                in] * matrix[out * inchannels + in];
-          }
-          outarray[sample * outchannels + out] = outval;
-        }
-      }
+    case GST_AUDIO_FORMAT_F64BE:
+      MIX (f64, gdouble);
       break;
-    }
     case GST_AUDIO_FORMAT_S16LE:
-    case GST_AUDIO_FORMAT_S16BE:{
-      const gint16 *inarray;
-      gint16 *outarray;
-      guint n_samples = outmap.size / (sizeof (gint16) * outchannels);
-      guint n = self->shift_bytes;
-      gint32 *conv_matrix = self->s16_conv_matrix;
-
-      inarray = (gint16 *) inmap.data;
-      outarray = (gint16 *) outmap.data;
-
-      for (sample = 0; sample < n_samples; sample++) {
-        for (out = 0; out < outchannels; out++) {
-          gint32 outval = 0;
-          for (in = 0; in < inchannels; in++) {
-            outval += (gint32) (inarray[sample * inchannels + in] *
-                conv_matrix[out * inchannels + in]);
-          }
-          outarray[sample * outchannels + out] = (gint16) (outval >> n);
-        }
-      }
+    case GST_AUDIO_FORMAT_S16BE:
+      MIX (s16, gint16);
       break;
-    }
     case GST_AUDIO_FORMAT_S32LE:
-    case GST_AUDIO_FORMAT_S32BE:{
-      const gint32 *inarray;
-      gint32 *outarray;
-      guint n_samples = outmap.size / (sizeof (gint32) * outchannels);
-      guint n = self->shift_bytes;
-      gint64 *conv_matrix = self->s32_conv_matrix;
-
-      inarray = (gint32 *) inmap.data;
-      outarray = (gint32 *) outmap.data;
-
-      for (sample = 0; sample < n_samples; sample++) {
-        for (out = 0; out < outchannels; out++) {
-          gint64 outval = 0;
-          for (in = 0; in < inchannels; in++) {
-            outval += (gint64) (inarray[sample * inchannels + in] *
-                conv_matrix[out * inchannels + in]);
-          }
-          outarray[sample * outchannels + out] = (gint32) (outval >> n);
-        }
-      }
+    case GST_AUDIO_FORMAT_S32BE:
+      MIX (s32, gint32);
       break;
-    }
     default:
+      GST_OBJECT_UNLOCK (self);
       gst_buffer_unmap (inbuf, &inmap);
       gst_buffer_unmap (outbuf, &outmap);
       return GST_FLOW_NOT_SUPPORTED;
 
   }
 
+  GST_OBJECT_UNLOCK (self);
+
   gst_buffer_unmap (inbuf, &inmap);
   gst_buffer_unmap (outbuf, &outmap);
   return GST_FLOW_OK;
 }
 
+#undef MIX
+
 static gboolean
 gst_audio_mix_matrix_get_unit_size (GstBaseTransform * trans,
     GstCaps * caps, gsize * size)
@@ -559,6 +811,8 @@ gst_audio_mix_matrix_set_caps (GstBaseTransform * trans, GstCaps * incaps,
   if (!gst_audio_info_from_caps (&out_info, outcaps))
     return FALSE;
 
+  GST_OBJECT_LOCK (self);
+
   self->format = info.finfo->format;
 
   if (self->mode == GST_AUDIO_MIX_MATRIX_MODE_FIRST_CHANNELS) {
@@ -567,7 +821,10 @@ gst_audio_mix_matrix_set_caps (GstBaseTransform * trans, GstCaps * incaps,
     self->in_channels = info.channels;
     self->out_channels = out_info.channels;
 
+    g_free (self->matrix);
     self->matrix = g_new (gdouble, self->in_channels * self->out_channels);
+    self->matrix_in_channels = self->in_channels;
+    self->matrix_out_channels = self->out_channels;
 
     for (out = 0; out < self->out_channels; out++) {
       for (in = 0; in < self->in_channels; in++) {
@@ -575,27 +832,20 @@ gst_audio_mix_matrix_set_caps (GstBaseTransform * trans, GstCaps * incaps,
       }
     }
   } else if (!self->matrix || info.channels != self->in_channels ||
-      out_info.channels != self->out_channels) {
+      out_info.channels != self->out_channels ||
+      self->matrix_in_channels != self->in_channels ||
+      self->matrix_out_channels != self->out_channels) {
+    GST_OBJECT_UNLOCK (self);
     GST_ELEMENT_ERROR (self, LIBRARY, SETTINGS,
         ("Erroneous matrix detected"),
         ("Please enter a matrix with the correct input and output channels"));
     return FALSE;
   }
 
-  switch (self->format) {
-    case GST_AUDIO_FORMAT_S16LE:
-    case GST_AUDIO_FORMAT_S16BE:{
-      gst_audio_mix_matrix_convert_s16_matrix (self);
-      break;
-    }
-    case GST_AUDIO_FORMAT_S32LE:
-    case GST_AUDIO_FORMAT_S32BE:{
-      gst_audio_mix_matrix_convert_s32_matrix (self);
-      break;
-    }
-    default:
-      break;
-  }
+  gst_audio_mix_matrix_prepare (self);
+
+  GST_OBJECT_UNLOCK (self);
+
   return TRUE;
 }
 
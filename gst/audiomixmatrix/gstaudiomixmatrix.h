@@ -56,12 +56,31 @@ struct _GstAudioMixMatrix
   guint in_channels;
   guint out_channels;
   gdouble *matrix;
+  /* the channels the matrix was set for, the in and out channels can be
+   * changed afterwards */
+  guint matrix_in_channels;
+  guint matrix_out_channels;
   guint64 channel_mask;
   GstAudioMixMatrixMode mode;
+  gfloat *f32_conv_matrix;
+  gdouble *f64_conv_matrix;
   gint32 *s16_conv_matrix;
   gint64 *s32_conv_matrix;
   gint shift_bytes;
 
+  /* the converted matrices are transposed: the coefficients of an input
+   * channel for all output channels follow each other, padded to
+   * conv_stride */
+  guint conv_stride;
+  gpointer accumulator;
+
+  /* the non-zero coefficients of output channel out are those of the input
+   * channels sparse_inputs[sparse_offsets[out]..sparse_offsets[out+1]-1] */
+  gboolean sparse;
+  gboolean permutation;
+  guint *sparse_offsets;
+  guint *sparse_inputs;
+
   GstAudioFormat format;
 };
 
@@ -309,7 +309,8 @@ gst_compositor_pad_set_info (GstVideoAggregatorPad * pad,
         GST_VIDEO_INFO_FORMAT (current_info),
         GST_VIDEO_INFO_FORMAT (&tmp_info));
 
-    cpad->convert = gst_video_converter_new (current_info, &tmp_info, NULL);
+    cpad->convert = gst_video_converter_new (current_info, &tmp_info,
+        gst_video_aggregator_pad_get_converter_config (pad));
     cpad->conversion_info = tmp_info;
     if (!cpad->convert) {
       g_free (colorimetry);
@@ -368,7 +369,6 @@ gst_compositor_pad_prepare_frame (GstVideoAggregatorPad * pad,
   GstVideoFrame *converted_frame;
   GstBuffer *converted_buf = NULL;
   GstVideoFrame *frame;
-  static GstAllocationParams params = { 0, 15, 0, 0, };
   gint width, height;
   gboolean frame_obscured = FALSE;
   GList *l;
@@ -442,7 +442,8 @@ gst_compositor_pad_prepare_frame (GstVideoAggregatorPad * pad,
           GST_VIDEO_INFO_FORMAT (&tmp_info));
 
       cpad->convert =
-          gst_video_converter_new (&pad->buffer_vinfo, &tmp_info, NULL);
+          gst_video_converter_new (&pad->buffer_vinfo, &tmp_info,
+          gst_video_aggregator_pad_get_converter_config (pad));
       cpad->conversion_info = tmp_info;
 
       if (!cpad->convert) {
@@ -537,12 +538,14 @@ gst_compositor_pad_prepare_frame (GstVideoAggregatorPad * pad,
     converted_size = GST_VIDEO_INFO_SIZE (&cpad->conversion_info);
     outsize = GST_VIDEO_INFO_SIZE (&vagg->info);
     converted_size = converted_size > outsize ? converted_size : outsize;
-    converted_buf = gst_buffer_new_allocate (NULL, converted_size, &params);
+    converted_buf =
+        gst_video_aggregator_pad_acquire_converted_buffer (pad, converted_size);
 
     if (!gst_video_frame_map (converted_frame, &(cpad->conversion_info),
             converted_buf, GST_MAP_READWRITE)) {
       GST_WARNING_OBJECT (vagg, "Could not map converted frame");
 
+      gst_buffer_unref (converted_buf);
       g_slice_free (GstVideoFrame, converted_frame);
       gst_video_frame_unmap (frame);
       g_slice_free (GstVideoFrame, frame);
@@ -643,10 +646,12 @@ gst_compositor_pad_init (GstCompositorPad * compo_pad)
 
 /* GstCompositor */
 #define DEFAULT_BACKGROUND COMPOSITOR_BACKGROUND_CHECKER
+#define DEFAULT_N_THREADS 1
 enum
 {
   PROP_0,
-  PROP_BACKGROUND
+  PROP_BACKGROUND,
+  PROP_N_THREADS
 };
 
 #define GST_TYPE_COMPOSITOR_BACKGROUND (gst_compositor_background_get_type())
@@ -682,6 +687,11 @@ gst_compositor_get_property (GObject * object,
     case PROP_BACKGROUND:
       g_value_set_enum (value, self->background);
       break;
+    case PROP_N_THREADS:
+      GST_OBJECT_LOCK (self);
+      g_value_set_uint (value, self->n_threads);
+      GST_OBJECT_UNLOCK (self);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -698,6 +708,11 @@ gst_compositor_set_property (GObject * object,
     case PROP_BACKGROUND:
       self->background = g_value_get_enum (value);
       break;
+    case PROP_N_THREADS:
+      GST_OBJECT_LOCK (self);
+      self->n_threads = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (self);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -965,49 +980,89 @@ _negotiated_caps (GstVideoAggregator * vagg, GstCaps * caps)
   return TRUE;
 }
 
-static GstFlowReturn
-gst_compositor_aggregate_frames (GstVideoAggregator * vagg, GstBuffer * outbuf)
+/* Output frames are split in bands whose height is a multiple of this, so
+ * that every band starts on a chroma row for all the subsampled formats and
+ * on a cell boundary of the checker pattern. This keeps the result of the
+ * band-wise fill and blend identical to the one of a full-frame pass. */
+#define BAND_ALIGN 16
+
+typedef struct
+{
+  GstVideoFrame *frame;
+  gint xpos, ypos;
+  gdouble alpha;
+} CompositorLayer;
+
+typedef struct
+{
+  GstVideoFrame *outframe;
+  gint y, height;
+} CompositorBand;
+
+/* Make @band a view of the rows [y, y + height) of @frame */
+static void
+gst_compositor_band_frame (GstVideoFrame * frame, gint y, gint height,
+    GstVideoFrame * band)
+{
+  const GstVideoFormatInfo *finfo = frame->info.finfo;
+  guint i;
+
+  *band = *frame;
+  GST_VIDEO_INFO_HEIGHT (&band->info) = height;
+
+  for (i = 0; i < GST_VIDEO_FRAME_N_COMPONENTS (frame); i++) {
+    guint plane = GST_VIDEO_FORMAT_INFO_PLANE (finfo, i);
+
+    band->data[plane] = (guint8 *) frame->data[plane] +
+        GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (finfo, i, y) *
+        GST_VIDEO_FRAME_PLANE_STRIDE (frame, plane);
+  }
+}
+
+static void
+gst_compositor_composite_band (GstCompositor * self, GstVideoFrame * outframe,
+    gint y, gint height)
 {
-  GList *l;
-  GstCompositor *self = GST_COMPOSITOR (vagg);
   BlendFunction composite;
-  GstVideoFrame out_frame, *outframe;
+  GstVideoFrame band_frame, *frame;
+  guint i;
 
-  if (!gst_video_frame_map (&out_frame, &vagg->info, outbuf, GST_MAP_WRITE)) {
-    GST_WARNING_OBJECT (vagg, "Could not map output buffer");
-    return GST_FLOW_ERROR;
+  if (y == 0 && height == GST_VIDEO_FRAME_HEIGHT (outframe)) {
+    frame = outframe;
+  } else {
+    gst_compositor_band_frame (outframe, y, height, &band_frame);
+    frame = &band_frame;
   }
 
-  outframe = &out_frame;
   /* default to blending */
   composite = self->blend;
   /* TODO: If the frames to be composited completely obscure the background,
    * don't bother drawing the background at all. */
   switch (self->background) {
     case COMPOSITOR_BACKGROUND_CHECKER:
-      self->fill_checker (outframe);
+      self->fill_checker (frame);
       break;
     case COMPOSITOR_BACKGROUND_BLACK:
-      self->fill_color (outframe, 16, 128, 128);
+      self->fill_color (frame, 16, 128, 128);
       break;
     case COMPOSITOR_BACKGROUND_WHITE:
-      self->fill_color (outframe, 240, 128, 128);
+      self->fill_color (frame, 240, 128, 128);
       break;
     case COMPOSITOR_BACKGROUND_TRANSPARENT:
     {
-      guint i, plane, num_planes, height;
+      guint j, plane, num_planes, comp_height;
 
-      num_planes = GST_VIDEO_FRAME_N_PLANES (outframe);
+      num_planes = GST_VIDEO_FRAME_N_PLANES (frame);
       for (plane = 0; plane < num_planes; ++plane) {
         guint8 *pdata;
         gsize rowsize, plane_stride;
 
-        pdata = GST_VIDEO_FRAME_PLANE_DATA (outframe, plane);
-        plane_stride = GST_VIDEO_FRAME_PLANE_STRIDE (outframe, plane);
-        rowsize = GST_VIDEO_FRAME_COMP_WIDTH (outframe, plane)
-            * GST_VIDEO_FRAME_COMP_PSTRIDE (outframe, plane);
-        height = GST_VIDEO_FRAME_COMP_HEIGHT (outframe, plane);
-        for (i = 0; i < height; ++i) {
+        pdata = GST_VIDEO_FRAME_PLANE_DATA (frame, plane);
+        plane_stride = GST_VIDEO_FRAME_PLANE_STRIDE (frame, plane);
+        rowsize = GST_VIDEO_FRAME_COMP_WIDTH (frame, plane)
+            * GST_VIDEO_FRAME_COMP_PSTRIDE (frame, plane);
+        comp_height = GST_VIDEO_FRAME_COMP_HEIGHT (frame, plane);
+        for (j = 0; j < comp_height; ++j) {
           memset (pdata, 0, rowsize);
           pdata += plane_stride;
         }
@@ -1019,16 +1074,114 @@ gst_compositor_aggregate_frames (GstVideoAggregator * vagg, GstBuffer * outbuf)
     }
   }
 
+  for (i = 0; i < self->layers->len; i++) {
+    CompositorLayer *layer = &g_array_index (self->layers, CompositorLayer, i);
+
+    /* skip the layers that can't touch this band, the blend functions may
+     * round ypos up by one row for subsampled formats */
+    if (layer->ypos >= y + height ||
+        layer->ypos + GST_VIDEO_FRAME_HEIGHT (layer->frame) + 1 <= y)
+      continue;
+
+    composite (layer->frame, layer->xpos, layer->ypos - y, layer->alpha,
+        frame);
+  }
+}
+
+static void
+gst_compositor_band_func (gpointer data, gpointer user_data)
+{
+  CompositorBand *band = data;
+  GstCompositor *self = user_data;
+
+  gst_compositor_composite_band (self, band->outframe, band->y, band->height);
+
+  g_mutex_lock (&self->band_lock);
+  if (--self->bands_pending == 0)
+    g_cond_signal (&self->band_cond);
+  g_mutex_unlock (&self->band_lock);
+}
+
+static GstFlowReturn
+gst_compositor_aggregate_frames (GstVideoAggregator * vagg, GstBuffer * outbuf)
+{
+  GList *l;
+  GstCompositor *self = GST_COMPOSITOR (vagg);
+  GstVideoFrame out_frame, *outframe;
+  CompositorBand *bands;
+  guint n_threads, n_bands, band_height, i;
+  gint height;
+
+  if (!gst_video_frame_map (&out_frame, &vagg->info, outbuf, GST_MAP_WRITE)) {
+    GST_WARNING_OBJECT (vagg, "Could not map output buffer");
+    return GST_FLOW_ERROR;
+  }
+
+  outframe = &out_frame;
+  height = GST_VIDEO_FRAME_HEIGHT (outframe);
+
   GST_OBJECT_LOCK (vagg);
+  g_array_set_size (self->layers, 0);
   for (l = GST_ELEMENT (vagg)->sinkpads; l; l = l->next) {
     GstVideoAggregatorPad *pad = l->data;
     GstCompositorPad *compo_pad = GST_COMPOSITOR_PAD (pad);
+    CompositorLayer layer;
 
     if (pad->aggregated_frame != NULL) {
-      composite (pad->aggregated_frame, compo_pad->xpos, compo_pad->ypos,
-          compo_pad->alpha, outframe);
+      layer.frame = pad->aggregated_frame;
+      layer.xpos = compo_pad->xpos;
+      layer.ypos = compo_pad->ypos;
+      layer.alpha = compo_pad->alpha;
+      g_array_append_val (self->layers, layer);
     }
   }
+
+  n_threads = self->n_threads;
+  if (n_threads == 0)
+    n_threads = g_get_num_processors ();
+
+  n_bands = MIN (n_threads, (height + BAND_ALIGN - 1) / BAND_ALIGN);
+  if (n_bands <= 1) {
+    gst_compositor_composite_band (self, outframe, 0, height);
+    goto done;
+  }
+
+  band_height = (height + n_bands - 1) / n_bands;
+  band_height = (band_height + BAND_ALIGN - 1) / BAND_ALIGN * BAND_ALIGN;
+  n_bands = (height + band_height - 1) / band_height;
+
+  if (!self->band_pool) {
+    self->band_pool = g_thread_pool_new (gst_compositor_band_func, self,
+        n_threads - 1, FALSE, NULL);
+  } else if (g_thread_pool_get_max_threads (self->band_pool) !=
+      (gint) n_threads - 1) {
+    g_thread_pool_set_max_threads (self->band_pool, n_threads - 1, NULL);
+  }
+
+  GST_LOG_OBJECT (self, "compositing %u bands of %u rows", n_bands,
+      band_height);
+
+  bands = g_newa (CompositorBand, n_bands);
+  self->bands_pending = n_bands - 1;
+  for (i = 0; i < n_bands; i++) {
+    bands[i].outframe = outframe;
+    bands[i].y = i * band_height;
+    bands[i].height = MIN (band_height, height - bands[i].y);
+  }
+
+  /* the first band is done from here while the pool handles the others */
+  for (i = 1; i < n_bands; i++) {
+    if (!g_thread_pool_push (self->band_pool, &bands[i], NULL))
+      gst_compositor_band_func (&bands[i], self);
+  }
+  gst_compositor_composite_band (self, outframe, bands[0].y, bands[0].height);
+
+  g_mutex_lock (&self->band_lock);
+  while (self->bands_pending > 0)
+    g_cond_wait (&self->band_cond, &self->band_lock);
+  g_mutex_unlock (&self->band_lock);
+
+done:
   GST_OBJECT_UNLOCK (vagg);
 
   gst_video_frame_unmap (outframe);
@@ -1036,6 +1189,20 @@ gst_compositor_aggregate_frames (GstVideoAggregator * vagg, GstBuffer * outbuf)
   return GST_FLOW_OK;
 }
 
+static void
+gst_compositor_finalize (GObject * object)
+{
+  GstCompositor *self = GST_COMPOSITOR (object);
+
+  if (self->band_pool)
+    g_thread_pool_free (self->band_pool, FALSE, TRUE);
+  g_mutex_clear (&self->band_lock);
+  g_cond_clear (&self->band_cond);
+  g_array_free (self->layers, TRUE);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
 static gboolean
 _sink_query (GstAggregator * agg, GstAggregatorPad * bpad, GstQuery * query)
 {
@@ -1090,6 +1257,7 @@ gst_compositor_class_init (GstCompositorClass * klass)
 
   gobject_class->get_property = gst_compositor_get_property;
   gobject_class->set_property = gst_compositor_set_property;
+  gobject_class->finalize = gst_compositor_finalize;
 
   agg_class->sinkpads_type = GST_TYPE_COMPOSITOR_PAD;
   agg_class->sink_query = _sink_query;
@@ -1102,6 +1270,20 @@ gst_compositor_class_init (GstCompositorClass * klass)
           GST_TYPE_COMPOSITOR_BACKGROUND,
           DEFAULT_BACKGROUND, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstCompositor:n-threads:
+   *
+   * Maximum number of threads used to composite an output frame. The frame
+   * is split in horizontal bands that are filled and blended in parallel,
+   * the output is identical to the one of single-threaded compositing.
+   * 0 uses one thread per processor.
+   */
+  g_object_class_install_property (gobject_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Number of threads",
+          "Maximum number of threads used for compositing "
+          "(0 = number of processors)", 0, G_MAXINT, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_static_pad_template (gstelement_class, &src_factory);
   gst_element_class_add_static_pad_template (gstelement_class, &sink_factory);
 
@@ -1115,7 +1297,11 @@ static void
 gst_compositor_init (GstCompositor * self)
 {
   self->background = DEFAULT_BACKGROUND;
+  self->n_threads = DEFAULT_N_THREADS;
   /* initialize variables */
+  g_mutex_init (&self->band_lock);
+  g_cond_init (&self->band_cond);
+  self->layers = g_array_new (FALSE, FALSE, sizeof (CompositorLayer));
 }
 
 /* Element registration */
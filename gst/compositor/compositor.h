@@ -73,6 +73,14 @@ struct _GstCompositor
   BlendFunction blend, overlay;
   FillCheckerFunction fill_checker;
   FillColorFunction fill_color;
+
+  /* band-parallel compositing, see gst_compositor_aggregate_frames() */
+  guint n_threads;
+  GThreadPool *band_pool;
+  GMutex band_lock;
+  GCond band_cond;
+  guint bands_pending;
+  GArray *layers;
 };
 
 struct _GstCompositorClass
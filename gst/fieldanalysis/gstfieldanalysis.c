@@ -82,6 +82,10 @@ GST_DEBUG_CATEGORY_STATIC (gst_field_analysis_debug);
 #define DEFAULT_BLOCK_HEIGHT 16
 #define DEFAULT_BLOCK_THRESH 80
 #define DEFAULT_IGNORED_LINES 2
+#define DEFAULT_N_THREADS 1
+
+/* minimum number of field rows per band for the field metrics */
+#define BAND_MIN_ROWS 16
 
 enum
 {
@@ -96,7 +100,8 @@ enum
   PROP_BLOCK_WIDTH,
   PROP_BLOCK_HEIGHT,
   PROP_BLOCK_THRESH,
-  PROP_IGNORED_LINES
+  PROP_IGNORED_LINES,
+  PROP_N_THREADS
 };
 
 static GstStaticPadTemplate sink_factory =
@@ -274,6 +279,20 @@ gst_field_analysis_class_init (GstFieldAnalysisClass * klass)
           "Ignore this many lines from the top and bottom for windowed comb detection",
           2, G_MAXUINT64, DEFAULT_IGNORED_LINES,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstFieldAnalysis:n-threads:
+   *
+   * Maximum number of threads used to compute the metrics of a frame. The
+   * rows of the fields are split in bands that are processed in parallel and
+   * the results of the bands are combined in a fixed order, so the analysis
+   * does not depend on the number of threads. 0 uses one thread per
+   * processor.
+   */
+  g_object_class_install_property (gobject_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Number of threads",
+          "Maximum number of threads used for computing the metrics "
+          "(0 = number of processors)", 0, G_MAXINT, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   gstelement_class->change_state =
       GST_DEBUG_FUNCPTR (gst_field_analysis_change_state);
@@ -298,11 +317,14 @@ static gfloat same_parity_3_tap (GstFieldAnalysis * filter,
 static gfloat opposite_parity_5_tap (GstFieldAnalysis * filter,
     FieldAnalysisFields (*history)[2]);
 static guint64 block_score_for_row_32detect (GstFieldAnalysis * filter,
-    FieldAnalysisFields (*history)[2], guint8 * base_fj, guint8 * base_fjp1);
+    FieldAnalysisFields (*history)[2], guint8 * base_fj, guint8 * base_fjp1,
+    guint8 * comb_mask, guint * block_scores);
 static guint64 block_score_for_row_iscombed (GstFieldAnalysis * filter,
-    FieldAnalysisFields (*history)[2], guint8 * base_fj, guint8 * base_fjp1);
+    FieldAnalysisFields (*history)[2], guint8 * base_fj, guint8 * base_fjp1,
+    guint8 * comb_mask, guint * block_scores);
 static guint64 block_score_for_row_5_tap (GstFieldAnalysis * filter,
-    FieldAnalysisFields (*history)[2], guint8 * base_fj, guint8 * base_fjp1);
+    FieldAnalysisFields (*history)[2], guint8 * base_fj, guint8 * base_fjp1,
+    guint8 * comb_mask, guint * block_scores);
 static gfloat opposite_parity_windowed_comb (GstFieldAnalysis * filter,
     FieldAnalysisFields (*history)[2]);
 
@@ -325,10 +347,6 @@ gst_field_analysis_reset (GstFieldAnalysis * filter)
   filter->is_telecine = FALSE;
   filter->first_buffer = TRUE;
   gst_video_info_init (&filter->vinfo);
-  g_free (filter->comb_mask);
-  filter->comb_mask = NULL;
-  g_free (filter->block_scores);
-  filter->block_scores = NULL;
 }
 
 static void
@@ -358,6 +376,9 @@ gst_field_analysis_init (GstFieldAnalysis * filter)
   filter->block_height = DEFAULT_BLOCK_HEIGHT;
   filter->block_thresh = DEFAULT_BLOCK_THRESH;
   filter->ignored_lines = DEFAULT_IGNORED_LINES;
+  filter->n_threads = DEFAULT_N_THREADS;
+  g_mutex_init (&filter->band_lock);
+  g_cond_init (&filter->band_cond);
 }
 
 static void
@@ -423,18 +444,6 @@ gst_field_analysis_set_property (GObject * object, guint prop_id,
       break;
     case PROP_BLOCK_WIDTH:
       filter->block_width = g_value_get_uint64 (value);
-      if (GST_VIDEO_FRAME_WIDTH (&filter->frames[0].frame)) {
-        const gint frame_width =
-            GST_VIDEO_FRAME_WIDTH (&filter->frames[0].frame);
-        if (filter->block_scores) {
-          gsize nbytes = (frame_width / filter->block_width) * sizeof (guint);
-          filter->block_scores = g_realloc (filter->block_scores, nbytes);
-          memset (filter->block_scores, 0, nbytes);
-        } else {
-          filter->block_scores =
-              g_malloc0 ((frame_width / filter->block_width) * sizeof (guint));
-        }
-      }
       break;
     case PROP_BLOCK_HEIGHT:
       filter->block_height = g_value_get_uint64 (value);
@@ -445,6 +454,9 @@ gst_field_analysis_set_property (GObject * object, guint prop_id,
     case PROP_IGNORED_LINES:
       filter->ignored_lines = g_value_get_uint64 (value);
       break;
+    case PROP_N_THREADS:
+      filter->n_threads = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -519,6 +531,9 @@ gst_field_analysis_get_property (GObject * object, guint prop_id,
     case PROP_IGNORED_LINES:
       g_value_set_uint64 (value, filter->ignored_lines);
       break;
+    case PROP_N_THREADS:
+      g_value_set_uint (value, filter->n_threads);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -528,7 +543,6 @@ gst_field_analysis_get_property (GObject * object, guint prop_id,
 static void
 gst_field_analysis_update_format (GstFieldAnalysis * filter, GstCaps * caps)
 {
-  gint width;
   GQueue *outbufs;
   GstVideoInfo vinfo;
 
@@ -565,22 +579,6 @@ gst_field_analysis_update_format (GstFieldAnalysis * filter, GstCaps * caps)
   filter->flushing = FALSE;
 
   filter->vinfo = vinfo;
-  width = GST_VIDEO_INFO_WIDTH (&filter->vinfo);
-
-  /* update allocations for metric scores */
-  if (filter->comb_mask) {
-    filter->comb_mask = g_realloc (filter->comb_mask, width);
-  } else {
-    filter->comb_mask = g_malloc (width);
-  }
-  if (filter->block_scores) {
-    gsize nbytes = (width / filter->block_width) * sizeof (guint);
-    filter->block_scores = g_realloc (filter->block_scores, nbytes);
-    memset (filter->block_scores, 0, nbytes);
-  } else {
-    filter->block_scores =
-        g_malloc0 ((width / filter->block_width) * sizeof (guint));
-  }
 
   GST_OBJECT_UNLOCK (filter);
   return;
@@ -802,36 +800,133 @@ gst_field_analysis_sink_event (GstPad * pad, GstObject * parent,
 }
 
 
-static gfloat
-same_parity_sad (GstFieldAnalysis * filter, FieldAnalysisFields (*history)[2])
+typedef guint64 (*FieldAnalysisBandFunc) (GstFieldAnalysis * filter,
+    FieldAnalysisFields (*history)[2], gint start, gint end);
+
+typedef enum
+{
+  BAND_REDUCE_SUM,
+  BAND_REDUCE_MAX
+} FieldAnalysisBandReduce;
+
+typedef struct
+{
+  FieldAnalysisFields (*history)[2];
+  FieldAnalysisBandFunc func;
+  gint start, end;
+  guint64 result;
+} FieldAnalysisBand;
+
+static void
+gst_field_analysis_band_func (gpointer data, gpointer user_data)
+{
+  FieldAnalysisBand *band = data;
+  GstFieldAnalysis *filter = user_data;
+
+  band->result = band->func (filter, band->history, band->start, band->end);
+
+  g_mutex_lock (&filter->band_lock);
+  if (--filter->bands_pending == 0)
+    g_cond_signal (&filter->band_cond);
+  g_mutex_unlock (&filter->band_lock);
+}
+
+/* computes the rows [0, n_rows) of a metric with func, split in bands of at
+ * least min_rows rows that are processed in parallel. the results of the
+ * bands are integers combined in band order, so the result does not depend
+ * on the number of bands */
+static guint64
+gst_field_analysis_run_bands (GstFieldAnalysis * filter,
+    FieldAnalysisFields (*history)[2], FieldAnalysisBandFunc func,
+    gint n_rows, gint min_rows, FieldAnalysisBandReduce reduce)
+{
+  FieldAnalysisBand *bands;
+  guint n_threads, n_bands, band_rows, i;
+  guint64 result;
+
+  if (n_rows <= 0)
+    return 0;
+
+  n_threads = filter->n_threads;
+  if (n_threads == 0)
+    n_threads = g_get_num_processors ();
+
+  n_bands = MIN (n_threads, n_rows / min_rows);
+  if (n_bands <= 1)
+    return func (filter, history, 0, n_rows);
+
+  band_rows = (n_rows + n_bands - 1) / n_bands;
+  n_bands = (n_rows + band_rows - 1) / band_rows;
+
+  if (!filter->band_pool) {
+    filter->band_pool = g_thread_pool_new (gst_field_analysis_band_func,
+        filter, n_threads - 1, FALSE, NULL);
+  } else if (g_thread_pool_get_max_threads (filter->band_pool) !=
+      (gint) n_threads - 1) {
+    g_thread_pool_set_max_threads (filter->band_pool, n_threads - 1, NULL);
+  }
+
+  bands = g_newa (FieldAnalysisBand, n_bands);
+  filter->bands_pending = n_bands - 1;
+  for (i = 0; i < n_bands; i++) {
+    bands[i].history = history;
+    bands[i].func = func;
+    bands[i].start = i * band_rows;
+    bands[i].end = MIN (bands[i].start + band_rows, n_rows);
+  }
+
+  /* the first band is done from here while the pool handles the others */
+  for (i = 1; i < n_bands; i++) {
+    if (!g_thread_pool_push (filter->band_pool, &bands[i], NULL))
+      gst_field_analysis_band_func (&bands[i], filter);
+  }
+  bands[0].result = func (filter, history, bands[0].start, bands[0].end);
+
+  g_mutex_lock (&filter->band_lock);
+  while (filter->bands_pending > 0)
+    g_cond_wait (&filter->band_cond, &filter->band_lock);
+  g_mutex_unlock (&filter->band_lock);
+
+  result = bands[0].result;
+  for (i = 1; i < n_bands; i++) {
+    if (reduce == BAND_REDUCE_MAX)
+      result = MAX (result, bands[i].result);
+    else
+      result += bands[i].result;
+  }
+
+  return result;
+}
+
+/* line of the luma plane of frame */
+static inline guint8 *
+frame_line (GstVideoFrame * frame, gint line)
+{
+  return GST_VIDEO_FRAME_COMP_DATA (frame, 0) +
+      GST_VIDEO_FRAME_COMP_OFFSET (frame, 0) +
+      line * GST_VIDEO_FRAME_COMP_STRIDE (frame, 0);
+}
+
+static guint64
+same_parity_sad_rows (GstFieldAnalysis * filter,
+    FieldAnalysisFields (*history)[2], gint start, gint end)
 {
   gint j;
-  gfloat sum;
+  guint64 sum;
   guint8 *f1j, *f2j;
 
   const gint width = GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame);
-  const gint height = GST_VIDEO_FRAME_HEIGHT (&(*history)[0].frame);
   const gint stride0x2 =
       GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame, 0) << 1;
   const gint stride1x2 =
       GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[1].frame, 0) << 1;
   const guint32 noise_floor = filter->noise_floor;
 
-  f1j =
-      GST_VIDEO_FRAME_COMP_DATA (&(*history)[0].frame,
-      0) + GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[0].frame,
-      0) +
-      (*history)[0].parity * GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame,
-      0);
-  f2j =
-      GST_VIDEO_FRAME_COMP_DATA (&(*history)[1].frame,
-      0) + GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[1].frame,
-      0) +
-      (*history)[1].parity * GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[1].frame,
-      0);
-
-  sum = 0.0f;
-  for (j = 0; j < (height >> 1); j++) {
+  f1j = frame_line (&(*history)[0].frame, 2 * start + (*history)[0].parity);
+  f2j = frame_line (&(*history)[1].frame, 2 * start + (*history)[1].parity);
+
+  sum = 0;
+  for (j = start; j < end; j++) {
     guint32 tempsum = 0;
     fieldanalysis_orc_same_parity_sad_planar_yuv (&tempsum, f1j, f2j,
         noise_floor, width);
@@ -840,18 +935,32 @@ same_parity_sad (GstFieldAnalysis * filter, FieldAnalysisFields (*history)[2])
     f2j += stride1x2;
   }
 
-  return sum / (0.5f * width * height);
+  return sum;
 }
 
 static gfloat
-same_parity_ssd (GstFieldAnalysis * filter, FieldAnalysisFields (*history)[2])
+same_parity_sad (GstFieldAnalysis * filter, FieldAnalysisFields (*history)[2])
+{
+  guint64 sum;
+
+  const gint width = GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame);
+  const gint height = GST_VIDEO_FRAME_HEIGHT (&(*history)[0].frame);
+
+  sum = gst_field_analysis_run_bands (filter, history, same_parity_sad_rows,
+      height >> 1, BAND_MIN_ROWS, BAND_REDUCE_SUM);
+
+  return sum / (0.5f * width * height);
+}
+
+static guint64
+same_parity_ssd_rows (GstFieldAnalysis * filter,
+    FieldAnalysisFields (*history)[2], gint start, gint end)
 {
   gint j;
-  gfloat sum;
+  guint64 sum;
   guint8 *f1j, *f2j;
 
   const gint width = GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame);
-  const gint height = GST_VIDEO_FRAME_HEIGHT (&(*history)[0].frame);
   const gint stride0x2 =
       GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame, 0) << 1;
   const gint stride1x2 =
@@ -859,21 +968,11 @@ same_parity_ssd (GstFieldAnalysis * filter, FieldAnalysisFields (*history)[2])
   /* noise floor needs to be squared for SSD */
   const guint32 noise_floor = filter->noise_floor * filter->noise_floor;
 
-  f1j =
-      GST_VIDEO_FRAME_COMP_DATA (&(*history)[0].frame,
-      0) + GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[0].frame,
-      0) +
-      (*history)[0].parity * GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame,
-      0);
-  f2j =
-      GST_VIDEO_FRAME_COMP_DATA (&(*history)[1].frame,
-      0) + GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[1].frame,
-      0) +
-      (*history)[1].parity * GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[1].frame,
-      0);
-
-  sum = 0.0f;
-  for (j = 0; j < (height >> 1); j++) {
+  f1j = frame_line (&(*history)[0].frame, 2 * start + (*history)[0].parity);
+  f2j = frame_line (&(*history)[1].frame, 2 * start + (*history)[1].parity);
+
+  sum = 0;
+  for (j = start; j < end; j++) {
     guint32 tempsum = 0;
     fieldanalysis_orc_same_parity_ssd_planar_yuv (&tempsum, f1j, f2j,
         noise_floor, width);
@@ -882,20 +981,32 @@ same_parity_ssd (GstFieldAnalysis * filter, FieldAnalysisFields (*history)[2])
     f2j += stride1x2;
   }
 
-  return sum / (0.5f * width * height); /* field is half height */
+  return sum;
 }
 
-/* horizontal [1,4,1] diff between fields - is this a good idea or should the
- * current sample be emphasised more or less? */
 static gfloat
-same_parity_3_tap (GstFieldAnalysis * filter, FieldAnalysisFields (*history)[2])
+same_parity_ssd (GstFieldAnalysis * filter, FieldAnalysisFields (*history)[2])
+{
+  guint64 sum;
+
+  const gint width = GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame);
+  const gint height = GST_VIDEO_FRAME_HEIGHT (&(*history)[0].frame);
+
+  sum = gst_field_analysis_run_bands (filter, history, same_parity_ssd_rows,
+      height >> 1, BAND_MIN_ROWS, BAND_REDUCE_SUM);
+
+  return sum / (0.5f * width * height); /* field is half height */
+}
+
+static guint64
+same_parity_3_tap_rows (GstFieldAnalysis * filter,
+    FieldAnalysisFields (*history)[2], gint start, gint end)
 {
   gint i, j;
-  gfloat sum;
+  guint64 sum;
   guint8 *f1j, *f2j;
 
   const gint width = GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame);
-  const gint height = GST_VIDEO_FRAME_HEIGHT (&(*history)[0].frame);
   const gint stride0x2 =
       GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame, 0) << 1;
   const gint stride1x2 =
@@ -904,19 +1015,11 @@ same_parity_3_tap (GstFieldAnalysis * filter, FieldAnalysisFields (*history)[2])
   /* noise floor needs to be *6 for [1,4,1] */
   const guint32 noise_floor = filter->noise_floor * 6;
 
-  f1j = GST_VIDEO_FRAME_COMP_DATA (&(*history)[0].frame, 0) +
-      GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[0].frame, 0) +
-      (*history)[0].parity * GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame,
-      0);
-  f2j =
-      GST_VIDEO_FRAME_COMP_DATA (&(*history)[1].frame,
-      0) + GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[1].frame,
-      0) +
-      (*history)[1].parity * GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[1].frame,
-      0);
-
-  sum = 0.0f;
-  for (j = 0; j < (height >> 1); j++) {
+  f1j = frame_line (&(*history)[0].frame, 2 * start + (*history)[0].parity);
+  f2j = frame_line (&(*history)[1].frame, 2 * start + (*history)[1].parity);
+
+  sum = 0;
+  for (j = start; j < end; j++) {
     guint32 tempsum = 0;
     guint32 diff;
 
@@ -942,32 +1045,39 @@ same_parity_3_tap (GstFieldAnalysis * filter, FieldAnalysisFields (*history)[2])
     f2j += stride1x2;
   }
 
-  return sum / ((6.0f / 2.0f) * width * height);        /* 1 + 4 + 1 = 6; field is half height */
+  return sum;
 }
 
-/* vertical [1,-3,4,-3,1] - same as is used in FieldDiff from TIVTC,
- * tritical's AVISynth IVTC filter */
-/* 0th field's parity defines operation */
+/* horizontal [1,4,1] diff between fields - is this a good idea or should the
+ * current sample be emphasised more or less? */
 static gfloat
-opposite_parity_5_tap (GstFieldAnalysis * filter,
-    FieldAnalysisFields (*history)[2])
+same_parity_3_tap (GstFieldAnalysis * filter, FieldAnalysisFields (*history)[2])
+{
+  guint64 sum;
+
+  const gint width = GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame);
+  const gint height = GST_VIDEO_FRAME_HEIGHT (&(*history)[0].frame);
+
+  sum = gst_field_analysis_run_bands (filter, history, same_parity_3_tap_rows,
+      height >> 1, BAND_MIN_ROWS, BAND_REDUCE_SUM);
+
+  return sum / ((6.0f / 2.0f) * width * height);        /* 1 + 4 + 1 = 6; field is half height */
+}
+
+static guint64
+opposite_parity_5_tap_rows (GstFieldAnalysis * filter,
+    FieldAnalysisFields (*history)[2], gint start, gint end)
 {
   gint j;
-  gfloat sum;
+  guint64 sum;
   guint8 *fjm2, *fjm1, *fj, *fjp1, *fjp2;
-  guint32 tempsum;
+  GstVideoFrame *top, *bottom;
 
   const gint width = GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame);
-  const gint height = GST_VIDEO_FRAME_HEIGHT (&(*history)[0].frame);
-  const gint stride0x2 =
-      GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame, 0) << 1;
-  const gint stride1x2 =
-      GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[1].frame, 0) << 1;
+  const gint last = (GST_VIDEO_FRAME_HEIGHT (&(*history)[0].frame) >> 1) - 1;
   /* noise floor needs to be *6 for [1,-3,4,-3,1] */
   const guint32 noise_floor = filter->noise_floor * 6;
 
-  sum = 0.0f;
-
   /* fj is line j of the combined frame made from the top field even lines of
    *   field 0 and the bottom field odd lines from field 1
    * fjp1 is one line down from fj
@@ -975,60 +1085,56 @@ opposite_parity_5_tap (GstFieldAnalysis * filter,
    * fj with j == 0 is the 0th line of the top field
    * fj with j == 1 is the 0th line of the bottom field or the 1st field of
    *   the frame*/
-
-  /* unroll first line as it is a special case */
   if ((*history)[0].parity == TOP_FIELD) {
-    fj = GST_VIDEO_FRAME_COMP_DATA (&(*history)[0].frame,
-        0) + GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[0].frame, 0);
-    fjp1 =
-        GST_VIDEO_FRAME_COMP_DATA (&(*history)[1].frame,
-        0) + GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[1].frame,
-        0) + GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[1].frame, 0);
-    fjp2 = fj + stride0x2;
+    top = &(*history)[0].frame;
+    bottom = &(*history)[1].frame;
   } else {
-    fj = GST_VIDEO_FRAME_COMP_DATA (&(*history)[1].frame,
-        0) + GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[1].frame, 0);
-    fjp1 =
-        GST_VIDEO_FRAME_COMP_DATA (&(*history)[0].frame,
-        0) + GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[0].frame,
-        0) + GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame, 0);
-    fjp2 = fj + stride1x2;
+    top = &(*history)[1].frame;
+    bottom = &(*history)[0].frame;
   }
 
-  tempsum = 0;
-  fieldanalysis_orc_opposite_parity_5_tap_planar_yuv (&tempsum, fjp2, fjp1, fj,
-      fjp1, fjp2, noise_floor, width);
-  sum += tempsum;
-
-  for (j = 1; j < (height >> 1) - 1; j++) {
-    /* shift everything down a line in the field of interest (means += stridex2) */
-    fjm2 = fj;
-    fjm1 = fjp1;
-    fj = fjp2;
-    if ((*history)[0].parity == TOP_FIELD) {
-      fjp1 += stride1x2;
-      fjp2 += stride0x2;
+  sum = 0;
+  for (j = start; j < end; j++) {
+    guint32 tempsum = 0;
+
+    fj = frame_line (top, 2 * j);
+    if (j == 0) {
+      /* the first line is a special case */
+      fjp1 = fjm1 = frame_line (bottom, 1);
+      fjp2 = fjm2 = frame_line (top, 2);
+    } else if (j == last) {
+      /* the last line is a special case */
+      fjm1 = fjp1 = frame_line (bottom, 2 * j - 1);
+      fjm2 = fjp2 = frame_line (top, 2 * j - 2);
     } else {
-      fjp1 += stride0x2;
-      fjp2 += stride1x2;
+      fjm2 = frame_line (top, 2 * j - 2);
+      fjm1 = frame_line (bottom, 2 * j - 1);
+      fjp1 = frame_line (bottom, 2 * j + 1);
+      fjp2 = frame_line (top, 2 * j + 2);
     }
 
-    tempsum = 0;
     fieldanalysis_orc_opposite_parity_5_tap_planar_yuv (&tempsum, fjm2, fjm1,
         fj, fjp1, fjp2, noise_floor, width);
     sum += tempsum;
   }
 
-  /* unroll the last line as it is a special case */
-  /* shift everything down a line in the field of interest (means += stridex2) */
-  fjm2 = fj;
-  fjm1 = fjp1;
-  fj = fjp2;
+  return sum;
+}
 
-  tempsum = 0;
-  fieldanalysis_orc_opposite_parity_5_tap_planar_yuv (&tempsum, fjm2, fjm1, fj,
-      fjm1, fjm2, noise_floor, width);
-  sum += tempsum;
+/* vertical [1,-3,4,-3,1] - same as is used in FieldDiff from TIVTC,
+ * tritical's AVISynth IVTC filter */
+/* 0th field's parity defines operation */
+static gfloat
+opposite_parity_5_tap (GstFieldAnalysis * filter,
+    FieldAnalysisFields (*history)[2])
+{
+  guint64 sum;
+
+  const gint width = GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame);
+  const gint height = GST_VIDEO_FRAME_HEIGHT (&(*history)[0].frame);
+
+  sum = gst_field_analysis_run_bands (filter, history,
+      opposite_parity_5_tap_rows, height >> 1, BAND_MIN_ROWS, BAND_REDUCE_SUM);
 
   return sum / ((6.0f / 2.0f) * width * height);        /* 1 + 4 + 1 == 3 + 3 == 6; field is half height */
 }
@@ -1037,11 +1143,10 @@ opposite_parity_5_tap (GstFieldAnalysis * filter,
  * the return value is the highest block score for the row of blocks */
 static inline guint64
 block_score_for_row_32detect (GstFieldAnalysis * filter,
-    FieldAnalysisFields (*history)[2], guint8 * base_fj, guint8 * base_fjp1)
+    FieldAnalysisFields (*history)[2], guint8 * base_fj, guint8 * base_fjp1,
+    guint8 * comb_mask, guint * block_scores)
 {
   guint64 i, j;
-  guint8 *comb_mask = filter->comb_mask;
-  guint *block_scores = filter->block_scores;
   guint64 block_score;
   guint8 *fjm2, *fjm1, *fj, *fjp1;
   const gint incr = GST_VIDEO_FRAME_COMP_PSTRIDE (&(*history)[0].frame, 0);
@@ -1054,6 +1159,8 @@ block_score_for_row_32detect (GstFieldAnalysis * filter,
       GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame) -
       (GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame) % block_width);
 
+  memset (block_scores, 0, (width / block_width) * sizeof (guint));
+
   fjm2 = base_fj - stridex2;
   fjm1 = base_fjp1 - stridex2;
   fj = base_fj;
@@ -1114,8 +1221,6 @@ block_score_for_row_32detect (GstFieldAnalysis * filter,
       block_score = block_scores[i];
   }
 
-  g_free (block_scores);
-  g_free (comb_mask);
   return block_score;
 }
 
@@ -1124,11 +1229,10 @@ block_score_for_row_32detect (GstFieldAnalysis * filter,
  * the return value is the highest block score for the row of blocks */
 static inline guint64
 block_score_for_row_iscombed (GstFieldAnalysis * filter,
-    FieldAnalysisFields (*history)[2], guint8 * base_fj, guint8 * base_fjp1)
+    FieldAnalysisFields (*history)[2], guint8 * base_fj, guint8 * base_fjp1,
+    guint8 * comb_mask, guint * block_scores)
 {
   guint64 i, j;
-  guint8 *comb_mask = filter->comb_mask;
-  guint *block_scores = filter->block_scores;
   guint64 block_score;
   guint8 *fjm1, *fj, *fjp1;
   const gint incr = GST_VIDEO_FRAME_COMP_PSTRIDE (&(*history)[0].frame, 0);
@@ -1142,6 +1246,8 @@ block_score_for_row_iscombed (GstFieldAnalysis * filter,
       GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame) -
       (GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame) % block_width);
 
+  memset (block_scores, 0, (width / block_width) * sizeof (guint));
+
   fjm1 = base_fjp1 - stridex2;
   fj = base_fj;
   fjp1 = base_fjp1;
@@ -1202,8 +1308,6 @@ block_score_for_row_iscombed (GstFieldAnalysis * filter,
       block_score = block_scores[i];
   }
 
-  g_free (block_scores);
-  g_free (comb_mask);
   return block_score;
 }
 
@@ -1212,11 +1316,10 @@ block_score_for_row_iscombed (GstFieldAnalysis * filter,
  * the return value is the highest block score for the row of blocks */
 static inline guint64
 block_score_for_row_5_tap (GstFieldAnalysis * filter,
-    FieldAnalysisFields (*history)[2], guint8 * base_fj, guint8 * base_fjp1)
+    FieldAnalysisFields (*history)[2], guint8 * base_fj, guint8 * base_fjp1,
+    guint8 * comb_mask, guint * block_scores)
 {
   guint64 i, j;
-  guint8 *comb_mask = filter->comb_mask;
-  guint *block_scores = filter->block_scores;
   guint64 block_score;
   guint8 *fjm2, *fjm1, *fj, *fjp1, *fjp2;
   const gint incr = GST_VIDEO_FRAME_COMP_PSTRIDE (&(*history)[0].frame, 0);
@@ -1230,6 +1333,7 @@ block_score_for_row_5_tap (GstFieldAnalysis * filter,
       GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame) -
       (GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame) % block_width);
 
+  memset (block_scores, 0, (width / block_width) * sizeof (guint));
 
   fjm2 = base_fj - stridex2;
   fjm1 = base_fjp1 - stridex2;
@@ -1313,28 +1417,19 @@ block_score_for_row_5_tap (GstFieldAnalysis * filter,
       block_score = block_scores[i];
   }
 
-  g_free (block_scores);
-  g_free (comb_mask);
   return block_score;
 }
 
-/* a pass is made over the field using one of three comb-detection metrics
-   and the results are then analysed block-wise. if the samples to the left
-   and right are combed, they contribute to the block score. if the block
-   score is above the given threshold, the frame is combed. if the block
-   score is between half the threshold and the threshold, the block is
-   slightly combed. if when analysis is complete, slight combing is detected
-   that is returned. if any results are observed that are above the threshold,
-   the function returns immediately */
-/* 0th field's parity defines operation */
-static gfloat
-opposite_parity_windowed_comb (GstFieldAnalysis * filter,
-    FieldAnalysisFields (*history)[2])
+static guint64
+opposite_parity_windowed_comb_rows (GstFieldAnalysis * filter,
+    FieldAnalysisFields (*history)[2], gint start, gint end)
 {
   gint j;
-  gboolean slightly_combed;
+  guint64 combed;
+  guint8 *comb_mask;
+  guint *block_scores;
 
-  const gint height = GST_VIDEO_FRAME_HEIGHT (&(*history)[0].frame);
+  const gint width = GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame);
   const gint stride = GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame, 0);
   const guint64 block_thresh = filter->block_thresh;
   const guint64 block_height = filter->block_height;
@@ -1358,30 +1453,69 @@ opposite_parity_windowed_comb (GstFieldAnalysis * filter,
         0) + GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame, 0);
   }
 
-  /* we operate on a row of blocks of height block_height through each iteration */
-  slightly_combed = FALSE;
-  for (j = 0; j <= height - filter->ignored_lines - block_height;
-      j += block_height) {
-    guint64 line_offset = (filter->ignored_lines + j) * stride;
-    guint block_score =
+  /* each band has its own comb mask and block scores */
+  comb_mask = g_malloc (width);
+  block_scores = g_new (guint, width / filter->block_width + 1);
+
+  /* we operate on a row of blocks of height block_height through each
+   * iteration. 0 means not combed, 1 slightly combed and 2 combed */
+  combed = 0;
+  for (j = start; j < end && combed < 2; j++) {
+    guint64 line_offset = (filter->ignored_lines + j * block_height) * stride;
+    guint64 block_score =
         filter->block_score_for_row (filter, history, base_fj + line_offset,
-        base_fjp1 + line_offset);
+        base_fjp1 + line_offset, comb_mask, block_scores);
 
     if (block_score > (block_thresh >> 1)
         && block_score <= block_thresh) {
       /* blend if nothing more combed comes along */
-      slightly_combed = TRUE;
+      combed = 1;
     } else if (block_score > block_thresh) {
-      if (GST_VIDEO_INFO_INTERLACE_MODE (&(*history)[0].frame.info) ==
-          GST_VIDEO_INTERLACE_MODE_INTERLEAVED) {
-        return 1.0f;            /* blend */
-      } else {
-        return 2.0f;            /* deinterlace */
-      }
+      combed = 2;
+    }
+  }
+
+  g_free (block_scores);
+  g_free (comb_mask);
+
+  return combed;
+}
+
+/* a pass is made over the field using one of three comb-detection metrics
+   and the results are then analysed block-wise. if the samples to the left
+   and right are combed, they contribute to the block score. if the block
+   score is above the given threshold, the frame is combed. if the block
+   score is between half the threshold and the threshold, the block is
+   slightly combed. if when analysis is complete, slight combing is detected
+   that is returned. if any results are observed that are above the threshold,
+   the band stops there and the frame is combed */
+/* 0th field's parity defines operation */
+static gfloat
+opposite_parity_windowed_comb (GstFieldAnalysis * filter,
+    FieldAnalysisFields (*history)[2])
+{
+  gint n_rows = 0;
+  guint64 combed;
+
+  const guint64 height = GST_VIDEO_FRAME_HEIGHT (&(*history)[0].frame);
+  const guint64 block_height = filter->block_height;
+
+  if (block_height > 0 && height >= filter->ignored_lines + block_height)
+    n_rows = (height - filter->ignored_lines - block_height) / block_height + 1;
+
+  combed = gst_field_analysis_run_bands (filter, history,
+      opposite_parity_windowed_comb_rows, n_rows, 1, BAND_REDUCE_MAX);
+
+  if (combed == 2) {
+    if (GST_VIDEO_INFO_INTERLACE_MODE (&(*history)[0].frame.info) ==
+        GST_VIDEO_INTERLACE_MODE_INTERLEAVED) {
+      return 1.0f;              /* blend */
+    } else {
+      return 2.0f;              /* deinterlace */
     }
   }
 
-  return (gfloat) slightly_combed;      /* TRUE means blend, else don't */
+  return (gfloat) combed;       /* TRUE means blend, else don't */
 }
 
 /* this is where the magic happens
@@ -1832,6 +1966,11 @@ gst_field_analysis_finalize (GObject * object)
 
   gst_field_analysis_reset (filter);
 
+  if (filter->band_pool)
+    g_thread_pool_free (filter->band_pool, FALSE, TRUE);
+  g_mutex_clear (&filter->band_lock);
+  g_cond_clear (&filter->band_cond);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
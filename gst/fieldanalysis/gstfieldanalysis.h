@@ -119,14 +119,18 @@ struct _GstFieldAnalysis
   GstVideoInfo vinfo;
   gfloat (*same_field) (GstFieldAnalysis *, FieldAnalysisFields (*)[2]);
   gfloat (*same_frame) (GstFieldAnalysis *, FieldAnalysisFields (*)[2]);
-  guint64 (*block_score_for_row) (GstFieldAnalysis *, FieldAnalysisFields (*)[2], guint8 *, guint8 *);
+  guint64 (*block_score_for_row) (GstFieldAnalysis *, FieldAnalysisFields (*)[2], guint8 *, guint8 *, guint8 *, guint *);
   gboolean is_telecine;
   gboolean first_buffer; /* indicates the first buffer for which a buffer will be output
                           * after a discont or flushing seek */
-  guint8 *comb_mask;
-  guint *block_scores;
   gboolean flushing;     /* indicates whether we are flushing or not */
 
+  /* row band parallel metrics, see gst_field_analysis_run_bands() */
+  GThreadPool *band_pool;
+  GMutex band_lock;
+  GCond band_cond;
+  guint bands_pending;
+
   /* properties */
   guint32 noise_floor; /* threshold for the result of a metric to be valid */
   gfloat field_thresh; /* threshold used for the same parity field metric */
@@ -135,6 +139,7 @@ struct _GstFieldAnalysis
   guint64 block_width, block_height; /* width/height of window used for comb clusted detection */
   guint64 block_thresh;
   guint64 ignored_lines;
+  guint n_threads;
 };
 
 struct _GstFieldAnalysisClass
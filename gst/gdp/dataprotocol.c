@@ -133,8 +133,7 @@ G_STMT_START {							\
 #define CRC_INIT   0xFFFF
 
 static guint16 gst_dp_crc (const guint8 * buffer, guint length);
-static guint16 gst_dp_crc_from_memory_maps (const GstMapInfo * maps,
-    guint n_maps);
+static guint16 gst_dp_crc_from_buffer (GstBuffer * buffer);
 
 /* payloading functions */
 
@@ -156,32 +155,9 @@ gst_dp_payload_buffer (GstBuffer * buffer, GstDPHeaderFlag flags)
   /* version, flags, type */
   GST_DP_INIT_HEADER (h, GST_DP_VERSION_1_0, flags, GST_DP_PAYLOAD_BUFFER);
 
-  if ((flags & GST_DP_HEADER_FLAG_CRC_PAYLOAD)) {
-    GstMapInfo *maps;
-    guint n_maps, i;
-
-    buffer_size = 0;
-
-    n_maps = gst_buffer_n_memory (buffer);
-    if (n_maps > 0) {
-      maps = g_newa (GstMapInfo, n_maps);
-
-      for (i = 0; i < n_maps; ++i) {
-        GstMemory *mem;
-
-        mem = gst_buffer_peek_memory (buffer, i);
-        gst_memory_map (mem, &maps[i], GST_MAP_READ);
-        buffer_size += maps[i].size;
-      }
-
-      crc = gst_dp_crc_from_memory_maps (maps, n_maps);
-
-      for (i = 0; i < n_maps; ++i)
-        gst_memory_unmap (maps[i].memory, &maps[i]);
-    }
-  } else {
-    buffer_size = gst_buffer_get_size (buffer);
-  }
+  buffer_size = gst_buffer_get_size (buffer);
+  if ((flags & GST_DP_HEADER_FLAG_CRC_PAYLOAD))
+    crc = gst_dp_crc_from_buffer (buffer);
 
   /* buffer properties */
   GST_WRITE_UINT32_BE (h + 6, buffer_size);
@@ -220,8 +196,10 @@ gst_dp_payload_buffer (GstBuffer * buffer, GstDPHeaderFlag flags)
   /* header */
   gst_buffer_append_memory (ret_buf, mem);
 
-  /* buffer data */
-  return gst_buffer_append (ret_buf, gst_buffer_ref (buffer));
+  /* buffer data, the memories of the buffer are shared, not copied */
+  gst_buffer_copy_into (ret_buf, buffer, GST_BUFFER_COPY_MEMORY, 0, -1);
+
+  return ret_buf;
 }
 
 GstBuffer *
@@ -364,6 +342,52 @@ static const guint16 gst_dp_crc_table[256] = {
   0x6e17, 0x7e36, 0x4e55, 0x5e74, 0x2e93, 0x3eb2, 0x0ed1, 0x1ef0
 };
 
+/* Tables for slicing-by-8: gst_dp_crc_slices[k - 1][i] is the CRC register
+ * after byte i followed by k zero bytes, starting from a zero register. With
+ * them the register is updated for 8 bytes at once with 8 independent
+ * lookups, instead of 8 dependent ones. */
+static guint16 gst_dp_crc_slices[7][256];
+
+static gpointer
+gst_dp_crc_init_slices (gpointer data)
+{
+  guint i, k;
+
+  for (i = 0; i < 256; i++) {
+    guint16 crc = gst_dp_crc_table[i];
+
+    for (k = 0; k < 7; k++) {
+      crc = (guint16) ((crc << 8) ^ gst_dp_crc_table[crc >> 8]);
+      gst_dp_crc_slices[k][i] = crc;
+    }
+  }
+
+  return NULL;
+}
+
+static guint16
+gst_dp_crc_update (guint16 crc_register, const guint8 * buffer, gsize length)
+{
+  static GOnce slices_once = G_ONCE_INIT;
+
+  g_once (&slices_once, gst_dp_crc_init_slices, NULL);
+
+  for (; length >= 8; length -= 8, buffer += 8) {
+    crc_register = gst_dp_crc_slices[6][buffer[0] ^ (crc_register >> 8)] ^
+        gst_dp_crc_slices[5][buffer[1] ^ (crc_register & 0xff)] ^
+        gst_dp_crc_slices[4][buffer[2]] ^ gst_dp_crc_slices[3][buffer[3]] ^
+        gst_dp_crc_slices[2][buffer[4]] ^ gst_dp_crc_slices[1][buffer[5]] ^
+        gst_dp_crc_slices[0][buffer[6]] ^ gst_dp_crc_table[buffer[7]];
+  }
+
+  for (; length--;) {
+    crc_register = (guint16) ((crc_register << 8) ^
+        gst_dp_crc_table[((crc_register >> 8) & 0x00ff) ^ *buffer++]);
+  }
+
+  return crc_register;
+}
+
 /**
  * gst_dp_crc:
  * @buffer: array of bytes
@@ -386,37 +410,32 @@ gst_dp_crc (const guint8 * buffer, guint length)
   g_assert (buffer != NULL);
 
   /* calc CRC */
-  for (; length--;) {
-    crc_register = (guint16) ((crc_register << 8) ^
-        gst_dp_crc_table[((crc_register >> 8) & 0x00ff) ^ *buffer++]);
-  }
+  crc_register = gst_dp_crc_update (crc_register, buffer, length);
+
   return (0xffff ^ crc_register);
 }
 
+/* the CRC of the data of all the memories of buffer, mapped one at a time so
+ * that a buffer of several memories is not merged */
 static guint16
-gst_dp_crc_from_memory_maps (const GstMapInfo * maps, guint n_maps)
+gst_dp_crc_from_buffer (GstBuffer * buffer)
 {
   guint16 crc_register = CRC_INIT;
   gsize total_length = 0;
+  guint n_mems, i;
 
-  if (n_maps == 0)
-    return 0;
-
-  g_assert (maps != NULL);
-
-  /* calc CRC */
-  while (n_maps > 0) {
-    guint8 *buffer = maps->data;
-    gsize length = maps->size;
+  n_mems = gst_buffer_n_memory (buffer);
+  for (i = 0; i < n_mems; i++) {
+    GstMemory *mem = gst_buffer_peek_memory (buffer, i);
+    GstMapInfo map;
 
-    total_length += length;
-
-    while (length-- > 0) {
-      crc_register = (guint16) ((crc_register << 8) ^
-          gst_dp_crc_table[((crc_register >> 8) & 0x00ff) ^ *buffer++]);
+    if (!gst_memory_map (mem, &map, GST_MAP_READ)) {
+      GST_WARNING ("could not map memory %u of buffer %p", i, buffer);
+      continue;
     }
-    --n_maps;
-    ++maps;
+    crc_register = gst_dp_crc_update (crc_register, map.data, map.size);
+    total_length += map.size;
+    gst_memory_unmap (mem, &map);
   }
 
   if (G_UNLIKELY (total_length == 0))
@@ -474,6 +493,17 @@ gst_dp_header_payload_type (const guint8 * header)
 
 /*** DEPACKETIZING FUNCTIONS ***/
 
+static void
+gst_dp_buffer_set_header_fields (GstBuffer * buffer, const guint8 * header)
+{
+  GST_BUFFER_TIMESTAMP (buffer) = GST_DP_HEADER_TIMESTAMP (header);
+  GST_BUFFER_DTS (buffer) = GST_DP_HEADER_DTS (header);
+  GST_BUFFER_DURATION (buffer) = GST_DP_HEADER_DURATION (header);
+  GST_BUFFER_OFFSET (buffer) = GST_DP_HEADER_OFFSET (header);
+  GST_BUFFER_OFFSET_END (buffer) = GST_DP_HEADER_OFFSET_END (header);
+  GST_BUFFER_FLAGS (buffer) = GST_DP_HEADER_BUFFER_FLAGS (header);
+}
+
 /**
  * gst_dp_buffer_from_header:
  * @header_length: the length of the packet header
@@ -507,16 +537,55 @@ gst_dp_buffer_from_header (guint header_length, const guint8 * header,
       gst_buffer_new_allocate (allocator,
       (guint) GST_DP_HEADER_PAYLOAD_LENGTH (header), allocation_params);
 
-  GST_BUFFER_TIMESTAMP (buffer) = GST_DP_HEADER_TIMESTAMP (header);
-  GST_BUFFER_DTS (buffer) = GST_DP_HEADER_DTS (header);
-  GST_BUFFER_DURATION (buffer) = GST_DP_HEADER_DURATION (header);
-  GST_BUFFER_OFFSET (buffer) = GST_DP_HEADER_OFFSET (header);
-  GST_BUFFER_OFFSET_END (buffer) = GST_DP_HEADER_OFFSET_END (header);
-  GST_BUFFER_FLAGS (buffer) = GST_DP_HEADER_BUFFER_FLAGS (header);
+  gst_dp_buffer_set_header_fields (buffer, header);
 
   return buffer;
 }
 
+static gboolean
+gst_dp_remove_meta (GstBuffer * buffer, GstMeta ** meta, gpointer user_data)
+{
+  *meta = NULL;
+  return TRUE;
+}
+
+/**
+ * gst_dp_buffer_from_packet:
+ * @header_length: the length of the packet header
+ * @header: the byte array of the packet header
+ * @payload: (transfer full): the payload of the packet
+ *
+ * Turns @payload into the #GstBuffer described by the given header. The
+ * memories of @payload are kept, so the payload data is not copied, this is
+ * meant for payloads taken from a #GstAdapter with
+ * gst_adapter_take_buffer_fast().
+ *
+ * This function does not check the arguments passed to it, use
+ * gst_dp_validate_header() and gst_dp_validate_payload_buffer() first if
+ * the header and payload data are unchecked.
+ *
+ * Returns: A #GstBuffer if the buffer was successfully created, or NULL.
+ */
+GstBuffer *
+gst_dp_buffer_from_packet (guint header_length, const guint8 * header,
+    GstBuffer * payload)
+{
+  g_return_val_if_fail (header != NULL, NULL);
+  g_return_val_if_fail (header_length >= GST_DP_HEADER_LENGTH, NULL);
+  g_return_val_if_fail (GST_DP_HEADER_PAYLOAD_TYPE (header) ==
+      GST_DP_PAYLOAD_BUFFER, NULL);
+  g_return_val_if_fail (GST_IS_BUFFER (payload), NULL);
+
+  /* only copies the buffer and not the data if it is shared */
+  payload = gst_buffer_make_writable (payload);
+
+  /* the metas came from the transport, not from the sender */
+  gst_buffer_foreach_meta (payload, gst_dp_remove_meta, NULL);
+  gst_dp_buffer_set_header_fields (payload, header);
+
+  return payload;
+}
+
 /**
  * gst_dp_caps_from_packet:
  * @header_length: the length of the packet header
@@ -754,6 +823,49 @@ crc_error:
   }
 }
 
+/**
+ * gst_dp_validate_payload_buffer:
+ * @header_length: the length of the packet header
+ * @header: the byte array of the packet header
+ * @payload: the payload of the packet
+ *
+ * Validates the given packet payload using the given packet header
+ * by checking the CRC checksum, like gst_dp_validate_payload(). The memories
+ * of @payload are checked one after the other, so a payload of several
+ * memories does not need to be merged first.
+ *
+ * Returns: %TRUE if the CRC matches, or no CRC checksum is present.
+ */
+gboolean
+gst_dp_validate_payload_buffer (guint header_length, const guint8 * header,
+    GstBuffer * payload)
+{
+  guint16 crc_read, crc_calculated;
+
+  g_return_val_if_fail (header != NULL, FALSE);
+  g_return_val_if_fail (header_length >= GST_DP_HEADER_LENGTH, FALSE);
+  g_return_val_if_fail (GST_IS_BUFFER (payload), FALSE);
+
+  if (!(GST_DP_HEADER_FLAGS (header) & GST_DP_HEADER_FLAG_CRC_PAYLOAD))
+    return TRUE;
+
+  crc_read = GST_DP_HEADER_CRC_PAYLOAD (header);
+  crc_calculated = gst_dp_crc_from_buffer (payload);
+  if (crc_read != crc_calculated)
+    goto crc_error;
+
+  GST_LOG ("payload crc validation: %02x", crc_read);
+  return TRUE;
+
+  /* ERRORS */
+crc_error:
+  {
+    GST_WARNING ("payload crc mismatch: read %02x, calculated %02x", crc_read,
+        crc_calculated);
+    return FALSE;
+  }
+}
+
 /**
  * gst_dp_validate_packet:
  * @header_length: the length of the packet header
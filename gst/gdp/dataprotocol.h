@@ -81,6 +81,9 @@ GstBuffer *     gst_dp_buffer_from_header       (guint header_length,
                                                 const guint8 * header,
                                                 GstAllocator * allocator,
                                                 GstAllocationParams * allocation_params);
+GstBuffer *     gst_dp_buffer_from_packet       (guint header_length,
+                                                const guint8 * header,
+                                                GstBuffer * payload);
 GstCaps *       gst_dp_caps_from_packet         (guint header_length,
                                                 const guint8 * header,
                                                 const guint8 * payload);
@@ -104,6 +107,9 @@ gboolean        gst_dp_validate_header          (guint header_length,
 gboolean        gst_dp_validate_payload         (guint header_length,
                                                 const guint8 * header,
                                                 const guint8 * payload);
+gboolean        gst_dp_validate_payload_buffer  (guint header_length,
+                                                const guint8 * header,
+                                                GstBuffer * payload);
 gboolean        gst_dp_validate_packet          (guint header_length,
                                                 const guint8 * header,
                                                 const guint8 * payload);
@@ -144,6 +144,7 @@ gst_gdp_depay_init (GstGDPDepay * gdpdepay)
 
   gdpdepay->allocator = NULL;
   gst_allocation_params_init (&gdpdepay->allocation_params);
+  gdpdepay->share_payload = TRUE;
 }
 
 static void
@@ -340,7 +341,10 @@ gst_gdp_depay_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
           goto wrong_type;
         }
 
-        if (this->payload_length) {
+        /* buffer payloads are validated once taken from the adapter, so
+         * that they don't need to be made contiguous */
+        if (this->payload_length &&
+            this->state != GST_GDP_DEPAY_STATE_BUFFER) {
           const guint8 *data;
           gboolean res;
 
@@ -362,21 +366,42 @@ gst_gdp_depay_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
           goto no_caps;
 
         GST_LOG_OBJECT (this, "reading GDP buffer from adapter");
-        buf =
-            gst_dp_buffer_from_header (GST_DP_HEADER_LENGTH, this->header,
-            this->allocator, &this->allocation_params);
-        if (!buf)
-          goto buffer_failed;
-
-        /* now take the payload if there is any */
-        if (this->payload_length > 0) {
-          GstMapInfo map;
-
-          gst_buffer_map (buf, &map, GST_MAP_WRITE);
-          gst_adapter_copy (this->adapter, map.data, 0, this->payload_length);
-          gst_buffer_unmap (buf, &map);
+        if (this->share_payload) {
+          /* the payload is made of the memories of the input buffers */
+          if (this->payload_length > 0)
+            buf = gst_adapter_take_buffer_fast (this->adapter,
+                this->payload_length);
+          else
+            buf = gst_buffer_new ();
+
+          buf = gst_dp_buffer_from_packet (GST_DP_HEADER_LENGTH, this->header,
+              buf);
+          if (!buf)
+            goto buffer_failed;
+        } else {
+          buf = gst_dp_buffer_from_header (GST_DP_HEADER_LENGTH, this->header,
+              this->allocator, &this->allocation_params);
+          if (!buf)
+            goto buffer_failed;
+
+          /* now take the payload if there is any */
+          if (this->payload_length > 0) {
+            GstMapInfo map;
+
+            gst_buffer_map (buf, &map, GST_MAP_WRITE);
+            gst_adapter_copy (this->adapter, map.data, 0,
+                this->payload_length);
+            gst_buffer_unmap (buf, &map);
+
+            gst_adapter_flush (this->adapter, this->payload_length);
+          }
+        }
 
-          gst_adapter_flush (this->adapter, this->payload_length);
+        if (this->payload_length > 0 &&
+            !gst_dp_validate_payload_buffer (GST_DP_HEADER_LENGTH,
+                this->header, buf)) {
+          gst_buffer_unref (buf);
+          goto payload_validate_error;
         }
 
         if (GST_BUFFER_TIMESTAMP (buf) > -this->ts_offset)
@@ -538,6 +563,7 @@ gst_gdp_depay_change_state (GstElement * element, GstStateChange transition)
         gst_object_unref (this->allocator);
       this->allocator = NULL;
       gst_allocation_params_init (&this->allocation_params);
+      this->share_payload = TRUE;
       break;
     default:
       break;
@@ -578,6 +604,16 @@ gst_gdp_depay_decide_allocation (GstGDPDepay * gdpdepay)
   gdpdepay->allocator = allocator;
   gdpdepay->allocation_params = params;
 
+  /* The payload can only be made of the memories of the input buffers if
+   * downstream is fine with system memory at any address. Otherwise it is
+   * copied to memory from the allocator of downstream. */
+  gdpdepay->share_payload = (allocator == NULL ||
+      g_strcmp0 (allocator->mem_type, GST_ALLOCATOR_SYSMEM) == 0) &&
+      params.flags == 0 && params.align == 0 && params.prefix == 0 &&
+      params.padding == 0;
+  GST_DEBUG_OBJECT (gdpdepay, "%s the payload of buffers",
+      gdpdepay->share_payload ? "sharing" : "copying");
+
   gst_caps_unref (caps);
   gst_query_unref (query);
 }
@@ -71,6 +71,7 @@ struct _GstGDPDepay
 
   GstAllocator *allocator;
   GstAllocationParams allocation_params;
+  gboolean share_payload;
 };
 
 struct _GstGDPDepayClass
@@ -78,6 +78,7 @@ gst_inter_surface_unref (GstInterSurface * surface)
     }
 
     g_mutex_clear (&surface->mutex);
+    gst_inter_surface_clear_video_ring (surface);
     gst_buffer_replace (&surface->video_buffer, NULL);
     gst_buffer_replace (&surface->sub_buffer, NULL);
     gst_object_unref (surface->audio_adapter);
@@ -86,3 +87,96 @@ gst_inter_surface_unref (GstInterSurface * surface)
   }
   g_mutex_unlock (&mutex);
 }
+
+#define SLOT_BUFFER(slot) \
+  ((GstBuffer *) ((guintptr) g_atomic_pointer_get (&(slot)->buffer) & ~1))
+
+/* Publish @buffer as the next frame of the video ring, taking a reference.
+ * There is only one writer per surface, the intervideosink of the channel.
+ *
+ * Every slot is protected by a bit lock on its buffer pointer, only held to
+ * swap or ref the buffer, so readers don't contend with each other or with
+ * the writer unless they hit the very same slot at the same time. */
+void
+gst_inter_surface_push_video_frame (GstInterSurface * surface,
+    GstBuffer * buffer)
+{
+  GstInterVideoSlot *slot;
+  GstBuffer *old;
+  guint size, seq;
+
+  size = g_atomic_int_get (&surface->video_ring_size);
+  g_return_if_fail (size > 0 && size <= GST_INTER_SURFACE_MAX_VIDEO_RING_SIZE);
+  g_return_if_fail ((size & (size - 1)) == 0);
+
+  seq = g_atomic_int_get (&surface->video_seq) + 1;
+  slot = &surface->video_ring[seq & (size - 1)];
+
+  g_pointer_bit_lock (&slot->buffer, 0);
+  old = SLOT_BUFFER (slot);
+  slot->seq = seq;
+  /* keep the lock bit set until the unlock */
+  g_atomic_pointer_set (&slot->buffer,
+      (gpointer) ((guintptr) (buffer ? gst_buffer_ref (buffer) : NULL) | 1));
+  g_pointer_bit_unlock (&slot->buffer, 0);
+
+  /* full barrier, the slot is visible before the new sequence number */
+  g_atomic_int_inc (&surface->video_seq);
+
+  if (old)
+    gst_buffer_unref (old);
+}
+
+/* Get a reference to frame @seq of the video ring, or to a later one if
+ * the writer already overwrote it. @frame_seq is set to the number of the
+ * returned frame. Returns %NULL if the frame was cleared. */
+GstBuffer *
+gst_inter_surface_get_video_frame (GstInterSurface * surface, guint seq,
+    guint * frame_seq)
+{
+  GstInterVideoSlot *slot;
+  GstBuffer *buffer;
+  guint size;
+
+  size = g_atomic_int_get (&surface->video_ring_size);
+  if (size == 0) {
+    *frame_seq = seq;
+    return NULL;
+  }
+
+  slot = &surface->video_ring[seq & (size - 1)];
+
+  g_pointer_bit_lock (&slot->buffer, 0);
+  buffer = SLOT_BUFFER (slot);
+  *frame_seq = slot->seq;
+  /* a slot written before the ring size changed */
+  if ((gint) (slot->seq - seq) < 0) {
+    buffer = NULL;
+    *frame_seq = seq;
+  }
+  if (buffer)
+    gst_buffer_ref (buffer);
+  g_pointer_bit_unlock (&slot->buffer, 0);
+
+  return buffer;
+}
+
+/* Drop the frames of the video ring, readers get %NULL for them */
+void
+gst_inter_surface_clear_video_ring (GstInterSurface * surface)
+{
+  guint i;
+
+  for (i = 0; i < GST_INTER_SURFACE_MAX_VIDEO_RING_SIZE; i++) {
+    GstInterVideoSlot *slot = &surface->video_ring[i];
+    GstBuffer *old;
+
+    g_pointer_bit_lock (&slot->buffer, 0);
+    old = SLOT_BUFFER (slot);
+    g_atomic_pointer_set (&slot->buffer, GSIZE_TO_POINTER (1));
+    g_pointer_bit_unlock (&slot->buffer, 0);
+
+    if (old)
+      gst_buffer_unref (old);
+  }
+}
@@ -27,6 +27,16 @@
 G_BEGIN_DECLS
 
 typedef struct _GstInterSurface GstInterSurface;
+typedef struct _GstInterVideoSlot GstInterVideoSlot;
+
+#define GST_INTER_SURFACE_MAX_VIDEO_RING_SIZE 16
+
+/* Bit 0 of buffer is a lock, see gst_inter_surface_push_video_frame() */
+struct _GstInterVideoSlot
+{
+  GstBuffer *buffer;
+  guint seq;
+};
 
 struct _GstInterSurface
 {
@@ -48,6 +58,17 @@ struct _GstInterSurface
   GstBuffer *video_buffer;
   GstBuffer *sub_buffer;
   GstAdapter *audio_adapter;
+
+  /* ring of the last video frames, readers keep their own cursor into it
+   * when video_ring_size is not 0. video_ring_size is a power of 2, so
+   * that the slot of a frame stays the same when video_seq wraps around.
+   * video_seq is the number of frames published and video_info_cookie
+   * changes with video_info. These are accessed atomically, without the
+   * mutex */
+  guint video_ring_size;
+  guint video_seq;
+  guint video_info_cookie;
+  GstInterVideoSlot video_ring[GST_INTER_SURFACE_MAX_VIDEO_RING_SIZE];
 };
 
 #define DEFAULT_AUDIO_BUFFER_TIME  (GST_SECOND)
@@ -58,6 +79,12 @@ struct _GstInterSurface
 GstInterSurface * gst_inter_surface_get (const char *name);
 void gst_inter_surface_unref (GstInterSurface *surface);
 
+void gst_inter_surface_push_video_frame (GstInterSurface *surface,
+    GstBuffer *buffer);
+GstBuffer * gst_inter_surface_get_video_frame (GstInterSurface *surface,
+    guint seq, guint *frame_seq);
+void gst_inter_surface_clear_video_ring (GstInterSurface *surface);
+
 
 G_END_DECLS
 
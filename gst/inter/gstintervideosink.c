@@ -34,6 +34,12 @@
  * See the gstintertest.c example in the gst-plugins-bad source code for
  * more details.
  *
+ * By default all the intervideosrc elements of a channel share the latest
+ * frame. When #GstInterVideoSink:ring-size is set, the last frames are kept
+ * in a ring instead and every intervideosrc follows them with its own
+ * cursor, so that several readers can each consume the frames at their own
+ * rate. The frames are shared by reference between the readers.
+ *
  */
 
 #ifdef HAVE_CONFIG_H
@@ -66,10 +72,12 @@ static GstFlowReturn gst_inter_video_sink_show_frame (GstVideoSink * sink,
 enum
 {
   PROP_0,
-  PROP_CHANNEL
+  PROP_CHANNEL,
+  PROP_RING_SIZE
 };
 
 #define DEFAULT_CHANNEL ("default")
+#define DEFAULT_RING_SIZE 0
 
 /* pad templates */
 static GstStaticPadTemplate gst_inter_video_sink_sink_template =
@@ -118,12 +126,21 @@ gst_inter_video_sink_class_init (GstInterVideoSinkClass * klass)
       g_param_spec_string ("channel", "Channel",
           "Channel name to match inter src and sink elements",
           DEFAULT_CHANNEL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_RING_SIZE,
+      g_param_spec_uint ("ring-size", "Ring size",
+          "Number of recent frames that readers can follow with their own "
+          "cursor, must be a power of 2 (0 = readers share the latest frame)",
+          0, GST_INTER_SURFACE_MAX_VIDEO_RING_SIZE, DEFAULT_RING_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
 }
 
 static void
 gst_inter_video_sink_init (GstInterVideoSink * intervideosink)
 {
   intervideosink->channel = g_strdup (DEFAULT_CHANNEL);
+  intervideosink->ring_size = DEFAULT_RING_SIZE;
 }
 
 void
@@ -137,6 +154,19 @@ gst_inter_video_sink_set_property (GObject * object, guint property_id,
       g_free (intervideosink->channel);
       intervideosink->channel = g_value_dup_string (value);
       break;
+    case PROP_RING_SIZE:
+    {
+      guint ring_size = g_value_get_uint (value);
+
+      /* the ring is indexed with a mask of the wrapping sequence numbers */
+      if (ring_size & (ring_size - 1)) {
+        GST_WARNING_OBJECT (intervideosink,
+            "Ignoring ring size %u, not a power of 2", ring_size);
+        break;
+      }
+      intervideosink->ring_size = ring_size;
+      break;
+    }
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -153,6 +183,9 @@ gst_inter_video_sink_get_property (GObject * object, guint property_id,
     case PROP_CHANNEL:
       g_value_set_string (value, intervideosink->channel);
       break;
+    case PROP_RING_SIZE:
+      g_value_set_uint (value, intervideosink->ring_size);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -199,6 +232,10 @@ gst_inter_video_sink_start (GstBaseSink * sink)
   intervideosink->surface = gst_inter_surface_get (intervideosink->channel);
   g_mutex_lock (&intervideosink->surface->mutex);
   memset (&intervideosink->surface->video_info, 0, sizeof (GstVideoInfo));
+  g_atomic_int_inc (&intervideosink->surface->video_info_cookie);
+  gst_inter_surface_clear_video_ring (intervideosink->surface);
+  g_atomic_int_set (&intervideosink->surface->video_ring_size,
+      intervideosink->ring_size);
   g_mutex_unlock (&intervideosink->surface->mutex);
 
   return TRUE;
@@ -215,6 +252,9 @@ gst_inter_video_sink_stop (GstBaseSink * sink)
   }
   intervideosink->surface->video_buffer = NULL;
   memset (&intervideosink->surface->video_info, 0, sizeof (GstVideoInfo));
+  g_atomic_int_inc (&intervideosink->surface->video_info_cookie);
+  g_atomic_int_set (&intervideosink->surface->video_ring_size, 0);
+  gst_inter_surface_clear_video_ring (intervideosink->surface);
   g_mutex_unlock (&intervideosink->surface->mutex);
 
   gst_inter_surface_unref (intervideosink->surface);
@@ -236,6 +276,7 @@ gst_inter_video_sink_set_caps (GstBaseSink * sink, GstCaps * caps)
 
   g_mutex_lock (&intervideosink->surface->mutex);
   intervideosink->surface->video_info = info;
+  g_atomic_int_inc (&intervideosink->surface->video_info_cookie);
   intervideosink->info = info;
   g_mutex_unlock (&intervideosink->surface->mutex);
 
@@ -250,6 +291,12 @@ gst_inter_video_sink_show_frame (GstVideoSink * sink, GstBuffer * buffer)
   GST_DEBUG_OBJECT (intervideosink, "render ts %" GST_TIME_FORMAT,
       GST_TIME_ARGS (GST_BUFFER_PTS (buffer)));
 
+  /* the readers follow the ring with their own cursor */
+  if (intervideosink->ring_size > 0) {
+    gst_inter_surface_push_video_frame (intervideosink->surface, buffer);
+    return GST_FLOW_OK;
+  }
+
   g_mutex_lock (&intervideosink->surface->mutex);
   if (intervideosink->surface->video_buffer) {
     gst_buffer_unref (intervideosink->surface->video_buffer);
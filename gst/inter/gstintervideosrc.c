@@ -32,6 +32,12 @@
  * The intersubsrc element cannot be used effectively with gst-launch-1.0,
  * as it requires a second pipeline in the application to send subtitles.
  *
+ * When the intervideosink of the channel has a #GstInterVideoSink:ring-size,
+ * every intervideosrc follows the frames with its own cursor. It outputs the
+ * frames in order, skipping the ones that were overwritten when it falls
+ * behind, and repeats the last frame when there is no new one. These are
+ * counted in #GstInterVideoSrc:dropped and #GstInterVideoSrc:duplicated.
+ *
  */
 
 #ifdef HAVE_CONFIG_H
@@ -71,7 +77,9 @@ enum
 {
   PROP_0,
   PROP_CHANNEL,
-  PROP_TIMEOUT
+  PROP_TIMEOUT,
+  PROP_DROPPED,
+  PROP_DUPLICATED
 };
 
 #define DEFAULT_CHANNEL ("default")
@@ -130,6 +138,16 @@ gst_inter_video_src_class_init (GstInterVideoSrcClass * klass)
           "Timeout after which to start outputting black frames",
           0, G_MAXUINT64, DEFAULT_TIMEOUT,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_DROPPED,
+      g_param_spec_uint64 ("dropped", "Dropped",
+          "Number of frames of the sink's ring that were skipped",
+          0, G_MAXUINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_DUPLICATED,
+      g_param_spec_uint64 ("duplicated", "Duplicated",
+          "Number of times the last frame of the sink's ring was repeated",
+          0, G_MAXUINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -175,6 +193,16 @@ gst_inter_video_src_get_property (GObject * object, guint property_id,
     case PROP_TIMEOUT:
       g_value_set_uint64 (value, intervideosrc->timeout);
       break;
+    case PROP_DROPPED:
+      GST_OBJECT_LOCK (intervideosrc);
+      g_value_set_uint64 (value, intervideosrc->dropped);
+      GST_OBJECT_UNLOCK (intervideosrc);
+      break;
+    case PROP_DUPLICATED:
+      GST_OBJECT_LOCK (intervideosrc);
+      g_value_set_uint64 (value, intervideosrc->duplicated);
+      GST_OBJECT_UNLOCK (intervideosrc);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -276,6 +304,15 @@ gst_inter_video_src_start (GstBaseSrc * src)
   intervideosrc->surface = gst_inter_surface_get (intervideosrc->channel);
   intervideosrc->timestamp_offset = 0;
   intervideosrc->n_frames = 0;
+  /* make sure the first frame checks the video info */
+  intervideosrc->video_info_cookie =
+      g_atomic_int_get (&intervideosrc->surface->video_info_cookie) - 1;
+  intervideosrc->ring_started = FALSE;
+  intervideosrc->n_repeats = 0;
+  GST_OBJECT_LOCK (intervideosrc);
+  intervideosrc->dropped = 0;
+  intervideosrc->duplicated = 0;
+  GST_OBJECT_UNLOCK (intervideosrc);
 
   return TRUE;
 }
@@ -290,6 +327,7 @@ gst_inter_video_src_stop (GstBaseSrc * src)
   gst_inter_surface_unref (intervideosrc->surface);
   intervideosrc->surface = NULL;
   gst_buffer_replace (&intervideosrc->black_frame, NULL);
+  gst_buffer_replace (&intervideosrc->last_frame, NULL);
 
   return TRUE;
 }
@@ -319,26 +357,13 @@ gst_inter_video_src_get_times (GstBaseSrc * src, GstBuffer * buffer,
   }
 }
 
-static GstFlowReturn
-gst_inter_video_src_create (GstBaseSrc * src, guint64 offset, guint size,
-    GstBuffer ** buf)
+/* Must be called with the surface mutex. Returns the caps to switch to if
+ * the video info of the sink changed */
+static GstCaps *
+gst_inter_video_src_check_info (GstInterVideoSrc * intervideosrc)
 {
-  GstInterVideoSrc *intervideosrc = GST_INTER_VIDEO_SRC (src);
-  GstCaps *caps;
-  GstBuffer *buffer;
-  guint64 frames;
-  gboolean is_gap = FALSE;
+  GstCaps *caps = NULL;
 
-  GST_DEBUG_OBJECT (intervideosrc, "create");
-
-  caps = NULL;
-  buffer = NULL;
-
-  frames = gst_util_uint64_scale_ceil (intervideosrc->timeout,
-      GST_VIDEO_INFO_FPS_N (&intervideosrc->info),
-      GST_VIDEO_INFO_FPS_D (&intervideosrc->info) * GST_SECOND);
-
-  g_mutex_lock (&intervideosrc->surface->mutex);
   if (intervideosrc->surface->video_info.finfo) {
     GstVideoInfo tmp_info = intervideosrc->surface->video_info;
 
@@ -360,6 +385,108 @@ gst_inter_video_src_create (GstBaseSrc * src, guint64 offset, guint size,
     }
   }
 
+  return caps;
+}
+
+/* Get the next frame of the ring of the sink, without taking the surface
+ * mutex. Returns %NULL if a black frame should be output instead. */
+static GstBuffer *
+gst_inter_video_src_get_ring_frame (GstInterVideoSrc * intervideosrc,
+    guint ring_size, guint64 frames, gboolean * is_gap)
+{
+  GstBuffer *buffer;
+  guint head, seq, frame_seq;
+
+  head = g_atomic_int_get (&intervideosrc->surface->video_seq);
+
+  if (!intervideosrc->ring_started) {
+    /* start with the latest frame */
+    intervideosrc->read_seq = head != 0 ? head - 1 : 0;
+    intervideosrc->ring_started = TRUE;
+  }
+
+  if (head != intervideosrc->read_seq) {
+    /* take the next frame, or the oldest one left if we fell behind */
+    if (head - intervideosrc->read_seq > ring_size)
+      seq = head - ring_size + 1;
+    else
+      seq = intervideosrc->read_seq + 1;
+
+    buffer = gst_inter_surface_get_video_frame (intervideosrc->surface, seq,
+        &frame_seq);
+    if (frame_seq - intervideosrc->read_seq > 1) {
+      GST_LOG_OBJECT (intervideosrc, "dropped %u frames",
+          frame_seq - intervideosrc->read_seq - 1);
+      GST_OBJECT_LOCK (intervideosrc);
+      intervideosrc->dropped += frame_seq - intervideosrc->read_seq - 1;
+      GST_OBJECT_UNLOCK (intervideosrc);
+    }
+    intervideosrc->read_seq = frame_seq;
+    intervideosrc->n_repeats = 0;
+    gst_buffer_replace (&intervideosrc->last_frame, buffer);
+
+    return buffer;
+  }
+
+  /* Can only repeat if timeout > 0 */
+  if (intervideosrc->last_frame && intervideosrc->n_repeats < frames) {
+    intervideosrc->n_repeats++;
+    GST_OBJECT_LOCK (intervideosrc);
+    intervideosrc->duplicated++;
+    GST_OBJECT_UNLOCK (intervideosrc);
+    *is_gap = TRUE;
+    return gst_buffer_ref (intervideosrc->last_frame);
+  }
+
+  gst_buffer_replace (&intervideosrc->last_frame, NULL);
+  *is_gap = TRUE;
+
+  return NULL;
+}
+
+static GstFlowReturn
+gst_inter_video_src_create (GstBaseSrc * src, guint64 offset, guint size,
+    GstBuffer ** buf)
+{
+  GstInterVideoSrc *intervideosrc = GST_INTER_VIDEO_SRC (src);
+  GstCaps *caps;
+  GstBuffer *buffer;
+  guint64 frames;
+  guint ring_size, cookie;
+  gboolean is_gap = FALSE;
+
+  GST_DEBUG_OBJECT (intervideosrc, "create");
+
+  caps = NULL;
+  buffer = NULL;
+
+  frames = gst_util_uint64_scale_ceil (intervideosrc->timeout,
+      GST_VIDEO_INFO_FPS_N (&intervideosrc->info),
+      GST_VIDEO_INFO_FPS_D (&intervideosrc->info) * GST_SECOND);
+
+  ring_size = g_atomic_int_get (&intervideosrc->surface->video_ring_size);
+  if (ring_size > 0) {
+    /* only take the mutex when the sink changed the video info */
+    cookie = g_atomic_int_get (&intervideosrc->surface->video_info_cookie);
+    if (cookie != intervideosrc->video_info_cookie) {
+      g_mutex_lock (&intervideosrc->surface->mutex);
+      caps = gst_inter_video_src_check_info (intervideosrc);
+      g_mutex_unlock (&intervideosrc->surface->mutex);
+      intervideosrc->video_info_cookie = cookie;
+    }
+
+    buffer = gst_inter_video_src_get_ring_frame (intervideosrc, ring_size,
+        frames, &is_gap);
+    goto negotiate;
+  }
+
+  /* the sink of the channel doesn't use a ring (anymore) */
+  intervideosrc->ring_started = FALSE;
+  gst_buffer_replace (&intervideosrc->last_frame, NULL);
+
+  g_mutex_lock (&intervideosrc->surface->mutex);
+  caps = gst_inter_video_src_check_info (intervideosrc);
+
   if (intervideosrc->surface->video_buffer) {
     /* We have a buffer to push */
     buffer = gst_buffer_ref (intervideosrc->surface->video_buffer);
@@ -380,6 +507,7 @@ gst_inter_video_src_create (GstBaseSrc * src, guint64 offset, guint size,
   intervideosrc->surface->video_buffer_count++;
   g_mutex_unlock (&intervideosrc->surface->mutex);
 
+negotiate:
   if (caps) {
     gboolean ret;
     GstStructure *s;
@@ -48,6 +48,17 @@ struct _GstInterVideoSrc
   GstBuffer *black_frame;
   int n_frames;
   GstClockTime timestamp_offset;
+
+  /* reading from the ring of the sink */
+  gboolean ring_started;
+  guint read_seq;
+  guint video_info_cookie;
+  GstBuffer *last_frame;
+  guint n_repeats;
+
+  /* protected by the object lock */
+  guint64 dropped;
+  guint64 duplicated;
 };
 
 struct _GstInterVideoSrcClass
@@ -105,6 +105,9 @@ struct _GstInterlace
   int fields_since_timebase;
   guint pattern_offset;         /* initial offset into the pattern */
   gboolean passthrough;
+
+  guint64 bytes_copied;         /* video data copied to weave fields,
+                                 * protected by the object lock */
 };
 
 struct _GstInterlaceClass
@@ -118,7 +121,8 @@ enum
   PROP_TOP_FIELD_FIRST,
   PROP_PATTERN,
   PROP_PATTERN_OFFSET,
-  PROP_ALLOW_RFF
+  PROP_ALLOW_RFF,
+  PROP_BYTES_COPIED
 };
 
 typedef enum
@@ -243,6 +247,12 @@ gst_interlace_class_init (GstInterlaceClass * klass)
           "Allow generation of buffers with RFF flag set, i.e., duration of 3 fields",
           FALSE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (object_class, PROP_BYTES_COPIED,
+      g_param_spec_uint64 ("bytes-copied", "Bytes copied",
+          "Number of bytes of video data copied to combine fields of "
+          "different frames", 0, G_MAXUINT64, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_set_static_metadata (element_class,
       "Interlace filter", "Filter/Video",
       "Creates an interlaced video from progressive frames",
@@ -295,6 +305,7 @@ gst_interlace_init (GstInterlace * interlace)
   interlace->allow_rff = FALSE;
   interlace->pattern = GST_INTERLACE_PATTERN_2_3;
   interlace->pattern_offset = 0;
+  interlace->bytes_copied = 0;
   gst_interlace_reset (interlace);
 }
 
@@ -793,6 +804,7 @@ copy_field (GstInterlace * interlace, GstBuffer * dest, GstBuffer * src,
   gint i, j, n_planes;
   guint8 *d, *s;
   GstVideoFrame dframe, sframe;
+  guint64 copied = 0;
 
   if (!gst_video_frame_map (&dframe, info, dest, GST_MAP_WRITE))
     goto dest_map_failed;
@@ -822,9 +834,14 @@ copy_field (GstInterlace * interlace, GstBuffer * dest, GstBuffer * src,
       memcpy (d, s, cwidth);
       d += ds * 2;
       s += ss * 2;
+      copied += cwidth;
     }
   }
 
+  GST_OBJECT_LOCK (interlace);
+  interlace->bytes_copied += copied;
+  GST_OBJECT_UNLOCK (interlace);
+
   gst_video_frame_unmap (&dframe);
   gst_video_frame_unmap (&sframe);
   return;
@@ -842,6 +859,61 @@ src_map_failed:
   }
 }
 
+/* a buffer can be written to without copying its data */
+static gboolean
+gst_interlace_buffer_is_reusable (GstBuffer * buf)
+{
+  return gst_buffer_is_writable (buf) &&
+      gst_buffer_is_all_memory_writable (buf);
+}
+
+/* keeps the memory layout of a reused frame and removes its other metas */
+static gboolean
+gst_interlace_remove_meta (GstBuffer * buffer, GstMeta ** meta,
+    gpointer user_data)
+{
+  if ((*meta)->info->api != GST_VIDEO_META_API_TYPE)
+    *meta = NULL;
+
+  return TRUE;
+}
+
+/* Returns the output buffer of field field_index of the stored frame and
+ * the other field of buffer. The stored frame is not needed after this
+ * buffer, so when nobody else uses it or its memories only the field of
+ * buffer is copied into it. Otherwise both fields are copied into a new
+ * buffer. */
+static GstBuffer *
+gst_interlace_weave_stored_frame (GstInterlace * interlace, GstBuffer * buffer)
+{
+  GstBuffer *output_buffer;
+
+  if (interlace->stored_fields > 1 ||
+      !gst_interlace_buffer_is_reusable (interlace->stored_frame)) {
+    output_buffer = gst_buffer_new_and_alloc (gst_buffer_get_size (buffer));
+    /* take the first field from the stored frame */
+    copy_field (interlace, output_buffer, interlace->stored_frame,
+        interlace->field_index);
+    /* take the second field from the incoming buffer */
+    copy_field (interlace, output_buffer, buffer, interlace->field_index ^ 1);
+    return output_buffer;
+  }
+
+  GST_DEBUG ("copying field %d from current into stored frame",
+      interlace->field_index ^ 1);
+  output_buffer = interlace->stored_frame;
+  interlace->stored_frame = NULL;
+  copy_field (interlace, output_buffer, buffer, interlace->field_index ^ 1);
+
+  /* the flags, offsets and metas of the stored frame are not the ones of the
+   * woven frame, which gets the same as a new buffer */
+  GST_BUFFER_FLAGS (output_buffer) &= GST_MINI_OBJECT_FLAG_LAST - 1;
+  GST_BUFFER_OFFSET (output_buffer) = GST_BUFFER_OFFSET_NONE;
+  GST_BUFFER_OFFSET_END (output_buffer) = GST_BUFFER_OFFSET_NONE;
+  gst_buffer_foreach_meta (output_buffer, gst_interlace_remove_meta, NULL);
+
+  return output_buffer;
+}
 
 static GstFlowReturn
 gst_interlace_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
@@ -920,13 +992,8 @@ gst_interlace_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
     if (interlace->stored_fields > 0) {
       GST_DEBUG ("1 field from stored, 1 from current");
 
-      output_buffer = gst_buffer_new_and_alloc (gst_buffer_get_size (buffer));
-      /* take the first field from the stored frame */
-      copy_field (interlace, output_buffer, interlace->stored_frame,
-          interlace->field_index);
+      output_buffer = gst_interlace_weave_stored_frame (interlace, buffer);
       interlace->stored_fields--;
-      /* take the second field from the incoming buffer */
-      copy_field (interlace, output_buffer, buffer, interlace->field_index ^ 1);
       current_fields--;
       n_output_fields = 2;
       interlaced = TRUE;
@@ -1031,6 +1098,11 @@ gst_interlace_get_property (GObject * object,
     case PROP_ALLOW_RFF:
       g_value_set_boolean (value, interlace->allow_rff);
       break;
+    case PROP_BYTES_COPIED:
+      GST_OBJECT_LOCK (interlace);
+      g_value_set_uint64 (value, interlace->bytes_copied);
+      GST_OBJECT_UNLOCK (interlace);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1040,7 +1112,8 @@ gst_interlace_get_property (GObject * object,
 static GstStateChangeReturn
 gst_interlace_change_state (GstElement * element, GstStateChange transition)
 {
-  //GstInterlace *interlace = GST_INTERLACE (element);
+  GstInterlace *interlace = GST_INTERLACE (element);
+  GstStateChangeReturn ret;
 
   switch (transition) {
     case GST_STATE_CHANGE_PAUSED_TO_READY:
@@ -1050,7 +1123,19 @@ gst_interlace_change_state (GstElement * element, GstStateChange transition)
       break;
   }
 
-  return GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
+  ret = GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
+
+  switch (transition) {
+    case GST_STATE_CHANGE_READY_TO_NULL:
+      GST_OBJECT_LOCK (interlace);
+      interlace->bytes_copied = 0;
+      GST_OBJECT_UNLOCK (interlace);
+      break;
+    default:
+      break;
+  }
+
+  return ret;
 }
 
 static gboolean
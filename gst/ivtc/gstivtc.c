@@ -47,6 +47,7 @@
 #include <gst/base/gstbasetransform.h>
 #include <gst/video/video.h>
 #include "gstivtc.h"
+#include "ivtccomb.h"
 #include <string.h>
 #include <math.h>
 
@@ -59,6 +60,11 @@ GST_DEBUG_CATEGORY_STATIC (gst_ivtc_debug_category);
 /* prototypes */
 
 
+static void gst_ivtc_set_property (GObject * object,
+    guint property_id, const GValue * value, GParamSpec * pspec);
+static void gst_ivtc_get_property (GObject * object,
+    guint property_id, GValue * value, GParamSpec * pspec);
+static void gst_ivtc_finalize (GObject * object);
 static GstCaps *gst_ivtc_transform_caps (GstBaseTransform * trans,
     GstPadDirection direction, GstCaps * caps, GstCaps * filter);
 static GstCaps *gst_ivtc_fixate_caps (GstBaseTransform * trans,
@@ -73,13 +79,17 @@ static void gst_ivtc_flush (GstIvtc * ivtc);
 static void gst_ivtc_retire_fields (GstIvtc * ivtc, int n_fields);
 static void gst_ivtc_construct_frame (GstIvtc * itvc, GstBuffer * outbuf);
 
-static int get_comb_score (GstVideoFrame * top, GstVideoFrame * bottom);
+static int get_comb_score (GstIvtc * ivtc, GstVideoFrame * top,
+    GstVideoFrame * bottom);
 
 enum
 {
-  PROP_0
+  PROP_0,
+  PROP_N_THREADS
 };
 
+#define DEFAULT_N_THREADS 1
+
 /* pad templates */
 
 #define MAX_WIDTH 2048
@@ -114,6 +124,7 @@ G_DEFINE_TYPE_WITH_CODE (GstIvtc, gst_ivtc, GST_TYPE_BASE_TRANSFORM,
 static void
 gst_ivtc_class_init (GstIvtcClass * klass)
 {
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
   GstBaseTransformClass *base_transform_class =
       GST_BASE_TRANSFORM_CLASS (klass);
 
@@ -134,11 +145,78 @@ gst_ivtc_class_init (GstIvtcClass * klass)
   base_transform_class->set_caps = GST_DEBUG_FUNCPTR (gst_ivtc_set_caps);
   base_transform_class->sink_event = GST_DEBUG_FUNCPTR (gst_ivtc_sink_event);
   base_transform_class->transform = GST_DEBUG_FUNCPTR (gst_ivtc_transform);
+
+  gobject_class->set_property = gst_ivtc_set_property;
+  gobject_class->get_property = gst_ivtc_get_property;
+  gobject_class->finalize = gst_ivtc_finalize;
+
+  /**
+   * GstIvtc:n-threads:
+   *
+   * Maximum number of threads used to compute the comb score of a pair of
+   * fields. The combed pixels of bands of rows are found in parallel, the
+   * scores and so the reconstructed frames are the same as with a single
+   * thread. 0 uses one thread per processor.
+   */
+  g_object_class_install_property (gobject_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Number of threads",
+          "Maximum number of threads used for comb detection "
+          "(0 = number of processors)", 0, G_MAXINT, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
 gst_ivtc_init (GstIvtc * ivtc)
 {
+  ivtc->n_threads = DEFAULT_N_THREADS;
+  g_mutex_init (&ivtc->band_lock);
+  g_cond_init (&ivtc->band_cond);
+}
+
+static void
+gst_ivtc_set_property (GObject * object, guint property_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstIvtc *ivtc = GST_IVTC (object);
+
+  switch (property_id) {
+    case PROP_N_THREADS:
+      ivtc->n_threads = g_value_get_uint (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_ivtc_get_property (GObject * object, guint property_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstIvtc *ivtc = GST_IVTC (object);
+
+  switch (property_id) {
+    case PROP_N_THREADS:
+      g_value_set_uint (value, ivtc->n_threads);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_ivtc_finalize (GObject * object)
+{
+  GstIvtc *ivtc = GST_IVTC (object);
+
+  if (ivtc->band_pool)
+    g_thread_pool_free (ivtc->band_pool, FALSE, TRUE);
+  g_mutex_clear (&ivtc->band_lock);
+  g_cond_clear (&ivtc->band_cond);
+  g_free (ivtc->comb_mask);
+
+  G_OBJECT_CLASS (gst_ivtc_parent_class)->finalize (object);
 }
 
 static GstCaps *
@@ -299,6 +377,7 @@ add_field (GstIvtc * ivtc, GstBuffer * buffer, int parity, int index)
   field->buffer = gst_buffer_ref (buffer);
   field->parity = parity;
   field->ts = ts;
+  field->next_score = -1;
 
   gst_video_frame_map (&ivtc->fields[i].frame, &ivtc->sink_video_info,
       buffer, GST_MAP_READ);
@@ -318,14 +397,20 @@ similarity (GstIvtc * ivtc, int i1, int i2)
   f1 = &ivtc->fields[i1];
   f2 = &ivtc->fields[i2];
 
+  if (i2 == i1 + 1 && f1->next_score >= 0)
+    return f1->next_score;
+
   if (f1->parity == TOP_FIELD) {
-    score = get_comb_score (&f1->frame, &f2->frame);
+    score = get_comb_score (ivtc, &f1->frame, &f2->frame);
   } else {
-    score = get_comb_score (&f2->frame, &f1->frame);
+    score = get_comb_score (ivtc, &f2->frame, &f1->frame);
   }
 
   GST_DEBUG ("score %d", score);
 
+  if (i2 == i1 + 1)
+    f1->next_score = score;
+
   return score;
 }
 
@@ -629,45 +714,134 @@ gst_ivtc_construct_frame (GstIvtc * ivtc, GstBuffer * outbuf)
 
 }
 
+typedef struct
+{
+  GstIvtc *ivtc;
+  GstVideoFrame *top;
+  GstVideoFrame *bottom;
+  int start;
+  int end;
+} GstIvtcCombBand;
+
+static void
+get_comb_mask_rows (GstIvtc * ivtc, GstVideoFrame * top,
+    GstVideoFrame * bottom, int start, int end)
+{
+  int width = GST_VIDEO_FRAME_COMP_WIDTH (top, 0);
+  int j, k;
+
+  k = 0;
+  for (j = start; j < end; j++) {
+    ivtc_comb_mask_row (ivtc->comb_mask + j * width,
+        GET_LINE_IL (top, bottom, 0, j - 1), GET_LINE_IL (top, bottom, 0, j),
+        GET_LINE_IL (top, bottom, 0, j + 1), width);
+  }
+}
+
+static void
+gst_ivtc_comb_band_func (gpointer data, gpointer user_data)
+{
+  GstIvtcCombBand *band = data;
+  GstIvtc *ivtc = band->ivtc;
+
+  get_comb_mask_rows (ivtc, band->top, band->bottom, band->start, band->end);
+
+  g_mutex_lock (&ivtc->band_lock);
+  if (--ivtc->bands_pending == 0)
+    g_cond_signal (&ivtc->band_cond);
+  g_mutex_unlock (&ivtc->band_lock);
+}
+
+/* Finds the combed pixels of the rows in parallel bands. The run counts of
+ * a row depend on the ones of the row above, so they are then added up
+ * from here, which is cheap as most pixels are not combed. */
+static void
+get_comb_mask_bands (GstIvtc * ivtc, GstVideoFrame * top,
+    GstVideoFrame * bottom, guint n_threads, guint n_bands)
+{
+  GstIvtcCombBand *bands;
+  gsize size;
+  int height;
+  guint i;
+
+  height = GST_VIDEO_FRAME_COMP_HEIGHT (top, 0);
+  size = (gsize) GST_VIDEO_FRAME_COMP_WIDTH (top, 0) * height;
+  if (ivtc->comb_mask_size < size) {
+    g_free (ivtc->comb_mask);
+    ivtc->comb_mask = g_malloc (size);
+    ivtc->comb_mask_size = size;
+  }
+
+  if (!ivtc->band_pool) {
+    ivtc->band_pool = g_thread_pool_new (gst_ivtc_comb_band_func, NULL,
+        n_threads - 1, FALSE, NULL);
+  } else if (g_thread_pool_get_max_threads (ivtc->band_pool) !=
+      (gint) n_threads - 1) {
+    g_thread_pool_set_max_threads (ivtc->band_pool, n_threads - 1, NULL);
+  }
+
+  bands = g_newa (GstIvtcCombBand, n_bands);
+  ivtc->bands_pending = n_bands - 1;
+  for (i = 0; i < n_bands; i++) {
+    bands[i].ivtc = ivtc;
+    bands[i].top = top;
+    bands[i].bottom = bottom;
+    bands[i].start = 2 + (guint64) (height - 4) * i / n_bands;
+    bands[i].end = 2 + (guint64) (height - 4) * (i + 1) / n_bands;
+  }
+
+  /* the first band is done from here while the pool handles the others */
+  for (i = 1; i < n_bands; i++) {
+    if (!g_thread_pool_push (ivtc->band_pool, &bands[i], NULL))
+      gst_ivtc_comb_band_func (&bands[i], NULL);
+  }
+  get_comb_mask_rows (ivtc, top, bottom, bands[0].start, bands[0].end);
+
+  g_mutex_lock (&ivtc->band_lock);
+  while (ivtc->bands_pending > 0)
+    g_cond_wait (&ivtc->band_cond, &ivtc->band_lock);
+  g_mutex_unlock (&ivtc->band_lock);
+}
+
 static int
-get_comb_score (GstVideoFrame * top, GstVideoFrame * bottom)
+get_comb_score (GstIvtc * ivtc, GstVideoFrame * top, GstVideoFrame * bottom)
 {
   int j;
-  int thisline[MAX_WIDTH];
+  guint16 thisline[MAX_WIDTH];
+  guint8 mask[MAX_WIDTH];
   int score = 0;
   int height;
   int width;
   int k;
+  guint n_threads, n_bands;
 
   height = GST_VIDEO_FRAME_COMP_HEIGHT (top, 0);
   width = GST_VIDEO_FRAME_COMP_WIDTH (top, 0);
 
   memset (thisline, 0, sizeof (thisline));
 
+  n_threads = ivtc->n_threads;
+  if (n_threads == 0)
+    n_threads = g_get_num_processors ();
+
+  /* at least 16 rows per band */
+  n_bands = height > 4 ? MIN (n_threads, (height - 4) / 16) : 0;
+
   k = 0;
   /* remove a few lines from top and bottom, as they sometimes contain
    * artifacts */
-  for (j = 2; j < height - 2; j++) {
-    guint8 *src1 = GET_LINE_IL (top, bottom, 0, j - 1);
-    guint8 *src2 = GET_LINE_IL (top, bottom, 0, j);
-    guint8 *src3 = GET_LINE_IL (top, bottom, 0, j + 1);
-    int i;
-
-    for (i = 0; i < width; i++) {
-      if (src2[i] < MIN (src1[i], src3[i]) - 5 ||
-          src2[i] > MAX (src1[i], src3[i]) + 5) {
-        if (i > 0) {
-          thisline[i] += thisline[i - 1];
-        }
-        thisline[i]++;
-        if (thisline[i] > 1000)
-          thisline[i] = 1000;
-      } else {
-        thisline[i] = 0;
-      }
-      if (thisline[i] > 100) {
-        score++;
-      }
+  if (n_bands > 1) {
+    get_comb_mask_bands (ivtc, top, bottom, n_threads, n_bands);
+    for (j = 2; j < height - 2; j++) {
+      score += ivtc_comb_accumulate_row (thisline,
+          ivtc->comb_mask + j * width, width);
+    }
+  } else {
+    for (j = 2; j < height - 2; j++) {
+      ivtc_comb_mask_row (mask, GET_LINE_IL (top, bottom, 0, j - 1),
+          GET_LINE_IL (top, bottom, 0, j), GET_LINE_IL (top, bottom, 0,
+              j + 1), width);
+      score += ivtc_comb_accumulate_row (thisline, mask, width);
     }
   }
 
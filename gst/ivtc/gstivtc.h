@@ -41,6 +41,10 @@ struct _GstIvtcField
   int parity;
   GstVideoFrame frame;
   GstClockTime ts;
+  /* comb score with the next field, -1 if not computed yet. Fields are
+   * only appended to and retired from the start of the queue, so the next
+   * field stays the same until this one is retired */
+  int next_score;
 };
 
 #define GST_IVTC_MAX_FIELDS 10
@@ -58,6 +62,15 @@ struct _GstIvtc
 
   int n_fields;
   GstIvtcField fields[GST_IVTC_MAX_FIELDS];
+
+  /* row band parallel comb scores, see get_comb_score() */
+  guint n_threads;
+  GThreadPool *band_pool;
+  GMutex band_lock;
+  GCond band_cond;
+  guint bands_pending;
+  guint8 *comb_mask;
+  gsize comb_mask_size;
 };
 
 struct _GstIvtcClass
@@ -0,0 +1,177 @@
+/* GStreamer
+ * Copyright (C) 2013 David Schleef <ds@schleef.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+ * Boston, MA 02110-1335, USA.
+ */
+
+/* Comb metric of get_comb_score() in gstivtc.c.
+ *
+ * A pixel of line j is combed if it is more than 5 below or above both
+ * pixels of lines j - 1 and j + 1, which come from the other field. Each
+ * combed pixel gets a run count of 1 + the count of the pixel above + the
+ * count of the pixel on its left, saturated to 1000, other pixels get 0.
+ * The score is the number of pixels with a count above 100, so that only
+ * large combed areas count.
+ *
+ * This is split in ivtc_comb_mask_row(), which only depends on the three
+ * lines and can be done for all lines in parallel, and
+ * ivtc_comb_accumulate_row(), which updates the run counts of a line from
+ * the ones of the previous line. Both give the same result as the original
+ * per pixel loop.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "ivtccomb.h"
+
+#if defined (__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define COMB_THRESHOLD 5
+#define MAX_RUN 1000
+#define SCORE_RUN 100
+
+/* sets mask[i] to 0xff for the combed pixels of src2, 0 for the others */
+void
+ivtc_comb_mask_row (guint8 * mask, const guint8 * src1, const guint8 * src2,
+    const guint8 * src3, int width)
+{
+  int i = 0;
+
+#if defined (__SSE2__)
+  const __m128i threshold = _mm_set1_epi8 (COMB_THRESHOLD);
+  const __m128i zero = _mm_setzero_si128 ();
+  const __m128i ones = _mm_set1_epi8 (-1);
+
+  for (; i + 16 <= width; i += 16) {
+    __m128i a = _mm_loadu_si128 ((const __m128i *) (src1 + i));
+    __m128i b = _mm_loadu_si128 ((const __m128i *) (src2 + i));
+    __m128i c = _mm_loadu_si128 ((const __m128i *) (src3 + i));
+    __m128i lo = _mm_min_epu8 (a, c);
+    __m128i hi = _mm_max_epu8 (a, c);
+    /* distance of src2 outside of [lo, hi], at most one of them is not 0 */
+    __m128i d = _mm_max_epu8 (_mm_subs_epu8 (lo, b), _mm_subs_epu8 (b, hi));
+
+    d = _mm_cmpeq_epi8 (_mm_subs_epu8 (d, threshold), zero);
+    _mm_storeu_si128 ((__m128i *) (mask + i), _mm_xor_si128 (d, ones));
+  }
+#endif
+
+  for (; i < width; i++) {
+    if (src2[i] < MIN (src1[i], src3[i]) - COMB_THRESHOLD ||
+        src2[i] > MAX (src1[i], src3[i]) + COMB_THRESHOLD)
+      mask[i] = 0xff;
+    else
+      mask[i] = 0;
+  }
+}
+
+#if defined (__SSE2__)
+/* Run counts of 8 pixels. A combed pixel adds the count on its left, which
+ * is the sum of the counts of the combed pixels since the last pixel that
+ * is not combed, so this is a segmented prefix sum: at each step a lane
+ * adds the lane k to its left if all lanes in between are combed. As all
+ * counts are positive, saturating at each step gives the same result as
+ * saturating after each pixel. */
+static inline __m128i
+comb_run_8 (__m128i old, __m128i combed, int carry)
+{
+  const __m128i one = _mm_set1_epi16 (1);
+  const __m128i max_run = _mm_set1_epi16 (MAX_RUN);
+  __m128i x;
+
+  x = _mm_add_epi16 (_mm_add_epi16 (old, one), _mm_cvtsi32_si128 (carry));
+  x = _mm_min_epi16 (_mm_and_si128 (x, combed), max_run);
+
+  x = _mm_add_epi16 (x, _mm_and_si128 (combed, _mm_slli_si128 (x, 2)));
+  x = _mm_min_epi16 (x, max_run);
+  combed = _mm_and_si128 (combed, _mm_slli_si128 (combed, 2));
+
+  x = _mm_add_epi16 (x, _mm_and_si128 (combed, _mm_slli_si128 (x, 4)));
+  x = _mm_min_epi16 (x, max_run);
+  combed = _mm_and_si128 (combed, _mm_slli_si128 (combed, 4));
+
+  x = _mm_add_epi16 (x, _mm_and_si128 (combed, _mm_slli_si128 (x, 8)));
+  return _mm_min_epi16 (x, max_run);
+}
+#endif
+
+/* updates the run counts of thisline with the mask of the next line and
+ * returns the number of pixels of that line with a count above 100 */
+int
+ivtc_comb_accumulate_row (guint16 * thisline, const guint8 * mask, int width)
+{
+  int i = 0;
+  int score = 0;
+  int left = 0;
+
+#if defined (__SSE2__)
+  const __m128i score_run = _mm_set1_epi16 (SCORE_RUN);
+  __m128i count = _mm_setzero_si128 ();
+
+  for (; i + 16 <= width; i += 16) {
+    __m128i m = _mm_loadu_si128 ((const __m128i *) (mask + i));
+    __m128i x0, x1;
+
+    /* most of the pixels of a frame are not combed */
+    if (_mm_movemask_epi8 (m) == 0) {
+      _mm_storeu_si128 ((__m128i *) (thisline + i), _mm_setzero_si128 ());
+      _mm_storeu_si128 ((__m128i *) (thisline + i + 8), _mm_setzero_si128 ());
+      left = 0;
+      continue;
+    }
+
+    x0 = comb_run_8 (_mm_loadu_si128 ((const __m128i *) (thisline + i)),
+        _mm_unpacklo_epi8 (m, m), left);
+    left = _mm_extract_epi16 (x0, 7);
+    x1 = comb_run_8 (_mm_loadu_si128 ((const __m128i *) (thisline + i + 8)),
+        _mm_unpackhi_epi8 (m, m), left);
+    left = _mm_extract_epi16 (x1, 7);
+
+    _mm_storeu_si128 ((__m128i *) (thisline + i), x0);
+    _mm_storeu_si128 ((__m128i *) (thisline + i + 8), x1);
+
+    /* the lanes count 0 to -2 per 16 pixels, so this can't overflow for
+     * lines up to 2^18 pixels */
+    count = _mm_add_epi16 (count, _mm_cmpgt_epi16 (x0, score_run));
+    count = _mm_add_epi16 (count, _mm_cmpgt_epi16 (x1, score_run));
+  }
+
+  /* sign extend the lanes and add them up */
+  count = _mm_madd_epi16 (count, _mm_set1_epi16 (-1));
+  count = _mm_add_epi32 (count, _mm_srli_si128 (count, 8));
+  count = _mm_add_epi32 (count, _mm_srli_si128 (count, 4));
+  score = _mm_cvtsi128_si32 (count);
+#endif
+
+  for (; i < width; i++) {
+    if (mask[i]) {
+      int run = thisline[i] + left + 1;
+
+      thisline[i] = MIN (run, MAX_RUN);
+    } else {
+      thisline[i] = 0;
+    }
+    left = thisline[i];
+    if (thisline[i] > SCORE_RUN)
+      score++;
+  }
+
+  return score;
+}
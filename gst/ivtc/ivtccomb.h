@@ -0,0 +1,34 @@
+/* GStreamer
+ * Copyright (C) 2013 David Schleef <ds@schleef.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+ * Boston, MA 02110-1335, USA.
+ */
+
+#ifndef _IVTC_COMB_H_
+#define _IVTC_COMB_H_
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+void ivtc_comb_mask_row (guint8 * mask, const guint8 * src1,
+    const guint8 * src2, const guint8 * src3, int width);
+int ivtc_comb_accumulate_row (guint16 * thisline, const guint8 * mask,
+    int width);
+
+G_END_DECLS
+
+#endif
@@ -238,6 +238,7 @@ mpegts_base_init (MpegTSBase * base)
   base->parse_private_sections = FALSE;
   base->is_pes = g_new0 (guint8, 1024);
   base->known_psi = g_new0 (guint8, 1024);
+  base->scan_pids = g_new0 (guint8, 1024);
   base->program_size = sizeof (MpegTSBaseProgram);
   base->stream_size = sizeof (MpegTSBaseStream);
 
@@ -257,6 +258,7 @@ mpegts_base_dispose (GObject * object)
     base->disposed = TRUE;
     g_free (base->known_psi);
     g_free (base->is_pes);
+    g_free (base->scan_pids);
   }
 
   if (G_OBJECT_CLASS (parent_class)->dispose)
@@ -1353,6 +1355,30 @@ mpegts_base_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
   return res;
 }
 
+static void
+mpegts_base_update_scan_pids (MpegTSBase * base)
+{
+  GHashTableIter iter;
+  MpegTSBaseProgram *program;
+  guint i;
+
+  if (base->push_data) {
+    for (i = 0; i < 1024; i++)
+      base->scan_pids[i] = base->known_psi[i] | base->is_pes[i];
+  } else {
+    memcpy (base->scan_pids, base->known_psi, 1024);
+  }
+
+  /* the PCR are needed in any case */
+  GST_OBJECT_LOCK (base);
+  g_hash_table_iter_init (&iter, base->programs);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) & program)) {
+    if (program->active && program->pcr_pid < 0x2000)
+      MPEGTS_BIT_SET (base->scan_pids, program->pcr_pid);
+  }
+  GST_OBJECT_UNLOCK (base);
+}
+
 static GstFlowReturn
 mpegts_base_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
 {
@@ -1391,7 +1417,13 @@ mpegts_base_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
 
   mpegts_packetizer_push (base->packetizer, buf);
 
+  if (base->bulk_scan)
+    mpegts_base_update_scan_pids (base);
+
   while (res == GST_FLOW_OK) {
+    if (base->bulk_scan)
+      mpegts_packetizer_skip_packets (base->packetizer, base->scan_pids);
+
     pret = mpegts_packetizer_next_packet (base->packetizer, &packet);
 
     /* If we don't have enough data, return */
@@ -1427,6 +1459,10 @@ mpegts_base_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
         g_list_free (others);
       }
 
+      /* the section might have added or removed PSI or PCR PIDs */
+      if (base->bulk_scan)
+        mpegts_base_update_scan_pids (base);
+
       /* we need to push section packet downstream */
       if (base->push_section)
         res = klass->push (base, &packet, section);
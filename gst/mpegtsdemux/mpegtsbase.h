@@ -158,6 +158,12 @@ struct _MpegTSBase {
   gboolean push_data;
   gboolean push_section;
 
+  /* Whether to skip, without parsing them, the packets that carry neither
+   * PSI nor PCR nor data to push. Their PIDs are not in @scan_pids, which
+   * is rebuilt for each input buffer */
+  gboolean bulk_scan;
+  guint8 *scan_pids;
+
   /* Whether the parent bin is streams-aware, meaning we can
    * add/remove streams at any point in time */
   gboolean streams_aware;
@@ -25,6 +25,10 @@
 #include <string.h>
 #include <stdlib.h>
 
+#if defined (__SSE2__)
+#include <emmintrin.h>
+#endif
+
 /* Skew calculation pameters */
 #define MAX_TIME	(2 * GST_SECOND)
 
@@ -53,6 +57,7 @@ static void mpegts_packetizer_finalize (GObject * object);
 static GstClockTime calculate_skew (MpegTSPacketizer2 * packetizer,
     MpegTSPCR * pcr, guint64 pcrtime, GstClockTime time);
 static void _close_current_group (MpegTSPCR * pcrtable);
+static void mpegts_packetizer_unmap (MpegTSPacketizer2 * packetizer);
 static void record_pcr (MpegTSPacketizer2 * packetizer, MpegTSPCR * pcrtable,
     guint64 pcr, guint64 offset);
 
@@ -257,6 +262,7 @@ mpegts_packetizer_init (MpegTSPacketizer2 * packetizer)
   packetizer->calculate_skew = FALSE;
   packetizer->calculate_offset = FALSE;
 
+  packetizer->map_buffer = NULL;
   packetizer->map_data = NULL;
   packetizer->map_size = 0;
   packetizer->map_offset = 0;
@@ -289,6 +295,7 @@ mpegts_packetizer_dispose (GObject * object)
       g_free (packetizer->streams);
     }
 
+    mpegts_packetizer_unmap (packetizer);
     gst_adapter_clear (packetizer->adapter);
     g_object_unref (packetizer->adapter);
     g_mutex_clear (&packetizer->group_lock);
@@ -571,13 +578,11 @@ mpegts_packetizer_clear (MpegTSPacketizer2 * packetizer)
     memset (packetizer->streams, 0, 8192 * sizeof (MpegTSPacketizerStream *));
   }
 
+  mpegts_packetizer_unmap (packetizer);
   gst_adapter_clear (packetizer->adapter);
   packetizer->offset = 0;
   packetizer->empty = TRUE;
   packetizer->need_sync = FALSE;
-  packetizer->map_data = NULL;
-  packetizer->map_size = 0;
-  packetizer->map_offset = 0;
   packetizer->last_in_time = GST_CLOCK_TIME_NONE;
 
   pcrtable = packetizer->observations[packetizer->pcrtablelut[0x1fff]];
@@ -610,14 +615,12 @@ mpegts_packetizer_flush (MpegTSPacketizer2 * packetizer, gboolean hard)
       }
     }
   }
+  mpegts_packetizer_unmap (packetizer);
   gst_adapter_clear (packetizer->adapter);
 
   packetizer->offset = 0;
   packetizer->empty = TRUE;
   packetizer->need_sync = FALSE;
-  packetizer->map_data = NULL;
-  packetizer->map_size = 0;
-  packetizer->map_offset = 0;
   packetizer->last_in_time = GST_CLOCK_TIME_NONE;
 
   pcrtable = packetizer->observations[packetizer->pcrtablelut[0x1fff]];
@@ -680,11 +683,12 @@ mpegts_packetizer_push (MpegTSPacketizer2 * packetizer, GstBuffer * buffer)
 }
 
 static void
-mpegts_packetizer_flush_bytes (MpegTSPacketizer2 * packetizer, gsize size)
+mpegts_packetizer_unmap (MpegTSPacketizer2 * packetizer)
 {
-  if (size > 0) {
-    GST_LOG ("flushing %" G_GSIZE_FORMAT " bytes from adapter", size);
-    gst_adapter_flush (packetizer->adapter, size);
+  if (packetizer->map_buffer) {
+    gst_buffer_unmap (packetizer->map_buffer, &packetizer->map_info);
+    gst_buffer_unref (packetizer->map_buffer);
+    packetizer->map_buffer = NULL;
   }
 
   packetizer->map_data = NULL;
@@ -692,6 +696,19 @@ mpegts_packetizer_flush_bytes (MpegTSPacketizer2 * packetizer, gsize size)
   packetizer->map_offset = 0;
 }
 
+static void
+mpegts_packetizer_flush_bytes (MpegTSPacketizer2 * packetizer, gsize size)
+{
+  /* Release our reference to the mapped region before flushing, packets
+   * handed out earlier may still hold their own reference to it */
+  mpegts_packetizer_unmap (packetizer);
+
+  if (size > 0) {
+    GST_LOG ("flushing %" G_GSIZE_FORMAT " bytes from adapter", size);
+    gst_adapter_flush (packetizer->adapter, size);
+  }
+}
+
 static gboolean
 mpegts_packetizer_map (MpegTSPacketizer2 * packetizer, gsize size)
 {
@@ -706,11 +723,23 @@ mpegts_packetizer_map (MpegTSPacketizer2 * packetizer, gsize size)
   if (available < size)
     return FALSE;
 
-  packetizer->map_data =
-      (guint8 *) gst_adapter_map (packetizer->adapter, available);
-  if (!packetizer->map_data)
+  /* Take a buffer instead of mapping the adapter directly. When the data
+   * lives in a single input buffer this is a sub-buffer sharing its memory,
+   * which allows users of the packets to keep references to the payload
+   * instead of copying it (see MpegTSPacketizerPacket.buffer) */
+  packetizer->map_buffer = gst_adapter_get_buffer (packetizer->adapter,
+      available);
+  if (!packetizer->map_buffer)
     return FALSE;
 
+  if (!gst_buffer_map (packetizer->map_buffer, &packetizer->map_info,
+          GST_MAP_READ)) {
+    gst_buffer_unref (packetizer->map_buffer);
+    packetizer->map_buffer = NULL;
+    return FALSE;
+  }
+
+  packetizer->map_data = packetizer->map_info.data;
   packetizer->map_size = available;
   packetizer->map_offset = 0;
 
@@ -719,11 +748,70 @@ mpegts_packetizer_map (MpegTSPacketizer2 * packetizer, gsize size)
   return TRUE;
 }
 
+/* Returns the offset of the first position of @data from which @n_syncs
+ * sync bytes follow each other @packet_size bytes apart, or the number of
+ * positions that could be checked if there is none. All those positions can
+ * then be discarded when resyncing. */
+gsize
+mpegts_packetizer_find_sync (const guint8 * data, gsize size,
+    guint packet_size, guint n_syncs)
+{
+  gsize span = (gsize) (n_syncs - 1) * packet_size;
+  gsize i = 0, limit;
+  guint k;
+
+  if (size <= span)
+    return 0;
+  limit = size - span;
+
+#if defined (__SSE2__)
+  {
+    /* check 16 candidate positions at once */
+    const __m128i sync = _mm_set1_epi8 (PACKET_SYNC_BYTE);
+
+    for (; i + 16 <= limit; i += 16) {
+      __m128i match;
+      gint mask;
+
+      match = _mm_cmpeq_epi8 (_mm_loadu_si128 ((const __m128i *) (data + i)),
+          sync);
+      for (k = 1; k < n_syncs; k++)
+        match = _mm_and_si128 (match,
+            _mm_cmpeq_epi8 (_mm_loadu_si128 ((const __m128i *) (data + i +
+                        k * packet_size)), sync));
+
+      mask = _mm_movemask_epi8 (match);
+      if (mask)
+        return i + g_bit_nth_lsf (mask, -1);
+    }
+  }
+#endif
+
+  while (i < limit) {
+    const guint8 *sync;
+
+    sync = memchr (data + i, PACKET_SYNC_BYTE, limit - i);
+    if (!sync)
+      break;
+
+    i = sync - data;
+    for (k = 1; k < n_syncs; k++) {
+      if (data[i + k * packet_size] != PACKET_SYNC_BYTE)
+        break;
+    }
+    if (k == n_syncs)
+      return i;
+    i++;
+  }
+
+  return limit;
+}
+
 static gboolean
 mpegts_try_discover_packet_size (MpegTSPacketizer2 * packetizer)
 {
   guint8 *data;
-  gsize size, i, j;
+  gsize size, limit, i, j;
 
   static const guint psizes[] = {
     MPEGTS_NORMAL_PACKETSIZE,
@@ -738,25 +826,22 @@ mpegts_try_discover_packet_size (MpegTSPacketizer2 * packetizer)
   size = packetizer->map_size - packetizer->map_offset;
   data = packetizer->map_data + packetizer->map_offset;
 
-  for (i = 0; i + 3 * MPEGTS_MAX_PACKETSIZE < size; i++) {
-    /* find a sync byte */
-    if (data[i] != PACKET_SYNC_BYTE)
-      continue;
-
-    /* check for 4 consecutive sync bytes with each possible packet size */
-    for (j = 0; j < G_N_ELEMENTS (psizes); j++) {
-      guint packet_size = psizes[j];
-
-      if (data[i + packet_size] == PACKET_SYNC_BYTE &&
-          data[i + 2 * packet_size] == PACKET_SYNC_BYTE &&
-          data[i + 3 * packet_size] == PACKET_SYNC_BYTE) {
-        packetizer->packet_size = packet_size;
-        goto out;
-      }
+  /* look for 4 consecutive sync bytes with each possible packet size, the
+   * earliest position wins and the packet sizes are tried in order */
+  limit = size > 3 * MPEGTS_MAX_PACKETSIZE ?
+      size - 3 * MPEGTS_MAX_PACKETSIZE : 0;
+  i = limit;
+  for (j = 0; j < G_N_ELEMENTS (psizes); j++) {
+    gsize pos;
+
+    pos = mpegts_packetizer_find_sync (data, limit + 3 * psizes[j], psizes[j],
+        4);
+    if (pos < i) {
+      packetizer->packet_size = psizes[j];
+      i = pos;
     }
   }
 
-out:
   packetizer->map_offset += i;
 
   if (packetizer->packet_size == 0) {
@@ -778,7 +863,7 @@ out:
 static gboolean
 mpegts_packetizer_sync (MpegTSPacketizer2 * packetizer)
 {
-  gboolean found = FALSE;
+  gboolean found;
   guint8 *data;
   guint packet_size;
   gsize size, sync_offset, i;
@@ -796,14 +881,9 @@ mpegts_packetizer_sync (MpegTSPacketizer2 * packetizer)
   else
     sync_offset = 0;
 
-  for (i = sync_offset; i + 2 * packet_size < size; i++) {
-    if (data[i] == PACKET_SYNC_BYTE &&
-        data[i + packet_size] == PACKET_SYNC_BYTE &&
-        data[i + 2 * packet_size] == PACKET_SYNC_BYTE) {
-      found = TRUE;
-      break;
-    }
-  }
+  i = sync_offset + mpegts_packetizer_find_sync (data + sync_offset,
+      size - sync_offset, packet_size, 3);
+  found = i + 2 * packet_size < size;
 
   packetizer->map_offset += i - sync_offset;
 
@@ -813,6 +893,74 @@ mpegts_packetizer_sync (MpegTSPacketizer2 * packetizer)
   return found;
 }
 
+guint
+mpegts_packetizer_scan_headers (const guint8 * data, gsize size,
+    guint packet_size, MpegTSPacketizerHeader * headers, guint n_headers)
+{
+  guint i, n;
+
+  /* M2TS packets don't start with the sync byte, all other variants do */
+  if (packet_size == MPEGTS_M2TS_PACKETSIZE)
+    data += 4;
+
+  n = MIN (size / packet_size, n_headers);
+  for (i = 0; i < n; i++, data += packet_size) {
+    guint32 header = GST_READ_UINT32_BE (data);
+
+    if (G_UNLIKELY ((header >> 24) != PACKET_SYNC_BYTE))
+      break;
+
+    headers[i].pid = (header >> 8) & 0x1fff;
+    headers[i].flags = (header >> 16) & 0xe0;
+    headers[i].scram_afc_cc = header & 0xff;
+  }
+
+  return i;
+}
+
+guint
+mpegts_packetizer_skip_packets (MpegTSPacketizer2 * packetizer,
+    const guint8 * pids)
+{
+  MpegTSPacketizerHeader headers[64];
+  guint packet_size = packetizer->packet_size;
+  guint skipped = 0, n, i;
+
+  if (G_UNLIKELY (!packet_size || packetizer->need_sync))
+    return 0;
+
+  while (mpegts_packetizer_map (packetizer, packet_size)) {
+    n = mpegts_packetizer_scan_headers (packetizer->map_data +
+        packetizer->map_offset, packetizer->map_size - packetizer->map_offset,
+        packet_size, headers, G_N_ELEMENTS (headers));
+
+    /* stop before the packets that need to be looked at, including the
+     * corrupted ones so that they get reported as such */
+    for (i = 0; i < n; i++) {
+      if (MPEGTS_BIT_IS_SET (pids, headers[i].pid) || (headers[i].flags & 0x80))
+        break;
+    }
+
+    packetizer->map_offset += i * packet_size;
+    packetizer->offset += i * packet_size;
+    skipped += i;
+
+    /* a short scan means the end of the mapped data or a lost sync, which
+     * mpegts_packetizer_next_packet() takes care of */
+    if (i < G_N_ELEMENTS (headers))
+      break;
+  }
+
+  if (packetizer->map_data &&
+      packetizer->map_size - packetizer->map_offset < packet_size)
+    mpegts_packetizer_flush_bytes (packetizer, packetizer->map_offset);
+
+  if (skipped)
+    GST_LOG ("skipped %u packets", skipped);
+
+  return skipped;
+}
+
 MpegTSPacketizerPacketReturn
 mpegts_packetizer_next_packet (MpegTSPacketizer2 * packetizer,
     MpegTSPacketizerPacket * packet)
@@ -854,6 +1002,8 @@ mpegts_packetizer_next_packet (MpegTSPacketizer2 * packetizer,
       /* ALL mpeg-ts variants contain 188 bytes of data. Those with bigger
        * packet sizes contain either extra data (timesync, FEC, ..) either
        * before or after the data */
+      packet->buffer = packetizer->map_buffer;
+      packet->buffer_offset = packet_data - packetizer->map_data;
       packet->data_start = packet_data;
       packet->data_end = packet->data_start + 188;
       packet->offset = packetizer->offset;
@@ -264,6 +264,8 @@ struct _MpegTSPacketizer2 {
   gboolean       calculate_offset;
 
   /* Shortcuts for adapter usage */
+  GstBuffer *map_buffer;
+  GstMapInfo map_info;
   guint8 *map_data;
   gsize map_offset;
   gsize map_size;
@@ -308,8 +310,26 @@ typedef struct
   guint8  afc_flags;
   guint64 pcr;
   guint64 offset;
+
+  /* Buffer backing data_start (not reffed, only valid until the packet is
+   * cleared) and the offset of data_start within it. Take a reference
+   * or a sub-buffer to keep the payload around without copying it */
+  GstBuffer *buffer;
+  gsize buffer_offset;
 } MpegTSPacketizerPacket;
 
+/* Header fields of a packet, as extracted by mpegts_packetizer_scan_headers() */
+typedef struct
+{
+  guint16 pid;
+  /* transport_error_indicator (0x80), payload_unit_start_indicator (0x40)
+   * and transport_priority (0x20) */
+  guint8  flags;
+  /* scrambling_control (0xc0), adaptation_field_control (0x30) and
+   * continuity_counter (0x0f) */
+  guint8  scram_afc_cc;
+} MpegTSPacketizerHeader;
+
 typedef struct
 {
   guint8 table_id;
@@ -351,6 +371,14 @@ G_GNUC_INTERNAL void mpegts_packetizer_clear_packet (MpegTSPacketizer2 *packetiz
 G_GNUC_INTERNAL void mpegts_packetizer_remove_stream(MpegTSPacketizer2 *packetizer,
   gint16 pid);
 
+/* Batch scanning */
+G_GNUC_INTERNAL gsize mpegts_packetizer_find_sync (const guint8 *data, gsize size,
+  guint packet_size, guint n_syncs);
+G_GNUC_INTERNAL guint mpegts_packetizer_scan_headers (const guint8 *data, gsize size,
+  guint packet_size, MpegTSPacketizerHeader *headers, guint n_headers);
+G_GNUC_INTERNAL guint mpegts_packetizer_skip_packets (MpegTSPacketizer2 *packetizer,
+  const guint8 *pids);
+
 G_GNUC_INTERNAL GstMpegtsSection *mpegts_packetizer_push_section (MpegTSPacketizer2 *packetzer,
 								  MpegTSPacketizerPacket *packet, GList **remaining);
 
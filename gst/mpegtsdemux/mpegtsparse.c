@@ -84,6 +84,7 @@ enum
   PROP_SET_TIMESTAMPS,
   PROP_SMOOTHING_LATENCY,
   PROP_PCR_PID,
+  PROP_PIDS,
   /* FILL ME */
 };
 
@@ -131,6 +132,17 @@ mpegts_parse_dispose (GObject * object)
 
   gst_flow_combiner_free (parse->flowcombiner);
 
+  if (parse->filter_adapter) {
+    g_object_unref (parse->filter_adapter);
+    parse->filter_adapter = NULL;
+  }
+  g_free (parse->pids);
+  parse->pids = NULL;
+  g_free (parse->filter_pids);
+  parse->filter_pids = NULL;
+  g_free (parse->pending_filter_pids);
+  parse->pending_filter_pids = NULL;
+
   GST_CALL_PARENT (G_OBJECT_CLASS, dispose, (object));
 }
 
@@ -159,6 +171,14 @@ mpegts_parse_class_init (MpegTSParse2Class * klass)
       g_param_spec_int ("pcr-pid", "PID containing PCR",
           "Set the PID to use for PCR values (-1 for auto)",
           -1, G_MAXINT, -1, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_PIDS,
+      g_param_spec_string ("pids", "PIDs",
+          "Colon-separated list of PIDs (eg. 0:256:512) to output on the src "
+          "pad, or NULL to output all of them. The packets of the other PIDs "
+          "are dropped, and not parsed at all when they carry neither PSI "
+          "nor PCR", NULL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_PLAYING));
 
   element_class = GST_ELEMENT_CLASS (klass);
   element_class->pad_removed = mpegts_parse_pad_removed;
@@ -197,6 +217,7 @@ mpegts_parse_init (MpegTSParse2 * parse)
   parse->user_pcr_pid = parse->pcr_pid = -1;
 
   parse->flowcombiner = gst_flow_combiner_new ();
+  parse->filter_adapter = gst_adapter_new ();
 
   parse->srcpad = gst_pad_new_from_static_template (&src_template, "src");
   gst_flow_combiner_add_pad (parse->flowcombiner, parse->srcpad);
@@ -243,6 +264,7 @@ mpegts_parse_reset (MpegTSBase * base)
 
   g_list_free_full (parse->pending_buffers, (GDestroyNotify) gst_buffer_unref);
   parse->pending_buffers = NULL;
+  gst_adapter_clear (parse->filter_adapter);
 
   parse->current_pcr = GST_CLOCK_TIME_NONE;
   parse->previous_pcr = GST_CLOCK_TIME_NONE;
@@ -252,6 +274,57 @@ mpegts_parse_reset (MpegTSBase * base)
   parse->ts_offset = 0;
 }
 
+/* Builds the filter of @pids, which the streaming thread picks up with
+ * mpegts_parse_update_filter() before filtering the next buffer */
+static void
+mpegts_parse_set_pids (MpegTSParse2 * parse, const gchar * pids)
+{
+  gchar **split, **tmp;
+  guint8 *filter_pids = NULL;
+
+  if (pids != NULL && *pids != '\0') {
+    filter_pids = g_new0 (guint8, 1024);
+
+    split = g_strsplit (pids, ":", -1);
+    for (tmp = split; *tmp; tmp++) {
+      gchar *end;
+      guint64 pid = g_ascii_strtoull (*tmp, &end, 0);
+
+      if (end == *tmp || *end != '\0' || pid > 0x1fff) {
+        GST_WARNING_OBJECT (parse, "Ignoring invalid PID '%s'", *tmp);
+        continue;
+      }
+      MPEGTS_BIT_SET (filter_pids, pid);
+    }
+    g_strfreev (split);
+  }
+
+  GST_OBJECT_LOCK (parse);
+  g_free (parse->pids);
+  parse->pids = filter_pids ? g_strdup (pids) : NULL;
+  g_free (parse->pending_filter_pids);
+  parse->pending_filter_pids = filter_pids;
+  parse->filter_pids_changed = TRUE;
+  GST_OBJECT_UNLOCK (parse);
+}
+
+/* Called from the streaming thread only */
+static void
+mpegts_parse_update_filter (MpegTSParse2 * parse)
+{
+  GST_OBJECT_LOCK (parse);
+  if (parse->filter_pids_changed) {
+    g_free (parse->filter_pids);
+    parse->filter_pids = parse->pending_filter_pids;
+    parse->pending_filter_pids = NULL;
+    parse->filter_pids_changed = FALSE;
+    /* the data left from the previous filter is not packet aligned */
+    gst_adapter_clear (parse->filter_adapter);
+    GST_MPEGTS_BASE (parse)->bulk_scan = parse->filter_pids != NULL;
+  }
+  GST_OBJECT_UNLOCK (parse);
+}
+
 static void
 mpegts_parse_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec)
@@ -270,6 +343,9 @@ mpegts_parse_set_property (GObject * object, guint prop_id,
     case PROP_PCR_PID:
       parse->pcr_pid = parse->user_pcr_pid = g_value_get_int (value);
       break;
+    case PROP_PIDS:
+      mpegts_parse_set_pids (parse, g_value_get_string (value));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -291,6 +367,11 @@ mpegts_parse_get_property (GObject * object, guint prop_id,
     case PROP_PCR_PID:
       g_value_set_int (value, parse->pcr_pid);
       break;
+    case PROP_PIDS:
+      GST_OBJECT_LOCK (parse);
+      g_value_set_string (value, parse->pids);
+      GST_OBJECT_UNLOCK (parse);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -857,6 +938,103 @@ drain_pending_buffers (MpegTSParse2 * parse, gboolean drain_all)
   return ret;
 }
 
+/* Returns the packets of @buffer whose PIDs are in the filter, as buffers
+ * sharing the input memory wherever the packets don't straddle two input
+ * buffers. The header of each packet is extracted in batches, packets are
+ * never parsed here. Returns NULL if no packet was kept. */
+static GstBuffer *
+mpegts_parse_filter_pids (MpegTSParse2 * parse, GstBuffer * buffer)
+{
+  MpegTSPacketizerHeader headers[64];
+  gsize run_sizes[G_N_ELEMENTS (headers)];
+  gboolean run_keep[G_N_ELEMENTS (headers)];
+  GstAdapter *adapter = parse->filter_adapter;
+  GstBuffer *outbuf = NULL;
+  GstClockTime pts, dts;
+  gboolean discont;
+  guint packet_size, sync_offset;
+  gsize available;
+
+  pts = GST_BUFFER_PTS (buffer);
+  dts = GST_BUFFER_DTS (buffer);
+  discont = GST_BUFFER_IS_DISCONT (buffer);
+
+  /* drop the partial packet of the previous buffer */
+  if (discont)
+    gst_adapter_clear (adapter);
+  gst_adapter_push (adapter, buffer);
+
+  /* keep the data until the packetizer figured out the packet size */
+  packet_size = GST_MPEGTS_BASE (parse)->packetizer->packet_size;
+  if (packet_size == 0)
+    return NULL;
+  sync_offset = packet_size == MPEGTS_M2TS_PACKETSIZE ? 4 : 0;
+
+  while ((available = gst_adapter_available (adapter)) >= packet_size) {
+    const guint8 *data;
+    gsize size;
+    guint n, n_runs, i;
+
+    size = MIN (available, G_N_ELEMENTS (headers) * packet_size);
+    data = gst_adapter_map (adapter, size);
+    n = mpegts_packetizer_scan_headers (data, size, packet_size, headers,
+        G_N_ELEMENTS (headers));
+
+    if (n == 0) {
+      gsize skip;
+
+      /* lost sync, skip to the next 3 consecutive sync bytes */
+      skip = mpegts_packetizer_find_sync (data + sync_offset,
+          size - sync_offset, packet_size, 3);
+      gst_adapter_unmap (adapter);
+      if (skip == 0)
+        break;
+      GST_DEBUG_OBJECT (parse, "lost sync, dropping %" G_GSIZE_FORMAT
+          " bytes", skip);
+      gst_adapter_flush (adapter, skip);
+      continue;
+    }
+
+    /* group the packets in runs of kept and dropped ones */
+    n_runs = 0;
+    for (i = 0; i < n; i++) {
+      gboolean keep = MPEGTS_BIT_IS_SET (parse->filter_pids, headers[i].pid);
+
+      if (n_runs > 0 && run_keep[n_runs - 1] == keep) {
+        run_sizes[n_runs - 1] += packet_size;
+      } else {
+        run_keep[n_runs] = keep;
+        run_sizes[n_runs] = packet_size;
+        n_runs++;
+      }
+    }
+    gst_adapter_unmap (adapter);
+
+    for (i = 0; i < n_runs; i++) {
+      if (run_keep[i]) {
+        GstBuffer *run = gst_adapter_take_buffer (adapter, run_sizes[i]);
+
+        outbuf = outbuf ? gst_buffer_append (outbuf, run) : run;
+      } else {
+        gst_adapter_flush (adapter, run_sizes[i]);
+      }
+    }
+  }
+
+  if (outbuf == NULL)
+    return NULL;
+
+  GST_BUFFER_PTS (outbuf) = pts;
+  GST_BUFFER_DTS (outbuf) = dts;
+  GST_BUFFER_OFFSET (outbuf) = GST_BUFFER_OFFSET_NONE;
+  if (discont)
+    GST_BUFFER_FLAG_SET (outbuf, GST_BUFFER_FLAG_DISCONT);
+  else
+    GST_BUFFER_FLAG_UNSET (outbuf, GST_BUFFER_FLAG_DISCONT);
+
+  return outbuf;
+}
+
 static GstFlowReturn
 mpegts_parse_input_done (MpegTSBase * base, GstBuffer * buffer)
 {
@@ -865,6 +1043,13 @@ mpegts_parse_input_done (MpegTSBase * base, GstBuffer * buffer)
 
   GST_LOG_OBJECT (parse, "Received buffer %" GST_PTR_FORMAT, buffer);
 
+  mpegts_parse_update_filter (parse);
+  if (parse->filter_pids) {
+    buffer = mpegts_parse_filter_pids (parse, buffer);
+    if (buffer == NULL)
+      return GST_FLOW_OK;
+  }
+
   if (parse->current_pcr != GST_CLOCK_TIME_NONE) {
     GST_DEBUG_OBJECT (parse,
         "InputTS %" GST_TIME_FORMAT " PCR %" GST_TIME_FORMAT,
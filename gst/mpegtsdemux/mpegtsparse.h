@@ -75,6 +75,16 @@ struct _MpegTSParse2 {
   GList *pending_buffers;
   GstClockTime previous_pcr;
   guint bytes_since_pcr;
+
+  /* PID filter of the src pad, NULL if all the packets are output. The
+   * streaming thread owns filter_pids, set_property leaves a new filter in
+   * pending_filter_pids under the object lock */
+  gchar *pids;
+  guint8 *filter_pids;
+  guint8 *pending_filter_pids;
+  gboolean filter_pids_changed;
+  /* input data not yet filtered, less than a packet normally */
+  GstAdapter *filter_adapter;
 };
 
 struct _MpegTSParse2Class {
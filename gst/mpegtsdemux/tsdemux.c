@@ -123,6 +123,14 @@ typedef struct
   gsize size;
 } SimpleBuffer;
 
+/* Region of an incoming buffer holding part of a PES payload */
+typedef struct
+{
+  GstBuffer *buffer;
+  gsize offset;
+  gsize size;
+} PESChunk;
+
 struct _TSDemuxH264ParsingInfos
 {
   /* H264 parsing data */
@@ -151,16 +159,19 @@ struct _TSDemuxStream
   /* Output data */
   PendingPacketState state;
 
-  /* Data being reconstructed (allocated) */
+  /* Data being reconstructed, as PESChunk referencing the incoming
+   * buffers. Only copied when outputting or when ->data is needed */
+  GArray *chunks;
+
+  /* Contiguous copy of the data being reconstructed (allocated), only
+   * set when the payload needs to be inspected (keyframe scanning, opus) */
   guint8 *data;
 
   /* Size of data being reconstructed (if known, else 0) */
   guint expected_size;
 
-  /* Amount of bytes in current ->data */
+  /* Amount of bytes in current ->chunks or ->data */
   guint current_size;
-  /* Size of ->data */
-  guint allocated_size;
 
   /* Current PTS/DTS for this stream (in running time) */
   GstClockTime pts;
@@ -615,6 +626,136 @@ clear_simple_buffer (SimpleBuffer * sbuf)
   sbuf->data = NULL;
 }
 
+static void
+clear_pes_chunk (PESChunk * chunk)
+{
+  gst_buffer_unref (chunk->buffer);
+}
+
+/* Drops all data collected for the current PES packet */
+static void
+gst_ts_demux_stream_clear_data (TSDemuxStream * stream)
+{
+  if (stream->chunks)
+    g_array_set_size (stream->chunks, 0);
+  g_free (stream->data);
+  stream->data = NULL;
+  stream->current_size = 0;
+}
+
+/* Keeps a reference to the payload region of the packet instead of copying
+ * it. Successive TS packets are never contiguous in the input (they are
+ * separated by their headers), so each one gets its own chunk */
+static inline void
+gst_ts_demux_stream_add_chunk (TSDemuxStream * stream,
+    MpegTSPacketizerPacket * packet, guint8 * data, guint size)
+{
+  PESChunk chunk;
+
+  if (G_UNLIKELY (size == 0))
+    return;
+
+  chunk.buffer = gst_buffer_ref (packet->buffer);
+  chunk.offset = packet->buffer_offset + (data - packet->data_start);
+  chunk.size = size;
+  g_array_append_val (stream->chunks, chunk);
+
+  stream->current_size += size;
+}
+
+/* Copies all collected chunks to @dest, which must be at least
+ * stream->current_size bytes. Consecutive chunks very often come from the
+ * same buffer, which is then only mapped once */
+static gboolean
+gst_ts_demux_stream_copy_chunks (TSDemuxStream * stream, guint8 * dest)
+{
+  GstBuffer *mapped = NULL;
+  GstMapInfo map;
+  guint i;
+
+  for (i = 0; i < stream->chunks->len; i++) {
+    PESChunk *chunk = &g_array_index (stream->chunks, PESChunk, i);
+
+    if (chunk->buffer != mapped) {
+      if (mapped)
+        gst_buffer_unmap (mapped, &map);
+      if (!gst_buffer_map (chunk->buffer, &map, GST_MAP_READ))
+        return FALSE;
+      mapped = chunk->buffer;
+    }
+
+    memcpy (dest, map.data + chunk->offset, chunk->size);
+    dest += chunk->size;
+  }
+
+  if (mapped)
+    gst_buffer_unmap (mapped, &map);
+
+  return TRUE;
+}
+
+/* Makes the collected data available as a contiguous allocation in
+ * stream->data, for the code paths that need to look into the payload */
+static gboolean
+gst_ts_demux_stream_flatten (TSDemuxStream * stream)
+{
+  if (stream->data)
+    return TRUE;
+
+  stream->data = g_malloc (stream->current_size);
+  if (!gst_ts_demux_stream_copy_chunks (stream, stream->data)) {
+    g_free (stream->data);
+    stream->data = NULL;
+    return FALSE;
+  }
+  g_array_set_size (stream->chunks, 0);
+
+  return TRUE;
+}
+
+/* Creates the output buffer for the collected data.
+ *
+ * If the PES only spans a few TS packets (audio, subtitles, metadata) the
+ * output buffer is made of memories shared with the incoming buffers, and
+ * downstream only merges them if it has to map the buffer. Larger PES are
+ * copied exactly once in a buffer of the final size. */
+static GstBuffer *
+gst_ts_demux_stream_take_buffer (TSDemuxStream * stream)
+{
+  GstBuffer *buffer;
+  GstMapInfo map;
+  guint i;
+
+  if (stream->data) {
+    buffer = gst_buffer_new_wrapped (stream->data, stream->current_size);
+    stream->data = NULL;
+    return buffer;
+  }
+
+  if (stream->chunks->len <= gst_buffer_get_max_memory ()) {
+    buffer = gst_buffer_new ();
+    for (i = 0; i < stream->chunks->len; i++) {
+      PESChunk *chunk = &g_array_index (stream->chunks, PESChunk, i);
+
+      gst_buffer_copy_into (buffer, chunk->buffer, GST_BUFFER_COPY_MEMORY,
+          chunk->offset, chunk->size);
+    }
+  } else {
+    buffer = gst_buffer_new_allocate (NULL, stream->current_size, NULL);
+    gst_buffer_map (buffer, &map, GST_MAP_WRITE);
+    if (!gst_ts_demux_stream_copy_chunks (stream, map.data)) {
+      gst_buffer_unmap (buffer, &map);
+      gst_buffer_unref (buffer);
+      buffer = NULL;
+    } else {
+      gst_buffer_unmap (buffer, &map);
+    }
+  }
+  g_array_set_size (stream->chunks, 0);
+
+  return buffer;
+}
+
 static gboolean
 scan_keyframe_h264 (TSDemuxStream * stream, const guint8 * data,
     const gsize data_size, const gsize max_frame_offset)
@@ -1647,6 +1788,11 @@ gst_ts_demux_stream_added (MpegTSBase * base, MpegTSBaseStream * bstream,
   GstTSDemux *demux = (GstTSDemux *) base;
   TSDemuxStream *stream = (TSDemuxStream *) bstream;
 
+  if (!stream->chunks) {
+    stream->chunks = g_array_new (FALSE, FALSE, sizeof (PESChunk));
+    g_array_set_clear_func (stream->chunks, (GDestroyNotify) clear_pes_chunk);
+  }
+
   if (!stream->pad) {
     /* Create the pad */
     if (bstream->stream_type != 0xff) {
@@ -1737,6 +1883,11 @@ gst_ts_demux_stream_removed (MpegTSBase * base, MpegTSBaseStream * bstream)
   }
 
   tsdemux_h264_parsing_info_clear (&stream->h264infos);
+
+  if (stream->chunks) {
+    g_array_free (stream->chunks, TRUE);
+    stream->chunks = NULL;
+  }
 }
 
 static void
@@ -1762,12 +1913,9 @@ gst_ts_demux_stream_flush (TSDemuxStream * stream, GstTSDemux * tsdemux,
 {
   GST_DEBUG ("flushing stream %p", stream);
 
-  g_free (stream->data);
-  stream->data = NULL;
+  gst_ts_demux_stream_clear_data (stream);
   stream->state = PENDING_PACKET_EMPTY;
   stream->expected_size = 0;
-  stream->allocated_size = 0;
-  stream->current_size = 0;
   stream->discont = TRUE;
   stream->pts = GST_CLOCK_TIME_NONE;
   stream->dts = GST_CLOCK_TIME_NONE;
@@ -2152,7 +2300,8 @@ check_pending_buffers (GstTSDemux * demux)
 
 static void
 gst_ts_demux_parse_pes_header (GstTSDemux * demux, TSDemuxStream * stream,
-    guint8 * data, guint32 length, guint64 bufferoffset)
+    MpegTSPacketizerPacket * packet, guint8 * data, guint32 length,
+    guint64 bufferoffset)
 {
   PESHeader header;
   PESParsingResult parseres;
@@ -2208,16 +2357,10 @@ gst_ts_demux_parse_pes_header (GstTSDemux * demux, TSDemuxStream * stream,
   data += header.header_size;
   length -= header.header_size;
 
-  /* Create the output buffer */
-  if (stream->expected_size)
-    stream->allocated_size = MAX (stream->expected_size, length);
-  else
-    stream->allocated_size = MAX (8192, length);
-
-  g_assert (stream->data == NULL);
-  stream->data = g_malloc (stream->allocated_size);
-  memcpy (stream->data, data, length);
-  stream->current_size = length;
+  /* Start collecting the payload */
+  g_assert (stream->data == NULL && stream->chunks->len == 0);
+  stream->current_size = 0;
+  gst_ts_demux_stream_add_chunk (stream, packet, data, length);
 
   stream->state = PENDING_PACKET_BUFFER;
 
@@ -2274,30 +2417,21 @@ gst_ts_demux_queue_data (GstTSDemux * demux, TSDemuxStream * stream,
       GST_LOG ("HEADER: Parsing PES header");
 
       /* parse the header */
-      gst_ts_demux_parse_pes_header (demux, stream, data, size, packet->offset);
+      gst_ts_demux_parse_pes_header (demux, stream, packet, data, size,
+          packet->offset);
       break;
     }
     case PENDING_PACKET_BUFFER:
     {
       GST_LOG ("BUFFER: appending data");
-      if (G_UNLIKELY (stream->current_size + size > stream->allocated_size)) {
-        GST_LOG ("resizing buffer");
-        do {
-          stream->allocated_size *= 2;
-        } while (stream->current_size + size > stream->allocated_size);
-        stream->data = g_realloc (stream->data, stream->allocated_size);
-      }
-      memcpy (stream->data + stream->current_size, data, size);
-      stream->current_size += size;
+      gst_ts_demux_stream_add_chunk (stream, packet, data, size);
       break;
     }
     case PENDING_PACKET_DISCONT:
     {
       GST_LOG ("DISCONT: not storing/pushing");
-      if (G_UNLIKELY (stream->data)) {
-        g_free (stream->data);
-        stream->data = NULL;
-      }
+      if (G_UNLIKELY (stream->current_size))
+        gst_ts_demux_stream_clear_data (stream);
       stream->continuity_counter = CONTINUITY_UNSET;
       break;
     }
@@ -2572,8 +2706,8 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream,
       "stream:%p, pid:0x%04x stream_type:%d state:%d", stream, bs->pid,
       bs->stream_type, stream->state);
 
-  if (G_UNLIKELY (stream->data == NULL)) {
-    GST_LOG ("stream->data == NULL");
+  if (G_UNLIKELY (stream->current_size == 0)) {
+    GST_LOG ("no data");
     goto beach;
   }
 
@@ -2589,10 +2723,20 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream,
 
   if (G_UNLIKELY (demux->program == NULL)) {
     GST_LOG_OBJECT (demux, "No program");
-    g_free (stream->data);
     goto beach;
   }
 
+  /* Opus access units and keyframe scanning need to look into the data */
+  if ((bs->stream_type == GST_MPEGTS_STREAM_TYPE_PRIVATE_PES_PACKETS &&
+          bs->registration_id == DRF_ID_OPUS) || (stream->needs_keyframe
+          && stream->scan_function)) {
+    if (!gst_ts_demux_stream_flatten (stream)) {
+      GST_ERROR_OBJECT (demux, "Failed to map PES data");
+      res = GST_FLOW_ERROR;
+      goto beach;
+    }
+  }
+
   if (stream->needs_keyframe) {
     MpegTSBase *base = (MpegTSBase *) demux;
 
@@ -2616,7 +2760,11 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream,
           buffer_list = NULL;
         }
       } else {
-        buffer = gst_buffer_new_wrapped (stream->data, stream->current_size);
+        buffer = gst_ts_demux_stream_take_buffer (stream);
+        if (!buffer) {
+          res = GST_FLOW_ERROR;
+          goto beach;
+        }
       }
 
       stream->seeked_pts = stream->pts;
@@ -2632,7 +2780,6 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream,
 
       stream->continuity_counter = CONTINUITY_UNSET;
       res = GST_FLOW_REWINDING;
-      g_free (stream->data);
       goto beach;
     }
   } else {
@@ -2650,7 +2797,11 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream,
         buffer_list = NULL;
       }
     } else {
-      buffer = gst_buffer_new_wrapped (stream->data, stream->current_size);
+      buffer = gst_ts_demux_stream_take_buffer (stream);
+      if (!buffer) {
+        res = GST_FLOW_ERROR;
+        goto beach;
+      }
     }
 
     if (G_UNLIKELY (stream->pending_ts && !check_pending_buffers (demux))) {
@@ -2795,9 +2946,8 @@ beach:
   /* Reset everything */
   GST_LOG ("Resetting to EMPTY, returning %s", gst_flow_get_name (res));
   stream->state = PENDING_PACKET_EMPTY;
-  stream->data = NULL;
+  gst_ts_demux_stream_clear_data (stream);
   stream->expected_size = 0;
-  stream->current_size = 0;
 
   return res;
 }
@@ -116,6 +116,10 @@ enum
 #define MPEGTSMUX_DEFAULT_ALIGNMENT    -1
 #define MPEGTSMUX_DEFAULT_M2TS         FALSE
 
+/* Number of packets written per output buffer. Batching is not used in M2TS
+ * mode, where the 4 bytes timestamp of each packet is interpolated later */
+#define MPEGTSMUX_BATCH_PACKETS        256
+
 static GstStaticPadTemplate mpegtsmux_sink_factory =
     GST_STATIC_PAD_TEMPLATE ("sink_%d",
     GST_PAD_SINK,
@@ -421,6 +425,8 @@ mpegtsmux_reset (MpegTsMux * mux, gboolean alloc)
     mux->tsmux = tsmux_new ();
     tsmux_set_write_func (mux->tsmux, new_packet_cb, mux);
     tsmux_set_alloc_func (mux->tsmux, alloc_packet_cb, mux);
+    tsmux_set_packet_batching (mux->tsmux,
+        mux->m2ts_mode ? 0 : MPEGTSMUX_BATCH_PACKETS);
   }
 }
 
@@ -465,6 +471,9 @@ gst_mpegtsmux_set_property (GObject * object, guint prop_id,
     case PROP_M2TS_MODE:
       /*set incase if the output stream need to be of 192 bytes */
       mux->m2ts_mode = g_value_get_boolean (value);
+      if (mux->tsmux)
+        tsmux_set_packet_batching (mux->tsmux,
+            mux->m2ts_mode ? 0 : MPEGTSMUX_BATCH_PACKETS);
       break;
     case PROP_PROG_MAP:
     {
@@ -1206,6 +1215,7 @@ mpegtsmux_collected_buffer (GstCollectPads * pads, GstCollectData * data,
     /* EOS */
     GST_INFO_OBJECT (mux, "EOS");
     /* drain some possibly cached data */
+    tsmux_flush_packets (mux->tsmux);
     new_packet_m2ts (mux, NULL, -1);
     mpegtsmux_push_packets (mux, TRUE);
     gst_pad_push_event (mux->srcpad, gst_event_new_eos ());
@@ -1345,6 +1355,14 @@ mpegtsmux_collected_buffer (GstCollectPads * pads, GstCollectData * data,
       goto write_fail;
     }
   }
+  /* output the packets batched for this buffer */
+  if (!tsmux_flush_packets (mux->tsmux)) {
+    GST_DEBUG_OBJECT (mux, "Failed to write data packets");
+    GST_ELEMENT_ERROR (mux, STREAM, MUX,
+        ("Failed writing output data to stream %04x", best->stream->id),
+        (NULL));
+    goto write_fail;
+  }
   /* flush packet cache */
   return mpegtsmux_push_packets (mux, FALSE);
 
@@ -1710,8 +1728,8 @@ exit:
   return TRUE;
 }
 
-/* Called when the TsMux has prepared a packet for output. Return FALSE
- * on error */
+/* Called when the TsMux has prepared a packet for output, or several
+ * consecutive packets when batching. Return FALSE on error */
 static gboolean
 new_packet_cb (GstBuffer * buf, void *user_data, gint64 new_pcr)
 {
@@ -153,6 +153,8 @@ tsmux_new (void)
   mux->si_sections = g_hash_table_new_full (g_direct_hash, g_direct_equal,
       NULL, (GDestroyNotify) tsmux_section_free);
 
+  mux->batch_pcr = -1;
+
   return mux;
 }
 
@@ -193,6 +195,51 @@ tsmux_set_alloc_func (TsMux * mux, TsMuxAllocFunc func, void *user_data)
   mux->alloc_func_data = user_data;
 }
 
+/**
+ * tsmux_set_packet_batching:
+ * @mux: a #TsMux
+ * @n_packets: maximum number of packets per output buffer, or 0
+ *
+ * When @n_packets is not 0, the packets of the streams are not written in
+ * buffers obtained from the alloc function anymore. Instead, consecutive
+ * packets are written in a buffer of @n_packets packets taken from a pool
+ * owned by @mux, which is given to the write function once it is full,
+ * when other packets (PAT, PMT, SI) need to be output or when
+ * tsmux_flush_packets() is called. The PCR passed to the write function is
+ * then the first one written in the buffer.
+ *
+ * Any pending batch is written out before changing the setting.
+ */
+void
+tsmux_set_packet_batching (TsMux * mux, guint n_packets)
+{
+  g_return_if_fail (mux != NULL);
+
+  if (mux->batch_packets == n_packets)
+    return;
+
+  tsmux_flush_packets (mux);
+
+  if (mux->batch_pool) {
+    gst_buffer_pool_set_active (mux->batch_pool, FALSE);
+    gst_object_unref (mux->batch_pool);
+    mux->batch_pool = NULL;
+  }
+
+  mux->batch_packets = n_packets;
+
+  if (n_packets > 0) {
+    GstStructure *config;
+
+    mux->batch_pool = gst_buffer_pool_new ();
+    config = gst_buffer_pool_get_config (mux->batch_pool);
+    gst_buffer_pool_config_set_params (config, NULL,
+        n_packets * TSMUX_PACKET_LENGTH, 0, 0);
+    gst_buffer_pool_set_config (mux->batch_pool, config);
+    gst_buffer_pool_set_active (mux->batch_pool, TRUE);
+  }
+}
+
 /**
  * tsmux_set_pat_interval:
  * @mux: a #TsMux
@@ -331,6 +378,16 @@ tsmux_free (TsMux * mux)
   /* Free SI table sections */
   g_hash_table_destroy (mux->si_sections);
 
+  /* Drop any pending batch */
+  if (mux->batch_buffer) {
+    gst_buffer_unmap (mux->batch_buffer, &mux->batch_map);
+    gst_buffer_unref (mux->batch_buffer);
+  }
+  if (mux->batch_pool) {
+    gst_buffer_pool_set_active (mux->batch_pool, FALSE);
+    gst_object_unref (mux->batch_pool);
+  }
+
   g_slice_free (TsMux, mux);
 }
 
@@ -585,6 +642,13 @@ tsmux_get_buffer (TsMux * mux, GstBuffer ** buf)
 static gboolean
 tsmux_packet_out (TsMux * mux, GstBuffer * buf, gint64 pcr)
 {
+  /* Keep the output in order with the packets batched so far */
+  if (G_UNLIKELY (mux->batch_buffer != NULL) && !tsmux_flush_packets (mux)) {
+    if (buf)
+      gst_buffer_unref (buf);
+    return FALSE;
+  }
+
   if (G_UNLIKELY (mux->write_func == NULL)) {
     if (buf)
       gst_buffer_unref (buf);
@@ -976,6 +1040,87 @@ tsmux_write_si (TsMux * mux)
 
 }
 
+/**
+ * tsmux_flush_packets:
+ * @mux: a #TsMux
+ *
+ * Give the packets batched so far to the write function, see
+ * tsmux_set_packet_batching().
+ *
+ * Returns: TRUE if the packets could be written.
+ */
+gboolean
+tsmux_flush_packets (TsMux * mux)
+{
+  GstBuffer *buf;
+  gint64 pcr;
+
+  g_return_val_if_fail (mux != NULL, FALSE);
+
+  if (mux->batch_buffer == NULL)
+    return TRUE;
+
+  buf = mux->batch_buffer;
+  pcr = mux->batch_pcr;
+
+  gst_buffer_unmap (buf, &mux->batch_map);
+  gst_buffer_set_size (buf, mux->batch_len);
+
+  mux->batch_buffer = NULL;
+  mux->batch_len = 0;
+  mux->batch_pcr = -1;
+
+  TS_DEBUG ("Writing batch of %" G_GSIZE_FORMAT " packets",
+      gst_buffer_get_size (buf) / TSMUX_PACKET_LENGTH);
+
+  return tsmux_packet_out (mux, buf, pcr);
+}
+
+static gboolean
+tsmux_write_batched_stream_packet (TsMux * mux, TsMuxStream * stream,
+    gint64 pcr)
+{
+  guint payload_len, payload_offs;
+  guint8 *data;
+
+  if (mux->batch_buffer == NULL) {
+    if (gst_buffer_pool_acquire_buffer (mux->batch_pool, &mux->batch_buffer,
+            NULL) != GST_FLOW_OK)
+      return FALSE;
+
+    /* The buffer might come back from downstream with the size of a
+     * previous batch */
+    gst_buffer_set_size (mux->batch_buffer,
+        mux->batch_packets * TSMUX_PACKET_LENGTH);
+
+    if (!gst_buffer_map (mux->batch_buffer, &mux->batch_map, GST_MAP_WRITE)) {
+      gst_buffer_unref (mux->batch_buffer);
+      mux->batch_buffer = NULL;
+      return FALSE;
+    }
+  }
+
+  data = mux->batch_map.data + mux->batch_len;
+
+  if (!tsmux_write_ts_header (data, &stream->pi, &payload_len, &payload_offs))
+    return FALSE;
+
+  if (!tsmux_stream_get_data (stream, data + payload_offs, payload_len))
+    return FALSE;
+
+  mux->batch_len += TSMUX_PACKET_LENGTH;
+  if (pcr != -1 && mux->batch_pcr == -1)
+    mux->batch_pcr = pcr;
+
+  /* Reset all dynamic flags */
+  stream->pi.flags &= TSMUX_PACKET_FLAG_PES_FULL_HEADER;
+
+  if (mux->batch_len + TSMUX_PACKET_LENGTH > mux->batch_map.size)
+    return tsmux_flush_packets (mux);
+
+  return TRUE;
+}
+
 /**
  * tsmux_write_stream_packet:
  * @mux: a #TsMux
@@ -1089,6 +1234,9 @@ tsmux_write_stream_packet (TsMux * mux, TsMuxStream * stream)
   }
   pi->stream_avail = tsmux_stream_bytes_avail (stream);
 
+  if (mux->batch_packets > 0)
+    return tsmux_write_batched_stream_packet (mux, stream, cur_pcr);
+
   /* obtain buffer */
   if (!tsmux_get_buffer (mux, &buf))
     return FALSE;
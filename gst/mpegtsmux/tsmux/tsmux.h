@@ -176,6 +176,17 @@ struct TsMux {
   TsMuxAllocFunc alloc_func;
   void *alloc_func_data;
 
+  /* packet batching: when batch_packets > 0, the stream packets are written
+   * into a buffer from batch_pool and handed to write_func together */
+  guint batch_packets;
+  GstBufferPool *batch_pool;
+  GstBuffer *batch_buffer;
+  GstMapInfo batch_map;
+  /* bytes written in batch_buffer */
+  guint batch_len;
+  /* first PCR written in batch_buffer or -1 */
+  gint64 batch_pcr;
+
   /* scratch space for writing ES_info descriptors */
   guint8 es_info_buf[TSMUX_MAX_ES_INFO_LENGTH];
 };
@@ -187,6 +198,7 @@ void 		tsmux_free 			(TsMux *mux);
 /* Setting muxing session properties */
 void 		tsmux_set_write_func 		(TsMux *mux, TsMuxWriteFunc func, void *user_data);
 void 		tsmux_set_alloc_func 		(TsMux *mux, TsMuxAllocFunc func, void *user_data);
+void 		tsmux_set_packet_batching 	(TsMux *mux, guint n_packets);
 void 		tsmux_set_pat_interval          (TsMux *mux, guint interval);
 guint 		tsmux_get_pat_interval          (TsMux *mux);
 guint16		tsmux_get_new_pid 		(TsMux *mux);
@@ -211,6 +223,7 @@ void 		tsmux_program_set_pcr_stream 	(TsMuxProgram *program, TsMuxStream *stream
 
 /* writing stuff */
 gboolean 	tsmux_write_stream_packet 	(TsMux *mux, TsMuxStream *stream);
+gboolean 	tsmux_flush_packets 		(TsMux *mux);
 
 G_END_DECLS
 
@@ -55,6 +55,7 @@
 #include "mxfessence.h"
 
 #include <string.h>
+#include <gst/base/gstbytereader.h>
 
 static GstStaticPadTemplate mxf_sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
@@ -115,7 +116,8 @@ enum
   PROP_0,
   PROP_PACKAGE,
   PROP_MAX_DRIFT,
-  PROP_STRUCTURE
+  PROP_STRUCTURE,
+  PROP_INDEX_CACHE_LOCATION
 };
 
 static gboolean gst_mxf_demux_sink_event (GstPad * pad, GstObject * parent,
@@ -152,6 +154,127 @@ gst_mxf_demux_partition_free (GstMXFDemuxPartition * partition)
   g_free (partition);
 }
 
+static void
+gst_mxf_demux_keyframe_index_clear (GstMXFDemuxKeyframeIndex * index)
+{
+  if (index->runs)
+    g_array_free (index->runs, TRUE);
+  index->runs = NULL;
+  if (index->keyframes)
+    g_array_free (index->keyframes, TRUE);
+  index->keyframes = NULL;
+}
+
+/* Returns the number of runs that start at or before @position */
+static guint
+keyframe_index_runs_upper_bound (GstMXFDemuxKeyframeIndex * index,
+    gint64 position)
+{
+  guint low = 0, high = index->runs ? index->runs->len : 0, mid;
+
+  while (low < high) {
+    mid = low + (high - low) / 2;
+    if (g_array_index (index->runs, GstMXFDemuxIndexRun, mid).start <=
+        position)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+
+  return low;
+}
+
+/* Returns the number of keyframes at or before @position */
+static guint
+keyframe_index_keyframes_upper_bound (GstMXFDemuxKeyframeIndex * index,
+    gint64 position)
+{
+  guint low = 0, high = index->keyframes ? index->keyframes->len : 0, mid;
+
+  while (low < high) {
+    mid = low + (high - low) / 2;
+    if (g_array_index (index->keyframes, gint64, mid) <= position)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+
+  return low;
+}
+
+/* Stores the offset of the edit unit @position in @offsets and adds it to
+ * the lookup tables of @index */
+static void
+gst_mxf_demux_index_set_entry (GArray ** offsets,
+    GstMXFDemuxKeyframeIndex * index, gint64 position, guint64 offset,
+    gboolean keyframe)
+{
+  GstMXFDemuxIndex *entry;
+  GstMXFDemuxIndexRun *prev = NULL, *next = NULL;
+  guint i;
+
+  if (!*offsets)
+    *offsets = g_array_new (FALSE, TRUE, sizeof (GstMXFDemuxIndex));
+
+  if ((*offsets)->len <= position) {
+    if (position >= G_MAXINT)
+      return;
+    g_array_set_size (*offsets, position + 1);
+  }
+
+  entry = &g_array_index (*offsets, GstMXFDemuxIndex, position);
+  entry->offset = offset;
+  entry->keyframe = keyframe;
+
+  if (offset == 0)
+    return;
+
+  /* Keep the runs of edit units with known offsets merged */
+  if (!index->runs)
+    index->runs = g_array_new (FALSE, FALSE, sizeof (GstMXFDemuxIndexRun));
+
+  i = keyframe_index_runs_upper_bound (index, position);
+  if (i > 0)
+    prev = &g_array_index (index->runs, GstMXFDemuxIndexRun, i - 1);
+  if (i < index->runs->len)
+    next = &g_array_index (index->runs, GstMXFDemuxIndexRun, i);
+
+  if (prev && position < prev->end) {
+    /* already known */
+  } else if (prev && prev->end == position) {
+    prev->end++;
+    if (next && next->start == prev->end) {
+      prev->end = next->end;
+      g_array_remove_index (index->runs, i);
+    }
+  } else if (next && next->start == position + 1) {
+    next->start = position;
+  } else {
+    GstMXFDemuxIndexRun run = { position, position + 1 };
+
+    g_array_insert_val (index->runs, i, run);
+  }
+
+  if (!index->keyframes)
+    index->keyframes = g_array_new (FALSE, FALSE, sizeof (gint64));
+
+  i = keyframe_index_keyframes_upper_bound (index, position);
+  if (i > 0 && g_array_index (index->keyframes, gint64, i - 1) == position) {
+    if (!keyframe)
+      g_array_remove_index (index->keyframes, i - 1);
+  } else if (keyframe) {
+    g_array_insert_val (index->keyframes, i, position);
+  }
+}
+
+static void
+gst_mxf_demux_index_table_free (GstMXFDemuxIndexTable * t)
+{
+  g_array_free (t->offsets, TRUE);
+  gst_mxf_demux_keyframe_index_clear (&t->keyframe_index);
+  g_free (t);
+}
+
 static void
 gst_mxf_demux_reset_mxf_state (GstMXFDemux * demux)
 {
@@ -172,6 +295,7 @@ gst_mxf_demux_reset_mxf_state (GstMXFDemux * demux)
 
     if (t->offsets)
       g_array_free (t->offsets, TRUE);
+    gst_mxf_demux_keyframe_index_clear (&t->keyframe_index);
 
     g_free (t->mapping_data);
 
@@ -282,11 +406,8 @@ gst_mxf_demux_reset (GstMXFDemux * demux)
   if (demux->index_tables) {
     GList *l;
 
-    for (l = demux->index_tables; l; l = l->next) {
-      GstMXFDemuxIndexTable *t = l->data;
-      g_array_free (t->offsets, TRUE);
-      g_free (t);
-    }
+    for (l = demux->index_tables; l; l = l->next)
+      gst_mxf_demux_index_table_free (l->data);
     g_list_free (demux->index_tables);
     demux->index_tables = NULL;
   }
@@ -1762,26 +1883,8 @@ gst_mxf_demux_handle_generic_container_essence_element (GstMXFDemux * demux,
     }
   }
 
-  if (!etrack->offsets)
-    etrack->offsets = g_array_new (FALSE, TRUE, sizeof (GstMXFDemuxIndex));
-
-  {
-    if (etrack->offsets->len > etrack->position) {
-      GstMXFDemuxIndex *index =
-          &g_array_index (etrack->offsets, GstMXFDemuxIndex, etrack->position);
-
-      index->offset = demux->offset - demux->run_in;
-      index->keyframe = keyframe;
-    } else if (etrack->position < G_MAXINT) {
-      GstMXFDemuxIndex index;
-
-      index.offset = demux->offset - demux->run_in;
-      index.keyframe = keyframe;
-      if (etrack->offsets->len < etrack->position)
-        g_array_set_size (etrack->offsets, etrack->position);
-      g_array_insert_val (etrack->offsets, etrack->position, index);
-    }
-  }
+  gst_mxf_demux_index_set_entry (&etrack->offsets, &etrack->keyframe_index,
+      etrack->position, demux->offset - demux->run_in, keyframe);
 
   if (peek)
     goto out;
@@ -2020,12 +2123,13 @@ read_partition_header (GstMXFDemux * demux)
   gst_buffer_unref (buf);
 }
 
+static GstFlowReturn gst_mxf_demux_add_random_index_pack_partitions (GstMXFDemux
+    * demux);
+
 static GstFlowReturn
 gst_mxf_demux_handle_random_index_pack (GstMXFDemux * demux, const MXFUL * key,
     GstBuffer * buffer)
 {
-  guint i;
-  GList *l;
   GstMapInfo map;
   gboolean ret;
 
@@ -2049,6 +2153,16 @@ gst_mxf_demux_handle_random_index_pack (GstMXFDemux * demux, const MXFUL * key,
     return GST_FLOW_ERROR;
   }
 
+  return gst_mxf_demux_add_random_index_pack_partitions (demux);
+}
+
+/* Adds the partitions of the random index pack that are not known yet */
+static GstFlowReturn
+gst_mxf_demux_add_random_index_pack_partitions (GstMXFDemux * demux)
+{
+  guint i;
+  GList *l;
+
   for (i = 0; i < demux->random_index_pack->len; i++) {
     GstMXFDemuxPartition *p = NULL;
     MXFRandomIndexPackEntry *e =
@@ -2219,6 +2333,275 @@ beach:
   return ret;
 }
 
+#define INDEX_CACHE_MAGIC "GstMXFI2"
+#define INDEX_CACHE_FINGERPRINT_SIZE 20
+#define INDEX_CACHE_TAIL_SIZE 4096
+
+/* Hashes the header partition pack, which has the offset of the footer
+ * partition, and the end of the file, which has the random index pack, to
+ * tell files of the same size apart */
+static gboolean
+gst_mxf_demux_get_index_cache_fingerprint (GstMXFDemux * demux,
+    guint64 filesize, guint8 * fingerprint)
+{
+  GChecksum *checksum;
+  GstBuffer *buffer = NULL;
+  GstMapInfo map;
+  MXFUL key;
+  guint64 old_offset = demux->offset;
+  guint tail_size;
+  gsize len = INDEX_CACHE_FINGERPRINT_SIZE;
+  gboolean ret = FALSE;
+
+  checksum = g_checksum_new (G_CHECKSUM_SHA1);
+
+  demux->offset = demux->run_in;
+  if (gst_mxf_demux_pull_klv_packet (demux, demux->run_in, &key, &buffer,
+          NULL) != GST_FLOW_OK)
+    goto out;
+  gst_buffer_map (buffer, &map, GST_MAP_READ);
+  g_checksum_update (checksum, map.data, map.size);
+  gst_buffer_unmap (buffer, &map);
+  gst_buffer_unref (buffer);
+  buffer = NULL;
+
+  tail_size = MIN (filesize - demux->run_in, INDEX_CACHE_TAIL_SIZE);
+  if (gst_mxf_demux_pull_range (demux, filesize - tail_size, tail_size,
+          &buffer) != GST_FLOW_OK)
+    goto out;
+  gst_buffer_map (buffer, &map, GST_MAP_READ);
+  g_checksum_update (checksum, map.data, map.size);
+  gst_buffer_unmap (buffer, &map);
+  gst_buffer_unref (buffer);
+
+  g_checksum_get_digest (checksum, fingerprint, &len);
+  ret = len == INDEX_CACHE_FINGERPRINT_SIZE;
+
+out:
+  demux->offset = old_offset;
+  g_checksum_free (checksum);
+
+  return ret;
+}
+
+/* The index cache stores the random index pack and the index tables of a
+ * file, all numbers big endian:
+ *   magic (8 bytes), file size (64 bits), run-in (64 bits),
+ *   fingerprint (SHA-1 of the header partition pack and of the last 4096
+ *   bytes of the file, 20 bytes),
+ *   number of random index pack entries (32 bits), per entry the offset
+ *   (64 bits) and body SID (32 bits),
+ *   number of index tables (32 bits), per index table the body SID, index
+ *   SID and number of edit units (32 bits each) and per edit unit the offset
+ *   shifted left by one with the keyframe flag in the lowest bit (64 bits)
+ */
+static void
+gst_mxf_demux_save_index_cache (GstMXFDemux * demux, guint64 filesize)
+{
+  GError *err = NULL;
+  guint8 *data, *ptr;
+  gsize size;
+  GList *l;
+  guint i, n_rip;
+  guint8 fingerprint[INDEX_CACHE_FINGERPRINT_SIZE];
+
+  if (!gst_mxf_demux_get_index_cache_fingerprint (demux, filesize,
+          fingerprint)) {
+    GST_WARNING_OBJECT (demux, "Failed to fingerprint the file, not writing "
+        "the index cache");
+    return;
+  }
+
+  n_rip = demux->random_index_pack ? demux->random_index_pack->len : 0;
+
+  size = 8 + 8 + 8 + INDEX_CACHE_FINGERPRINT_SIZE + 4 + 12 * n_rip + 4;
+  for (l = demux->index_tables; l; l = l->next) {
+    GstMXFDemuxIndexTable *t = l->data;
+
+    size += 12 + 8 * t->offsets->len;
+  }
+
+  ptr = data = g_malloc (size);
+  memcpy (ptr, INDEX_CACHE_MAGIC, 8);
+  ptr += 8;
+  GST_WRITE_UINT64_BE (ptr, filesize);
+  ptr += 8;
+  GST_WRITE_UINT64_BE (ptr, demux->run_in);
+  ptr += 8;
+  memcpy (ptr, fingerprint, INDEX_CACHE_FINGERPRINT_SIZE);
+  ptr += INDEX_CACHE_FINGERPRINT_SIZE;
+
+  GST_WRITE_UINT32_BE (ptr, n_rip);
+  ptr += 4;
+  for (i = 0; i < n_rip; i++) {
+    MXFRandomIndexPackEntry *e =
+        &g_array_index (demux->random_index_pack, MXFRandomIndexPackEntry, i);
+
+    GST_WRITE_UINT64_BE (ptr, e->offset);
+    GST_WRITE_UINT32_BE (ptr + 8, e->body_sid);
+    ptr += 12;
+  }
+
+  GST_WRITE_UINT32_BE (ptr, g_list_length (demux->index_tables));
+  ptr += 4;
+  for (l = demux->index_tables; l; l = l->next) {
+    GstMXFDemuxIndexTable *t = l->data;
+
+    GST_WRITE_UINT32_BE (ptr, t->body_sid);
+    GST_WRITE_UINT32_BE (ptr + 4, t->index_sid);
+    GST_WRITE_UINT32_BE (ptr + 8, t->offsets->len);
+    ptr += 12;
+
+    for (i = 0; i < t->offsets->len; i++) {
+      GstMXFDemuxIndex *index = &g_array_index (t->offsets, GstMXFDemuxIndex,
+          i);
+
+      GST_WRITE_UINT64_BE (ptr, (index->offset << 1) | ! !index->keyframe);
+      ptr += 8;
+    }
+  }
+
+  if (!g_file_set_contents (demux->index_cache_location, (const gchar *) data,
+          size, &err)) {
+    GST_WARNING_OBJECT (demux, "Failed to write index cache: %s",
+        err->message);
+    g_clear_error (&err);
+  } else {
+    GST_DEBUG_OBJECT (demux, "Wrote index cache to %s",
+        demux->index_cache_location);
+  }
+
+  g_free (data);
+}
+
+/* Reads the random index pack and the index tables from the index cache
+ * instead of pulling them from the end of the file and every partition */
+static gboolean
+gst_mxf_demux_load_index_cache (GstMXFDemux * demux)
+{
+  gchar *contents = NULL;
+  gsize size;
+  GstByteReader reader;
+  const guint8 *magic, *cached_fingerprint;
+  guint8 fingerprint[INDEX_CACHE_FINGERPRINT_SIZE];
+  gint64 upstream_size;
+  guint64 filesize, run_in;
+  guint32 n, n_entries;
+  GArray *random_index_pack = NULL;
+  GList *index_tables = NULL;
+  guint i, j;
+
+  if (!demux->index_cache_location)
+    return FALSE;
+
+  if (!gst_pad_peer_query_duration (demux->sinkpad, GST_FORMAT_BYTES,
+          &upstream_size) || upstream_size == -1)
+    return FALSE;
+
+  if (!g_file_get_contents (demux->index_cache_location, &contents, &size,
+          NULL)) {
+    GST_DEBUG_OBJECT (demux, "No index cache at %s",
+        demux->index_cache_location);
+    return FALSE;
+  }
+
+  gst_byte_reader_init (&reader, (const guint8 *) contents, size);
+
+  if (!gst_byte_reader_get_data (&reader, 8, &magic)
+      || memcmp (magic, INDEX_CACHE_MAGIC, 8) != 0
+      || !gst_byte_reader_get_uint64_be (&reader, &filesize)
+      || !gst_byte_reader_get_uint64_be (&reader, &run_in)
+      || !gst_byte_reader_get_data (&reader, INDEX_CACHE_FINGERPRINT_SIZE,
+          &cached_fingerprint))
+    goto invalid;
+
+  if (filesize != (guint64) upstream_size || run_in != demux->run_in
+      || !gst_mxf_demux_get_index_cache_fingerprint (demux, filesize,
+          fingerprint)
+      || memcmp (fingerprint, cached_fingerprint,
+          INDEX_CACHE_FINGERPRINT_SIZE) != 0) {
+    GST_DEBUG_OBJECT (demux, "Index cache is for another file");
+    goto invalid;
+  }
+
+  if (!gst_byte_reader_get_uint32_be (&reader, &n))
+    goto invalid;
+
+  random_index_pack =
+      g_array_new (FALSE, FALSE, sizeof (MXFRandomIndexPackEntry));
+  for (i = 0; i < n; i++) {
+    MXFRandomIndexPackEntry e;
+
+    if (!gst_byte_reader_get_uint64_be (&reader, &e.offset)
+        || !gst_byte_reader_get_uint32_be (&reader, &e.body_sid)
+        || e.offset < demux->run_in)
+      goto invalid;
+    g_array_append_val (random_index_pack, e);
+  }
+
+  if (!gst_byte_reader_get_uint32_be (&reader, &n))
+    goto invalid;
+
+  for (i = 0; i < n; i++) {
+    GstMXFDemuxIndexTable *t;
+    guint32 body_sid, index_sid;
+
+    if (!gst_byte_reader_get_uint32_be (&reader, &body_sid)
+        || !gst_byte_reader_get_uint32_be (&reader, &index_sid)
+        || !gst_byte_reader_get_uint32_be (&reader, &n_entries)
+        || n_entries > G_MAXINT / sizeof (GstMXFDemuxIndex)
+        || gst_byte_reader_get_remaining (&reader) / 8 < n_entries)
+      goto invalid;
+
+    t = g_new0 (GstMXFDemuxIndexTable, 1);
+    t->body_sid = body_sid;
+    t->index_sid = index_sid;
+    t->offsets =
+        g_array_sized_new (FALSE, TRUE, sizeof (GstMXFDemuxIndex), n_entries);
+    g_array_set_size (t->offsets, n_entries);
+    index_tables = g_list_prepend (index_tables, t);
+
+    for (j = 0; j < n_entries; j++) {
+      guint64 v = gst_byte_reader_get_uint64_be_unchecked (&reader);
+
+      if (v >> 1)
+        gst_mxf_demux_index_set_entry (&t->offsets, &t->keyframe_index, j,
+            v >> 1, v & 1);
+    }
+  }
+
+  if (gst_byte_reader_get_remaining (&reader) != 0)
+    goto invalid;
+
+  g_free (contents);
+
+  if (demux->random_index_pack)
+    g_array_free (demux->random_index_pack, TRUE);
+  demux->random_index_pack = random_index_pack;
+  gst_mxf_demux_add_random_index_pack_partitions (demux);
+
+  g_list_free_full (demux->index_tables,
+      (GDestroyNotify) gst_mxf_demux_index_table_free);
+  demux->index_tables = index_tables;
+  demux->index_table_segments_collected = TRUE;
+
+  GST_DEBUG_OBJECT (demux, "Read %u index tables from index cache %s", n,
+      demux->index_cache_location);
+
+  return TRUE;
+
+invalid:
+  GST_WARNING_OBJECT (demux, "Ignoring invalid index cache %s",
+      demux->index_cache_location);
+  g_free (contents);
+  if (random_index_pack)
+    g_array_free (random_index_pack, TRUE);
+  g_list_free_full (index_tables,
+      (GDestroyNotify) gst_mxf_demux_index_table_free);
+
+  return FALSE;
+}
+
 static void
 gst_mxf_demux_pull_random_index_pack (GstMXFDemux * demux)
 {
@@ -2290,6 +2673,9 @@ gst_mxf_demux_pull_random_index_pack (GstMXFDemux * demux)
   if (flow_ret == GST_FLOW_OK && !demux->index_table_segments_collected) {
     collect_index_table_segments (demux);
     demux->index_table_segments_collected = TRUE;
+
+    if (demux->index_cache_location && demux->index_tables)
+      gst_mxf_demux_save_index_cache (demux, filesize);
   }
 }
 
@@ -2598,66 +2984,70 @@ gst_mxf_demux_set_partition_for_offset (GstMXFDemux * demux, guint64 offset)
 }
 
 static guint64
-find_offset (GArray * offsets, gint64 * position, gboolean keyframe)
+find_offset (GArray * offsets, GstMXFDemuxKeyframeIndex * index,
+    gint64 * position, gboolean keyframe)
 {
+  GstMXFDemuxIndexRun *run;
   GstMXFDemuxIndex *idx;
-  guint64 current_offset = -1;
-  gint64 current_position = *position;
+  gint64 keyframe_position;
+  guint i;
 
   if (!offsets || offsets->len <= *position)
     return -1;
 
+  i = keyframe_index_runs_upper_bound (index, *position);
+  if (i == 0)
+    return -1;
+  run = &g_array_index (index->runs, GstMXFDemuxIndexRun, i - 1);
+  if (*position >= run->end)
+    return -1;
+
   idx = &g_array_index (offsets, GstMXFDemuxIndex, *position);
-  if (idx->offset != 0 && (!keyframe || idx->keyframe)) {
-    current_offset = idx->offset;
-  } else if (idx->offset != 0) {
-    current_position--;
-    while (current_position >= 0) {
-      idx = &g_array_index (offsets, GstMXFDemuxIndex, current_position);
-      if (idx->offset == 0) {
-        break;
-      } else if (!idx->keyframe) {
-        current_position--;
-        continue;
-      } else {
-        current_offset = idx->offset;
-        break;
-      }
-    }
-  }
+  if (!keyframe || idx->keyframe)
+    return idx->offset;
 
-  if (current_offset == -1)
+  /* Go back to the previous keyframe if the offsets of all edit units from
+   * there on are known */
+  i = keyframe_index_keyframes_upper_bound (index, *position);
+  if (i == 0)
+    return -1;
+  keyframe_position = g_array_index (index->keyframes, gint64, i - 1);
+  if (keyframe_position < run->start)
     return -1;
 
-  *position = current_position;
-  return current_offset;
+  *position = keyframe_position;
+  return g_array_index (offsets, GstMXFDemuxIndex, keyframe_position).offset;
 }
 
 static guint64
-find_closest_offset (GArray * offsets, gint64 * position, gboolean keyframe)
+find_closest_offset (GArray * offsets, GstMXFDemuxKeyframeIndex * index,
+    gint64 * position, gboolean keyframe)
 {
-  GstMXFDemuxIndex *idx;
   gint64 current_position = *position;
+  guint i;
 
   if (!offsets || offsets->len == 0)
     return -1;
 
   current_position = MIN (current_position, offsets->len - 1);
 
-  idx = &g_array_index (offsets, GstMXFDemuxIndex, current_position);
-  while (idx->offset == 0 || (keyframe && !idx->keyframe)) {
-    current_position--;
-    if (current_position < 0)
-      break;
-    idx = &g_array_index (offsets, GstMXFDemuxIndex, current_position);
-  }
+  if (keyframe) {
+    i = keyframe_index_keyframes_upper_bound (index, current_position);
+    if (i == 0)
+      return -1;
+    current_position = g_array_index (index->keyframes, gint64, i - 1);
+  } else {
+    GstMXFDemuxIndexRun *run;
 
-  if (idx->offset != 0 && (!keyframe || idx->keyframe)) {
-    *position = current_position;
-    return idx->offset;
+    i = keyframe_index_runs_upper_bound (index, current_position);
+    if (i == 0)
+      return -1;
+    run = &g_array_index (index->runs, GstMXFDemuxIndexRun, i - 1);
+    current_position = MIN (current_position, run->end - 1);
   }
 
-  return -1;
+  *position = current_position;
+  return g_array_index (offsets, GstMXFDemuxIndex, current_position).offset;
 }
 
 static guint64
@@ -2698,7 +3088,8 @@ from_index:
   }
 
   /* First try to find an offset in our index */
-  offset = find_offset (etrack->offsets, position, keyframe);
+  offset = find_offset (etrack->offsets, &etrack->keyframe_index, position,
+      keyframe);
   if (offset != -1) {
     GST_DEBUG_OBJECT (demux,
         "Found edit unit %" G_GINT64_FORMAT " for %" G_GINT64_FORMAT
@@ -2709,7 +3100,9 @@ from_index:
 
   GST_DEBUG_OBJECT (demux, "Not found in index");
   if (!demux->random_access) {
-    offset = find_closest_offset (etrack->offsets, position, keyframe);
+    offset =
+        find_closest_offset (etrack->offsets, &etrack->keyframe_index,
+        position, keyframe);
     if (offset != -1) {
       GST_DEBUG_OBJECT (demux,
           "Starting with edit unit %" G_GINT64_FORMAT " for %" G_GINT64_FORMAT
@@ -2719,7 +3112,9 @@ from_index:
     }
 
     if (index_table) {
-      offset = find_closest_offset (index_table->offsets, position, keyframe);
+      offset =
+          find_closest_offset (index_table->offsets,
+          &index_table->keyframe_index, position, keyframe);
       if (offset != -1) {
         GST_DEBUG_OBJECT (demux,
             "Starting with edit unit %" G_GINT64_FORMAT " for %" G_GINT64_FORMAT
@@ -2734,7 +3129,8 @@ from_index:
     demux->offset = demux->run_in;
 
     offset =
-        find_closest_offset (etrack->offsets, &index_start_position, FALSE);
+        find_closest_offset (etrack->offsets, &etrack->keyframe_index,
+        &index_start_position, FALSE);
     if (offset != -1) {
       demux->offset = offset + demux->run_in;
       GST_DEBUG_OBJECT (demux,
@@ -2748,7 +3144,9 @@ from_index:
     if (index_table) {
       gint64 tmp_position = *position;
 
-      offset = find_closest_offset (index_table->offsets, &tmp_position, TRUE);
+      offset =
+          find_closest_offset (index_table->offsets,
+          &index_table->keyframe_index, &tmp_position, TRUE);
       if (offset != -1 && tmp_position > index_start_position) {
         demux->offset = offset + demux->run_in;
         index_start_position = tmp_position;
@@ -3023,8 +3421,10 @@ gst_mxf_demux_loop (GstPad * pad)
       goto pause;
     }
 
-    /* First of all pull&parse the random index pack at EOF */
-    gst_mxf_demux_pull_random_index_pack (demux);
+    /* First of all pull&parse the random index pack at EOF, unless it was
+     * stored in the index cache together with the index tables */
+    if (!gst_mxf_demux_load_index_cache (demux))
+      gst_mxf_demux_pull_random_index_pack (demux);
   }
 
   /* Now actually do something */
@@ -3565,8 +3965,7 @@ collect_index_table_segments (GstMXFDemux * demux)
     end = start + segment->index_duration;
     if (end > G_MAXINT / sizeof (GstMXFDemuxIndex)) {
       demux->index_tables = g_list_remove (demux->index_tables, t);
-      g_array_free (t->offsets, TRUE);
-      g_free (t);
+      gst_mxf_demux_index_table_free (t);
       continue;
     }
 
@@ -3575,8 +3974,6 @@ collect_index_table_segments (GstMXFDemux * demux)
 
     for (i = 0; i < segment->n_index_entries && start + i < t->offsets->len;
         i++) {
-      GstMXFDemuxIndex *index =
-          &g_array_index (t->offsets, GstMXFDemuxIndex, start + i);
       guint64 offset = segment->index_entries[i].stream_offset;
       GList *m;
       GstMXFDemuxPartition *offset_partition = NULL, *next_partition = NULL;
@@ -3608,9 +4005,9 @@ collect_index_table_segments (GstMXFDemux * demux)
           GST_ERROR_OBJECT (demux,
               "Invalid index table segment going into next unrelated partition");
         } else {
-          index->offset = offset;
-          index->keyframe = ! !(segment->index_entries[i].flags & 0x80)
-              || (segment->index_entries[i].key_frame_offset == 0);
+          gst_mxf_demux_index_set_entry (&t->offsets, &t->keyframe_index,
+              start + i, offset, ! !(segment->index_entries[i].flags & 0x80)
+              || (segment->index_entries[i].key_frame_offset == 0));
         }
       }
     }
@@ -4364,6 +4761,10 @@ gst_mxf_demux_set_property (GObject * object, guint prop_id,
     case PROP_MAX_DRIFT:
       demux->max_drift = g_value_get_uint64 (value);
       break;
+    case PROP_INDEX_CACHE_LOCATION:
+      g_free (demux->index_cache_location);
+      demux->index_cache_location = g_value_dup_string (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -4383,6 +4784,9 @@ gst_mxf_demux_get_property (GObject * object, guint prop_id,
     case PROP_MAX_DRIFT:
       g_value_set_uint64 (value, demux->max_drift);
       break;
+    case PROP_INDEX_CACHE_LOCATION:
+      g_value_set_string (value, demux->index_cache_location);
+      break;
     case PROP_STRUCTURE:{
       GstStructure *s;
 
@@ -4432,6 +4836,8 @@ gst_mxf_demux_finalize (GObject * object)
   demux->current_package_string = NULL;
   g_free (demux->requested_package_string);
   demux->requested_package_string = NULL;
+  g_free (demux->index_cache_location);
+  demux->index_cache_location = NULL;
 
   g_ptr_array_free (demux->src, TRUE);
   demux->src = NULL;
@@ -4475,6 +4881,13 @@ gst_mxf_demux_class_init (GstMXFDemuxClass * klass)
           "Structural metadata of the MXF file",
           GST_TYPE_STRUCTURE, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_INDEX_CACHE_LOCATION,
+      g_param_spec_string ("index-cache-location", "Index cache location",
+          "File to store the index tables of the input in, to not read them "
+          "from all partitions the next time the same file is opened "
+          "(pull mode only)", NULL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gstelement_class->change_state =
       GST_DEBUG_FUNCPTR (gst_mxf_demux_change_state);
   gstelement_class->query = GST_DEBUG_FUNCPTR (gst_mxf_demux_query);
@@ -62,6 +62,18 @@ typedef struct
   gboolean keyframe;
 } GstMXFDemuxIndex;
 
+typedef struct
+{
+  gint64 start, end;
+} GstMXFDemuxIndexRun;
+
+/* Sorted lookup tables for an array of GstMXFDemuxIndex */
+typedef struct
+{
+  GArray *runs;                 /* GstMXFDemuxIndexRun of edit units with an offset */
+  GArray *keyframes;            /* gint64 edit units that are keyframes */
+} GstMXFDemuxKeyframeIndex;
+
 typedef struct
 {
   guint32 body_sid;
@@ -75,6 +87,7 @@ typedef struct
   gint64 duration;
 
   GArray *offsets;
+  GstMXFDemuxKeyframeIndex keyframe_index;
 
   MXFMetadataSourcePackage *source_package;
   MXFMetadataTimelineTrack *source_track;
@@ -93,6 +106,7 @@ typedef struct
   guint32 body_sid;
   guint32 index_sid;
   GArray *offsets;
+  GstMXFDemuxKeyframeIndex keyframe_index;
 } GstMXFDemuxIndexTable;
 
 struct _GstMXFDemuxPad
@@ -186,6 +200,7 @@ struct _GstMXFDemux
   /* Properties */
   gchar *requested_package_string;
   GstClockTime max_drift;
+  gchar *index_cache_location;
 };
 
 struct _GstMXFDemuxClass
@@ -42,17 +42,54 @@ enum
   ARG_DELAY_PROBABILITY,
   ARG_DROP_PROBABILITY,
   ARG_DUPLICATE_PROBABILITY,
-  ARG_DROP_PACKETS
+  ARG_DROP_PACKETS,
+  ARG_MAX_KBPS,
+  ARG_MAX_BUCKET_SIZE,
+  ARG_MAX_QUEUE_SIZE,
+  ARG_GILBERT_ELLIOTT_P,
+  ARG_GILBERT_ELLIOTT_R,
+  ARG_GILBERT_ELLIOTT_GOOD_LOSS,
+  ARG_GILBERT_ELLIOTT_BAD_LOSS,
+  ARG_SEED
 };
 
+/* a delayed packet, pushed by the srcpad task at time */
+typedef struct
+{
+  GstClockTime time;
+  guint64 seqnum;
+  GstBuffer *buf;
+} NetSimPacket;
+
+/* a packet in the queue of the simulated link until departure */
+typedef struct
+{
+  GstClockTime departure;
+  gsize size;
+} NetSimLinkPacket;
+
 struct _GstNetSimPrivate
 {
   GstPad *sinkpad, *srcpad;
 
+  /* the delayed packets, a binary heap ordered by time, then by seqnum so
+   * that packets with the same time are pushed in order */
   GMutex loop_mutex;
-  GCond start_cond;
-  GMainLoop *main_loop;
+  GCond cond;
+  GArray *packets;
+  guint64 seqnum;
   gboolean running;
+  /* the task popped a packet and is pushing it */
+  gboolean pushing;
+
+  /* token bucket of the simulated link */
+  GstClockTime bucket_time;
+  gdouble bucket_tokens;
+  GArray *link_queue;
+  guint link_head;
+  guint64 link_bytes;
+
+  gboolean gilbert_elliott_bad;
 
   GRand *rand_seed;
   gint min_delay;
@@ -61,6 +98,14 @@ struct _GstNetSimPrivate
   gfloat drop_probability;
   gfloat duplicate_probability;
   guint drop_packets;
+  gint max_kbps;
+  gint max_bucket_size;
+  gint max_queue_size;
+  gfloat gilbert_elliott_p;
+  gfloat gilbert_elliott_r;
+  gfloat gilbert_elliott_good_loss;
+  gfloat gilbert_elliott_bad_loss;
+  gint64 seed;
 };
 
 /* these numbers are nothing but wild guesses and dont reflect any reality */
@@ -70,6 +115,14 @@ struct _GstNetSimPrivate
 #define DEFAULT_DROP_PROBABILITY 0.0
 #define DEFAULT_DUPLICATE_PROBABILITY 0.0
 #define DEFAULT_DROP_PACKETS 0
+#define DEFAULT_MAX_KBPS -1
+#define DEFAULT_MAX_BUCKET_SIZE -1
+#define DEFAULT_MAX_QUEUE_SIZE -1
+#define DEFAULT_GILBERT_ELLIOTT_P 0.0
+#define DEFAULT_GILBERT_ELLIOTT_R 1.0
+#define DEFAULT_GILBERT_ELLIOTT_GOOD_LOSS 0.0
+#define DEFAULT_GILBERT_ELLIOTT_BAD_LOSS 1.0
+#define DEFAULT_SEED -1
 
 #define GST_NET_SIM_GET_PRIVATE(o) \
   (G_TYPE_INSTANCE_GET_PRIVATE ((o), GST_TYPE_NET_SIM, \
@@ -89,42 +142,106 @@ GST_STATIC_PAD_TEMPLATE ("src",
 
 G_DEFINE_TYPE (GstNetSim, gst_net_sim, GST_TYPE_ELEMENT);
 
+static gboolean
+net_sim_packet_before (const NetSimPacket * a, const NetSimPacket * b)
+{
+  return a->time < b->time || (a->time == b->time && a->seqnum < b->seqnum);
+}
+
+static void
+net_sim_packets_push (GArray * packets, const NetSimPacket * packet)
+{
+  NetSimPacket *p;
+  guint i;
+
+  g_array_set_size (packets, packets->len + 1);
+  p = (NetSimPacket *) packets->data;
+  for (i = packets->len - 1; i > 0 && net_sim_packet_before (packet,
+          &p[(i - 1) / 2]); i = (i - 1) / 2)
+    p[i] = p[(i - 1) / 2];
+  p[i] = *packet;
+}
+
+static void
+net_sim_packets_pop (GArray * packets, NetSimPacket * packet)
+{
+  NetSimPacket *p = (NetSimPacket *) packets->data;
+  NetSimPacket last;
+  guint i = 0, child, n;
+
+  *packet = p[0];
+  n = packets->len - 1;
+  last = p[n];
+  while ((child = 2 * i + 1) < n) {
+    if (child + 1 < n && net_sim_packet_before (&p[child + 1], &p[child]))
+      child++;
+    if (!net_sim_packet_before (&p[child], &last))
+      break;
+    p[i] = p[child];
+    i = child;
+  }
+  p[i] = last;
+  g_array_set_size (packets, n);
+}
+
+/* Pushes the delayed packets when they are due. The times are on the
+ * monotonic clock of gst_util_get_timestamp() */
 static void
 gst_net_sim_loop (GstNetSim * netsim)
 {
-  GMainLoop *loop;
-
-  GST_TRACE_OBJECT (netsim, "TASK: begin");
-
-  g_mutex_lock (&netsim->priv->loop_mutex);
-  loop = g_main_loop_ref (netsim->priv->main_loop);
-  netsim->priv->running = TRUE;
-  GST_TRACE_OBJECT (netsim, "TASK: signal start");
-  g_cond_signal (&netsim->priv->start_cond);
-  g_mutex_unlock (&netsim->priv->loop_mutex);
-
-  GST_TRACE_OBJECT (netsim, "TASK: run");
-  g_main_loop_run (loop);
-  g_main_loop_unref (loop);
-
-  g_mutex_lock (&netsim->priv->loop_mutex);
-  GST_TRACE_OBJECT (netsim, "TASK: pause");
-  gst_pad_pause_task (netsim->priv->srcpad);
-  netsim->priv->running = FALSE;
-  GST_TRACE_OBJECT (netsim, "TASK: signal end");
-  g_cond_signal (&netsim->priv->start_cond);
-  g_mutex_unlock (&netsim->priv->loop_mutex);
-  GST_TRACE_OBJECT (netsim, "TASK: end");
+  GstNetSimPrivate *priv = netsim->priv;
+  NetSimPacket packet;
+  GstClockTime now, time;
+
+  g_mutex_lock (&priv->loop_mutex);
+  while (priv->running) {
+    if (priv->packets->len == 0) {
+      g_cond_wait (&priv->cond, &priv->loop_mutex);
+      continue;
+    }
+
+    now = gst_util_get_timestamp ();
+    time = g_array_index (priv->packets, NetSimPacket, 0).time;
+    if (time <= now)
+      break;
+
+    /* g_cond_wait_until() has a microsecond resolution */
+    g_cond_wait_until (&priv->cond, &priv->loop_mutex,
+        g_get_monotonic_time () + (time - now + GST_USECOND - 1) /
+        GST_USECOND);
+  }
+
+  if (!priv->running) {
+    GST_TRACE_OBJECT (netsim, "TASK: pause");
+    g_mutex_unlock (&priv->loop_mutex);
+    gst_pad_pause_task (priv->srcpad);
+    return;
+  }
+
+  net_sim_packets_pop (priv->packets, &packet);
+  priv->pushing = TRUE;
+  g_mutex_unlock (&priv->loop_mutex);
+
+  GST_DEBUG_OBJECT (netsim, "Pushing buffer now");
+  gst_pad_push (priv->srcpad, packet.buf);
+
+  g_mutex_lock (&priv->loop_mutex);
+  priv->pushing = FALSE;
+  g_mutex_unlock (&priv->loop_mutex);
 }
 
-static gboolean
-_main_loop_quit_and_remove_source (gpointer user_data)
+static void
+gst_net_sim_reset (GstNetSim * netsim)
 {
-  GMainLoop *main_loop = user_data;
-  GST_DEBUG ("MAINLOOP: Quit %p", main_loop);
-  g_main_loop_quit (main_loop);
-  g_assert (!g_main_loop_is_running (main_loop));
-  return FALSE;                 /* Remove source */
+  GstNetSimPrivate *priv = netsim->priv;
+
+  priv->bucket_time = GST_CLOCK_TIME_NONE;
+  g_array_set_size (priv->link_queue, 0);
+  priv->link_head = 0;
+  priv->link_bytes = 0;
+  priv->gilbert_elliott_bad = FALSE;
+  if (priv->seed >= 0)
+    g_rand_set_seed (priv->rand_seed, priv->seed);
 }
 
 static gboolean
@@ -132,120 +249,182 @@ gst_net_sim_src_activatemode (GstPad * pad, GstObject * parent,
     GstPadMode mode, gboolean active)
 {
   GstNetSim *netsim = GST_NET_SIM (parent);
-  gboolean result = FALSE;
+  GstNetSimPrivate *priv = netsim->priv;
+  NetSimPacket packet;
+  gboolean result = TRUE;
 
   (void) pad;
   (void) mode;
 
-  g_mutex_lock (&netsim->priv->loop_mutex);
+  g_mutex_lock (&priv->loop_mutex);
   if (active) {
-    if (netsim->priv->main_loop == NULL) {
-      GMainContext *main_context = g_main_context_new ();
-      netsim->priv->main_loop = g_main_loop_new (main_context, FALSE);
-      g_main_context_unref (main_context);
+    if (!priv->running) {
+      gst_net_sim_reset (netsim);
+      priv->running = TRUE;
 
       GST_TRACE_OBJECT (netsim, "ACT: Starting task on srcpad");
-      result = gst_pad_start_task (netsim->priv->srcpad,
+      result = gst_pad_start_task (priv->srcpad,
           (GstTaskFunction) gst_net_sim_loop, netsim, NULL);
-
-      GST_TRACE_OBJECT (netsim, "ACT: Wait for task to start");
-      g_assert (!netsim->priv->running);
-      while (!netsim->priv->running)
-        g_cond_wait (&netsim->priv->start_cond, &netsim->priv->loop_mutex);
-      GST_TRACE_OBJECT (netsim, "ACT: Task on srcpad started");
     }
+    g_mutex_unlock (&priv->loop_mutex);
   } else {
-    if (netsim->priv->main_loop != NULL) {
-      GSource *source;
-      guint id;
-
-      /* Adds an Idle Source which quits the main loop from within.
-       * This removes the possibility for run/quit race conditions. */
-      GST_TRACE_OBJECT (netsim, "DEACT: Stopping main loop on deactivate");
-      source = g_idle_source_new ();
-      g_source_set_callback (source, _main_loop_quit_and_remove_source,
-          g_main_loop_ref (netsim->priv->main_loop),
-          (GDestroyNotify) g_main_loop_unref);
-      id = g_source_attach (source,
-          g_main_loop_get_context (netsim->priv->main_loop));
-      g_source_unref (source);
-      g_assert_cmpuint (id, >, 0);
-      g_main_loop_unref (netsim->priv->main_loop);
-      netsim->priv->main_loop = NULL;
-
-      GST_TRACE_OBJECT (netsim, "DEACT: Wait for mainloop and task to pause");
-      g_assert (netsim->priv->running);
-      while (netsim->priv->running)
-        g_cond_wait (&netsim->priv->start_cond, &netsim->priv->loop_mutex);
-
-      GST_TRACE_OBJECT (netsim, "DEACT: Stopping task on srcpad");
-      result = gst_pad_stop_task (netsim->priv->srcpad);
-      GST_TRACE_OBJECT (netsim, "DEACT: Mainloop and GstTask stopped");
+    GST_TRACE_OBJECT (netsim, "DEACT: Stopping task on srcpad");
+    priv->running = FALSE;
+    g_cond_signal (&priv->cond);
+    g_mutex_unlock (&priv->loop_mutex);
+
+    result = gst_pad_stop_task (priv->srcpad);
+
+    g_mutex_lock (&priv->loop_mutex);
+    while (priv->packets->len > 0) {
+      net_sim_packets_pop (priv->packets, &packet);
+      gst_buffer_unref (packet.buf);
     }
+    g_mutex_unlock (&priv->loop_mutex);
+    GST_TRACE_OBJECT (netsim, "DEACT: GstTask stopped");
   }
-  g_mutex_unlock (&netsim->priv->loop_mutex);
 
   return result;
 }
 
-typedef struct
+/* Returns the time at which a packet of size bytes arriving at now leaves
+ * the simulated link, or GST_CLOCK_TIME_NONE if it is dropped because the
+ * queue of the link is full. The link is a token bucket filled at max-kbps
+ * up to max-bucket-size bytes, a packet waits in the queue until there are
+ * enough tokens for all its bytes. */
+static GstClockTime
+gst_net_sim_link_departure (GstNetSim * netsim, GstClockTime now, gsize size)
 {
-  GstPad *pad;
-  GstBuffer *buf;
-} PushBufferCtx;
+  GstNetSimPrivate *priv = netsim->priv;
+  NetSimLinkPacket *link_packet;
+  GstClockTime start, departure;
+  gdouble rate, bucket, tokens;
+
+  if (priv->max_kbps <= 0)
+    return now;
+
+  /* remove the packets that left the queue since the previous packet */
+  while (priv->link_head < priv->link_queue->len) {
+    link_packet = &g_array_index (priv->link_queue, NetSimLinkPacket,
+        priv->link_head);
+    if (link_packet->departure > now)
+      break;
+    priv->link_bytes -= link_packet->size;
+    priv->link_head++;
+  }
+  if (priv->link_head > 64 && priv->link_head * 2 > priv->link_queue->len) {
+    g_array_remove_range (priv->link_queue, 0, priv->link_head);
+    priv->link_head = 0;
+  }
 
-G_INLINE_FUNC PushBufferCtx *
-push_buffer_ctx_new (GstPad * pad, GstBuffer * buf)
-{
-  PushBufferCtx *ctx = g_slice_new (PushBufferCtx);
-  ctx->pad = gst_object_ref (pad);
-  ctx->buf = gst_buffer_ref (buf);
-  return ctx;
+  /* bytes per nanosecond */
+  rate = priv->max_kbps * 1000.0 / 8 / GST_SECOND;
+  bucket = MAX (priv->max_bucket_size, (gint64) size);
+
+  if (!GST_CLOCK_TIME_IS_VALID (priv->bucket_time)) {
+    start = now;
+    tokens = bucket;
+  } else {
+    start = MAX (now, priv->bucket_time);
+    tokens = MIN (bucket, priv->bucket_tokens +
+        (start - priv->bucket_time) * rate);
+  }
+
+  departure = start;
+  if (tokens < size) {
+    departure += (GstClockTime) ((size - tokens) / rate + 0.5);
+    tokens = size;
+  }
+
+  if (departure > now) {
+    NetSimLinkPacket queued = { departure, size };
+
+    if (priv->max_queue_size >= 0 &&
+        priv->link_bytes + size > (guint64) priv->max_queue_size)
+      return GST_CLOCK_TIME_NONE;
+
+    g_array_append_val (priv->link_queue, queued);
+    priv->link_bytes += size;
+  }
+
+  priv->bucket_time = departure;
+  priv->bucket_tokens = tokens - size;
+
+  return departure;
 }
 
-G_INLINE_FUNC void
-push_buffer_ctx_free (PushBufferCtx * ctx)
+static GstFlowReturn
+gst_net_sim_delay_buffer (GstNetSim * netsim, GstBuffer * buf)
 {
-  if (G_LIKELY (ctx != NULL)) {
-    gst_buffer_unref (ctx->buf);
-    gst_object_unref (ctx->pad);
-    g_slice_free (PushBufferCtx, ctx);
+  GstNetSimPrivate *priv = netsim->priv;
+  GstClockTime now, time;
+  NetSimPacket packet;
+  gboolean scheduled = FALSE;
+
+  now = gst_util_get_timestamp ();
+  time = gst_net_sim_link_departure (netsim, now, gst_buffer_get_size (buf));
+  if (!GST_CLOCK_TIME_IS_VALID (time)) {
+    GST_DEBUG_OBJECT (netsim, "Dropping packet, link queue is full");
+    return GST_FLOW_OK;
+  }
+
+  if (priv->delay_probability > 0 &&
+      g_rand_double (priv->rand_seed) < priv->delay_probability) {
+    gdouble delay = priv->min_delay + g_rand_double (priv->rand_seed) *
+        (priv->max_delay - priv->min_delay);
+
+    GST_DEBUG_OBJECT (netsim, "Delaying packet by %f ms", delay);
+    if (delay > 0)
+      time += (GstClockTime) (delay * GST_MSECOND);
   }
+
+  /* a packet due now is only pushed directly when no earlier packet is still
+   * on its way, it would overtake it otherwise */
+  g_mutex_lock (&priv->loop_mutex);
+  if (time > now || priv->packets->len > 0 || priv->pushing) {
+    if (priv->running) {
+      packet.time = time;
+      packet.seqnum = priv->seqnum++;
+      packet.buf = gst_buffer_ref (buf);
+      net_sim_packets_push (priv->packets, &packet);
+      /* wake up the task if it waits for a later packet */
+      if (g_array_index (priv->packets, NetSimPacket, 0).seqnum ==
+          packet.seqnum)
+        g_cond_signal (&priv->cond);
+      scheduled = TRUE;
+    }
+  }
+  g_mutex_unlock (&priv->loop_mutex);
+
+  if (scheduled)
+    return GST_FLOW_OK;
+
+  return gst_pad_push (priv->srcpad, gst_buffer_ref (buf));
 }
 
+/* Gilbert-Elliott burst loss: before each packet the link goes from the
+ * good to the bad state with probability p and back with probability r,
+ * packets are then lost with the loss probability of the state */
 static gboolean
-push_buffer_ctx_push (PushBufferCtx * ctx)
+gst_net_sim_burst_loss (GstNetSim * netsim)
 {
-  GST_DEBUG_OBJECT (ctx->pad, "Pushing buffer now");
-  gst_pad_push (ctx->pad, gst_buffer_ref (ctx->buf));
-  return FALSE;
-}
+  GstNetSimPrivate *priv = netsim->priv;
+  gfloat loss;
 
-static GstFlowReturn
-gst_net_sim_delay_buffer (GstNetSim * netsim, GstBuffer * buf)
-{
-  GstFlowReturn ret = GST_FLOW_OK;
+  if (priv->gilbert_elliott_p <= 0 && !priv->gilbert_elliott_bad)
+    return FALSE;
 
-  g_mutex_lock (&netsim->priv->loop_mutex);
-  if (netsim->priv->main_loop != NULL && netsim->priv->delay_probability > 0 &&
-      g_rand_double (netsim->priv->rand_seed) < netsim->priv->delay_probability)
-  {
-    PushBufferCtx *ctx = push_buffer_ctx_new (netsim->priv->srcpad, buf);
-    gint delay = g_rand_int_range (netsim->priv->rand_seed,
-        netsim->priv->min_delay, netsim->priv->max_delay);
-    GSource *source = g_timeout_source_new (delay);
-
-    GST_DEBUG_OBJECT (netsim, "Delaying packet by %d", delay);
-    g_source_set_callback (source, (GSourceFunc) push_buffer_ctx_push,
-        ctx, (GDestroyNotify) push_buffer_ctx_free);
-    g_source_attach (source, g_main_loop_get_context (netsim->priv->main_loop));
-    g_source_unref (source);
-  } else {
-    ret = gst_pad_push (netsim->priv->srcpad, gst_buffer_ref (buf));
+  if (priv->gilbert_elliott_bad) {
+    if (g_rand_double (priv->rand_seed) < priv->gilbert_elliott_r)
+      priv->gilbert_elliott_bad = FALSE;
+  } else if (g_rand_double (priv->rand_seed) < priv->gilbert_elliott_p) {
+    priv->gilbert_elliott_bad = TRUE;
   }
-  g_mutex_unlock (&netsim->priv->loop_mutex);
 
-  return ret;
+  loss = priv->gilbert_elliott_bad ? priv->gilbert_elliott_bad_loss :
+      priv->gilbert_elliott_good_loss;
+
+  return loss > 0 && g_rand_double (priv->rand_seed) < (gdouble) loss;
 }
 
 static GstFlowReturn
@@ -260,6 +439,8 @@ gst_net_sim_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
     netsim->priv->drop_packets--;
     GST_DEBUG_OBJECT (netsim, "Dropping packet (%d left)",
         netsim->priv->drop_packets);
+  } else if (gst_net_sim_burst_loss (netsim)) {
+    GST_DEBUG_OBJECT (netsim, "Dropping packet (burst loss)");
   } else if (netsim->priv->drop_probability > 0
       && g_rand_double (netsim->priv->rand_seed) <
       (gdouble) netsim->priv->drop_probability) {
@@ -308,6 +489,32 @@ gst_net_sim_set_property (GObject * object,
     case ARG_DROP_PACKETS:
       netsim->priv->drop_packets = g_value_get_uint (value);
       break;
+    case ARG_MAX_KBPS:
+      netsim->priv->max_kbps = g_value_get_int (value);
+      break;
+    case ARG_MAX_BUCKET_SIZE:
+      netsim->priv->max_bucket_size = g_value_get_int (value);
+      break;
+    case ARG_MAX_QUEUE_SIZE:
+      netsim->priv->max_queue_size = g_value_get_int (value);
+      break;
+    case ARG_GILBERT_ELLIOTT_P:
+      netsim->priv->gilbert_elliott_p = g_value_get_float (value);
+      break;
+    case ARG_GILBERT_ELLIOTT_R:
+      netsim->priv->gilbert_elliott_r = g_value_get_float (value);
+      break;
+    case ARG_GILBERT_ELLIOTT_GOOD_LOSS:
+      netsim->priv->gilbert_elliott_good_loss = g_value_get_float (value);
+      break;
+    case ARG_GILBERT_ELLIOTT_BAD_LOSS:
+      netsim->priv->gilbert_elliott_bad_loss = g_value_get_float (value);
+      break;
+    case ARG_SEED:
+      netsim->priv->seed = g_value_get_int64 (value);
+      if (netsim->priv->seed >= 0)
+        g_rand_set_seed (netsim->priv->rand_seed, netsim->priv->seed);
+      break;
   }
 }
 
@@ -339,6 +546,30 @@ gst_net_sim_get_property (GObject * object,
     case ARG_DROP_PACKETS:
       g_value_set_uint (value, netsim->priv->drop_packets);
       break;
+    case ARG_MAX_KBPS:
+      g_value_set_int (value, netsim->priv->max_kbps);
+      break;
+    case ARG_MAX_BUCKET_SIZE:
+      g_value_set_int (value, netsim->priv->max_bucket_size);
+      break;
+    case ARG_MAX_QUEUE_SIZE:
+      g_value_set_int (value, netsim->priv->max_queue_size);
+      break;
+    case ARG_GILBERT_ELLIOTT_P:
+      g_value_set_float (value, netsim->priv->gilbert_elliott_p);
+      break;
+    case ARG_GILBERT_ELLIOTT_R:
+      g_value_set_float (value, netsim->priv->gilbert_elliott_r);
+      break;
+    case ARG_GILBERT_ELLIOTT_GOOD_LOSS:
+      g_value_set_float (value, netsim->priv->gilbert_elliott_good_loss);
+      break;
+    case ARG_GILBERT_ELLIOTT_BAD_LOSS:
+      g_value_set_float (value, netsim->priv->gilbert_elliott_bad_loss);
+      break;
+    case ARG_SEED:
+      g_value_set_int64 (value, netsim->priv->seed);
+      break;
   }
 }
 
@@ -357,9 +588,12 @@ gst_net_sim_init (GstNetSim * netsim)
   gst_element_add_pad (GST_ELEMENT (netsim), netsim->priv->sinkpad);
 
   g_mutex_init (&netsim->priv->loop_mutex);
-  g_cond_init (&netsim->priv->start_cond);
+  g_cond_init (&netsim->priv->cond);
+  netsim->priv->packets = g_array_new (FALSE, FALSE, sizeof (NetSimPacket));
+  netsim->priv->link_queue = g_array_new (FALSE, FALSE,
+      sizeof (NetSimLinkPacket));
+  netsim->priv->bucket_time = GST_CLOCK_TIME_NONE;
   netsim->priv->rand_seed = g_rand_new ();
-  netsim->priv->main_loop = NULL;
 
   GST_OBJECT_FLAG_SET (netsim->priv->sinkpad,
       GST_PAD_FLAG_PROXY_CAPS | GST_PAD_FLAG_PROXY_ALLOCATION);
@@ -376,8 +610,10 @@ gst_net_sim_finalize (GObject * object)
   GstNetSim *netsim = GST_NET_SIM (object);
 
   g_rand_free (netsim->priv->rand_seed);
+  g_array_free (netsim->priv->packets, TRUE);
+  g_array_free (netsim->priv->link_queue, TRUE);
   g_mutex_clear (&netsim->priv->loop_mutex);
-  g_cond_clear (&netsim->priv->start_cond);
+  g_cond_clear (&netsim->priv->cond);
 
   G_OBJECT_CLASS (gst_net_sim_parent_class)->finalize (object);
 }
@@ -387,7 +623,7 @@ gst_net_sim_dispose (GObject * object)
 {
   GstNetSim *netsim = GST_NET_SIM (object);
 
-  g_assert (netsim->priv->main_loop == NULL);
+  g_assert (!netsim->priv->running);
 
   G_OBJECT_CLASS (gst_net_sim_parent_class)->dispose (object);
 }
@@ -408,7 +644,7 @@ gst_net_sim_class_init (GstNetSimClass * klass)
   gst_element_class_set_metadata (gstelement_class,
       "Network Simulator",
       "Filter/Network",
-      "An element that simulates network jitter, "
+      "An element that simulates network jitter, bandwidth, "
       "packet loss and packet duplication",
       "Philippe Kalaf <philippe.kalaf@collabora.co.uk>");
 
@@ -454,6 +690,91 @@ gst_net_sim_class_init (GstNetSimClass * klass)
           0, G_MAXUINT, DEFAULT_DROP_PACKETS,
           G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstNetSim:max-kbps:
+   *
+   * The capacity of the simulated link. Packets wait in the queue of the
+   * link until a token bucket filled at this rate has enough tokens for
+   * them, then they are delayed as set by the delay properties.
+   */
+  g_object_class_install_property (gobject_class, ARG_MAX_KBPS,
+      g_param_spec_int ("max-kbps", "Maximum kbps",
+          "The maximum number of kilobits to let through per second "
+          "(-1 = unlimited)", -1, G_MAXINT, DEFAULT_MAX_KBPS,
+          G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstNetSim:max-bucket-size:
+   *
+   * The size of the token bucket of the link in bytes, the largest burst
+   * sent at once after the link was idle. A packet larger than the bucket
+   * is sent when the bucket is full.
+   */
+  g_object_class_install_property (gobject_class, ARG_MAX_BUCKET_SIZE,
+      g_param_spec_int ("max-bucket-size", "Maximum Bucket Size (bytes)",
+          "The size of the token bucket, related to burstiness resilience "
+          "(-1 = size of the packet)", -1, G_MAXINT, DEFAULT_MAX_BUCKET_SIZE,
+          G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstNetSim:max-queue-size:
+   *
+   * The size of the queue of the link in bytes. Packets that would make
+   * the queue larger are dropped.
+   */
+  g_object_class_install_property (gobject_class, ARG_MAX_QUEUE_SIZE,
+      g_param_spec_int ("max-queue-size", "Maximum Queue Size (bytes)",
+          "The maximum number of bytes waiting for the link, more are dropped "
+          "(-1 = unlimited)", -1, G_MAXINT, DEFAULT_MAX_QUEUE_SIZE,
+          G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstNetSim:gilbert-elliott-p:
+   *
+   * Probability that the Gilbert-Elliott burst loss model goes from the
+   * good to the bad state before a packet. 0 disables the model.
+   */
+  g_object_class_install_property (gobject_class, ARG_GILBERT_ELLIOTT_P,
+      g_param_spec_float ("gilbert-elliott-p", "Gilbert-Elliott p",
+          "The probability to go from the good to the bad state",
+          0.0, 1.0, DEFAULT_GILBERT_ELLIOTT_P,
+          G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, ARG_GILBERT_ELLIOTT_R,
+      g_param_spec_float ("gilbert-elliott-r", "Gilbert-Elliott r",
+          "The probability to go from the bad to the good state",
+          0.0, 1.0, DEFAULT_GILBERT_ELLIOTT_R,
+          G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      ARG_GILBERT_ELLIOTT_GOOD_LOSS,
+      g_param_spec_float ("gilbert-elliott-good-loss",
+          "Gilbert-Elliott Good Loss",
+          "The probability a buffer is dropped in the good state",
+          0.0, 1.0, DEFAULT_GILBERT_ELLIOTT_GOOD_LOSS,
+          G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      ARG_GILBERT_ELLIOTT_BAD_LOSS,
+      g_param_spec_float ("gilbert-elliott-bad-loss",
+          "Gilbert-Elliott Bad Loss",
+          "The probability a buffer is dropped in the bad state",
+          0.0, 1.0, DEFAULT_GILBERT_ELLIOTT_BAD_LOSS,
+          G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstNetSim:seed:
+   *
+   * Seed of the random numbers of the drop, duplicate, delay and burst
+   * loss decisions. With a seed the same input gives the same decisions,
+   * the generator is seeded again when the element starts.
+   */
+  g_object_class_install_property (gobject_class, ARG_SEED,
+      g_param_spec_int64 ("seed", "Seed",
+          "The seed of the random number generator (-1 = random seed)",
+          -1, G_MAXUINT32, DEFAULT_SEED,
+          G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
+
   GST_DEBUG_CATEGORY_INIT (netsim_debug, "netsim", 0, "Network simulator");
 }
 
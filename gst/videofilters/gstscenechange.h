@@ -45,6 +45,8 @@ struct _GstSceneChange
   GstBuffer *oldbuf;
   GstVideoInfo oldinfo;
   int count;
+
+  guint sample_step;
 };
 
 struct _GstSceneChangeClass
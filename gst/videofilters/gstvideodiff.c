@@ -38,6 +38,7 @@
 #include <gst/video/video.h>
 #include <gst/video/gstvideofilter.h>
 #include "gstvideodiff.h"
+#include "videosad.h"
 
 GST_DEBUG_CATEGORY_STATIC (gst_video_diff_debug_category);
 #define GST_CAT_DEFAULT gst_video_diff_debug_category
@@ -85,29 +86,42 @@ gst_video_diff_init (GstVideoDiff * videodiff)
   videodiff->threshold = 10;
 }
 
+/* pixels of a line whose sum of absolute differences is checked at once */
+#define DIFF_BLOCK 64
+
 static GstFlowReturn
 gst_video_diff_transform_frame_ip_planarY (GstVideoDiff * videodiff,
     GstVideoFrame * outframe, GstVideoFrame * inframe, GstVideoFrame * oldframe)
 {
   int width = inframe->info.width;
   int height = inframe->info.height;
-  int i, j;
+  int i, j, x, n;
   int threshold = videodiff->threshold;
   int t = videodiff->t;
+  VideoSadLineFunc sad_line = video_sad_get_line_func ();
 
   for (j = 0; j < height; j++) {
     guint8 *d = (guint8 *) outframe->data[0] + outframe->info.stride[0] * j;
     guint8 *s1 = (guint8 *) oldframe->data[0] + oldframe->info.stride[0] * j;
     guint8 *s2 = (guint8 *) inframe->data[0] + inframe->info.stride[0] * j;
-    for (i = 0; i < width; i++) {
-      if ((s2[i] < s1[i] - threshold) || (s2[i] > s1[i] + threshold)) {
-        if ((i + j + t) & 0x4) {
-          d[i] = 16;
+    for (x = 0; x < width; x += DIFF_BLOCK) {
+      n = MIN (DIFF_BLOCK, width - x);
+      /* no pixel differs by more than the sum of the differences, so the
+       * unchanged parts of the frame are copied */
+      if (sad_line (s1 + x, s2 + x, n) <= threshold) {
+        memcpy (d + x, s2 + x, n);
+        continue;
+      }
+      for (i = x; i < x + n; i++) {
+        if ((s2[i] < s1[i] - threshold) || (s2[i] > s1[i] + threshold)) {
+          if ((i + j + t) & 0x4) {
+            d[i] = 16;
+          } else {
+            d[i] = 240;
+          }
         } else {
-          d[i] = 240;
+          d[i] = s2[i];
         }
-      } else {
-        d[i] = s2[i];
       }
     }
   }
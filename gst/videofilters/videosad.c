@@ -0,0 +1,197 @@
+/* GStreamer
+ * Copyright (C) 2011 David Schleef <ds@entropywave.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+ * Boston, MA 02110-1335, USA.
+ */
+
+/* Sums of absolute differences of 8 bit planes, used by scenechange for
+ * its frame score and by videodiff to skip the unchanged parts of a frame.
+ * The sums are 64 bit, so they can't overflow for any frame size. The SSE2
+ * and AVX2 line functions use psadbw, which sums the absolute differences
+ * of 8 pixels into a 64 bit lane in one instruction. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "videosad.h"
+
+#if defined (__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static guint64
+video_sad_line_c (const guint8 * s1, const guint8 * s2, int width)
+{
+  guint64 sad = 0;
+  int i;
+
+  for (i = 0; i < width; i++)
+    sad += ABS (s1[i] - s2[i]);
+
+  return sad;
+}
+
+#if defined (__SSE2__)
+static guint64
+video_sad_line_sse2 (const guint8 * s1, const guint8 * s2, int width)
+{
+  __m128i acc0 = _mm_setzero_si128 ();
+  __m128i acc1 = _mm_setzero_si128 ();
+  guint64 sad;
+  int i = 0;
+
+  for (; i + 32 <= width; i += 32) {
+    acc0 = _mm_add_epi64 (acc0,
+        _mm_sad_epu8 (_mm_loadu_si128 ((const __m128i *) (s1 + i)),
+            _mm_loadu_si128 ((const __m128i *) (s2 + i))));
+    acc1 = _mm_add_epi64 (acc1,
+        _mm_sad_epu8 (_mm_loadu_si128 ((const __m128i *) (s1 + i + 16)),
+            _mm_loadu_si128 ((const __m128i *) (s2 + i + 16))));
+  }
+  if (i + 16 <= width) {
+    acc0 = _mm_add_epi64 (acc0,
+        _mm_sad_epu8 (_mm_loadu_si128 ((const __m128i *) (s1 + i)),
+            _mm_loadu_si128 ((const __m128i *) (s2 + i))));
+    i += 16;
+  }
+
+  acc0 = _mm_add_epi64 (acc0, acc1);
+  acc0 = _mm_add_epi64 (acc0, _mm_srli_si128 (acc0, 8));
+  _mm_storel_epi64 ((__m128i *) & sad, acc0);
+
+  return sad + video_sad_line_c (s1 + i, s2 + i, width - i);
+}
+
+/* AVX2 is only used if the CPU running the code supports it */
+#if defined (__clang__) || (defined (__GNUC__) && (__GNUC__ > 4 || \
+    (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#define HAVE_VIDEO_SAD_AVX2 1
+#include <immintrin.h>
+
+__attribute__ ((target ("avx2")))
+static guint64
+video_sad_line_avx2 (const guint8 * s1, const guint8 * s2, int width)
+{
+  __m256i acc0 = _mm256_setzero_si256 ();
+  __m256i acc1 = _mm256_setzero_si256 ();
+  __m128i acc;
+  guint64 sad;
+  int i = 0;
+
+  for (; i + 64 <= width; i += 64) {
+    acc0 = _mm256_add_epi64 (acc0,
+        _mm256_sad_epu8 (_mm256_loadu_si256 ((const __m256i *) (s1 + i)),
+            _mm256_loadu_si256 ((const __m256i *) (s2 + i))));
+    acc1 = _mm256_add_epi64 (acc1,
+        _mm256_sad_epu8 (_mm256_loadu_si256 ((const __m256i *) (s1 + i +
+                    32)), _mm256_loadu_si256 ((const __m256i *) (s2 + i +
+                    32))));
+  }
+  if (i + 32 <= width) {
+    acc0 = _mm256_add_epi64 (acc0,
+        _mm256_sad_epu8 (_mm256_loadu_si256 ((const __m256i *) (s1 + i)),
+            _mm256_loadu_si256 ((const __m256i *) (s2 + i))));
+    i += 32;
+  }
+
+  acc0 = _mm256_add_epi64 (acc0, acc1);
+  acc = _mm_add_epi64 (_mm256_castsi256_si128 (acc0),
+      _mm256_extracti128_si256 (acc0, 1));
+  /* the tail is done here rather than by calling the SSE2 function, mixing
+   * AVX and SSE code costs a lot on some CPUs */
+  if (i + 16 <= width) {
+    acc = _mm_add_epi64 (acc,
+        _mm_sad_epu8 (_mm_loadu_si128 ((const __m128i *) (s1 + i)),
+            _mm_loadu_si128 ((const __m128i *) (s2 + i))));
+    i += 16;
+  }
+  acc = _mm_add_epi64 (acc, _mm_srli_si128 (acc, 8));
+  _mm_storel_epi64 ((__m128i *) & sad, acc);
+
+  for (; i < width; i++)
+    sad += ABS (s1[i] - s2[i]);
+
+  return sad;
+}
+#endif
+#endif
+
+static gpointer
+video_sad_line_select (gpointer data)
+{
+  VideoSadLineFunc func = video_sad_line_c;
+
+#if defined (__SSE2__)
+  func = video_sad_line_sse2;
+#ifdef HAVE_VIDEO_SAD_AVX2
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("avx2"))
+    func = video_sad_line_avx2;
+#endif
+#endif
+
+  return (gpointer) func;
+}
+
+/* the fastest line function for the CPU running the code */
+VideoSadLineFunc
+video_sad_get_line_func (void)
+{
+  static GOnce select_once = G_ONCE_INIT;
+
+  return (VideoSadLineFunc) g_once (&select_once, video_sad_line_select,
+      NULL);
+}
+
+/* Returns the sum of absolute differences of two planes and sets n_pixels
+ * to the number of pixels summed. With a step of 1 all pixels are summed,
+ * otherwise only every step-th row and every step-th block of
+ * VIDEO_SAD_BLOCK pixels of these rows, so about 1 / step^2 of the pixels.
+ * The first block of a row moves by one block from one sampled row to the
+ * next, so that all the columns of the plane are sampled. */
+guint64
+video_sad_plane (const guint8 * s1, int stride1, const guint8 * s2,
+    int stride2, int width, int height, int step, guint64 * n_pixels)
+{
+  VideoSadLineFunc sad_line = video_sad_get_line_func ();
+  guint64 sad = 0;
+  int j, x, n;
+
+  *n_pixels = 0;
+
+  if (step <= 1) {
+    for (j = 0; j < height; j++)
+      sad += sad_line (s1 + (gsize) stride1 * j, s2 + (gsize) stride2 * j,
+          width);
+    *n_pixels = (guint64) width * height;
+    return sad;
+  }
+
+  for (j = 0; j < height; j += step) {
+    const guint8 *l1 = s1 + (gsize) stride1 * j;
+    const guint8 *l2 = s2 + (gsize) stride2 * j;
+
+    for (x = (j / step) % step * VIDEO_SAD_BLOCK; x < width;
+        x += step * VIDEO_SAD_BLOCK) {
+      n = MIN (VIDEO_SAD_BLOCK, width - x);
+      sad += sad_line (l1 + x, l2 + x, n);
+      *n_pixels += n;
+    }
+  }
+
+  return sad;
+}
@@ -0,0 +1,41 @@
+/* GStreamer
+ * Copyright (C) 2011 David Schleef <ds@entropywave.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+ * Boston, MA 02110-1335, USA.
+ */
+
+#ifndef _VIDEO_SAD_H_
+#define _VIDEO_SAD_H_
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* width of the blocks of the sampled planes of video_sad_plane() */
+#define VIDEO_SAD_BLOCK 16
+
+/* sum of absolute differences of the width pixels of two lines */
+typedef guint64 (*VideoSadLineFunc) (const guint8 * s1, const guint8 * s2,
+    int width);
+
+VideoSadLineFunc video_sad_get_line_func (void);
+
+guint64 video_sad_plane (const guint8 * s1, int stride1, const guint8 * s2,
+    int stride2, int width, int height, int step, guint64 * n_pixels);
+
+G_END_DECLS
+
+#endif
@@ -38,6 +38,11 @@ GST_DEBUG_CATEGORY (h264_parse_debug);
 
 #define DEFAULT_CONFIG_INTERVAL      (0)
 
+/* NAL units from this size are referenced instead of copied when they are
+ * converted. The smaller ones are still copied as the number of memories of
+ * a buffer is limited */
+#define SHARED_NAL_MIN_SIZE          (4096)
+
 enum
 {
   PROP_0,
@@ -236,6 +241,7 @@ gst_h264_parse_reset_stream_info (GstH264Parse * h264parse)
     gst_buffer_replace (&h264parse->sps_nals[i], NULL);
   for (i = 0; i < GST_H264_MAX_PPS_COUNT; i++)
     gst_buffer_replace (&h264parse->pps_nals[i], NULL);
+  gst_buffer_replace (&h264parse->codec_nals, NULL);
 }
 
 static void
@@ -413,33 +419,81 @@ gst_h264_parse_negotiate (GstH264Parse * h264parse, gint in_format,
 
   h264parse->transform = in_format != h264parse->format ||
       align == GST_H264_PARSE_ALIGN_AU;
+
+  /* the prefix of the SPS/PPS inserted in the AUs may change */
+  gst_buffer_replace (&h264parse->codec_nals, NULL);
 }
 
-static GstBuffer *
-gst_h264_parse_wrap_nal (GstH264Parse * h264parse, guint format, guint8 * data,
-    guint size)
+/* writes the start code or the length of a nal of @size bytes for @format
+ * to @prefix and returns its size */
+static guint
+gst_h264_parse_nal_prefix (GstH264Parse * h264parse, guint format, guint size,
+    guint8 prefix[4])
 {
-  GstBuffer *buf;
   guint nl = h264parse->nal_length_size;
-  guint32 tmp;
-
-  GST_DEBUG_OBJECT (h264parse, "nal length %d", size);
 
-  buf = gst_buffer_new_allocate (NULL, 4 + size, NULL);
   if (format == GST_H264_PARSE_FORMAT_AVC
       || format == GST_H264_PARSE_FORMAT_AVC3) {
-    tmp = GUINT32_TO_BE (size << (32 - 8 * nl));
+    GST_WRITE_UINT32_BE (prefix, size << (32 - 8 * nl));
   } else {
     /* HACK: nl should always be 4 here, otherwise this won't work. 
      * There are legit cases where nl in avc stream is 2, but byte-stream
      * SC is still always 4 bytes. */
     nl = 4;
-    tmp = GUINT32_TO_BE (1);
+    GST_WRITE_UINT32_BE (prefix, 1);
   }
 
-  gst_buffer_fill (buf, 0, &tmp, sizeof (guint32));
+  return nl;
+}
+
+static GstBuffer *
+gst_h264_parse_wrap_nal (GstH264Parse * h264parse, guint format, guint8 * data,
+    guint size)
+{
+  GstBuffer *buf;
+  guint8 prefix[4];
+  guint nl;
+
+  GST_DEBUG_OBJECT (h264parse, "nal length %d", size);
+
+  nl = gst_h264_parse_nal_prefix (h264parse, format, size, prefix);
+
+  buf = gst_buffer_new_allocate (NULL, nl + size, NULL);
+  gst_buffer_fill (buf, 0, prefix, nl);
   gst_buffer_fill (buf, nl, data, size);
-  gst_buffer_set_size (buf, size + nl);
+
+  return buf;
+}
+
+/* like gst_h264_parse_wrap_nal(), but large nals reference the memory of
+ * @buffer, of which @nalu was parsed, instead of being copied. If the input
+ * already has the right prefix, it is kept as well */
+static GstBuffer *
+gst_h264_parse_wrap_nal_shared (GstH264Parse * h264parse, guint format,
+    GstBuffer * buffer, GstH264NalUnit * nalu)
+{
+  GstBuffer *buf;
+  guint8 prefix[4];
+  guint nl;
+
+  if (!buffer || nalu->size < SHARED_NAL_MIN_SIZE)
+    return gst_h264_parse_wrap_nal (h264parse, format,
+        nalu->data + nalu->offset, nalu->size);
+
+  GST_DEBUG_OBJECT (h264parse, "nal length %d, sharing input memory",
+      nalu->size);
+
+  nl = gst_h264_parse_nal_prefix (h264parse, format, nalu->size, prefix);
+
+  if (nalu->offset >= nl
+      && memcmp (nalu->data + nalu->offset - nl, prefix, nl) == 0)
+    return gst_buffer_copy_region (buffer, GST_BUFFER_COPY_MEMORY,
+        nalu->offset - nl, nl + nalu->size);
+
+  buf = gst_buffer_new_allocate (NULL, nl, NULL);
+  gst_buffer_fill (buf, 0, prefix, nl);
+  gst_buffer_copy_into (buf, buffer, GST_BUFFER_COPY_MEMORY, nalu->offset,
+      nalu->size);
 
   return buf;
 }
@@ -478,6 +532,8 @@ gst_h264_parser_store_nal (GstH264Parse * h264parse, guint id,
     gst_buffer_unref (store[id]);
 
   store[id] = buf;
+
+  gst_buffer_replace (&h264parse->codec_nals, NULL);
 }
 
 #ifndef GST_DISABLE_GST_DEBUG
@@ -696,9 +752,12 @@ gst_h264_parse_process_sei (GstH264Parse * h264parse, GstH264NalUnit * nalu)
   g_array_free (messages, TRUE);
 }
 
-/* caller guarantees 2 bytes of nal payload */
+/* caller guarantees 2 bytes of nal payload.
+ * @buffer is the buffer @nalu was parsed from, its memory is referenced by
+ * the output, or NULL to copy the nal */
 static gboolean
-gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
+gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu,
+    GstBuffer * buffer)
 {
   guint nal_type;
   GstH264PPS pps = { 0, };
@@ -891,8 +950,8 @@ gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
     GstBuffer *buf;
 
     GST_LOG_OBJECT (h264parse, "collecting NAL in AVC frame");
-    buf = gst_h264_parse_wrap_nal (h264parse, h264parse->format,
-        nalu->data + nalu->offset, nalu->size);
+    buf = gst_h264_parse_wrap_nal_shared (h264parse, h264parse->format,
+        buffer, nalu);
     gst_adapter_push (h264parse->frame_out, buf);
   }
   return TRUE;
@@ -990,7 +1049,7 @@ gst_h264_parse_handle_frame_packetized (GstBaseParse * parse,
     GST_DEBUG_OBJECT (h264parse, "AVC nal offset %d", nalu.offset + nalu.size);
 
     /* either way, have a look at it */
-    gst_h264_parse_process_nal (h264parse, &nalu);
+    gst_h264_parse_process_nal (h264parse, &nalu, buffer);
 
     /* dispatch per NALU if needed */
     if (h264parse->split_packetized) {
@@ -1228,7 +1287,7 @@ gst_h264_parse_handle_frame (GstBaseParse * parse,
       }
     }
 
-    if (!gst_h264_parse_process_nal (h264parse, &nalu)) {
+    if (!gst_h264_parse_process_nal (h264parse, &nalu, buffer)) {
       GST_WARNING_OBJECT (h264parse,
           "broken/invalid nal Type: %d %s, Size: %u will be dropped",
           nalu.type, _nal_name (nalu.type), nalu.size);
@@ -2138,12 +2197,13 @@ gst_h264_parse_parse_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
     h264parse->discont = FALSE;
   }
 
-  /* replace with transformed AVC output if applicable */
+  /* replace with transformed AVC output if applicable, made of the
+   * memories of the collected nals */
   av = gst_adapter_available (h264parse->frame_out);
   if (av) {
     GstBuffer *buf;
 
-    buf = gst_adapter_take_buffer (h264parse->frame_out, av);
+    buf = gst_adapter_take_buffer_fast (h264parse->frame_out, av);
     gst_buffer_copy_into (buf, buffer, GST_BUFFER_COPY_METADATA, 0, -1);
     gst_buffer_replace (&frame->out_buffer, buf);
     gst_buffer_unref (buf);
@@ -2266,6 +2326,61 @@ gst_h264_parse_prepare_key_unit (GstH264Parse * parse, GstEvent * event)
   parse->push_codec = TRUE;
 }
 
+/* returns the SPS and PPS NALs to insert in an AU, prefixed for the output
+ * format. They are cached until the SPS, the PPS or the format change */
+static GstBuffer *
+gst_h264_parse_get_codec_nals (GstH264Parse * h264parse)
+{
+  GstByteWriter bw;
+  GstBuffer *codec_nal;
+  const gboolean bs = h264parse->format == GST_H264_PARSE_FORMAT_BYTE;
+  const gint nls = 4 - h264parse->nal_length_size;
+  gboolean ok = TRUE;
+  gint i;
+
+  if (h264parse->codec_nals)
+    return h264parse->codec_nals;
+
+  gst_byte_writer_init (&bw);
+  for (i = 0; i < GST_H264_MAX_SPS_COUNT; i++) {
+    if ((codec_nal = h264parse->sps_nals[i])) {
+      gsize nal_size = gst_buffer_get_size (codec_nal);
+      GST_DEBUG_OBJECT (h264parse, "inserting SPS nal");
+      if (bs) {
+        ok &= gst_byte_writer_put_uint32_be (&bw, 1);
+      } else {
+        ok &= gst_byte_writer_put_uint32_be (&bw, (nal_size << (nls * 8)));
+        ok &= gst_byte_writer_set_pos (&bw,
+            gst_byte_writer_get_pos (&bw) - nls);
+      }
+
+      ok &= gst_byte_writer_put_buffer (&bw, codec_nal, 0, nal_size);
+    }
+  }
+  for (i = 0; i < GST_H264_MAX_PPS_COUNT; i++) {
+    if ((codec_nal = h264parse->pps_nals[i])) {
+      gsize nal_size = gst_buffer_get_size (codec_nal);
+      GST_DEBUG_OBJECT (h264parse, "inserting PPS nal");
+      if (bs) {
+        ok &= gst_byte_writer_put_uint32_be (&bw, 1);
+      } else {
+        ok &= gst_byte_writer_put_uint32_be (&bw, (nal_size << (nls * 8)));
+        ok &= gst_byte_writer_set_pos (&bw,
+            gst_byte_writer_get_pos (&bw) - nls);
+      }
+      ok &= gst_byte_writer_put_buffer (&bw, codec_nal, 0, nal_size);
+    }
+  }
+  /* some result checking seems to make some compilers happy */
+  if (G_UNLIKELY (!ok)) {
+    GST_ERROR_OBJECT (h264parse, "failed to insert SPS/PPS");
+  }
+
+  h264parse->codec_nals = gst_byte_writer_reset_and_get_buffer (&bw);
+
+  return h264parse->codec_nals;
+}
+
 static gboolean
 gst_h264_parse_handle_sps_pps_nals (GstH264Parse * h264parse,
     GstBuffer * buffer, GstBaseParseFrame * frame)
@@ -2293,60 +2408,27 @@ gst_h264_parse_handle_sps_pps_nals (GstH264Parse * h264parse,
       }
     }
   } else {
-    /* insert config NALs into AU */
-    GstByteWriter bw;
-    GstBuffer *new_buf;
-    const gboolean bs = h264parse->format == GST_H264_PARSE_FORMAT_BYTE;
-    const gint nls = 4 - h264parse->nal_length_size;
-    gboolean ok;
-
-    gst_byte_writer_init_with_size (&bw, gst_buffer_get_size (buffer), FALSE);
-    ok = gst_byte_writer_put_buffer (&bw, buffer, 0, h264parse->idr_pos);
-    GST_DEBUG_OBJECT (h264parse, "- inserting SPS/PPS");
-    for (i = 0; i < GST_H264_MAX_SPS_COUNT; i++) {
-      if ((codec_nal = h264parse->sps_nals[i])) {
-        gsize nal_size = gst_buffer_get_size (codec_nal);
-        GST_DEBUG_OBJECT (h264parse, "inserting SPS nal");
-        if (bs) {
-          ok &= gst_byte_writer_put_uint32_be (&bw, 1);
-        } else {
-          ok &= gst_byte_writer_put_uint32_be (&bw, (nal_size << (nls * 8)));
-          ok &= gst_byte_writer_set_pos (&bw,
-              gst_byte_writer_get_pos (&bw) - nls);
-        }
+    /* insert config NALs into AU, sharing the memories of the frame */
+    GstBuffer *codec_nals, *new_buf;
 
-        ok &= gst_byte_writer_put_buffer (&bw, codec_nal, 0, nal_size);
-        send_done = TRUE;
-      }
-    }
-    for (i = 0; i < GST_H264_MAX_PPS_COUNT; i++) {
-      if ((codec_nal = h264parse->pps_nals[i])) {
-        gsize nal_size = gst_buffer_get_size (codec_nal);
-        GST_DEBUG_OBJECT (h264parse, "inserting PPS nal");
-        if (bs) {
-          ok &= gst_byte_writer_put_uint32_be (&bw, 1);
-        } else {
-          ok &= gst_byte_writer_put_uint32_be (&bw, (nal_size << (nls * 8)));
-          ok &= gst_byte_writer_set_pos (&bw,
-              gst_byte_writer_get_pos (&bw) - nls);
-        }
-        ok &= gst_byte_writer_put_buffer (&bw, codec_nal, 0, nal_size);
-        send_done = TRUE;
-      }
-    }
-    ok &= gst_byte_writer_put_buffer (&bw, buffer, h264parse->idr_pos, -1);
+    GST_DEBUG_OBJECT (h264parse, "- inserting SPS/PPS");
+    codec_nals = gst_h264_parse_get_codec_nals (h264parse);
+    send_done = gst_buffer_get_size (codec_nals) > 0;
+
+    new_buf = gst_buffer_new ();
+    if (h264parse->idr_pos > 0)
+      gst_buffer_copy_into (new_buf, buffer, GST_BUFFER_COPY_MEMORY, 0,
+          h264parse->idr_pos);
+    gst_buffer_copy_into (new_buf, codec_nals, GST_BUFFER_COPY_MEMORY, 0, -1);
+    gst_buffer_copy_into (new_buf, buffer, GST_BUFFER_COPY_MEMORY,
+        h264parse->idr_pos, -1);
     /* collect result and push */
-    new_buf = gst_byte_writer_reset_and_get_buffer (&bw);
     gst_buffer_copy_into (new_buf, buffer, GST_BUFFER_COPY_METADATA, 0, -1);
     /* should already be keyframe/IDR, but it may not have been,
      * so mark it as such to avoid being discarded by picky decoder */
     GST_BUFFER_FLAG_UNSET (new_buf, GST_BUFFER_FLAG_DELTA_UNIT);
     gst_buffer_replace (&frame->out_buffer, new_buf);
     gst_buffer_unref (new_buf);
-    /* some result checking seems to make some compilers happy */
-    if (G_UNLIKELY (!ok)) {
-      GST_ERROR_OBJECT (h264parse, "failed to insert SPS/PPS");
-    }
   }
 
   return send_done;
@@ -2639,7 +2721,7 @@ gst_h264_parse_set_caps (GstBaseParse * parse, GstCaps * caps)
         goto avcc_too_small;
       }
 
-      gst_h264_parse_process_nal (h264parse, &nalu);
+      gst_h264_parse_process_nal (h264parse, &nalu, NULL);
       off = nalu.offset + nalu.size;
     }
 
@@ -2658,7 +2740,7 @@ gst_h264_parse_set_caps (GstBaseParse * parse, GstCaps * caps)
         goto avcc_too_small;
       }
 
-      gst_h264_parse_process_nal (h264parse, &nalu);
+      gst_h264_parse_process_nal (h264parse, &nalu, NULL);
       off = nalu.offset + nalu.size;
     }
 
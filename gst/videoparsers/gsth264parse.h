@@ -90,6 +90,8 @@ struct _GstH264Parse
   /* collected SPS and PPS NALUs */
   GstBuffer *sps_nals[GST_H264_MAX_SPS_COUNT];
   GstBuffer *pps_nals[GST_H264_MAX_PPS_COUNT];
+  /* SPS and PPS NALUs prefixed for insertion in the AUs */
+  GstBuffer *codec_nals;
 
   /* Infos we need to keep track of */
   guint32 sei_cpb_removal_delay;
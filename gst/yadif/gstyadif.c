@@ -72,10 +72,19 @@ static GstFlowReturn gst_yadif_transform (GstBaseTransform * trans,
 enum
 {
   PROP_0,
-  PROP_MODE
+  PROP_MODE,
+  PROP_N_THREADS
 };
 
 #define DEFAULT_MODE GST_DEINTERLACE_MODE_AUTO
+#define DEFAULT_N_THREADS 1
+
+/* the samples of these formats are filtered as native endian 16 bit */
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+#define FORMATS_16BIT "I420_10LE,I422_10LE,Y444_10LE"
+#else
+#define FORMATS_16BIT "I420_10BE,I422_10BE,Y444_10BE"
+#endif
 
 /* pad templates */
 
@@ -83,7 +92,8 @@ static GstStaticPadTemplate gst_yadif_sink_template =
 GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
     GST_PAD_ALWAYS,
-    GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE ("{Y42B,I420,Y444}")
+    GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE ("{Y42B,I420,Y444,"
+            FORMATS_16BIT "}")
         ",interlace-mode=(string){interleaved,mixed,progressive}")
     );
 
@@ -91,7 +101,8 @@ static GstStaticPadTemplate gst_yadif_src_template =
 GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
     GST_PAD_ALWAYS,
-    GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE ("{Y42B,I420,Y444}")
+    GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE ("{Y42B,I420,Y444,"
+            FORMATS_16BIT "}")
         ",interlace-mode=(string)progressive")
     );
 
@@ -160,11 +171,27 @@ gst_yadif_class_init (GstYadifClass * klass)
           DEFAULT_MODE,
           G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstYadif:n-threads:
+   *
+   * Maximum number of threads used to deinterlace a frame. The rows of the
+   * frame are split in bands that are filtered in parallel, the output is
+   * identical to the one of single-threaded filtering. 0 uses one thread
+   * per processor.
+   */
+  g_object_class_install_property (gobject_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Number of threads",
+          "Maximum number of threads used for deinterlacing "
+          "(0 = number of processors)", 0, G_MAXINT, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
 gst_yadif_init (GstYadif * yadif)
 {
+  yadif->n_threads = DEFAULT_N_THREADS;
+  g_mutex_init (&yadif->band_lock);
+  g_cond_init (&yadif->band_cond);
 }
 
 void
@@ -177,6 +204,9 @@ gst_yadif_set_property (GObject * object, guint property_id,
     case PROP_MODE:
       yadif->mode = g_value_get_enum (value);
       break;
+    case PROP_N_THREADS:
+      yadif->n_threads = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -193,6 +223,9 @@ gst_yadif_get_property (GObject * object, guint property_id,
     case PROP_MODE:
       g_value_set_enum (value, yadif->mode);
       break;
+    case PROP_N_THREADS:
+      g_value_set_uint (value, yadif->n_threads);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -212,9 +245,12 @@ gst_yadif_dispose (GObject * object)
 void
 gst_yadif_finalize (GObject * object)
 {
-  /* GstYadif *yadif = GST_YADIF (object); */
+  GstYadif *yadif = GST_YADIF (object);
 
-  /* clean up object here */
+  if (yadif->band_pool)
+    g_thread_pool_free (yadif->band_pool, FALSE, TRUE);
+  g_mutex_clear (&yadif->band_lock);
+  g_cond_clear (&yadif->band_cond);
 
   G_OBJECT_CLASS (gst_yadif_parent_class)->finalize (object);
 }
@@ -53,6 +53,13 @@ struct _GstYadif
   GstVideoFrame cur_frame;
   GstVideoFrame next_frame;
   GstVideoFrame dest_frame;
+
+  /* row band parallel filtering, see yadif_filter() */
+  guint n_threads;
+  GThreadPool *band_pool;
+  GMutex band_lock;
+  GCond band_cond;
+  guint bands_pending;
 };
 
 struct _GstYadifClass
@@ -62,6 +69,14 @@ struct _GstYadifClass
 
 GType gst_yadif_get_type (void);
 
+/* filters the w pixels of a line, see vf_yadif.c */
+typedef void (*GstYadifFilterLineFunc) (guint8 * dst, guint8 * prev,
+    guint8 * cur, guint8 * next, int w, int prefs, int mrefs, int parity,
+    int mode);
+typedef void (*GstYadifFilterLine16Func) (guint16 * dst, guint16 * prev,
+    guint16 * cur, guint16 * next, int w, int prefs, int mrefs, int parity,
+    int mode);
+
 G_END_DECLS
 
 #endif
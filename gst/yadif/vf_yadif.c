@@ -46,8 +46,10 @@
             spatial_score= score;\
             spatial_pred= (cur[mrefs  +(j)] + cur[prefs  -(j)])>>1;\
 
-#define FILTER \
-    for (x = 0;  x < w; x++) { \
+/* the spatial check looks 3 pixels to the left and right, so it is skipped
+ * for the 3 pixels at each edge of the line */
+#define FILTER(start, end, is_not_edge) \
+    for (x = start;  x < end; x++) { \
         int c = cur[mrefs]; \
         int d = (prev2[0] + next2[0])>>1; \
         int e = cur[prefs]; \
@@ -56,11 +58,10 @@
         int temporal_diff2 =(FFABS(next[mrefs] - c) + FFABS(next[prefs] - e) )>>1; \
         int diff = FFMAX3(temporal_diff0 >> 1, temporal_diff1, temporal_diff2); \
         int spatial_pred = (c+e) >> 1; \
-        int spatial_score = -1; \
  \
-        if (mrefs > 0 && prefs > 0) { \
-            spatial_score = FFABS(cur[mrefs - 1] - cur[prefs - 1]) + FFABS(c-e) \
-                            + FFABS(cur[mrefs + 1] - cur[prefs + 1]) - 1; \
+        if (is_not_edge) { \
+            int spatial_score = FFABS(cur[mrefs - 1] - cur[prefs - 1]) + FFABS(c-e) \
+                              + FFABS(cur[mrefs + 1] - cur[prefs + 1]) - 1; \
  \
             CHECK(-1) CHECK(-2) }} }} \
             CHECK( 1) CHECK( 2) }} }} \
@@ -89,6 +90,17 @@
         next2++; \
     }
 
+/* moves the line pointers of FILTER to pixel x */
+#define SKIP_TO(x) \
+    dst += (x) - edge; \
+    prev += (x) - edge; \
+    cur += (x) - edge; \
+    next += (x) - edge; \
+    prev2 += (x) - edge; \
+    next2 += (x) - edge;
+
+/* filters the pixels of a line that are at least 3 pixels away from its
+ * edges, the pointers point to the first of them */
 static void
 filter_line_c (guint8 * dst,
     guint8 * prev, guint8 * cur, guint8 * next,
@@ -98,9 +110,23 @@ filter_line_c (guint8 * dst,
   guint8 *prev2 = parity ? prev : cur;
   guint8 *next2 = parity ? cur : next;
 
-FILTER}
+FILTER (0, w, 1)}
+
+/* filters the pixels of a line that filter_line_c doesn't */
+static void
+filter_edges (guint8 * dst,
+    guint8 * prev, guint8 * cur, guint8 * next,
+    int w, int prefs, int mrefs, int parity, int mode)
+{
+  int x;
+  guint8 *prev2 = parity ? prev : cur;
+  guint8 *next2 = parity ? cur : next;
+  int edge = MIN (w, 3);
+
+  FILTER (0, edge, 0)
+  SKIP_TO (MAX (w - 3, edge))
+FILTER (MAX (w - 3, edge), w, 0)}
 
-#if 0
 static void
 filter_line_c_16bit (guint16 * dst,
     guint16 * prev, guint16 * cur, guint16 * next,
@@ -112,52 +138,124 @@ filter_line_c_16bit (guint16 * dst,
   mrefs /= 2;
   prefs /= 2;
 
-FILTER}
+FILTER (0, w, 1)}
+
+static void
+filter_edges_16bit (guint16 * dst,
+    guint16 * prev, guint16 * cur, guint16 * next,
+    int w, int prefs, int mrefs, int parity, int mode)
+{
+  int x;
+  guint16 *prev2 = parity ? prev : cur;
+  guint16 *next2 = parity ? cur : next;
+  int edge = MIN (w, 3);
+  mrefs /= 2;
+  prefs /= 2;
+
+  FILTER (0, edge, 0)
+  SKIP_TO (MAX (w - 3, edge))
+FILTER (MAX (w - 3, edge), w, 0)}
+
+/* the SIMD line filters need at least that many pixels */
+#define SIMD_MIN_WIDTH 16
+/* the SIMD 16 bit line filters compute in 16 bit lanes, which is exact for
+ * samples of up to this depth */
+#define SIMD_MAX_DEPTH 12
+
+typedef struct
+{
+  GstYadifFilterLineFunc filter_line;
+  GstYadifFilterLine16Func filter_line_16bit;
+} YadifFilterLineFuncs;
+
+#if defined (__SSE2__)
+void yadif_filter_line_select_x86 (GstYadifFilterLineFunc * filter_line,
+    GstYadifFilterLine16Func * filter_line_16bit);
 #endif
 
-void yadif_filter (GstYadif * yadif, int parity, int tff);
-#ifdef HAVE_CPU_X86_64
-void filter_line_x86_64 (guint8 * dst,
-    guint8 * prev, guint8 * cur, guint8 * next,
-    int w, int prefs, int mrefs, int parity, int mode);
+static gpointer
+yadif_filter_line_select (gpointer data)
+{
+  YadifFilterLineFuncs *funcs = data;
+
+  funcs->filter_line = filter_line_c;
+  funcs->filter_line_16bit = filter_line_c_16bit;
+#if defined (__SSE2__)
+  yadif_filter_line_select_x86 (&funcs->filter_line,
+      &funcs->filter_line_16bit);
 #endif
 
-void
-yadif_filter (GstYadif * yadif, int parity, int tff)
+  return funcs;
+}
+
+typedef struct
+{
+  GstYadif *yadif;
+  int parity, tff;
+  guint band, n_bands;
+} YadifBand;
+
+void yadif_filter (GstYadif * yadif, int parity, int tff);
+
+/* filters the rows of band of the n_bands bands of each component */
+static void
+yadif_filter_band (GstYadif * yadif, int parity, int tff, guint band,
+    guint n_bands)
 {
+  static YadifFilterLineFuncs funcs;
+  static GOnce select_once = G_ONCE_INIT;
   int y, i;
   const GstVideoInfo *vi = &yadif->video_info;
   const GstVideoFormatInfo *vfi = vi->finfo;
 
+  g_once (&select_once, yadif_filter_line_select, &funcs);
+
   for (i = 0; i < GST_VIDEO_FORMAT_INFO_N_COMPONENTS (vfi); i++) {
     int w = GST_VIDEO_FORMAT_INFO_SCALE_WIDTH (vfi, i, vi->width);
     int h = GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (vfi, i, vi->height);
     int refs = GST_VIDEO_INFO_COMP_STRIDE (vi, i);
     int df = GST_VIDEO_INFO_COMP_PSTRIDE (vi, i);
+    int depth = GST_VIDEO_FORMAT_INFO_DEPTH (vfi, i);
+    int y_start = (guint64) h * band / n_bands;
+    int y_end = (guint64) h * (band + 1) / n_bands;
     guint8 *prev_data = GST_VIDEO_FRAME_COMP_DATA (&yadif->prev_frame, i);
     guint8 *cur_data = GST_VIDEO_FRAME_COMP_DATA (&yadif->cur_frame, i);
     guint8 *next_data = GST_VIDEO_FRAME_COMP_DATA (&yadif->next_frame, i);
     guint8 *dest_data = GST_VIDEO_FRAME_COMP_DATA (&yadif->dest_frame, i);
+    GstYadifFilterLineFunc filter_line = filter_line_c;
+    GstYadifFilterLine16Func filter_line_16bit = filter_line_c_16bit;
+
+    if (w - 6 >= SIMD_MIN_WIDTH) {
+      filter_line = funcs.filter_line;
+      if (depth <= SIMD_MAX_DEPTH)
+        filter_line_16bit = funcs.filter_line_16bit;
+    }
 
-    for (y = 0; y < h; y++) {
+    for (y = y_start; y < y_end; y++) {
       if ((y ^ parity) & 1) {
         guint8 *prev = prev_data + y * refs;
         guint8 *cur = cur_data + y * refs;
         guint8 *next = next_data + y * refs;
         guint8 *dst = dest_data + y * refs;
         int mode = ((y == 1) || (y + 2 == h)) ? 2 : yadif->mode;
-#if HAVE_CPU_X86_64
-        if (0) {
-          filter_line_c (dst, prev, cur, next, w,
-              y + 1 < h ? refs : -refs, y ? -refs : refs, parity ^ tff, mode);
+        int prefs = y + 1 < h ? refs : -refs;
+        int mrefs = y ? -refs : refs;
+
+        if (depth > 8) {
+          if (w > 6)
+            filter_line_16bit ((guint16 *) dst + 3, (guint16 *) prev + 3,
+                (guint16 *) cur + 3, (guint16 *) next + 3, w - 6, prefs, mrefs,
+                parity ^ tff, mode);
+          filter_edges_16bit ((guint16 *) dst, (guint16 *) prev,
+              (guint16 *) cur, (guint16 *) next, w, prefs, mrefs, parity ^ tff,
+              mode);
         } else {
-          filter_line_x86_64 (dst, prev, cur, next, w,
-              y + 1 < h ? refs : -refs, y ? -refs : refs, parity ^ tff, mode);
+          if (w > 6)
+            filter_line (dst + 3, prev + 3, cur + 3, next + 3, w - 6, prefs,
+                mrefs, parity ^ tff, mode);
+          filter_edges (dst, prev, cur, next, w, prefs, mrefs, parity ^ tff,
+              mode);
         }
-#else
-        filter_line_c (dst, prev, cur, next, w,
-            y + 1 < h ? refs : -refs, y ? -refs : refs, parity ^ tff, mode);
-#endif
       } else {
         guint8 *dst = dest_data + y * refs;
         guint8 *cur = cur_data + y * refs;
@@ -166,8 +264,70 @@ yadif_filter (GstYadif * yadif, int parity, int tff)
       }
     }
   }
+}
 
-#if 0
-  emms_c ();
-#endif
+static void
+yadif_band_func (gpointer data, gpointer user_data)
+{
+  YadifBand *band = data;
+  GstYadif *yadif = band->yadif;
+
+  yadif_filter_band (yadif, band->parity, band->tff, band->band,
+      band->n_bands);
+
+  g_mutex_lock (&yadif->band_lock);
+  if (--yadif->bands_pending == 0)
+    g_cond_signal (&yadif->band_cond);
+  g_mutex_unlock (&yadif->band_lock);
+}
+
+/* the rows of the frame are split in n-threads bands that are filtered in
+ * parallel, each output row only depends on input rows so the output is the
+ * same for any number of bands */
+void
+yadif_filter (GstYadif * yadif, int parity, int tff)
+{
+  YadifBand *bands;
+  guint n_threads, n_bands, i;
+
+  n_threads = yadif->n_threads;
+  if (n_threads == 0)
+    n_threads = g_get_num_processors ();
+
+  /* at least 16 rows per band */
+  n_bands = MIN (n_threads, GST_VIDEO_INFO_HEIGHT (&yadif->video_info) / 16);
+  if (n_bands <= 1) {
+    yadif_filter_band (yadif, parity, tff, 0, 1);
+    return;
+  }
+
+  if (!yadif->band_pool) {
+    yadif->band_pool = g_thread_pool_new (yadif_band_func, NULL,
+        n_threads - 1, FALSE, NULL);
+  } else if (g_thread_pool_get_max_threads (yadif->band_pool) !=
+      (gint) n_threads - 1) {
+    g_thread_pool_set_max_threads (yadif->band_pool, n_threads - 1, NULL);
+  }
+
+  bands = g_newa (YadifBand, n_bands);
+  yadif->bands_pending = n_bands - 1;
+  for (i = 0; i < n_bands; i++) {
+    bands[i].yadif = yadif;
+    bands[i].parity = parity;
+    bands[i].tff = tff;
+    bands[i].band = i;
+    bands[i].n_bands = n_bands;
+  }
+
+  /* the first band is done from here while the pool handles the others */
+  for (i = 1; i < n_bands; i++) {
+    if (!g_thread_pool_push (yadif->band_pool, &bands[i], NULL))
+      yadif_band_func (&bands[i], NULL);
+  }
+  yadif_filter_band (yadif, parity, tff, 0, n_bands);
+
+  g_mutex_lock (&yadif->band_lock);
+  while (yadif->bands_pending > 0)
+    g_cond_wait (&yadif->band_cond, &yadif->band_lock);
+  g_mutex_unlock (&yadif->band_lock);
 }
@@ -21,87 +21,129 @@
 #include "config.h"
 
 #include <glib.h>
+#include "gstyadif.h"
+
+#if defined (__SSE2__)
+#include <emmintrin.h>
+
+/* The line filters of yadif_template.c work on vectors of 16 bit lanes, the
+ * vector operations are defined for each instruction set before including
+ * it. Each instruction set gets an 8 bit and a 16 bit line filter */
+
+#define SSE_LOAD8(p) \
+    _mm_unpacklo_epi8 (_mm_loadl_epi64 ((const __m128i *) (p)), \
+        _mm_setzero_si128 ())
+#define SSE_STORE8(p, v) \
+    _mm_storel_epi64 ((__m128i *) (p), _mm_packus_epi16 ((v), (v)))
+#define SSE_LOAD16(p) _mm_loadu_si128 ((const __m128i *) (p))
+#define SSE_STORE16(p, v) _mm_storeu_si128 ((__m128i *) (p), (v))
+
+#define VEC __m128i
+#define STEP 8
+#define V_SET1(a) _mm_set1_epi16 (a)
+#define V_ADD(a, b) _mm_add_epi16 (a, b)
+#define V_SUB(a, b) _mm_sub_epi16 (a, b)
+#define V_SRL1(a) _mm_srli_epi16 (a, 1)
+#define V_MIN(a, b) _mm_min_epi16 (a, b)
+#define V_MAX(a, b) _mm_max_epi16 (a, b)
+#define V_CMPGT(a, b) _mm_cmpgt_epi16 (a, b)
+#define V_AND(a, b) _mm_and_si128 (a, b)
+#define V_BLEND(m, a, b) \
+    _mm_or_si128 (_mm_and_si128 (m, a), _mm_andnot_si128 (m, b))
+#define LOAD8(p) SSE_LOAD8 (p)
+#define STORE8(p, v) SSE_STORE8 (p, v)
+#define LOAD16(p) SSE_LOAD16 (p)
+#define STORE16(p, v) SSE_STORE16 (p, v)
+
+#define V_ABS(a) _mm_max_epi16 (a, _mm_sub_epi16 (_mm_setzero_si128 (), a))
+#define TARGET
+#define RENAME(a) a ## _sse2
+#include "yadif_template.c"
+#undef V_ABS
+#undef TARGET
+#undef RENAME
 
-#if HAVE_CPU_X86_64
-
-typedef struct xmm_reg
-{
-  guint64 a, b;
-} xmm_reg;
-typedef gint64 x86_reg;
-#define DECLARE_ALIGNED(n,t,v)      t __attribute__ ((aligned (n))) v
-#define DECLARE_ASM_CONST(n,t,v)    static const t __attribute__((used)) __attribute__ ((aligned (n))) v
-
-#if defined(__APPLE__)
-#    define EXTERN_PREFIX "_"
-#else
-#    define EXTERN_PREFIX ""
-#endif
-
-#if defined(__PIC__)
-#    define LOCAL_MANGLE(a) #a "(%%rip)"
-#else
-#    define LOCAL_MANGLE(a) #a
-#endif
-
-#define MANGLE(a) EXTERN_PREFIX LOCAL_MANGLE(a)
-
-DECLARE_ASM_CONST (16, xmm_reg, pb_1) = {
-0x0101010101010101ULL, 0x0101010101010101ULL};
-
-DECLARE_ASM_CONST (16, xmm_reg, pw_1) = {
-0x0001000100010001ULL, 0x0001000100010001ULL};
-
-
-#define HAVE_SSE2_INLINE 1
+/* SSSE3 and AVX2 are only used if the CPU running the code supports them */
+#if defined (__clang__) || (defined (__GNUC__) && (__GNUC__ > 4 || \
+    (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#define HAVE_YADIF_AVX2 1
+#include <tmmintrin.h>
+#include <immintrin.h>
 
-#if HAVE_SSSE3_INLINE
-#define COMPILE_TEMPLATE_SSE2 1
-#define COMPILE_TEMPLATE_SSSE3 1
-#undef RENAME
+#define V_ABS(a) _mm_abs_epi16 (a)
+#define TARGET __attribute__ ((target ("ssse3")))
 #define RENAME(a) a ## _ssse3
 #include "yadif_template.c"
-#undef COMPILE_TEMPLATE_SSSE3
-#endif
-
-#if HAVE_SSE2_INLINE
+#undef V_ABS
+#undef TARGET
 #undef RENAME
-#define RENAME(a) a ## _sse2
-#include "yadif_template.c"
-#undef COMPILE_TEMPLATE_SSE2
-#endif
 
-#if HAVE_MMXEXT_INLINE
-#undef RENAME
-#define RENAME(a) a ## _mmxext
+#undef VEC
+#undef STEP
+#undef V_SET1
+#undef V_ADD
+#undef V_SUB
+#undef V_SRL1
+#undef V_MIN
+#undef V_MAX
+#undef V_CMPGT
+#undef V_AND
+#undef V_BLEND
+#undef LOAD8
+#undef STORE8
+#undef LOAD16
+#undef STORE16
+
+/* the bytes of the 16 lanes are packed in each 128 bit half, the permute
+ * puts the two halves of the result next to each other */
+#define AVX2_STORE8(p, v) \
+    _mm_storeu_si128 ((__m128i *) (p), _mm256_castsi256_si128 \
+        (_mm256_permute4x64_epi64 (_mm256_packus_epi16 ((v), (v)), 0xd8)))
+
+#define VEC __m256i
+#define STEP 16
+#define V_SET1(a) _mm256_set1_epi16 (a)
+#define V_ADD(a, b) _mm256_add_epi16 (a, b)
+#define V_SUB(a, b) _mm256_sub_epi16 (a, b)
+#define V_SRL1(a) _mm256_srli_epi16 (a, 1)
+#define V_MIN(a, b) _mm256_min_epi16 (a, b)
+#define V_MAX(a, b) _mm256_max_epi16 (a, b)
+#define V_CMPGT(a, b) _mm256_cmpgt_epi16 (a, b)
+#define V_AND(a, b) _mm256_and_si256 (a, b)
+#define V_BLEND(m, a, b) _mm256_blendv_epi8 (b, a, m)
+#define V_ABS(a) _mm256_abs_epi16 (a)
+#define LOAD8(p) \
+    _mm256_cvtepu8_epi16 (_mm_loadu_si128 ((const __m128i *) (p)))
+#define STORE8(p, v) AVX2_STORE8 (p, v)
+#define LOAD16(p) _mm256_loadu_si256 ((const __m256i *) (p))
+#define STORE16(p, v) _mm256_storeu_si256 ((__m256i *) (p), (v))
+#define TARGET __attribute__ ((target ("avx2")))
+#define RENAME(a) a ## _avx2
 #include "yadif_template.c"
+#undef TARGET
+#undef RENAME
 #endif
 
+void yadif_filter_line_select_x86 (GstYadifFilterLineFunc * filter_line,
+    GstYadifFilterLine16Func * filter_line_16bit);
 
-void filter_line_x86_64 (guint8 * dst,
-    guint8 * prev, guint8 * cur, guint8 * next,
-    int w, int prefs, int mrefs, int parity, int mode);
-
+/* the line filters need at least 16 pixels */
 void
-filter_line_x86_64 (guint8 * dst,
-    guint8 * prev, guint8 * cur, guint8 * next,
-    int w, int prefs, int mrefs, int parity, int mode)
+yadif_filter_line_select_x86 (GstYadifFilterLineFunc * filter_line,
+    GstYadifFilterLine16Func * filter_line_16bit)
 {
-#if 0
-#if HAVE_MMXEXT_INLINE
-  if (cpu_flags & AV_CPU_FLAG_MMXEXT)
-    yadif->filter_line = yadif_filter_line_mmxext;
-#endif
-#if HAVE_SSE2_INLINE
-  if (cpu_flags & AV_CPU_FLAG_SSE2)
-    yadif->filter_line = yadif_filter_line_sse2;
-#endif
-#if HAVE_SSSE3_INLINE
-  if (cpu_flags & AV_CPU_FLAG_SSSE3)
-    yadif->filter_line = yadif_filter_line_ssse3;
-#endif
+  *filter_line = yadif_filter_line_sse2;
+  *filter_line_16bit = yadif_filter_line_16bit_sse2;
+#ifdef HAVE_YADIF_AVX2
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("avx2")) {
+    *filter_line = yadif_filter_line_avx2;
+    *filter_line_16bit = yadif_filter_line_16bit_avx2;
+  } else if (__builtin_cpu_supports ("ssse3")) {
+    *filter_line = yadif_filter_line_ssse3;
+    *filter_line_16bit = yadif_filter_line_16bit_ssse3;
+  }
 #endif
-  yadif_filter_line_sse2 (dst, prev, cur, next, w, prefs, mrefs, parity, mode);
 }
 
 #endif
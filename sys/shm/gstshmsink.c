@@ -31,6 +31,11 @@
  * ! shmsink socket-path=/tmp/blah shm-size=2000000
  * ]| Send video to shm buffers.
  *
+ * With #GstShmSink:ring-size, the buffers are handed over to the readers
+ * through a ring in shared memory instead of one message per buffer on the
+ * control socket, which lowers the per-buffer cost for high frame rates or
+ * large frames. This needs a shmsrc that supports it.
+ *
  */
 #ifdef HAVE_CONFIG_H
 #include "config.h"
@@ -58,7 +63,9 @@ enum
   PROP_PERMS,
   PROP_SHM_SIZE,
   PROP_WAIT_FOR_CONNECTION,
-  PROP_BUFFER_TIME
+  PROP_BUFFER_TIME,
+  PROP_RING_SIZE,
+  PROP_SLOT_SIZE
 };
 
 struct GstShmClient
@@ -69,6 +76,8 @@ struct GstShmClient
 
 #define DEFAULT_SIZE ( 64 * 1024 * 1024 )
 #define DEFAULT_WAIT_FOR_CONNECTION (TRUE)
+#define DEFAULT_RING_SIZE 0
+#define DEFAULT_SLOT_SIZE 0
 /* Default is user read/write, group read */
 #define DEFAULT_PERMS ( S_IRUSR | S_IWUSR | S_IRGRP )
 
@@ -351,6 +360,8 @@ gst_shm_sink_init (GstShmSink * self)
   self->size = DEFAULT_SIZE;
   self->wait_for_connection = DEFAULT_WAIT_FOR_CONNECTION;
   self->perms = DEFAULT_PERMS;
+  self->ring_size = DEFAULT_RING_SIZE;
+  self->slot_size = DEFAULT_SLOT_SIZE;
 
   gst_allocation_params_init (&self->params);
 }
@@ -413,6 +424,26 @@ gst_shm_sink_class_init (GstShmSinkClass * klass)
           -1, G_MAXINT64, -1,
           G_PARAM_CONSTRUCT | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_RING_SIZE,
+      g_param_spec_uint ("ring-size",
+          "Size of the ring of the clients",
+          "Number of buffers that can be pending for each client in ring "
+          "mode, where the buffers are handed over in shared memory and "
+          "acknowledged in batches (0 to send them over the control socket). "
+          "Must be a power of 2. Applies to the clients that connect "
+          "afterwards",
+          0, G_MAXUINT16, DEFAULT_RING_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_SLOT_SIZE,
+      g_param_spec_uint ("slot-size",
+          "Allocation granularity of the shm area",
+          "Round the size of the blocks allocated in the shm area up to a "
+          "multiple of this, to avoid fragmenting it when the buffers have "
+          "about the same size (0 to disable)",
+          0, G_MAXUINT, DEFAULT_SLOT_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   signals[SIGNAL_CLIENT_CONNECTED] = g_signal_new ("client-connected",
       GST_TYPE_SHM_SINK, G_SIGNAL_RUN_LAST, 0, NULL, NULL,
       g_cclosure_marshal_VOID__INT, G_TYPE_NONE, 1, G_TYPE_INT);
@@ -501,6 +532,30 @@ gst_shm_sink_set_property (GObject * object, guint prop_id,
       GST_OBJECT_UNLOCK (object);
       g_cond_broadcast (&self->cond);
       break;
+    case PROP_RING_SIZE:
+    {
+      guint ring_size = g_value_get_uint (value);
+
+      /* the ring is indexed with a mask of the wrapping slot counters */
+      if (ring_size & (ring_size - 1)) {
+        GST_WARNING_OBJECT (self, "Ignoring ring size %u, not a power of 2",
+            ring_size);
+        break;
+      }
+      GST_OBJECT_LOCK (object);
+      self->ring_size = ring_size;
+      if (self->pipe)
+        sp_writer_set_ring_size (self->pipe, self->ring_size);
+      GST_OBJECT_UNLOCK (object);
+      break;
+    }
+    case PROP_SLOT_SIZE:
+      GST_OBJECT_LOCK (object);
+      self->slot_size = g_value_get_uint (value);
+      if (self->pipe)
+        sp_writer_set_slot_size (self->pipe, self->slot_size);
+      GST_OBJECT_UNLOCK (object);
+      break;
     default:
       break;
   }
@@ -530,6 +585,12 @@ gst_shm_sink_get_property (GObject * object, guint prop_id,
     case PROP_BUFFER_TIME:
       g_value_set_int64 (value, self->buffer_time);
       break;
+    case PROP_RING_SIZE:
+      g_value_set_uint (value, self->ring_size);
+      break;
+    case PROP_SLOT_SIZE:
+      g_value_set_uint (value, self->slot_size);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -566,6 +627,10 @@ gst_shm_sink_start (GstBaseSink * bsink)
   }
 
   sp_set_data (self->pipe, self);
+  GST_OBJECT_LOCK (self);
+  sp_writer_set_ring_size (self->pipe, self->ring_size);
+  sp_writer_set_slot_size (self->pipe, self->slot_size);
+  GST_OBJECT_UNLOCK (self);
   g_free (self->socket_path);
   self->socket_path = g_strdup (sp_writer_get_path (self->pipe));
 
@@ -641,6 +706,10 @@ gst_shm_sink_can_render (GstShmSink * self, GstClockTime time)
 {
   ShmBuffer *b;
 
+  /* wait for a free slot in the ring of all the clients */
+  if (!sp_writer_can_send (self->pipe))
+    return FALSE;
+
   if (time == GST_CLOCK_TIME_NONE || self->buffer_time == GST_CLOCK_TIME_NONE)
     return TRUE;
 
@@ -858,22 +927,20 @@ pollthread_func (gpointer data)
 
       if (gst_poll_fd_can_read (self->poll, &gclient->pollfd)) {
         int rv;
-        gpointer tag = NULL;
+        GSList *list = NULL;
 
+        /* in ring mode, a single read can release several buffers */
         GST_OBJECT_LOCK (self);
-        rv = sp_writer_recv (self->pipe, gclient->client, &tag);
+        rv = sp_writer_recv_buffers (self->pipe, gclient->client,
+            (sp_buffer_free_callback) free_buffer_locked, (void **) &list);
         GST_OBJECT_UNLOCK (self);
+        g_slist_free_full (list, (GDestroyNotify) gst_buffer_unref);
 
         if (rv < 0) {
           GST_WARNING_OBJECT (self, "One client has read error,"
               " closing (retval: %d errno: %d)", rv, errno);
           goto close_client;
         }
-
-        g_assert (rv == 0 || tag == NULL);
-
-        if (rv == 0)
-          gst_buffer_unref (tag);
       }
       continue;
     close_client:
@@ -63,6 +63,8 @@ struct _GstShmSink
   gboolean stop;
   gboolean unlock;
   GstClockTimeDiff buffer_time;
+  guint ring_size;
+  guint slot_size;
 
   GCond cond;
 
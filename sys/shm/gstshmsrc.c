@@ -327,40 +327,56 @@ gst_shm_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
   struct GstShmBuffer *gsb;
 
   do {
-    if (gst_poll_wait (self->poll, GST_CLOCK_TIME_NONE) < 0) {
-      if (errno == EBUSY)
-        return GST_FLOW_FLUSHING;
-      GST_ELEMENT_ERROR (self, RESOURCE, READ, ("Failed to read from shmsrc"),
-          ("Poll failed on fd: %s", strerror (errno)));
+    /* in ring mode there might be buffers to read without waiting */
+    GST_OBJECT_LOCK (self);
+    rv = sp_client_prepare_wait (self->pipe->pipe);
+    GST_OBJECT_UNLOCK (self);
+    if (rv < 0) {
+      GST_ELEMENT_ERROR (self, RESOURCE, WRITE, ("Failed to write to shmsrc"),
+          ("Could not acknowledge buffers: %s", strerror (errno)));
       return GST_FLOW_ERROR;
     }
 
-    if (self->unlocked)
-      return GST_FLOW_FLUSHING;
+    if (rv > 0) {
+      if (gst_poll_wait (self->poll, GST_CLOCK_TIME_NONE) < 0) {
+        if (errno == EBUSY)
+          return GST_FLOW_FLUSHING;
+        GST_ELEMENT_ERROR (self, RESOURCE, READ,
+            ("Failed to read from shmsrc"), ("Poll failed on fd: %s",
+                strerror (errno)));
+        return GST_FLOW_ERROR;
+      }
 
-    if (gst_poll_fd_has_closed (self->poll, &self->pollfd)) {
-      GST_ELEMENT_ERROR (self, RESOURCE, READ, ("Failed to read from shmsrc"),
-          ("Control socket has closed"));
-      return GST_FLOW_ERROR;
-    }
+      if (self->unlocked)
+        return GST_FLOW_FLUSHING;
 
-    if (gst_poll_fd_has_error (self->poll, &self->pollfd)) {
-      GST_ELEMENT_ERROR (self, RESOURCE, READ, ("Failed to read from shmsrc"),
-          ("Control socket has error"));
-      return GST_FLOW_ERROR;
-    }
+      if (gst_poll_fd_has_closed (self->poll, &self->pollfd)) {
+        GST_ELEMENT_ERROR (self, RESOURCE, READ,
+            ("Failed to read from shmsrc"), ("Control socket has closed"));
+        return GST_FLOW_ERROR;
+      }
 
-    if (gst_poll_fd_can_read (self->poll, &self->pollfd)) {
-      buf = NULL;
-      GST_LOG_OBJECT (self, "Reading from pipe");
-      GST_OBJECT_LOCK (self);
-      rv = sp_client_recv (self->pipe->pipe, &buf);
-      GST_OBJECT_UNLOCK (self);
-      if (rv < 0) {
-        GST_ELEMENT_ERROR (self, RESOURCE, READ, ("Failed to read from shmsrc"),
-            ("Error reading control data: %d", rv));
+      if (gst_poll_fd_has_error (self->poll, &self->pollfd)) {
+        GST_ELEMENT_ERROR (self, RESOURCE, READ,
+            ("Failed to read from shmsrc"), ("Control socket has error"));
         return GST_FLOW_ERROR;
       }
+
+      if (!gst_poll_fd_can_read (self->poll, &self->pollfd))
+        continue;
+    } else if (self->unlocked) {
+      return GST_FLOW_FLUSHING;
+    }
+
+    buf = NULL;
+    GST_LOG_OBJECT (self, "Reading from pipe");
+    GST_OBJECT_LOCK (self);
+    rv = sp_client_recv (self->pipe->pipe, &buf);
+    GST_OBJECT_UNLOCK (self);
+    if (rv < 0) {
+      GST_ELEMENT_ERROR (self, RESOURCE, READ, ("Failed to read from shmsrc"),
+          ("Error reading control data: %d", rv));
+      return GST_FLOW_ERROR;
     }
   } while (buf == NULL);
 
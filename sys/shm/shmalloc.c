@@ -39,6 +39,9 @@ struct _ShmAllocSpace
   /* The total size of this space */
   size_t size;
 
+  /* If not 0, the size and offset of all the blocks are multiples of this */
+  unsigned long slot_size;
+
   /* chained list of the blocks contained in this space */
   ShmAllocBlock *blocks;
 };
@@ -81,6 +84,15 @@ shm_alloc_space_free (ShmAllocSpace * self)
 }
 
 
+/* With a slot size, blocks of about the same size (video frames for example)
+ * all take the same number of slots, so that a freed block always leaves a
+ * hole big enough for the next one instead of fragmenting the space. */
+void
+shm_alloc_space_set_slot_size (ShmAllocSpace * self, unsigned long slot_size)
+{
+  self->slot_size = slot_size;
+}
+
 ShmAllocBlock *
 shm_alloc_space_alloc_block (ShmAllocSpace * self, unsigned long size)
 {
@@ -89,6 +101,8 @@ shm_alloc_space_alloc_block (ShmAllocSpace * self, unsigned long size)
   ShmAllocBlock *prev_item = NULL;
   unsigned long prev_end_offset = 0;
 
+  if (self->slot_size > 1)
+    size = (size + self->slot_size - 1) / self->slot_size * self->slot_size;
 
   for (item = self->blocks; item; item = item->next) {
     unsigned long max_size = 0;
@@ -56,6 +56,9 @@ typedef struct _ShmAllocBlock ShmAllocBlock;
 ShmAllocSpace *shm_alloc_space_new (size_t size);
 void shm_alloc_space_free (ShmAllocSpace * self);
 
+void shm_alloc_space_set_slot_size (ShmAllocSpace * self,
+    unsigned long slot_size);
+
 
 ShmAllocBlock *shm_alloc_space_alloc_block (ShmAllocSpace * self,
     unsigned long size);
@@ -67,9 +67,31 @@
  * type 4: ack buffer
  * offset
  *
- * Type 4 goes from the client to the server
+ * type 5: new ring area
+ * Area length
+ * Size of path (followed by path)
+ *
+ * type 6: ring wake up
+ * No payload
+ *
+ * type 7: ack buffers
+ * Number of buffers (followed by an area id and an offset for each)
+ * Position of the client in the ring
+ * Whether the client is about to wait for a wake up
+ *
+ * Types 4 and 7 go from the client to the server
  * The rest are from the server to the client
  * The client should never write in the SHM
+ *
+ * In ring mode (types 5 to 7), the buffers are not announced with type 3
+ * commands. The server writes them in a ring of slots in a shm area of
+ * their own for each client, then publishes them by incrementing the head
+ * of the ring. The client reads the slots up to the head without any
+ * system call, acknowledges the buffers it is done with in batches and
+ * only asks to be woken up, with its position in the ring, when it has
+ * nothing left to read. The server never has more buffers pending for a
+ * client than there are slots, so it never overwrites a slot that was
+ * not read yet.
  */
 
 
@@ -80,9 +102,39 @@ enum
   COMMAND_NEW_SHM_AREA = 1,
   COMMAND_CLOSE_SHM_AREA = 2,
   COMMAND_NEW_BUFFER = 3,
-  COMMAND_ACK_BUFFER = 4
+  COMMAND_ACK_BUFFER = 4,
+  COMMAND_NEW_RING = 5,
+  COMMAND_RING_WAKE = 6,
+  COMMAND_ACK_BUFFERS = 7
 };
 
+/* Maximum number of buffers acknowledged by a type 7 command */
+#define ACK_BATCH 16
+
+typedef struct
+{
+  int area_id;
+  unsigned long offset;
+} ShmAck;
+
+typedef struct
+{
+  int area_id;
+  unsigned long offset;
+  unsigned long size;
+} ShmRingSlot;
+
+/* Lives at the start of the ring area */
+typedef struct
+{
+  /* A power of 2, so that the slot of a counter stays the same when the
+   * counter wraps around */
+  unsigned int n_slots;
+  /* Number of slots published so far, only written by the server */
+  unsigned int head;
+  ShmRingSlot slots[0];
+} ShmRingHeader;
+
 typedef struct _ShmArea ShmArea;
 
 struct _ShmArea
@@ -141,12 +193,32 @@ struct _ShmPipe
   ShmClient *clients;
 
   mode_t perms;
+
+  /* Writer side: size of the rings of the new clients (0 to not use rings)
+   * and allocation granularity */
+  unsigned int ring_size;
+  unsigned long slot_size;
+
+  /* Reader side: ring announced by the writer, if any */
+  ShmArea *ring;
+  unsigned int ring_read;
+  ShmAck acks[ACK_BATCH];
+  unsigned int n_acks;
+  /* Whether the reader asked to be woken up and didn't read since */
+  int waiting;
 };
 
 struct _ShmClient
 {
   int fd;
 
+  /* Ring of the client in ring mode, NULL otherwise */
+  ShmArea *ring;
+  /* Buffers sent to the client and not acknowledged yet */
+  unsigned int unacked;
+  /* Whether the client waits for a wake up */
+  int waiting;
+
   ShmClient *next;
 };
 
@@ -179,6 +251,13 @@ struct CommandBuffer
     {
       unsigned long offset;
     } ack_buffer;
+    struct
+    {
+      unsigned int count;
+      unsigned int read_pos;
+      int waiting;
+      /* Followed by count ShmAck */
+    } ack_buffers;
   } payload;
 };
 
@@ -186,6 +265,8 @@ static ShmArea *sp_open_shm (char *path, int id, mode_t perms, size_t size);
 static void sp_close_shm (ShmArea * area);
 static int sp_shmbuf_dec (ShmPipe * self, ShmBuffer * buf,
     ShmBuffer * prev_buf, ShmClient * client, void **tag);
+static int sp_writer_ring_push (ShmClient * client, int area_id,
+    unsigned long offset, unsigned long size);
 static void sp_shm_area_dec (ShmPipe * self, ShmArea * area);
 
 
@@ -426,6 +507,11 @@ sp_dec (ShmPipe * self)
   while (self->shm_area)
     sp_shm_area_dec (self, self->shm_area);
 
+  if (self->ring) {
+    self->ring->use_count--;
+    sp_close_shm (self->ring);
+  }
+
   spalloc_free (ShmPipe, self);
 }
 
@@ -461,10 +547,15 @@ sp_writer_setperms_shm (ShmPipe * self, mode_t perms)
 {
   int ret = 0;
   ShmArea *area;
+  ShmClient *client;
 
   self->perms = perms;
   for (area = self->shm_area; area; area = area->next)
     ret |= fchmod (area->shm_fd, perms);
+  for (client = self->clients; client; client = client->next) {
+    if (client->ring)
+      ret |= fchmod (client->ring->shm_fd, perms);
+  }
 
   ret |= chmod (self->socket_path, perms);
 
@@ -502,6 +593,9 @@ sp_writer_resize (ShmPipe * self, size_t size)
   if (!newarea)
     return -1;
 
+  if (self->slot_size)
+    shm_alloc_space_set_slot_size (newarea->allocspace, self->slot_size);
+
   old_current = self->shm_area;
   newarea->next = self->shm_area;
   self->shm_area = newarea;
@@ -573,6 +667,74 @@ sp_writer_free_block (ShmBlock * block)
   spalloc_free (ShmBlock, block);
 }
 
+/* Returns 0 if @n_slots is not 0 or a power of 2 */
+int
+sp_writer_set_ring_size (ShmPipe * self, unsigned int n_slots)
+{
+  if (n_slots & (n_slots - 1))
+    return 0;
+
+  self->ring_size = n_slots;
+  return 1;
+}
+
+void
+sp_writer_set_slot_size (ShmPipe * self, size_t slot_size)
+{
+  ShmArea *area;
+
+  self->slot_size = slot_size;
+  for (area = self->shm_area; area; area = area->next)
+    shm_alloc_space_set_slot_size (area->allocspace, slot_size);
+}
+
+/* Returns 0 if a buffer can't be sent to one of the clients because all
+ * the slots of its ring are in use */
+int
+sp_writer_can_send (ShmPipe * self)
+{
+  ShmClient *client;
+
+  for (client = self->clients; client; client = client->next) {
+    if (client->ring &&
+        client->unacked >= ((ShmRingHeader *) client->ring->shm_area_buf)->
+        n_slots)
+      return 0;
+  }
+
+  return 1;
+}
+
+static int
+sp_writer_ring_push (ShmClient * client, int area_id, unsigned long offset,
+    unsigned long size)
+{
+  ShmRingHeader *ring = (ShmRingHeader *) client->ring->shm_area_buf;
+  ShmRingSlot *slot;
+  unsigned int head = ring->head;
+
+  /* all the slots might still be in use */
+  if (client->unacked >= ring->n_slots)
+    return 0;
+
+  slot = &ring->slots[head & (ring->n_slots - 1)];
+  slot->area_id = area_id;
+  slot->offset = offset;
+  slot->size = size;
+  __atomic_store_n (&ring->head, head + 1, __ATOMIC_RELEASE);
+
+  if (client->waiting) {
+    struct CommandBuffer cb = { 0 };
+
+    /* if this fails, the client is gone and the buffer gets released when
+     * closing it */
+    send_command (client->fd, &cb, COMMAND_RING_WAKE, 0);
+    client->waiting = 0;
+  }
+
+  return 1;
+}
+
 /* Returns the number of client this has successfully been sent to */
 
 int
@@ -614,12 +776,19 @@ sp_writer_send_buf (ShmPipe * self, char *buf, size_t size, void *tag)
   sb->tag = tag;
 
   for (client = self->clients; client; client = client->next) {
-    struct CommandBuffer cb = { 0 };
-    cb.payload.buffer.offset = offset;
-    cb.payload.buffer.size = bsize;
-    if (!send_command (client->fd, &cb, COMMAND_NEW_BUFFER, self->shm_area->id))
-      continue;
+    if (client->ring) {
+      if (!sp_writer_ring_push (client, area->id, offset, bsize))
+        continue;
+    } else {
+      struct CommandBuffer cb = { 0 };
+      cb.payload.buffer.offset = offset;
+      cb.payload.buffer.size = bsize;
+      if (!send_command (client->fd, &cb, COMMAND_NEW_BUFFER,
+              self->shm_area->id))
+        continue;
+    }
     sb->clients[i++] = client->fd;
+    client->unacked++;
     c++;
   }
 
@@ -652,43 +821,172 @@ recv_command (int fd, struct CommandBuffer *cb)
   }
 }
 
+static long int
+sp_client_recv_area (ShmPipe * self, struct CommandBuffer *cb,
+    ShmArea ** newarea)
+{
+  char *area_name = NULL;
+  int retval;
+
+  assert (cb->payload.new_shm_area.path_size > 0);
+  assert (cb->payload.new_shm_area.size > 0);
+
+  area_name = malloc (cb->payload.new_shm_area.path_size + 1);
+  retval = recv (self->main_socket, area_name,
+      cb->payload.new_shm_area.path_size, 0);
+  if (retval != cb->payload.new_shm_area.path_size) {
+    free (area_name);
+    return -3;
+  }
+  /* Ensure area_name is NULL terminated */
+  area_name[retval] = 0;
+
+  *newarea = sp_open_shm (area_name, cb->area_id, 0,
+      cb->payload.new_shm_area.size);
+  free (area_name);
+  if (!*newarea)
+    return -4;
+
+  return 0;
+}
+
+/* Returns the size of the next buffer of the ring, or 0 if there is none
+ * or if its area was not announced yet */
+static long int
+sp_client_ring_pop (ShmPipe * self, char **buf)
+{
+  ShmRingHeader *ring = (ShmRingHeader *) self->ring->shm_area_buf;
+  ShmRingSlot *slot;
+  ShmArea *area;
+
+  if (__atomic_load_n (&ring->head, __ATOMIC_ACQUIRE) == self->ring_read)
+    return 0;
+
+  slot = &ring->slots[self->ring_read & (ring->n_slots - 1)];
+  for (area = self->shm_area; area; area = area->next) {
+    if (area->id == slot->area_id)
+      break;
+  }
+  if (!area)
+    return 0;
+
+  if (slot->offset + slot->size > area->shm_area_len)
+    return -5;
+
+  self->ring_read++;
+  *buf = area->shm_area_buf + slot->offset;
+  sp_shm_area_inc (area);
+  return slot->size;
+}
+
+static int
+sp_client_send_acks (ShmPipe * self, int waiting)
+{
+  struct
+  {
+    struct CommandBuffer cb;
+    ShmAck acks[ACK_BATCH];
+  } msg;
+  size_t size;
+
+  memset (&msg.cb, 0, sizeof (struct CommandBuffer));
+  msg.cb.type = COMMAND_ACK_BUFFERS;
+  msg.cb.payload.ack_buffers.count = self->n_acks;
+  msg.cb.payload.ack_buffers.read_pos = self->ring_read;
+  msg.cb.payload.ack_buffers.waiting = waiting;
+  memcpy (msg.acks, self->acks, sizeof (ShmAck) * self->n_acks);
+
+  size = sizeof (struct CommandBuffer) + sizeof (ShmAck) * self->n_acks;
+  if (send (self->main_socket, &msg, size, MSG_NOSIGNAL) != size)
+    return 0;
+
+  self->n_acks = 0;
+  return 1;
+}
+
+/* Returns 1 if the caller should wait for the fd to be readable before
+ * calling sp_client_recv(), 0 if there is already a buffer to read and a
+ * negative number on error */
+int
+sp_client_prepare_wait (ShmPipe * self)
+{
+  ShmRingHeader *ring;
+
+  if (!self->ring)
+    return 1;
+
+  ring = (ShmRingHeader *) self->ring->shm_area_buf;
+  if (__atomic_load_n (&ring->head, __ATOMIC_ACQUIRE) != self->ring_read)
+    return 0;
+
+  /* flush the acks and ask to be woken up */
+  if (!sp_client_send_acks (self, 1))
+    return -1;
+
+  /* the server might have published a buffer before getting our request */
+  if (__atomic_load_n (&ring->head, __ATOMIC_ACQUIRE) != self->ring_read)
+    return 0;
+
+  self->waiting = 1;
+  return 1;
+}
+
 long int
 sp_client_recv (ShmPipe * self, char **buf)
 {
-  char *area_name = NULL;
   ShmArea *newarea;
   ShmArea *area;
   struct CommandBuffer cb;
-  int retval;
+  long int retval;
+
+  if (self->ring) {
+    self->waiting = 0;
+    retval = sp_client_ring_pop (self, buf);
+    if (retval != 0)
+      return retval;
+  }
 
   if (!recv_command (self->main_socket, &cb))
     return -1;
 
   switch (cb.type) {
     case COMMAND_NEW_SHM_AREA:
-      assert (cb.payload.new_shm_area.path_size > 0);
-      assert (cb.payload.new_shm_area.size > 0);
-
-      area_name = malloc (cb.payload.new_shm_area.path_size + 1);
-      retval = recv (self->main_socket, area_name,
-          cb.payload.new_shm_area.path_size, 0);
-      if (retval != cb.payload.new_shm_area.path_size) {
-        free (area_name);
-        return -3;
-      }
-      /* Ensure area_name is NULL terminated */
-      area_name[retval] = 0;
-
-      newarea = sp_open_shm (area_name, cb.area_id, 0,
-          cb.payload.new_shm_area.size);
-      free (area_name);
-      if (!newarea)
-        return -4;
+      retval = sp_client_recv_area (self, &cb, &newarea);
+      if (retval < 0)
+        return retval;
 
       newarea->next = self->shm_area;
       self->shm_area = newarea;
       break;
 
+    case COMMAND_NEW_RING:
+      retval = sp_client_recv_area (self, &cb, &newarea);
+      if (retval < 0)
+        return retval;
+
+      if (newarea->shm_area_len < sizeof (ShmRingHeader) ||
+          ((ShmRingHeader *) newarea->shm_area_buf)->n_slots == 0 ||
+          (((ShmRingHeader *) newarea->shm_area_buf)->n_slots &
+              (((ShmRingHeader *) newarea->shm_area_buf)->n_slots - 1)) ||
+          newarea->shm_area_len < sizeof (ShmRingHeader) +
+          sizeof (ShmRingSlot) *
+          ((ShmRingHeader *) newarea->shm_area_buf)->n_slots) {
+        newarea->use_count--;
+        sp_close_shm (newarea);
+        return -6;
+      }
+
+      if (self->ring) {
+        self->ring->use_count--;
+        sp_close_shm (self->ring);
+      }
+      self->ring = newarea;
+      self->ring_read = 0;
+      break;
+
+    case COMMAND_RING_WAKE:
+      break;
+
     case COMMAND_CLOSE_SHM_AREA:
       for (area = self->shm_area; area; area = area->next) {
         if (area->id == cb.area_id) {
@@ -744,6 +1042,79 @@ sp_writer_recv (ShmPipe * self, ShmClient * client, void **tag)
   return 0;
 }
 
+static int
+sp_writer_ack (ShmPipe * self, ShmClient * client, int area_id,
+    unsigned long offset, sp_buffer_free_callback callback, void *user_data)
+{
+  ShmBuffer *buf = NULL, *prev_buf = NULL;
+  void *tag = NULL;
+
+  for (buf = self->buffers; buf; buf = buf->next) {
+    if (buf->shm_area->id == area_id && buf->offset == offset) {
+      if (sp_shmbuf_dec (self, buf, prev_buf, client, &tag) == 0 && callback)
+        callback (tag, user_data);
+      return 0;
+    }
+    prev_buf = buf;
+  }
+
+  return -2;
+}
+
+/* Like sp_writer_recv(), but also handles the batched acks of the clients
+ * in ring mode, @callback is called with the tag of each released buffer */
+int
+sp_writer_recv_buffers (ShmPipe * self, ShmClient * client,
+    sp_buffer_free_callback callback, void *user_data)
+{
+  struct CommandBuffer cb;
+  ShmAck acks[ACK_BATCH];
+  unsigned int i, count;
+  int ret;
+
+  if (!recv_command (client->fd, &cb))
+    return -1;
+
+  switch (cb.type) {
+    case COMMAND_ACK_BUFFER:
+      return sp_writer_ack (self, client, cb.area_id,
+          cb.payload.ack_buffer.offset, callback, user_data);
+
+    case COMMAND_ACK_BUFFERS:
+      count = cb.payload.ack_buffers.count;
+      if (count > ACK_BATCH || !client->ring)
+        return -3;
+
+      if (count > 0 && recv (client->fd, acks, sizeof (ShmAck) * count,
+              MSG_WAITALL) != sizeof (ShmAck) * count)
+        return -1;
+
+      for (i = 0; i < count; i++) {
+        ret = sp_writer_ack (self, client, acks[i].area_id, acks[i].offset,
+            callback, user_data);
+        if (ret < 0)
+          return ret;
+      }
+
+      if (cb.payload.ack_buffers.waiting) {
+        ShmRingHeader *ring = (ShmRingHeader *) client->ring->shm_area_buf;
+
+        if (ring->head != cb.payload.ack_buffers.read_pos) {
+          struct CommandBuffer wake = { 0 };
+
+          if (!send_command (client->fd, &wake, COMMAND_RING_WAKE, 0))
+            return -1;
+        } else {
+          client->waiting = 1;
+        }
+      }
+      return 0;
+
+    default:
+      return -99;
+  }
+}
+
 int
 sp_client_recv_finish (ShmPipe * self, char *buf)
 {
@@ -761,6 +1132,18 @@ sp_client_recv_finish (ShmPipe * self, char *buf)
 
   offset = buf - shm_area->shm_area_buf;
 
+  if (self->ring) {
+    self->acks[self->n_acks].area_id = shm_area->id;
+    self->acks[self->n_acks].offset = offset;
+    self->n_acks++;
+    sp_shm_area_dec (self, shm_area);
+
+    /* while the reader waits, the server might be waiting for this ack */
+    if (self->n_acks < ACK_BATCH && !self->waiting)
+      return 1;
+    return sp_client_send_acks (self, self->waiting);
+  }
+
   sp_shm_area_dec (self, shm_area);
 
   cb.payload.ack_buffer.offset = offset;
@@ -805,6 +1188,38 @@ error:
 }
 
 
+static int
+sp_writer_open_ring (ShmPipe * self, ShmClient * client)
+{
+  struct CommandBuffer cb = { 0 };
+  ShmRingHeader *ring;
+  int pathlen;
+
+  client->ring = sp_open_shm (NULL, ++self->next_area_id, self->perms,
+      sizeof (ShmRingHeader) + sizeof (ShmRingSlot) * self->ring_size);
+  if (!client->ring)
+    return 0;
+
+  ring = (ShmRingHeader *) client->ring->shm_area_buf;
+  ring->n_slots = self->ring_size;
+  ring->head = 0;
+
+  pathlen = strlen (client->ring->shm_area_name) + 1;
+  cb.payload.new_shm_area.size = client->ring->shm_area_len;
+  cb.payload.new_shm_area.path_size = pathlen;
+  if (!send_command (client->fd, &cb, COMMAND_NEW_RING, client->ring->id) ||
+      send (client->fd, client->ring->shm_area_name, pathlen, MSG_NOSIGNAL) !=
+      pathlen) {
+    fprintf (stderr, "Sending ring area failed: %s", strerror (errno));
+    client->ring->use_count--;
+    sp_close_shm (client->ring);
+    client->ring = NULL;
+    return 0;
+  }
+
+  return 1;
+}
+
 ShmClient *
 sp_writer_accept_client (ShmPipe * self)
 {
@@ -835,8 +1250,14 @@ sp_writer_accept_client (ShmPipe * self)
   }
 
   client = spalloc_new (ShmClient);
+  memset (client, 0, sizeof (ShmClient));
   client->fd = fd;
 
+  if (self->ring_size > 0 && !sp_writer_open_ring (self, client)) {
+    spalloc_free (ShmClient, client);
+    goto error;
+  }
+
   /* Prepend ot linked list */
   client->next = self->clients;
   self->clients = client;
@@ -873,6 +1294,7 @@ sp_shmbuf_dec (ShmPipe * self, ShmBuffer * buf, ShmBuffer * prev_buf,
   assert (had_client);
 
   buf->use_count--;
+  client->unacked--;
 
   if (buf->use_count == 0) {
     /* Remove from linked list */
@@ -933,6 +1355,11 @@ again:
 
   self->num_clients--;
 
+  if (client->ring) {
+    client->ring->use_count--;
+    sp_close_shm (client->ring);
+  }
+
   spalloc_free (ShmClient, client);
 }
 
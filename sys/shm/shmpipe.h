@@ -56,6 +56,15 @@
  * buffers are no longer valid. If was valid buffer was received, the
  * client must release it with sp_client_recv_finish() when it is done
  * reading from it.
+ *
+ * In ring mode, enabled on the writer with sp_writer_set_ring_size()
+ * before the clients connect, with a power of 2 number of slots, the
+ * buffers are handed over through a ring in shared memory instead of one
+ * message per buffer, and the acks are sent in batches. The writer must
+ * then check sp_writer_can_send() before sending a buffer and read from
+ * the clients with sp_writer_recv_buffers(). The reader must call
+ * sp_client_prepare_wait() before each select() and call sp_client_recv()
+ * right away if it returns 0.
  */
 
 
@@ -89,6 +98,8 @@ void sp_set_data (ShmPipe * self, void *data);
 
 int sp_writer_setperms_shm (ShmPipe * self, mode_t perms);
 int sp_writer_resize (ShmPipe * self, size_t size);
+int sp_writer_set_ring_size (ShmPipe * self, unsigned int n_slots);
+void sp_writer_set_slot_size (ShmPipe * self, size_t slot_size);
 
 int sp_get_fd (ShmPipe * self);
 const char *sp_get_shm_area_name (ShmPipe *self);
@@ -97,6 +108,7 @@ int sp_writer_get_client_fd (ShmClient * client);
 ShmBlock *sp_writer_alloc_block (ShmPipe * self, size_t size);
 void sp_writer_free_block (ShmBlock *block);
 int sp_writer_send_buf (ShmPipe * self, char *buf, size_t size, void * tag);
+int sp_writer_can_send (ShmPipe * self);
 char *sp_writer_block_get_buf (ShmBlock *block);
 ShmPipe *sp_writer_block_get_pipe (ShmBlock *block);
 size_t sp_writer_get_max_buf_size (ShmPipe * self);
@@ -105,6 +117,8 @@ ShmClient * sp_writer_accept_client (ShmPipe * self);
 void sp_writer_close_client (ShmPipe *self, ShmClient * client,
     sp_buffer_free_callback callback, void * user_data);
 int sp_writer_recv (ShmPipe * self, ShmClient * client, void ** tag);
+int sp_writer_recv_buffers (ShmPipe * self, ShmClient * client,
+    sp_buffer_free_callback callback, void * user_data);
 
 int sp_writer_pending_writes (ShmPipe * self);
 
@@ -113,6 +127,7 @@ ShmBuffer *sp_writer_get_next_buffer (ShmBuffer * buffer);
 void *sp_writer_buf_get_tag (ShmBuffer * buffer);
 
 ShmPipe *sp_client_open (const char *path);
+int sp_client_prepare_wait (ShmPipe * self);
 long int sp_client_recv (ShmPipe * self, char **buf);
 int sp_client_recv_finish (ShmPipe * self, char *buf);
 void sp_client_close (ShmPipe * self);
@@ -0,0 +1,118 @@
+/* GStreamer
+ *
+ * audiomixer.c: benchmark mixing many audio inputs
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Mixes an increasing number of 48kHz stereo inputs with small buffers as
+ * fast as possible and reports how many seconds of audio are mixed per
+ * second. Every other input is mixed with a volume other than 1.0. The time
+ * includes generating the silent inputs.
+ *
+ * Usage: audiomixer [n-seconds] [format]
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <gst/gst.h>
+
+#define RATE 48000
+
+static gdouble
+run_audiomixer (guint n_seconds, const gchar * format, guint n_inputs,
+    guint buffer_ms)
+{
+  GstElement *pipeline;
+  GstMessage *msg;
+  GstBus *bus;
+  GString *desc;
+  GstClockTime start, elapsed;
+  guint i, samples_per_buffer;
+
+  samples_per_buffer = RATE * buffer_ms / 1000;
+
+  desc = g_string_new (NULL);
+  g_string_append_printf (desc, "audiomixer name=mix "
+      "output-buffer-duration=%" G_GUINT64_FORMAT " ! "
+      "audio/x-raw,format=%s,rate=%u,channels=2 ! fakesink sync=false ",
+      (guint64) buffer_ms * GST_MSECOND, format, RATE);
+  for (i = 0; i < n_inputs; i++) {
+    g_string_append_printf (desc, "audiotestsrc wave=silence "
+        "samplesperbuffer=%u num-buffers=%u ! "
+        "audio/x-raw,format=%s,rate=%u,channels=2 ! mix.sink_%u ",
+        samples_per_buffer, n_seconds * 1000 / buffer_ms, format, RATE, i);
+    if (i % 2)
+      g_string_append_printf (desc, "mix.sink_%u::volume=0.5 ", i);
+  }
+
+  pipeline = gst_parse_launch (desc->str, NULL);
+  g_string_free (desc, TRUE);
+  if (!pipeline)
+    g_error ("Could not create pipeline, check GST_PLUGIN_PATH");
+
+  gst_element_set_state (pipeline, GST_STATE_PAUSED);
+  gst_element_get_state (pipeline, NULL, NULL, GST_CLOCK_TIME_NONE);
+
+  start = gst_util_get_timestamp ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  elapsed = gst_util_get_timestamp () - start;
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR)
+    g_error ("Error while mixing");
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return (gdouble) n_seconds * GST_SECOND / elapsed;
+}
+
+gint
+main (gint argc, gchar * argv[])
+{
+  static const guint inputs[] = { 2, 8, 32, 64 };
+  static const guint buffer_ms[] = { 2, 5, 10 };
+  guint n_seconds = 60, i, j;
+  const gchar *format = "F32LE";
+
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    n_seconds = MAX (atoi (argv[1]), 1);
+  if (argc > 2)
+    format = argv[2];
+
+  g_print ("%u seconds of %u Hz stereo %s per input\n", n_seconds, RATE,
+      format);
+
+  for (i = 0; i < G_N_ELEMENTS (inputs); i++) {
+    for (j = 0; j < G_N_ELEMENTS (buffer_ms); j++) {
+      g_print ("%2u inputs, %2u ms buffers: %8.1f x realtime\n", inputs[i],
+          buffer_ms[j], run_audiomixer (n_seconds, format, inputs[i],
+              buffer_ms[j]));
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,154 @@
+/* GStreamer
+ *
+ * audiomixmatrix.c: benchmark matrix mixing of audio channels
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Mixes seconds of 48kHz audio through audiomixmatrix for some common
+ * matrix shapes and sample formats and reports how many seconds of audio
+ * are mixed per second. The time includes generating the silent input.
+ *
+ * Usage: audiomixmatrix [n-seconds]
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <gst/gst.h>
+
+#define RATE 48000
+
+typedef enum
+{
+  SHAPE_IDENTITY,
+  SHAPE_DOWNMIX,
+  SHAPE_SPARSE,
+  SHAPE_DENSE
+} Shape;
+
+static const struct
+{
+  const gchar *name;
+  guint in_channels;
+  guint out_channels;
+} shapes[] = {
+  {"identity 16x16", 16, 16},
+  {"downmix 5.1->2", 6, 2},
+  {"sparse 64x16", 64, 16},
+  {"dense 64x16", 64, 16}
+};
+
+static const gdouble downmix[2][6] = {
+  /* FL, FR, FC, LFE, RL, RR */
+  {1.0, 0.0, 0.7071, 0.0, 0.7071, 0.0},
+  {0.0, 1.0, 0.7071, 0.0, 0.0, 0.7071}
+};
+
+static gdouble
+coefficient (Shape shape, guint out, guint in)
+{
+  switch (shape) {
+    case SHAPE_IDENTITY:
+      return out == in ? 1.0 : 0.0;
+    case SHAPE_DOWNMIX:
+      return downmix[out][in];
+    case SHAPE_SPARSE:
+      /* each output is the sum of 4 inputs */
+      return in / 4 == out ? 0.25 : 0.0;
+    case SHAPE_DENSE:
+    default:
+      return 1.0 / 64;
+  }
+}
+
+static gdouble
+run_audiomixmatrix (guint n_seconds, Shape shape, const gchar * format)
+{
+  GstElement *pipeline;
+  GstMessage *msg;
+  GstBus *bus;
+  GString *desc;
+  GstClockTime start, elapsed;
+  guint in, out;
+
+  desc = g_string_new (NULL);
+  g_string_append_printf (desc, "audiotestsrc wave=silence "
+      "samplesperbuffer=%u num-buffers=%u ! "
+      "audio/x-raw,format=%s,rate=%u,channels=%u ! "
+      "audiomixmatrix in-channels=%u out-channels=%u channel-mask=-1 "
+      "matrix=\"<", RATE / 100, n_seconds * 100, format, RATE,
+      shapes[shape].in_channels, shapes[shape].in_channels,
+      shapes[shape].out_channels);
+  for (out = 0; out < shapes[shape].out_channels; out++) {
+    g_string_append (desc, out ? ", <" : "<");
+    for (in = 0; in < shapes[shape].in_channels; in++)
+      g_string_append_printf (desc, "%s(double)%f", in ? ", " : "",
+          coefficient (shape, out, in));
+    g_string_append (desc, ">");
+  }
+  g_string_append (desc, ">\" ! fakesink sync=false");
+
+  pipeline = gst_parse_launch (desc->str, NULL);
+  g_string_free (desc, TRUE);
+  if (!pipeline)
+    g_error ("Could not create pipeline, check GST_PLUGIN_PATH");
+
+  gst_element_set_state (pipeline, GST_STATE_PAUSED);
+  gst_element_get_state (pipeline, NULL, NULL, GST_CLOCK_TIME_NONE);
+
+  start = gst_util_get_timestamp ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  elapsed = gst_util_get_timestamp () - start;
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR)
+    g_error ("Error while mixing");
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return (gdouble) n_seconds * GST_SECOND / elapsed;
+}
+
+gint
+main (gint argc, gchar * argv[])
+{
+  static const gchar *formats[] = { "F32LE", "S16LE" };
+  guint n_seconds = 600, shape, i;
+
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    n_seconds = MAX (atoi (argv[1]), 1);
+
+  g_print ("%u seconds of %u Hz audio\n", n_seconds, RATE);
+
+  for (shape = 0; shape < G_N_ELEMENTS (shapes); shape++) {
+    for (i = 0; i < G_N_ELEMENTS (formats); i++) {
+      g_print ("%-16s %s: %8.1f x realtime\n", shapes[shape].name,
+          formats[i], run_audiomixmatrix (n_seconds, shape, formats[i]));
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,436 @@
+/* GStreamer
+ *
+ * codecparsers.c: benchmark the H.264 and H.265 NAL unit parsers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Splits byte-stream H.264 and H.265 into NAL units with
+ * gst_h26x_parser_identify_nalu(), which searches for the start codes, and
+ * reports the throughput. The synthetic streams are made of IDR slices of
+ * random data, as in high bitrate intra-only streams. A real stream can be
+ * given too, it is parsed as H.265 if the file name ends with .h265 or .hevc
+ * and as H.264 otherwise.
+ *
+ * For comparison, the throughput of a byte by byte start code search with
+ * gst_byte_reader_masked_scan_uint32() is reported as well.
+ *
+ * Then the H.264 slice headers of a synthetic 1080p stream with one slice per
+ * macroblock row are parsed, along with its SPS, to measure the bit reader.
+ *
+ * Usage: codecparsers [nal-size] [stream-file]
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <gst/gst.h>
+#include <gst/base/gstbytereader.h>
+#include <gst/codecparsers/gsth264parser.h>
+#include <gst/codecparsers/gsth265parser.h>
+
+#define STREAM_SIZE (64 * 1024 * 1024)
+#define N_RUNS 5
+
+#define N_FRAMES 300
+#define WIDTH_MBS 120
+#define HEIGHT_MBS 68
+#define N_SPS 100000
+
+/* Generates a byte stream of NAL units with a @header_size bytes @header
+ * and @nal_size bytes of random payload, with emulation prevention */
+static GByteArray *
+generate_stream (const guint8 * header, guint header_size, guint nal_size)
+{
+  GByteArray *stream = g_byte_array_sized_new (STREAM_SIZE + nal_size);
+  static const guint8 start_code[] = { 0x00, 0x00, 0x00, 0x01 };
+  GRand *rand = g_rand_new_with_seed (42);
+
+  while (stream->len < STREAM_SIZE) {
+    guint zeros = 0, i;
+
+    g_byte_array_append (stream, start_code, sizeof (start_code));
+    g_byte_array_append (stream, header, header_size);
+
+    for (i = 0; i < nal_size; i++) {
+      guint8 b = g_rand_int (rand) & 0xff;
+
+      if (zeros == 2 && b <= 3) {
+        static const guint8 epb = 0x03;
+
+        g_byte_array_append (stream, &epb, 1);
+        zeros = 0;
+      }
+      /* the last byte of a NAL unit can't be 0 */
+      if (i == nal_size - 1 && b == 0)
+        b = 0x80;
+      g_byte_array_append (stream, &b, 1);
+      zeros = b == 0 ? zeros + 1 : 0;
+    }
+  }
+
+  g_rand_free (rand);
+
+  return stream;
+}
+
+/* Returns the time it took to identify all NAL units of @stream */
+static GstClockTime
+run_h264 (const guint8 * data, gsize size, guint * n_nals)
+{
+  GstH264NalParser *parser = gst_h264_nal_parser_new ();
+  GstH264NalUnit nalu;
+  GstClockTime start;
+  guint offset = 0;
+
+  *n_nals = 0;
+  start = gst_util_get_timestamp ();
+  while (gst_h264_parser_identify_nalu (parser, data, offset, size,
+          &nalu) == GST_H264_PARSER_OK) {
+    offset = nalu.offset + nalu.size;
+    (*n_nals)++;
+  }
+  /* the last NAL unit has no start code after it */
+  if (nalu.valid)
+    (*n_nals)++;
+
+  gst_h264_nal_parser_free (parser);
+
+  return gst_util_get_timestamp () - start;
+}
+
+static GstClockTime
+run_h265 (const guint8 * data, gsize size, guint * n_nals)
+{
+  GstH265Parser *parser = gst_h265_parser_new ();
+  GstH265NalUnit nalu;
+  GstClockTime start;
+  guint offset = 0;
+
+  *n_nals = 0;
+  start = gst_util_get_timestamp ();
+  while (gst_h265_parser_identify_nalu (parser, data, offset, size,
+          &nalu) == GST_H265_PARSER_OK) {
+    offset = nalu.offset + nalu.size;
+    (*n_nals)++;
+  }
+  if (nalu.valid)
+    (*n_nals)++;
+
+  gst_h265_parser_free (parser);
+
+  return gst_util_get_timestamp () - start;
+}
+
+static GstClockTime
+run_byte_reader (const guint8 * data, gsize size, guint * n_nals)
+{
+  GstByteReader br;
+  GstClockTime start;
+  guint offset = 0;
+  gint off;
+
+  *n_nals = 0;
+  start = gst_util_get_timestamp ();
+  gst_byte_reader_init (&br, data, size);
+  while ((off = gst_byte_reader_masked_scan_uint32 (&br, 0xffffff00,
+              0x00000100, offset, size - offset)) >= 0) {
+    offset = off + 3;
+    (*n_nals)++;
+    if (size - offset < 4)
+      break;
+  }
+
+  return gst_util_get_timestamp () - start;
+}
+
+static void
+print_run (const gchar * name, const guint8 * data, gsize size,
+    GstClockTime (*run) (const guint8 *, gsize, guint *))
+{
+  GstClockTime elapsed, best = GST_CLOCK_TIME_NONE;
+  guint n_nals = 0, i;
+
+  for (i = 0; i < N_RUNS; i++) {
+    elapsed = run (data, size, &n_nals);
+    best = MIN (best, elapsed);
+  }
+
+  g_print ("%-24s %8u NAL units: %8.1f MB/s\n", name, n_nals,
+      ((gdouble) size / (1024 * 1024)) / ((gdouble) MAX (best,
+              1) / GST_SECOND));
+}
+
+static void
+put_bits (guint8 * data, guint * pos, guint32 value, guint nbits)
+{
+  while (nbits-- > 0) {
+    if ((value >> nbits) & 1)
+      data[*pos / 8] |= 0x80 >> (*pos % 8);
+    (*pos)++;
+  }
+}
+
+static void
+put_ue (guint8 * data, guint * pos, guint32 value)
+{
+  guint nbits = g_bit_storage (value + 1);
+
+  put_bits (data, pos, 0, nbits - 1);
+  put_bits (data, pos, value + 1, nbits);
+}
+
+static void
+put_se (guint8 * data, guint * pos, gint32 value)
+{
+  put_ue (data, pos, value > 0 ? 2 * value - 1 : -2 * value);
+}
+
+/* Appends a NAL unit with the @nal_header byte and the first @nbits bits of
+ * @rbsp followed by the trailing bits and @payload_size random bytes, with
+ * emulation prevention */
+static void
+append_nal (GByteArray * stream, guint8 nal_header, guint8 * rbsp, guint nbits,
+    guint payload_size, GRand * rand)
+{
+  static const guint8 start_code[] = { 0x00, 0x00, 0x00, 0x01 };
+  static const guint8 epb = 0x03;
+  guint zeros = 0, size, i;
+
+  put_bits (rbsp, &nbits, 1, 1);
+  size = (nbits + 7) / 8;
+  for (i = 0; i < payload_size; i++)
+    rbsp[size++] = g_rand_int (rand) & 0xff;
+  if (rbsp[size - 1] == 0)
+    rbsp[size - 1] = 0x80;
+
+  g_byte_array_append (stream, start_code, sizeof (start_code));
+  g_byte_array_append (stream, &nal_header, 1);
+  for (i = 0; i < size; i++) {
+    if (zeros == 2 && rbsp[i] <= 3) {
+      g_byte_array_append (stream, &epb, 1);
+      zeros = 0;
+    }
+    g_byte_array_append (stream, &rbsp[i], 1);
+    zeros = rbsp[i] == 0 ? zeros + 1 : 0;
+  }
+}
+
+/* Generates a baseline profile stream with an IDR frame every 30 frames and
+ * P frames otherwise */
+static GByteArray *
+generate_slices_stream (void)
+{
+  GByteArray *stream = g_byte_array_new ();
+  GRand *rand = g_rand_new_with_seed (42);
+  guint8 rbsp[128];
+  guint pos, frame, row;
+
+  /* SPS */
+  memset (rbsp, 0, sizeof (rbsp));
+  pos = 0;
+  put_bits (rbsp, &pos, 66, 8);
+  put_bits (rbsp, &pos, 0, 8);
+  put_bits (rbsp, &pos, 40, 8);
+  put_ue (rbsp, &pos, 0);
+  put_ue (rbsp, &pos, 0);
+  put_ue (rbsp, &pos, 2);
+  put_ue (rbsp, &pos, 1);
+  put_bits (rbsp, &pos, 0, 1);
+  put_ue (rbsp, &pos, WIDTH_MBS - 1);
+  put_ue (rbsp, &pos, HEIGHT_MBS - 1);
+  put_bits (rbsp, &pos, 1, 1);
+  put_bits (rbsp, &pos, 1, 1);
+  put_bits (rbsp, &pos, 0, 1);
+  put_bits (rbsp, &pos, 0, 1);
+  append_nal (stream, 0x67, rbsp, pos, 0, rand);
+
+  /* PPS */
+  memset (rbsp, 0, sizeof (rbsp));
+  pos = 0;
+  put_ue (rbsp, &pos, 0);
+  put_ue (rbsp, &pos, 0);
+  put_bits (rbsp, &pos, 0, 2);
+  put_ue (rbsp, &pos, 0);
+  put_ue (rbsp, &pos, 0);
+  put_ue (rbsp, &pos, 0);
+  put_bits (rbsp, &pos, 0, 3);
+  put_se (rbsp, &pos, 0);
+  put_se (rbsp, &pos, 0);
+  put_se (rbsp, &pos, 0);
+  put_bits (rbsp, &pos, 4, 3);
+  append_nal (stream, 0x68, rbsp, pos, 0, rand);
+
+  for (frame = 0; frame < N_FRAMES; frame++) {
+    gboolean idr = frame % 30 == 0;
+
+    for (row = 0; row < HEIGHT_MBS; row++) {
+      memset (rbsp, 0, sizeof (rbsp));
+      pos = 0;
+      put_ue (rbsp, &pos, row * WIDTH_MBS);
+      put_ue (rbsp, &pos, idr ? 7 : 5);
+      put_ue (rbsp, &pos, 0);
+      put_bits (rbsp, &pos, frame % 16, 4);
+      if (idr) {
+        put_ue (rbsp, &pos, frame / 30);
+        put_bits (rbsp, &pos, 0, 2);
+      } else {
+        /* no num_ref_idx_active_override_flag, ref_pic_list_modification
+         * nor adaptive_ref_pic_marking_mode_flag */
+        put_bits (rbsp, &pos, 0, 3);
+      }
+      put_se (rbsp, &pos, g_rand_int_range (rand, -26, 25));
+      put_ue (rbsp, &pos, 0);
+      put_se (rbsp, &pos, g_rand_int_range (rand, -6, 7));
+      put_se (rbsp, &pos, g_rand_int_range (rand, -6, 7));
+      append_nal (stream, idr ? 0x65 : 0x21, rbsp, pos, 64, rand);
+    }
+  }
+
+  g_rand_free (rand);
+
+  return stream;
+}
+
+/* Parses the SPS and the slice headers of @nalus N_RUNS times and prints the
+ * best rates */
+static void
+print_slices_run (GstH264NalParser * parser, GArray * nalus)
+{
+  GstClockTime elapsed, best_sps = GST_CLOCK_TIME_NONE, best_slice = best_sps;
+  GstClockTime start;
+  GstH264SliceHdr slice;
+  GstH264SPS sps;
+  guint n_slices = 0, i, j;
+
+  for (i = 0; i < N_RUNS; i++) {
+    start = gst_util_get_timestamp ();
+    for (j = 0; j < N_SPS; j++) {
+      if (gst_h264_parse_sps (&g_array_index (nalus, GstH264NalUnit, 0), &sps,
+              TRUE) != GST_H264_PARSER_OK)
+        g_error ("Could not parse the SPS");
+    }
+    elapsed = gst_util_get_timestamp () - start;
+    best_sps = MIN (best_sps, elapsed);
+
+    n_slices = 0;
+    start = gst_util_get_timestamp ();
+    for (j = 2; j < nalus->len; j++) {
+      GstH264NalUnit *nalu = &g_array_index (nalus, GstH264NalUnit, j);
+
+      if (gst_h264_parser_parse_slice_hdr (parser, nalu, &slice, TRUE,
+              TRUE) != GST_H264_PARSER_OK)
+        g_error ("Could not parse slice header %u", j);
+      n_slices++;
+    }
+    elapsed = gst_util_get_timestamp () - start;
+    best_slice = MIN (best_slice, elapsed);
+  }
+
+  g_print ("%-24s %8u NAL units: %8.2f M/s\n", "h264 sps", N_SPS,
+      ((gdouble) N_SPS / 1000000) / ((gdouble) MAX (best_sps,
+              1) / GST_SECOND));
+  g_print ("%-24s %8u NAL units: %8.2f M/s\n", "h264 slice headers",
+      n_slices, ((gdouble) n_slices / 1000000) / ((gdouble) MAX (best_slice,
+              1) / GST_SECOND));
+}
+
+static void
+run_slices (void)
+{
+  GstH264NalParser *parser = gst_h264_nal_parser_new ();
+  GByteArray *stream = generate_slices_stream ();
+  GArray *nalus = g_array_new (FALSE, FALSE, sizeof (GstH264NalUnit));
+  GstH264NalUnit nalu;
+  guint offset = 0;
+
+  while (TRUE) {
+    GstH264ParserResult res;
+
+    res = gst_h264_parser_identify_nalu (parser, stream->data, offset,
+        stream->len, &nalu);
+    if (res != GST_H264_PARSER_OK && res != GST_H264_PARSER_NO_NAL_END)
+      break;
+    g_array_append_val (nalus, nalu);
+    offset = nalu.offset + nalu.size;
+  }
+  if (nalus->len < 2
+      || gst_h264_parser_parse_nal (parser, &g_array_index (nalus,
+              GstH264NalUnit, 0)) != GST_H264_PARSER_OK
+      || gst_h264_parser_parse_nal (parser, &g_array_index (nalus,
+              GstH264NalUnit, 1)) != GST_H264_PARSER_OK)
+    g_error ("Could not parse the SPS and PPS");
+
+  print_slices_run (parser, nalus);
+
+  g_array_unref (nalus);
+  g_byte_array_unref (stream);
+  gst_h264_nal_parser_free (parser);
+}
+
+gint
+main (gint argc, gchar * argv[])
+{
+  /* IDR slices */
+  static const guint8 h264_header[] = { 0x65 };
+  static const guint8 h265_header[] = { 0x26, 0x01 };
+  guint nal_size = 512 * 1024;
+  GByteArray *stream;
+
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    nal_size = MAX (atoi (argv[1]), 16);
+
+  g_print ("%u MB of %u bytes NAL units\n", STREAM_SIZE / (1024 * 1024),
+      nal_size);
+
+  stream = generate_stream (h264_header, sizeof (h264_header), nal_size);
+  print_run ("h264 synthetic", stream->data, stream->len, run_h264);
+  print_run ("byte reader synthetic", stream->data, stream->len,
+      run_byte_reader);
+  g_byte_array_unref (stream);
+
+  stream = generate_stream (h265_header, sizeof (h265_header), nal_size);
+  print_run ("h265 synthetic", stream->data, stream->len, run_h265);
+  g_byte_array_unref (stream);
+
+  run_slices ();
+
+  if (argc > 2) {
+    gchar *contents;
+    gsize size;
+    GError *err = NULL;
+
+    if (!g_file_get_contents (argv[2], &contents, &size, &err))
+      g_error ("Could not read %s: %s", argv[2], err->message);
+
+    if (g_str_has_suffix (argv[2], ".h265")
+        || g_str_has_suffix (argv[2], ".hevc"))
+      print_run ("h265 file", (guint8 *) contents, size, run_h265);
+    else
+      print_run ("h264 file", (guint8 *) contents, size, run_h264);
+    print_run ("byte reader file", (guint8 *) contents, size,
+        run_byte_reader);
+
+    g_free (contents);
+  }
+
+  return 0;
+}
@@ -0,0 +1,124 @@
+/* GStreamer
+ *
+ * compositor.c: benchmark band-parallel compositing
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Composites a grid of translucent inputs into a 1080p frame as fast as
+ * possible and reports the number of output frames per second for an
+ * increasing number of compositing threads.
+ *
+ * Usage: compositor [n-frames] [grid-size] [format]
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <gst/gst.h>
+
+#define OUT_WIDTH 1920
+#define OUT_HEIGHT 1080
+
+static gdouble
+run_compositor (guint n_frames, guint grid, const gchar * format,
+    guint n_threads)
+{
+  GstElement *pipeline;
+  GstMessage *msg;
+  GstBus *bus;
+  GString *desc;
+  GstClockTime start, elapsed;
+  guint width, height, x, y;
+
+  width = OUT_WIDTH / grid;
+  height = OUT_HEIGHT / grid;
+
+  desc = g_string_new (NULL);
+  g_string_append_printf (desc, "compositor name=mix n-threads=%u ! "
+      "video/x-raw,format=%s,width=%u,height=%u ! fakesink sync=false ",
+      n_threads, format, OUT_WIDTH, OUT_HEIGHT);
+  for (y = 0; y < grid; y++) {
+    for (x = 0; x < grid; x++) {
+      /* overlap the neighbours a little to blend over other inputs too */
+      g_string_append_printf (desc, "videotestsrc num-buffers=%u "
+          "pattern=smpte ! video/x-raw,format=%s,width=%u,height=%u,"
+          "framerate=30/1 ! mix.sink_%u ", n_frames, format,
+          width + width / 8, height + height / 8, y * grid + x);
+      g_string_append_printf (desc, "mix.sink_%u::xpos=%u "
+          "mix.sink_%u::ypos=%u mix.sink_%u::alpha=0.8 ", y * grid + x,
+          x * width, y * grid + x, y * height, y * grid + x);
+    }
+  }
+
+  pipeline = gst_parse_launch (desc->str, NULL);
+  g_string_free (desc, TRUE);
+  if (!pipeline)
+    g_error ("Could not create pipeline, check GST_PLUGIN_PATH");
+
+  gst_element_set_state (pipeline, GST_STATE_PAUSED);
+  gst_element_get_state (pipeline, NULL, NULL, GST_CLOCK_TIME_NONE);
+
+  start = gst_util_get_timestamp ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  elapsed = gst_util_get_timestamp () - start;
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR)
+    g_error ("Error while compositing");
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return (gdouble) n_frames * GST_SECOND / elapsed;
+}
+
+gint
+main (gint argc, gchar * argv[])
+{
+  guint n_frames = 300, grid = 3, n_threads, n_processors;
+  const gchar *format = "AYUV";
+  gdouble fps, base_fps = 0;
+
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    n_frames = MAX (atoi (argv[1]), 1);
+  if (argc > 2)
+    grid = CLAMP (atoi (argv[2]), 1, 8);
+  if (argc > 3)
+    format = argv[3];
+
+  n_processors = g_get_num_processors ();
+  g_print ("%u frames of %ux%u %s, %u inputs, %u processors\n", n_frames,
+      OUT_WIDTH, OUT_HEIGHT, format, grid * grid, n_processors);
+
+  for (n_threads = 1; n_threads <= MAX (n_processors, 2); n_threads *= 2) {
+    fps = run_compositor (n_frames, grid, format, n_threads);
+    if (n_threads == 1)
+      base_fps = fps;
+    g_print ("%2u threads: %7.1f frames/s (x%.2f)\n", n_threads, fps,
+        fps / base_fps);
+  }
+
+  return 0;
+}
@@ -0,0 +1,119 @@
+/* GStreamer
+ *
+ * fieldanalysis.c: benchmark row band parallel field analysis
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Analyses interlaced SD (720x576) and HD (1920x1080) frames as fast as
+ * possible and reports the number of frames per second for an increasing
+ * number of analysis threads. The input is made of moving content so that
+ * fields differ from the ones of the previous frame, and the same frames
+ * are analysed for every thread count.
+ *
+ * Usage: fieldanalysis [n-frames] [frame-metric]
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <gst/gst.h>
+
+static const struct
+{
+  const gchar *name;
+  guint width, height;
+} sizes[] = {
+  {
+  "SD", 720, 576}, {
+  "HD", 1920, 1080}
+};
+
+static gdouble
+run_fieldanalysis (guint n_frames, guint width, guint height,
+    const gchar * frame_metric, guint n_threads)
+{
+  GstElement *pipeline;
+  GstMessage *msg;
+  GstBus *bus;
+  gchar *desc;
+  GstClockTime start, elapsed;
+
+  desc = g_strdup_printf ("videotestsrc num-buffers=%u pattern=ball ! "
+      "video/x-raw,format=I420,width=%u,height=%u,framerate=25/1,"
+      "interlace-mode=interleaved ! fieldanalysis frame-metric=%s "
+      "n-threads=%u ! fakesink sync=false", n_frames, width, height,
+      frame_metric, n_threads);
+  pipeline = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  if (!pipeline)
+    g_error ("Could not create pipeline, check GST_PLUGIN_PATH");
+
+  gst_element_set_state (pipeline, GST_STATE_PAUSED);
+  gst_element_get_state (pipeline, NULL, NULL, GST_CLOCK_TIME_NONE);
+
+  start = gst_util_get_timestamp ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  elapsed = gst_util_get_timestamp () - start;
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR)
+    g_error ("Error while analysing");
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return (gdouble) n_frames * GST_SECOND / elapsed;
+}
+
+gint
+main (gint argc, gchar * argv[])
+{
+  guint n_frames = 500, n_threads, n_processors, i;
+  const gchar *frame_metric = "5-tap";
+  gdouble fps, base_fps = 0;
+
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    n_frames = MAX (atoi (argv[1]), 2);
+  if (argc > 2)
+    frame_metric = argv[2];
+
+  n_processors = g_get_num_processors ();
+  g_print ("%u frames, %s frame metric, %u processors\n", n_frames,
+      frame_metric, n_processors);
+
+  for (i = 0; i < G_N_ELEMENTS (sizes); i++) {
+    g_print ("%s %ux%u:\n", sizes[i].name, sizes[i].width, sizes[i].height);
+    for (n_threads = 1; n_threads <= MAX (n_processors, 2); n_threads *= 2) {
+      fps = run_fieldanalysis (n_frames, sizes[i].width, sizes[i].height,
+          frame_metric, n_threads);
+      if (n_threads == 1)
+        base_fps = fps;
+      g_print ("%2u threads: %7.1f frames/s (x%.2f)\n", n_threads, fps,
+          fps / base_fps);
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,162 @@
+/* GStreamer
+ *
+ * interlace.c: benchmark the field weaving of the interlace filter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Runs 1080p I420 frames through interlace for a few field patterns and
+ * reports the output frames per second and the bytes copied per output
+ * frame, as read from the bytes-copied property. Each pattern runs twice:
+ * once with the input frames only used by interlace, so that a stored frame
+ * can be reused and only one field is copied into it, and once with a tee
+ * and a queue keeping the input frames, so that both fields are copied
+ * into a new frame as before. The outputs of both runs must be the same.
+ *
+ * Usage: interlace [n-frames]
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <gst/gst.h>
+
+#define WIDTH 1920
+#define HEIGHT 1080
+#define FRAME_SIZE (WIDTH * HEIGHT * 3 / 2)
+
+typedef struct
+{
+  const gchar *pattern;
+  const gchar *framerate;
+} Config;
+
+static const Config configs[] = {
+  {"1:1", "50/1"},
+  {"2:3", "24000/1001"},
+  {NULL, NULL}
+};
+
+typedef struct
+{
+  guint n_frames;
+  guint32 hash;
+} Output;
+
+static void
+handoff_cb (GstElement * sink, GstBuffer * buffer, GstPad * pad,
+    Output * output)
+{
+  GstMapInfo map;
+  gsize i;
+
+  gst_buffer_map (buffer, &map, GST_MAP_READ);
+  for (i = 0; i < map.size; i += 61)
+    output->hash = output->hash * 31 + map.data[i];
+  gst_buffer_unmap (buffer, &map);
+  output->n_frames++;
+}
+
+static gdouble
+run_interlace (guint n_frames, const Config * config, gboolean keep_input,
+    Output * output, guint64 * bytes_copied)
+{
+  GstElement *pipeline, *element;
+  GstMessage *msg;
+  GstBus *bus;
+  gchar *desc;
+  GstClockTime start, elapsed;
+
+  /* the queue holds on to the last input frames until EOS */
+  desc = g_strdup_printf ("videotestsrc num-buffers=%u pattern=ball ! "
+      "video/x-raw,format=I420,width=%u,height=%u,framerate=%s ! %s "
+      "interlace name=interlace field-pattern=%s ! "
+      "fakesink name=sink sync=false signal-handoffs=true", n_frames, WIDTH,
+      HEIGHT, config->framerate, keep_input ? "tee name=t ! queue "
+      "min-threshold-buffers=4 max-size-buffers=0 max-size-bytes=0 "
+      "max-size-time=0 ! fakesink sync=false t. !" : "", config->pattern);
+  pipeline = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  if (!pipeline)
+    g_error ("Could not create pipeline, check GST_PLUGIN_PATH");
+
+  output->n_frames = 0;
+  output->hash = 0;
+  element = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  g_signal_connect (element, "handoff", G_CALLBACK (handoff_cb), output);
+  gst_object_unref (element);
+
+  gst_element_set_state (pipeline, GST_STATE_PAUSED);
+  gst_element_get_state (pipeline, NULL, NULL, GST_CLOCK_TIME_NONE);
+
+  start = gst_util_get_timestamp ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  elapsed = gst_util_get_timestamp () - start;
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR)
+    g_error ("Error while interlacing");
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  element = gst_bin_get_by_name (GST_BIN (pipeline), "interlace");
+  g_object_get (element, "bytes-copied", bytes_copied, NULL);
+  gst_object_unref (element);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return (gdouble) output->n_frames * GST_SECOND / elapsed;
+}
+
+gint
+main (gint argc, gchar * argv[])
+{
+  guint n_frames = 500, i;
+  gboolean same = TRUE;
+  Output reused, copied;
+  guint64 reused_bytes, copied_bytes;
+  gdouble reused_fps, copied_fps;
+
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    n_frames = MAX (atoi (argv[1]), 1);
+
+  g_print ("%u frames of %ux%u I420, %u bytes per frame\n", n_frames, WIDTH,
+      HEIGHT, FRAME_SIZE);
+  for (i = 0; configs[i].pattern; i++) {
+    reused_fps = run_interlace (n_frames, &configs[i], FALSE, &reused,
+        &reused_bytes);
+    copied_fps = run_interlace (n_frames, &configs[i], TRUE, &copied,
+        &copied_bytes);
+
+    g_print ("%s at %s:\n", configs[i].pattern, configs[i].framerate);
+    g_print ("  input reused: %7.1f frames/s, %9.0f bytes copied per frame\n",
+        reused_fps, (gdouble) reused_bytes / MAX (reused.n_frames, 1));
+    g_print ("  input kept  : %7.1f frames/s, %9.0f bytes copied per frame"
+        "%s\n", copied_fps, (gdouble) copied_bytes / MAX (copied.n_frames, 1),
+        reused.n_frames == copied.n_frames && reused.hash == copied.hash ?
+        "" : ", OUTPUT DIFFERS");
+    same &= reused.n_frames == copied.n_frames && reused.hash == copied.hash;
+  }
+
+  return same ? 0 : 1;
+}
@@ -0,0 +1,338 @@
+/* GStreamer
+ *
+ * ivtc.c: benchmark the comb score of the inverse telecine filter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Telecines synthetic 1080p24 frames with a 3:2 pulldown and runs the field
+ * pairing decisions of gst_ivtc_construct_frame() on the fields, once with
+ * the original per pixel comb score and once with the one of ivtccomb.c.
+ * The decisions must be the same. Then reports the pixels per second of
+ * both comb scores, and finally runs the ivtc element on 2:3 telecined
+ * frames and reports the input frames per second for an increasing number
+ * of threads, checking that the output does not depend on the number of
+ * threads.
+ *
+ * Usage: ivtc [n-frames]
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <gst/gst.h>
+
+/* the comb metric is not exported by the plugin */
+#include "../../gst/ivtc/ivtccomb.c"
+
+#define WIDTH 1920
+#define HEIGHT 1080
+#define N_FILM_FRAMES 24
+#define N_RUNS 5
+#define THRESHOLD 100
+
+typedef int (*CombScoreFunc) (const guint8 * top, const guint8 * bottom);
+
+#define GET_LINE_IL(top,bottom,line) \
+  ((((line) & 1) ? (bottom) : (top)) + (line) * WIDTH)
+
+/* get_comb_score() before ivtccomb.c */
+static int
+comb_score_orig (const guint8 * top, const guint8 * bottom)
+{
+  static int thisline[WIDTH];
+  int score = 0;
+  int i, j;
+
+  memset (thisline, 0, sizeof (thisline));
+
+  for (j = 2; j < HEIGHT - 2; j++) {
+    const guint8 *src1 = GET_LINE_IL (top, bottom, j - 1);
+    const guint8 *src2 = GET_LINE_IL (top, bottom, j);
+    const guint8 *src3 = GET_LINE_IL (top, bottom, j + 1);
+
+    for (i = 0; i < WIDTH; i++) {
+      if (src2[i] < MIN (src1[i], src3[i]) - 5 ||
+          src2[i] > MAX (src1[i], src3[i]) + 5) {
+        if (i > 0) {
+          thisline[i] += thisline[i - 1];
+        }
+        thisline[i]++;
+        if (thisline[i] > 1000)
+          thisline[i] = 1000;
+      } else {
+        thisline[i] = 0;
+      }
+      if (thisline[i] > 100) {
+        score++;
+      }
+    }
+  }
+
+  return score;
+}
+
+static int
+comb_score_new (const guint8 * top, const guint8 * bottom)
+{
+  static guint16 thisline[WIDTH];
+  guint8 mask[WIDTH];
+  int score = 0;
+  int j;
+
+  memset (thisline, 0, sizeof (thisline));
+
+  for (j = 2; j < HEIGHT - 2; j++) {
+    ivtc_comb_mask_row (mask, GET_LINE_IL (top, bottom, j - 1),
+        GET_LINE_IL (top, bottom, j), GET_LINE_IL (top, bottom, j + 1),
+        WIDTH);
+    score += ivtc_comb_accumulate_row (thisline, mask, WIDTH);
+  }
+
+  return score;
+}
+
+/* a textured background with a bright box moving by 24 pixels per frame,
+ * and a little noise */
+static guint8 *
+make_film_frame (guint n)
+{
+  guint8 *data = g_malloc (WIDTH * HEIGHT);
+  guint x, y;
+
+  for (y = 0; y < HEIGHT; y++) {
+    for (x = 0; x < WIDTH; x++) {
+      guint v = 64 + ((x / 32 + y / 32) & 1) * 32 + g_random_int_range (0, 4);
+
+      if (x >= 200 + 24 * n && x < 600 + 24 * n && y >= 300 && y < 700)
+        v = 220 + g_random_int_range (0, 4);
+      data[y * WIDTH + x] = v;
+    }
+  }
+
+  return data;
+}
+
+typedef struct
+{
+  guint frame;
+  int parity;
+} Field;
+
+/* Pairs the fields like gst_ivtc_construct_frame() does when the stream is
+ * ahead of the anchor field, and returns the decisions as a string: one
+ * 'p', 'n' or 's' per output frame for the anchor paired with the previous
+ * field, the next field or interpolated. The film frames of which both
+ * fields are paired are counted in n_clean. */
+static gchar *
+run_cadence (guint8 ** frames, CombScoreFunc comb_score, guint * n_clean,
+    guint * n_scores)
+{
+  GString *decisions = g_string_new (NULL);
+  Field fields[8];
+  int next_score[8];
+  int n_fields = 0, parity = 0;
+  guint n;
+
+  *n_clean = *n_scores = 0;
+
+  for (n = 0; n < N_FILM_FRAMES; n++) {
+    int f, n_new = (n & 1) ? 2 : 3;
+
+    for (f = 0; f < n_new; f++) {
+      fields[n_fields].frame = n;
+      fields[n_fields].parity = parity;
+      next_score[n_fields] = -1;
+      n_fields++;
+      parity ^= 1;
+    }
+
+    while (n_fields >= 4) {
+      int score[2], i, n_retire, other;
+
+      /* the same cache as GstIvtcField.next_score */
+      for (i = 0; i < 2; i++) {
+        if (next_score[i] < 0) {
+          const Field *top = &fields[i + fields[i].parity];
+          const Field *bottom = &fields[i + 1 - fields[i].parity];
+
+          next_score[i] = comb_score (frames[top->frame],
+              frames[bottom->frame]);
+          (*n_scores)++;
+        }
+        score[i] = next_score[i];
+      }
+
+      if (score[0] < THRESHOLD) {
+        if (score[1] < score[0]) {
+          other = 2;
+          n_retire = 3;
+        } else {
+          other = 0;
+          n_retire = 2;
+        }
+      } else if (score[1] < THRESHOLD) {
+        other = 2;
+        n_retire = 3;
+      } else {
+        other = -1;
+        n_retire = 2;
+      }
+
+      g_string_append_c (decisions, other < 0 ? 's' : other ? 'n' : 'p');
+      if (other >= 0 && fields[other].frame == fields[1].frame)
+        (*n_clean)++;
+
+      memmove (fields, fields + n_retire, sizeof (Field) * (n_fields -
+              n_retire));
+      memmove (next_score, next_score + n_retire, sizeof (int) * (n_fields -
+              n_retire));
+      n_fields -= n_retire;
+    }
+  }
+
+  return g_string_free (decisions, FALSE);
+}
+
+/* best of N_RUNS scores of a combed pair of fields */
+static gdouble
+time_comb_score (guint8 ** frames, CombScoreFunc comb_score)
+{
+  GstClockTime start, elapsed, best = GST_CLOCK_TIME_NONE;
+  guint run;
+
+  for (run = 0; run < N_RUNS; run++) {
+    start = gst_util_get_timestamp ();
+    comb_score (frames[0], frames[1]);
+    elapsed = gst_util_get_timestamp () - start;
+    best = MIN (best, elapsed);
+  }
+
+  return (gdouble) WIDTH * (HEIGHT - 4) * GST_SECOND / best;
+}
+
+static void
+handoff_cb (GstElement * sink, GstBuffer * buffer, GstPad * pad,
+    guint32 * hash)
+{
+  GstMapInfo map;
+  gsize i;
+
+  gst_buffer_map (buffer, &map, GST_MAP_READ);
+  for (i = 0; i < map.size; i += 61)
+    *hash = *hash * 31 + map.data[i];
+  gst_buffer_unmap (buffer, &map);
+}
+
+static gdouble
+run_ivtc (guint n_frames, guint n_threads, guint32 * hash)
+{
+  GstElement *pipeline, *sink;
+  GstMessage *msg;
+  GstBus *bus;
+  gchar *desc;
+  GstClockTime start, elapsed;
+
+  desc = g_strdup_printf ("videotestsrc num-buffers=%u pattern=ball ! "
+      "video/x-raw,format=I420,width=%u,height=%u,framerate=24/1 ! "
+      "interlace field-pattern=2:3 ! ivtc n-threads=%u ! "
+      "fakesink name=sink sync=false signal-handoffs=true", n_frames, WIDTH,
+      HEIGHT, n_threads);
+  pipeline = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  if (!pipeline)
+    g_error ("Could not create pipeline, check GST_PLUGIN_PATH");
+
+  *hash = 0;
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  g_signal_connect (sink, "handoff", G_CALLBACK (handoff_cb), hash);
+  gst_object_unref (sink);
+
+  gst_element_set_state (pipeline, GST_STATE_PAUSED);
+  gst_element_get_state (pipeline, NULL, NULL, GST_CLOCK_TIME_NONE);
+
+  start = gst_util_get_timestamp ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  elapsed = gst_util_get_timestamp () - start;
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR)
+    g_error ("Error during inverse telecine");
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return (gdouble) n_frames * GST_SECOND / elapsed;
+}
+
+gint
+main (gint argc, gchar * argv[])
+{
+  guint8 *frames[N_FILM_FRAMES];
+  gchar *orig, *new;
+  guint n_frames = 200, n_threads, n_processors, n_clean, n_scores, i;
+  guint32 hash, base_hash = 0;
+  gboolean same;
+  gdouble fps, base_fps = 0;
+
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    n_frames = MAX (atoi (argv[1]), 1);
+
+  for (i = 0; i < N_FILM_FRAMES; i++)
+    frames[i] = make_film_frame (i);
+
+  orig = run_cadence (frames, comb_score_orig, &n_clean, &n_scores);
+  new = run_cadence (frames, comb_score_new, &n_clean, &n_scores);
+  same = strcmp (orig, new) == 0;
+  g_print ("3:2 cadence decisions: %s\n", orig);
+  g_print ("%s, %u of %u frames from matching fields, %u comb scores\n",
+      same ? "unchanged" : "CHANGED", n_clean, (guint) strlen (new), n_scores);
+  g_free (orig);
+  g_free (new);
+
+  g_print ("%ux%u comb score: original %.1f Mpixels/s, new %.1f "
+      "Mpixels/s\n", WIDTH, HEIGHT,
+      time_comb_score (frames, comb_score_orig) / 1e6,
+      time_comb_score (frames, comb_score_new) / 1e6);
+
+  for (i = 0; i < N_FILM_FRAMES; i++)
+    g_free (frames[i]);
+
+  n_processors = g_get_num_processors ();
+  g_print ("%u frames of %ux%u I420 at 24 fps, %u processors\n", n_frames,
+      WIDTH, HEIGHT, n_processors);
+  for (n_threads = 1; n_threads <= MAX (n_processors, 2); n_threads *= 2) {
+    fps = run_ivtc (n_frames, n_threads, &hash);
+    if (n_threads == 1) {
+      base_fps = fps;
+      base_hash = hash;
+    }
+    g_print ("%2u threads: %7.1f frames/s (x%.2f)%s\n", n_threads, fps,
+        fps / base_fps, hash == base_hash ? "" : ", OUTPUT DIFFERS");
+    same &= hash == base_hash;
+  }
+
+  return same ? 0 : 1;
+}
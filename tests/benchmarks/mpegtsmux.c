@@ -0,0 +1,124 @@
+/* GStreamer
+ *
+ * mpegtsmux.c: benchmark packet output of mpegtsmux
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Muxes a 25 fps video stream of ~60 Mbit/s and an audio stream as fast as
+ * possible and reports the number of TS packets and output buffers produced
+ * per second, for the alignments commonly used.
+ *
+ * Run it against two builds to compare them.
+ *
+ * Usage: mpegtsmux [n-frames]
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <gst/gst.h>
+
+#define VIDEO_FRAME_SIZE 300000
+#define AUDIO_FRAME_SIZE 768
+
+typedef struct
+{
+  guint64 bytes;
+  guint64 buffers;
+} OutputStats;
+
+static void
+handoff_cb (GstElement * sink, GstBuffer * buf, GstPad * pad,
+    OutputStats * stats)
+{
+  stats->bytes += gst_buffer_get_size (buf);
+  stats->buffers++;
+}
+
+static void
+run_mux (guint n_frames, gint alignment, gboolean m2ts)
+{
+  GstElement *pipeline, *sink;
+  GstMessage *msg;
+  GstBus *bus;
+  OutputStats stats = { 0, };
+  GstClockTime start, elapsed;
+  guint packet_size = m2ts ? 192 : 188;
+  gchar *desc;
+
+  /* fakesrc timestamps the buffers from the datarate */
+  desc = g_strdup_printf ("mpegtsmux name=mux alignment=%d m2ts-mode=%s ! "
+      "fakesink name=sink sync=false signal-handoffs=true "
+      "fakesrc num-buffers=%u sizetype=fixed sizemax=%u filltype=zero "
+      "datarate=%u ! video/mpeg,mpegversion=2,systemstream=false,parsed=true"
+      " ! mux. "
+      "fakesrc num-buffers=%u sizetype=fixed sizemax=%u filltype=zero "
+      "datarate=%u ! audio/mpeg,mpegversion=1,parsed=true ! mux. ",
+      alignment, m2ts ? "true" : "false", n_frames, VIDEO_FRAME_SIZE,
+      VIDEO_FRAME_SIZE * 25, n_frames * 2, AUDIO_FRAME_SIZE, AUDIO_FRAME_SIZE * 50);
+  pipeline = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  if (!pipeline)
+    g_error ("Could not create pipeline, check GST_PLUGIN_PATH");
+
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  g_signal_connect (sink, "handoff", G_CALLBACK (handoff_cb), &stats);
+  gst_object_unref (sink);
+
+  start = gst_util_get_timestamp ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  elapsed = gst_util_get_timestamp () - start;
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR)
+    g_error ("Error while muxing");
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  g_print ("alignment %2d%s: %9.0f packets/s, %9.0f buffers/s, "
+      "%6.1f packets/buffer, %.1f Mbit/s\n", alignment, m2ts ? " (m2ts)" : "",
+      (gdouble) (stats.bytes / packet_size) * GST_SECOND / elapsed,
+      (gdouble) stats.buffers * GST_SECOND / elapsed,
+      (gdouble) (stats.bytes / packet_size) / MAX (stats.buffers, 1),
+      (gdouble) stats.bytes * 8 * GST_SECOND / elapsed / 1000000);
+}
+
+gint
+main (gint argc, gchar * argv[])
+{
+  guint n_frames = 1500;
+
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    n_frames = MAX (atoi (argv[1]), 1);
+
+  g_print ("%u video frames of %u bytes\n", n_frames, VIDEO_FRAME_SIZE);
+
+  run_mux (n_frames, 0, FALSE);
+  run_mux (n_frames, 7, FALSE);
+  run_mux (n_frames, 0, TRUE);
+
+  return 0;
+}
@@ -0,0 +1,138 @@
+/* GStreamer
+ *
+ * netsim.c: benchmark the network simulator
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Pushes small packets through netsim as fast as possible and reports the
+ * packets per second netsim takes in and the number of packets it lets
+ * through, for a few configurations: no impairment, all packets delayed,
+ * a shaped link and burst loss. Packets still delayed when EOS reaches the
+ * sink are not counted. Finally runs the same lossy configuration twice
+ * with the same seed and checks that the same packets get through.
+ *
+ * Usage: netsim [n-packets]
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <gst/gst.h>
+
+#define PACKET_SIZE 188
+
+typedef struct
+{
+  guint n_received;
+  guint32 hash;
+} Received;
+
+static const gchar *configs[] = {
+  "",
+  "delay-probability=1.0 min-delay=0 max-delay=1",
+  "max-kbps=1000000 max-bucket-size=65536",
+  "gilbert-elliott-p=0.01 gilbert-elliott-r=0.2",
+  NULL
+};
+
+static void
+handoff_cb (GstElement * sink, GstBuffer * buffer, GstPad * pad,
+    Received * received)
+{
+  received->n_received++;
+  received->hash = received->hash * 31 + (guint32) GST_BUFFER_OFFSET (buffer);
+}
+
+static gdouble
+run_netsim (guint n_packets, const gchar * props, Received * received)
+{
+  GstElement *pipeline, *sink;
+  GstMessage *msg;
+  GstBus *bus;
+  gchar *desc;
+  GstClockTime start, elapsed;
+
+  desc = g_strdup_printf ("fakesrc num-buffers=%u sizetype=fixed sizemax=%u "
+      "filltype=zero ! netsim %s ! fakesink name=sink sync=false "
+      "signal-handoffs=true", n_packets, PACKET_SIZE, props);
+  pipeline = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  if (!pipeline)
+    g_error ("Could not create pipeline, check GST_PLUGIN_PATH");
+
+  received->n_received = 0;
+  received->hash = 0;
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  g_signal_connect (sink, "handoff", G_CALLBACK (handoff_cb), received);
+  gst_object_unref (sink);
+
+  gst_element_set_state (pipeline, GST_STATE_PAUSED);
+  gst_element_get_state (pipeline, NULL, NULL, GST_CLOCK_TIME_NONE);
+
+  start = gst_util_get_timestamp ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  elapsed = gst_util_get_timestamp () - start;
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR)
+    g_error ("Error while simulating the network");
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return (gdouble) n_packets * GST_SECOND / elapsed;
+}
+
+gint
+main (gint argc, gchar * argv[])
+{
+  guint n_packets = 200000, i;
+  Received received, replay;
+  gboolean same;
+  gdouble pps;
+
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    n_packets = MAX (atoi (argv[1]), 1);
+
+  g_print ("%u packets of %u bytes\n", n_packets, PACKET_SIZE);
+  for (i = 0; configs[i]; i++) {
+    pps = run_netsim (n_packets, configs[i], &received);
+    g_print ("%-48s: %9.0f packets/s, %u through\n",
+        configs[i][0] ? configs[i] : "no impairment", pps,
+        received.n_received);
+  }
+
+  run_netsim (n_packets, "seed=1234 drop-probability=0.1 "
+      "gilbert-elliott-p=0.01 gilbert-elliott-r=0.2", &received);
+  run_netsim (n_packets, "seed=1234 drop-probability=0.1 "
+      "gilbert-elliott-p=0.01 gilbert-elliott-r=0.2", &replay);
+  same = received.n_received == replay.n_received &&
+      received.hash == replay.hash;
+  g_print ("seeded replay: %u and %u packets through, %s\n",
+      received.n_received, replay.n_received, same ? "same packets" :
+      "PACKETS DIFFER");
+
+  return same ? 0 : 1;
+}
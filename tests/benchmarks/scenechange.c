@@ -0,0 +1,240 @@
+/* GStreamer
+ *
+ * scenechange.c: benchmark the sum of absolute differences of scenechange
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Checks that each SIMD line function supported by the CPU gives the same
+ * sums as the C one, then reports the pixels per second of each line
+ * function on 2160p planes, and the mean absolute difference and speed of
+ * the sampled planes for increasing steps. Finally runs the scenechange
+ * element on 2160p frames and reports the frames per second for each step.
+ *
+ * Usage: scenechange [n-frames]
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <gst/gst.h>
+
+/* the line functions are static */
+#include "../../gst/videofilters/videosad.c"
+
+#define WIDTH 3840
+#define HEIGHT 2160
+#define N_RUNS 5
+#define N_CHECKS 20000
+
+typedef struct
+{
+  const gchar *name;
+  VideoSadLineFunc sad_line;
+} Kernel;
+
+static guint
+get_kernels (Kernel * kernels)
+{
+  guint n = 0;
+
+  kernels[n].name = "c";
+  kernels[n++].sad_line = video_sad_line_c;
+#if defined (__SSE2__)
+  kernels[n].name = "sse2";
+  kernels[n++].sad_line = video_sad_line_sse2;
+#ifdef HAVE_VIDEO_SAD_AVX2
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("avx2")) {
+    kernels[n].name = "avx2";
+    kernels[n++].sad_line = video_sad_line_avx2;
+  }
+#endif
+#endif
+
+  return n;
+}
+
+static gboolean
+check_kernel (const Kernel * kernel)
+{
+  guint8 *s1 = g_malloc (WIDTH + 64), *s2 = g_malloc (WIDTH + 64);
+  guint i, k, mismatches = 0;
+
+  for (i = 0; i < N_CHECKS; i++) {
+    gint width = g_random_int_range (0, WIDTH);
+    gint o1 = g_random_int_range (0, 64), o2 = g_random_int_range (0, 64);
+
+    for (k = 0; k < WIDTH + 64; k++) {
+      s1[k] = g_random_int ();
+      s2[k] = g_random_int ();
+    }
+
+    if (kernel->sad_line (s1 + o1, s2 + o2, width) !=
+        video_sad_line_c (s1 + o1, s2 + o2, width))
+      mismatches++;
+  }
+
+  g_free (s1);
+  g_free (s2);
+
+  if (mismatches)
+    g_print ("%-5s: %u of %u lines differ from C\n", kernel->name,
+        mismatches, N_CHECKS);
+
+  return mismatches == 0;
+}
+
+/* noise on a gradient, moved by one pixel in the second plane */
+static void
+make_planes (guint8 ** p1, guint8 ** p2)
+{
+  gint x, y;
+
+  *p1 = g_malloc (WIDTH * HEIGHT);
+  *p2 = g_malloc (WIDTH * HEIGHT);
+
+  for (y = 0; y < HEIGHT; y++) {
+    for (x = 0; x < WIDTH; x++) {
+      (*p1)[y * WIDTH + x] = (x + y) / 32 + g_random_int_range (0, 64);
+      (*p2)[y * WIDTH + x] = (x + y + 1) / 32 + g_random_int_range (0, 64);
+    }
+  }
+}
+
+/* best of N_RUNS sums of the planes, in pixels per second of the plane */
+static gdouble
+time_kernel (const Kernel * kernel, const guint8 * p1, const guint8 * p2)
+{
+  GstClockTime start, elapsed, best = GST_CLOCK_TIME_NONE;
+  gint run, y;
+
+  for (run = 0; run < N_RUNS; run++) {
+    start = gst_util_get_timestamp ();
+    for (y = 0; y < HEIGHT; y++)
+      kernel->sad_line (p1 + y * WIDTH, p2 + y * WIDTH, WIDTH);
+    elapsed = gst_util_get_timestamp () - start;
+    best = MIN (best, elapsed);
+  }
+
+  return (gdouble) WIDTH * HEIGHT * GST_SECOND / best;
+}
+
+static gdouble
+time_plane (const guint8 * p1, const guint8 * p2, gint step, gdouble * mad)
+{
+  GstClockTime start, elapsed, best = GST_CLOCK_TIME_NONE;
+  guint64 sad = 0, n_pixels = 0;
+  gint run;
+
+  for (run = 0; run < N_RUNS; run++) {
+    start = gst_util_get_timestamp ();
+    sad = video_sad_plane (p1, WIDTH, p2, WIDTH, WIDTH, HEIGHT, step,
+        &n_pixels);
+    elapsed = gst_util_get_timestamp () - start;
+    best = MIN (best, elapsed);
+  }
+
+  *mad = (gdouble) sad / n_pixels;
+  return (gdouble) WIDTH * HEIGHT * GST_SECOND / best;
+}
+
+static gdouble
+run_scenechange (guint n_frames, guint sample_step)
+{
+  GstElement *pipeline;
+  GstMessage *msg;
+  GstBus *bus;
+  gchar *desc;
+  GstClockTime start, elapsed;
+
+  desc = g_strdup_printf ("videotestsrc num-buffers=%u pattern=ball ! "
+      "video/x-raw,format=I420,width=%u,height=%u,framerate=25/1 ! "
+      "scenechange sample-step=%u ! fakesink sync=false", n_frames, WIDTH,
+      HEIGHT, sample_step);
+  pipeline = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  if (!pipeline)
+    g_error ("Could not create pipeline, check GST_PLUGIN_PATH");
+
+  gst_element_set_state (pipeline, GST_STATE_PAUSED);
+  gst_element_get_state (pipeline, NULL, NULL, GST_CLOCK_TIME_NONE);
+
+  start = gst_util_get_timestamp ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  elapsed = gst_util_get_timestamp () - start;
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR)
+    g_error ("Error while detecting scene changes");
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return (gdouble) n_frames * GST_SECOND / elapsed;
+}
+
+gint
+main (gint argc, gchar * argv[])
+{
+  Kernel kernels[3];
+  guint n_kernels, n_frames = 100, step, i;
+  gboolean exact = TRUE;
+  guint8 *p1, *p2;
+  gdouble mad, pps;
+
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    n_frames = MAX (atoi (argv[1]), 1);
+
+  n_kernels = get_kernels (kernels);
+
+  for (i = 1; i < n_kernels; i++)
+    exact &= check_kernel (&kernels[i]);
+  g_print ("line functions %s video_sad_line_c\n",
+      exact ? "match" : "DIFFER FROM");
+
+  make_planes (&p1, &p2);
+
+  g_print ("%ux%u planes:\n", WIDTH, HEIGHT);
+  for (i = 0; i < n_kernels; i++) {
+    g_print ("%-5s: %6.2f Gpixels/s\n", kernels[i].name,
+        time_kernel (&kernels[i], p1, p2) / 1e9);
+  }
+  for (step = 1; step <= 8; step *= 2) {
+    pps = time_plane (p1, p2, step, &mad);
+    g_print ("sample step %u: %6.2f Gpixels/s, mean difference %.3f\n", step,
+        pps / 1e9, mad);
+  }
+
+  g_free (p1);
+  g_free (p2);
+
+  g_print ("%u frames of %ux%u I420\n", n_frames, WIDTH, HEIGHT);
+  for (step = 1; step <= 8; step *= 2) {
+    g_print ("sample step %u: %7.1f frames/s\n", step,
+        run_scenechange (n_frames, step));
+  }
+
+  return exact ? 0 : 1;
+}
@@ -0,0 +1,175 @@
+/* GStreamer
+ *
+ * shm.c: benchmark the shmsink to shmsrc transport
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Sends frames of the size of a 4K I420 frame from a shmsink to a shmsrc
+ * as fast as possible and reports the number of frames per second and the
+ * latency between shmsink and the element after shmsrc, first over the
+ * control socket and then with a ring of increasing size.
+ *
+ * Both pipelines run in this process, but they only communicate through
+ * the shm transport. The frames are copied into the shm area by shmsink,
+ * pass a smaller frame size to reduce the part of that copy.
+ *
+ * Usage: shm [n-frames] [frame-size]
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <gst/gst.h>
+
+typedef struct
+{
+  GMutex lock;
+  GCond cond;
+  /* monotonic time at which each frame reached shmsink */
+  GArray *send_times;
+  guint received;
+  gint64 total_latency;
+  gint64 max_latency;
+} Stats;
+
+static GstPadProbeReturn
+send_probe (GstPad * pad, GstPadProbeInfo * info, Stats * stats)
+{
+  gint64 now = g_get_monotonic_time ();
+
+  g_mutex_lock (&stats->lock);
+  g_array_append_val (stats->send_times, now);
+  g_mutex_unlock (&stats->lock);
+
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+handoff_cb (GstElement * sink, GstBuffer * buf, GstPad * pad, Stats * stats)
+{
+  gint64 now = g_get_monotonic_time (), latency;
+
+  g_mutex_lock (&stats->lock);
+  latency = now - g_array_index (stats->send_times, gint64, stats->received);
+  stats->total_latency += latency;
+  stats->max_latency = MAX (stats->max_latency, latency);
+  stats->received++;
+  g_cond_signal (&stats->cond);
+  g_mutex_unlock (&stats->lock);
+}
+
+static void
+run_shm (guint n_frames, guint frame_size, guint ring_size)
+{
+  GstElement *writer, *reader, *shmsink, *fakesink;
+  GstPad *pad;
+  Stats stats;
+  gchar *desc, *socket_path;
+  gint64 start, elapsed;
+
+  g_mutex_init (&stats.lock);
+  g_cond_init (&stats.cond);
+  stats.send_times = g_array_sized_new (FALSE, FALSE, sizeof (gint64),
+      n_frames);
+  stats.received = 0;
+  stats.total_latency = stats.max_latency = 0;
+
+  socket_path = g_strdup_printf ("%s/shm-bench-%d", g_get_tmp_dir (),
+      (gint) getpid ());
+  desc = g_strdup_printf ("fakesrc num-buffers=%u sizetype=fixed sizemax=%u "
+      "filltype=nothing ! shmsink name=sink socket-path=%s shm-size=%u "
+      "ring-size=%u slot-size=4096 sync=false", n_frames, frame_size,
+      socket_path, frame_size * 8, ring_size);
+  writer = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  g_free (socket_path);
+  if (!writer)
+    g_error ("Could not create pipeline, check GST_PLUGIN_PATH");
+
+  shmsink = gst_bin_get_by_name (GST_BIN (writer), "sink");
+  pad = gst_element_get_static_pad (shmsink, "sink");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER,
+      (GstPadProbeCallback) send_probe, &stats, NULL);
+  gst_object_unref (pad);
+
+  /* the socket only exists once shmsink is started, and its path might
+   * have been changed if it was in use */
+  gst_element_set_state (writer, GST_STATE_PLAYING);
+  g_object_get (shmsink, "socket-path", &socket_path, NULL);
+  gst_object_unref (shmsink);
+
+  desc = g_strdup_printf ("shmsrc socket-path=%s is-live=true ! "
+      "fakesink name=sink sync=false signal-handoffs=true", socket_path);
+  reader = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  g_free (socket_path);
+
+  fakesink = gst_bin_get_by_name (GST_BIN (reader), "sink");
+  g_signal_connect (fakesink, "handoff", G_CALLBACK (handoff_cb), &stats);
+  gst_object_unref (fakesink);
+
+  start = g_get_monotonic_time ();
+  gst_element_set_state (reader, GST_STATE_PLAYING);
+
+  g_mutex_lock (&stats.lock);
+  while (stats.received < n_frames)
+    g_cond_wait (&stats.cond, &stats.lock);
+  g_mutex_unlock (&stats.lock);
+  elapsed = g_get_monotonic_time () - start;
+
+  gst_element_set_state (reader, GST_STATE_NULL);
+  gst_element_set_state (writer, GST_STATE_NULL);
+  gst_object_unref (reader);
+  gst_object_unref (writer);
+
+  if (ring_size == 0)
+    g_print ("socket:       ");
+  else
+    g_print ("ring of %4u: ", ring_size);
+  g_print ("%8.1f frames/s, latency %6.1f us average, %6" G_GINT64_FORMAT
+      " us max\n", (gdouble) n_frames * G_USEC_PER_SEC / elapsed,
+      (gdouble) stats.total_latency / n_frames, stats.max_latency);
+
+  g_array_free (stats.send_times, TRUE);
+  g_cond_clear (&stats.cond);
+  g_mutex_clear (&stats.lock);
+}
+
+gint
+main (gint argc, gchar * argv[])
+{
+  guint n_frames = 1000, frame_size = 3840 * 2160 * 3 / 2;
+  guint ring_size;
+
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    n_frames = MAX (atoi (argv[1]), 1);
+  if (argc > 2)
+    frame_size = MAX (atoi (argv[2]), 1);
+
+  g_print ("%u frames of %u bytes\n", n_frames, frame_size);
+
+  run_shm (n_frames, frame_size, 0);
+  for (ring_size = 4; ring_size <= 64; ring_size *= 4)
+    run_shm (n_frames, frame_size, ring_size);
+
+  return 0;
+}
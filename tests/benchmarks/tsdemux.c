@@ -0,0 +1,424 @@
+/* GStreamer
+ *
+ * tsdemux.c: benchmark PES reassembly in tsdemux
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Generates a multi-program transport stream in memory (one MPEG-2 video and
+ * one MPEG audio stream per program) and pushes it through tsdemux, once for
+ * each program. Reports the demuxing throughput and how many bytes of the
+ * output buffers had to be copied, as opposed to being shared with the
+ * input buffers.
+ *
+ * The same stream is then filtered by tsparse, keeping the PIDs of one
+ * program, to compare its throughput with the one of a plain tsparse.
+ *
+ * Usage: tsdemux [n-programs] [n-frames]
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <stdlib.h>
+#include <gst/gst.h>
+
+#define TS_PACKET_SIZE 188
+/* 7 packets, as sent over UDP */
+#define TS_CHUNK_SIZE (7 * TS_PACKET_SIZE)
+
+#define PMT_PID(p) (0x100 + (p))
+#define VIDEO_PID(p) (0x200 + 2 * (p))
+#define AUDIO_PID(p) (0x201 + 2 * (p))
+
+static guint8 continuity[0x2000];
+
+typedef struct
+{
+  guint64 bytes;
+  guint64 copied_bytes;
+  guint64 buffers;
+  guint64 memories;
+} OutputStats;
+
+static guint32
+crc32_mpeg (const guint8 * data, guint size)
+{
+  guint32 crc = 0xffffffff;
+  guint i, j;
+
+  for (i = 0; i < size; i++) {
+    crc ^= (guint32) data[i] << 24;
+    for (j = 0; j < 8; j++)
+      crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+  }
+
+  return crc;
+}
+
+/* Writes one TS packet carrying @size bytes (at most 184, or 176 if a
+ * PCR is written) of @data, padding with adaptation field stuffing */
+static void
+put_ts_packet (GByteArray * ts, guint16 pid, gboolean pusi, gint64 pcr,
+    const guint8 * data, guint size)
+{
+  guint8 pkt[TS_PACKET_SIZE];
+  gboolean has_af = pcr >= 0 || size < 184;
+  guint pos = 4;
+
+  pkt[0] = 0x47;
+  pkt[1] = (pusi ? 0x40 : 0x00) | ((pid >> 8) & 0x1f);
+  pkt[2] = pid & 0xff;
+  pkt[3] = (has_af ? 0x30 : 0x10) | (continuity[pid]++ & 0x0f);
+
+  if (has_af) {
+    guint af_len = 183 - size;
+
+    pkt[4] = af_len;
+    if (af_len > 0) {
+      pkt[5] = pcr >= 0 ? 0x10 : 0x00;
+      memset (pkt + 6, 0xff, af_len - 1);
+      if (pcr >= 0) {
+        guint64 base = pcr / 300;
+        guint ext = pcr % 300;
+
+        pkt[6] = base >> 25;
+        pkt[7] = base >> 17;
+        pkt[8] = base >> 9;
+        pkt[9] = base >> 1;
+        pkt[10] = ((base & 1) << 7) | 0x7e | ((ext >> 8) & 1);
+        pkt[11] = ext & 0xff;
+      }
+    }
+    pos = 5 + af_len;
+  }
+
+  memcpy (pkt + pos, data, size);
+  g_byte_array_append (ts, pkt, TS_PACKET_SIZE);
+}
+
+static void
+put_section (GByteArray * ts, guint16 pid, guint8 * section, guint size)
+{
+  guint8 payload[184];
+  guint32 crc;
+
+  crc = crc32_mpeg (section, size - 4);
+  GST_WRITE_UINT32_BE (section + size - 4, crc);
+
+  payload[0] = 0;               /* pointer_field */
+  memcpy (payload + 1, section, size);
+  put_ts_packet (ts, pid, TRUE, -1, payload, size + 1);
+}
+
+static void
+put_psi (GByteArray * ts, guint n_programs)
+{
+  guint8 section[184];
+  guint i, len;
+
+  /* PAT */
+  len = 5 + 4 * n_programs + 4;
+  section[0] = 0x00;
+  section[1] = 0xb0 | (len >> 8);
+  section[2] = len & 0xff;
+  GST_WRITE_UINT16_BE (section + 3, 1);
+  section[5] = 0xc1;
+  section[6] = section[7] = 0;
+  for (i = 0; i < n_programs; i++) {
+    GST_WRITE_UINT16_BE (section + 8 + 4 * i, i + 1);
+    GST_WRITE_UINT16_BE (section + 10 + 4 * i, 0xe000 | PMT_PID (i));
+  }
+  put_section (ts, 0, section, 3 + len);
+
+  /* PMTs */
+  for (i = 0; i < n_programs; i++) {
+    len = 9 + 2 * 5 + 4;
+    section[0] = 0x02;
+    section[1] = 0xb0 | (len >> 8);
+    section[2] = len & 0xff;
+    GST_WRITE_UINT16_BE (section + 3, i + 1);
+    section[5] = 0xc1;
+    section[6] = section[7] = 0;
+    GST_WRITE_UINT16_BE (section + 8, 0xe000 | VIDEO_PID (i));
+    GST_WRITE_UINT16_BE (section + 10, 0xf000);
+    section[12] = 0x02;
+    GST_WRITE_UINT16_BE (section + 13, 0xe000 | VIDEO_PID (i));
+    GST_WRITE_UINT16_BE (section + 15, 0xf000);
+    section[17] = 0x03;
+    GST_WRITE_UINT16_BE (section + 18, 0xe000 | AUDIO_PID (i));
+    GST_WRITE_UINT16_BE (section + 20, 0xf000);
+    put_section (ts, PMT_PID (i), section, 3 + len);
+  }
+}
+
+static void
+put_pes (GByteArray * ts, guint16 pid, guint8 stream_id, guint64 pts,
+    guint payload_size, gboolean bounded, gint64 pcr)
+{
+  guint8 *pes;
+  guint size = 14 + payload_size, pos = 0;
+  gboolean first = TRUE;
+
+  pes = g_malloc (size);
+  pes[0] = pes[1] = 0;
+  pes[2] = 1;
+  pes[3] = stream_id;
+  GST_WRITE_UINT16_BE (pes + 4, bounded ? size - 6 : 0);
+  pes[6] = 0x80;
+  pes[7] = 0x80;
+  pes[8] = 5;
+  pes[9] = 0x21 | ((pts >> 29) & 0x0e);
+  pes[10] = (pts >> 22) & 0xff;
+  pes[11] = ((pts >> 14) & 0xfe) | 1;
+  pes[12] = (pts >> 7) & 0xff;
+  pes[13] = ((pts << 1) & 0xfe) | 1;
+  memset (pes + 14, stream_id, payload_size);
+
+  while (pos < size) {
+    guint chunk = MIN (size - pos, (first && pcr >= 0) ? 176 : 184);
+
+    put_ts_packet (ts, pid, first, first ? pcr : -1, pes + pos, chunk);
+    pos += chunk;
+    first = FALSE;
+  }
+
+  g_free (pes);
+}
+
+static GByteArray *
+generate_stream (guint n_programs, guint n_frames)
+{
+  GByteArray *ts = g_byte_array_new ();
+  GRand *rand = g_rand_new_with_seed (42);
+  guint f, p;
+
+  for (f = 0; f < n_frames; f++) {
+    /* 25 fps video, 2 audio frames per video frame */
+    guint64 pts = 90000 + f * 3600;
+
+    if (f % 10 == 0)
+      put_psi (ts, n_programs);
+
+    for (p = 0; p < n_programs; p++) {
+      guint video_size = (f % 12 == 0) ? g_rand_int_range (rand, 60000, 90000)
+          : g_rand_int_range (rand, 8000, 30000);
+
+      put_pes (ts, VIDEO_PID (p), 0xe0, pts, video_size, FALSE,
+          (pts - 9000) * 300);
+      put_pes (ts, AUDIO_PID (p), 0xc0, pts, 576, TRUE, -1);
+      put_pes (ts, AUDIO_PID (p), 0xc0, pts + 1800, 576, TRUE, -1);
+    }
+  }
+
+  g_rand_free (rand);
+
+  return ts;
+}
+
+static GstFlowReturn
+sink_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  OutputStats *stats = g_object_get_data (G_OBJECT (pad), "stats");
+  guint i, n = gst_buffer_n_memory (buffer);
+
+  for (i = 0; i < n; i++) {
+    GstMemory *mem = gst_buffer_peek_memory (buffer, i);
+
+    /* Memory shared with the input buffers has a parent */
+    if (mem->parent == NULL)
+      stats->copied_bytes += mem->size;
+  }
+  stats->bytes += gst_buffer_get_size (buffer);
+  stats->memories += n;
+  stats->buffers++;
+
+  gst_buffer_unref (buffer);
+
+  return GST_FLOW_OK;
+}
+
+static gboolean
+sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
+{
+  gst_event_unref (event);
+  return TRUE;
+}
+
+static void
+pad_added_cb (GstElement * demux, GstPad * srcpad, OutputStats * stats)
+{
+  GstPad *sinkpad = gst_pad_new ("sink", GST_PAD_SINK);
+
+  g_object_set_data (G_OBJECT (sinkpad), "stats", stats);
+  gst_pad_set_chain_function (sinkpad, sink_chain);
+  gst_pad_set_event_function (sinkpad, sink_event);
+  gst_pad_set_active (sinkpad, TRUE);
+  gst_pad_link (srcpad, sinkpad);
+  /* the peer pad keeps the sink pad alive */
+  gst_object_unref (sinkpad);
+}
+
+static GstClockTime
+run_element (GstElement * element, GByteArray * ts)
+{
+  GstPad *srcpad, *sinkpad;
+  GstSegment segment;
+  GstClockTime start;
+  guint offset;
+
+  srcpad = gst_pad_new ("src", GST_PAD_SRC);
+  sinkpad = gst_element_get_static_pad (element, "sink");
+  gst_pad_link (srcpad, sinkpad);
+  gst_object_unref (sinkpad);
+  gst_pad_set_active (srcpad, TRUE);
+
+  gst_element_set_state (element, GST_STATE_PLAYING);
+
+  gst_segment_init (&segment, GST_FORMAT_BYTES);
+  gst_pad_push_event (srcpad, gst_event_new_stream_start ("tsdemux-bench"));
+  gst_pad_push_event (srcpad,
+      gst_event_new_caps (gst_caps_new_simple ("video/mpegts", "systemstream",
+              G_TYPE_BOOLEAN, TRUE, "packetsize", G_TYPE_INT, TS_PACKET_SIZE,
+              NULL)));
+  gst_pad_push_event (srcpad, gst_event_new_segment (&segment));
+
+  start = gst_util_get_timestamp ();
+  for (offset = 0; offset < ts->len; offset += TS_CHUNK_SIZE) {
+    guint size = MIN (TS_CHUNK_SIZE, ts->len - offset);
+    GstBuffer *buf;
+
+    buf = gst_buffer_new_allocate (NULL, size, NULL);
+    gst_buffer_fill (buf, 0, ts->data + offset, size);
+    GST_BUFFER_OFFSET (buf) = offset;
+
+    if (gst_pad_push (srcpad, buf) != GST_FLOW_OK)
+      break;
+  }
+  gst_pad_push_event (srcpad, gst_event_new_eos ());
+  start = gst_util_get_timestamp () - start;
+
+  gst_element_set_state (element, GST_STATE_NULL);
+  gst_pad_set_active (srcpad, FALSE);
+  gst_object_unref (srcpad);
+  gst_object_unref (element);
+
+  return start;
+}
+
+static GstClockTime
+run_demux (GByteArray * ts, guint program, OutputStats * stats)
+{
+  GstElement *demux;
+
+  demux = gst_element_factory_make ("tsdemux", NULL);
+  if (!demux)
+    g_error ("tsdemux element not found, check GST_PLUGIN_PATH");
+
+  g_object_set (demux, "program-number", program, NULL);
+  g_signal_connect (demux, "pad-added", G_CALLBACK (pad_added_cb), stats);
+
+  return run_element (demux, ts);
+}
+
+static GstClockTime
+run_parse (GByteArray * ts, const gchar * pids, OutputStats * stats)
+{
+  GstElement *parse;
+  GstPad *srcpad;
+
+  parse = gst_element_factory_make ("tsparse", NULL);
+  if (!parse)
+    g_error ("tsparse element not found, check GST_PLUGIN_PATH");
+
+  g_object_set (parse, "pids", pids, NULL);
+  srcpad = gst_element_get_static_pad (parse, "src");
+  pad_added_cb (parse, srcpad, stats);
+  gst_object_unref (srcpad);
+
+  return run_element (parse, ts);
+}
+
+static void
+print_parse (GByteArray * ts, const gchar * pids)
+{
+  OutputStats stats = { 0, };
+  GstClockTime t;
+
+  t = run_parse (ts, pids, &stats);
+
+  g_print ("tsparse pids=%s: %10" G_GUINT64_FORMAT " bytes output, "
+      "%.3f bytes copied per output byte, %.1f MB/s of input\n",
+      pids ? pids : "(all)", stats.bytes,
+      (gdouble) stats.copied_bytes / MAX (stats.bytes, 1),
+      ((gdouble) ts->len / (1024 * 1024)) / ((gdouble) t / GST_SECOND));
+}
+
+gint
+main (gint argc, gchar * argv[])
+{
+  GByteArray *ts;
+  OutputStats total = { 0, };
+  GstClockTime elapsed = 0;
+  guint n_programs = 8, n_frames = 250, p;
+  gchar *pids;
+
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    n_programs = CLAMP (atoi (argv[1]), 1, 40);
+  if (argc > 2)
+    n_frames = MAX (atoi (argv[2]), 1);
+
+  ts = generate_stream (n_programs, n_frames);
+  g_print ("%u programs, %u frames: %u bytes of transport stream\n",
+      n_programs, n_frames, ts->len);
+
+  for (p = 1; p <= n_programs; p++) {
+    OutputStats stats = { 0, };
+    GstClockTime t;
+
+    t = run_demux (ts, p, &stats);
+    elapsed += t;
+
+    g_print ("program %2u: %8" G_GUINT64_FORMAT " buffers, %10"
+        G_GUINT64_FORMAT " bytes, %.3f memories/buffer, %.3f bytes copied"
+        " per output byte, %" GST_TIME_FORMAT "\n", p, stats.buffers,
+        stats.bytes, (gdouble) stats.memories / MAX (stats.buffers, 1),
+        (gdouble) stats.copied_bytes / MAX (stats.bytes, 1),
+        GST_TIME_ARGS (t));
+
+    total.bytes += stats.bytes;
+    total.copied_bytes += stats.copied_bytes;
+  }
+
+  g_print ("total: %.3f bytes copied per output byte, %.1f MB/s of input\n",
+      (gdouble) total.copied_bytes / MAX (total.bytes, 1),
+      ((gdouble) ts->len * n_programs / (1024 * 1024)) /
+      ((gdouble) elapsed / GST_SECOND));
+
+  pids = g_strdup_printf ("0:%u:%u:%u", PMT_PID (0), VIDEO_PID (0),
+      AUDIO_PID (0));
+  print_parse (ts, NULL);
+  print_parse (ts, pids);
+  g_free (pids);
+
+  g_byte_array_unref (ts);
+
+  return 0;
+}
@@ -0,0 +1,285 @@
+/* GStreamer
+ *
+ * yadif.c: benchmark the yadif line filters and row band parallel filtering
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Checks that each SIMD line filter supported by the CPU gives the same
+ * output as filter_line_c() (8 bit) and filter_line_c_16bit() (10 bit) for
+ * random lines, then reports the pixels per second of each line filter on
+ * 1080 lines. Finally deinterlaces 1080i frames with the yadif element and
+ * reports the frames per second for an increasing number of threads.
+ *
+ * Usage: yadif [n-frames]
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <gst/gst.h>
+
+/* the line filters are static */
+#include "../../gst/yadif/vf_yadif.c"
+#undef CHECK
+#undef FILTER
+#include "../../gst/yadif/yadif.c"
+
+#define WIDTH 1920
+#define HEIGHT 1080
+#define N_RUNS 5
+#define N_CHECKS 20000
+
+typedef struct
+{
+  const gchar *name;
+  GstYadifFilterLineFunc filter_line;
+  GstYadifFilterLine16Func filter_line_16bit;
+} Kernel;
+
+static guint
+get_kernels (Kernel * kernels)
+{
+  guint n = 0;
+
+  kernels[n].name = "c";
+  kernels[n].filter_line = filter_line_c;
+  kernels[n++].filter_line_16bit = filter_line_c_16bit;
+#if defined (__SSE2__)
+  kernels[n].name = "sse2";
+  kernels[n].filter_line = yadif_filter_line_sse2;
+  kernels[n++].filter_line_16bit = yadif_filter_line_16bit_sse2;
+#ifdef HAVE_YADIF_AVX2
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("ssse3")) {
+    kernels[n].name = "ssse3";
+    kernels[n].filter_line = yadif_filter_line_ssse3;
+    kernels[n++].filter_line_16bit = yadif_filter_line_16bit_ssse3;
+  }
+  if (__builtin_cpu_supports ("avx2")) {
+    kernels[n].name = "avx2";
+    kernels[n].filter_line = yadif_filter_line_avx2;
+    kernels[n++].filter_line_16bit = yadif_filter_line_16bit_avx2;
+  }
+#endif
+#endif
+
+  return n;
+}
+
+/* 5 lines of random samples of depth bits, or of a gradient for every other
+ * line set so that the spatial checks find directions */
+static void
+fill_lines (guint8 * data, gint stride, gint depth, gboolean smooth)
+{
+  gint i, y;
+
+  for (y = 0; y < 5; y++) {
+    guint8 *line = data + y * stride;
+
+    for (i = 0; i < stride / 2; i++) {
+      guint v;
+
+      if (smooth)
+        v = (i + 2 * y) * 3 / 2 + g_random_int_range (0, 2);
+      else
+        v = g_random_int ();
+      v &= (1 << depth) - 1;
+
+      if (depth > 8)
+        ((guint16 *) line)[i] = v;
+      else
+        line[i] = line[stride / 2 + i] = v;
+    }
+  }
+}
+
+static gboolean
+check_kernel (const Kernel * kernel, gint depth)
+{
+  gint stride = (WIDTH + 64) * 2;
+  guint8 *frames[3], *ref, *out;
+  guint i, k, mismatches = 0;
+
+  for (k = 0; k < 3; k++)
+    frames[k] = g_malloc (5 * stride);
+  ref = g_malloc0 (5 * stride);
+  out = g_malloc0 (5 * stride);
+
+  for (i = 0; i < N_CHECKS; i++) {
+    gint w = g_random_int_range (SIMD_MIN_WIDTH + 6, WIDTH);
+    gint parity = g_random_int_range (0, 2);
+    gint mode = g_random_int_range (0, 3);
+    gint o = 2 * stride + 3 * (depth > 8 ? 2 : 1);
+
+    for (k = 0; k < 3; k++)
+      fill_lines (frames[k], stride, depth, i & 1);
+
+    if (depth > 8) {
+      filter_line_c_16bit ((guint16 *) (ref + o), (guint16 *) (frames[0] + o),
+          (guint16 *) (frames[1] + o), (guint16 *) (frames[2] + o), w - 6,
+          stride, -stride, parity, mode);
+      kernel->filter_line_16bit ((guint16 *) (out + o),
+          (guint16 *) (frames[0] + o), (guint16 *) (frames[1] + o),
+          (guint16 *) (frames[2] + o), w - 6, stride, -stride, parity, mode);
+    } else {
+      filter_line_c (ref + o, frames[0] + o, frames[1] + o, frames[2] + o,
+          w - 6, stride, -stride, parity, mode);
+      kernel->filter_line (out + o, frames[0] + o, frames[1] + o,
+          frames[2] + o, w - 6, stride, -stride, parity, mode);
+    }
+
+    if (memcmp (ref + 2 * stride, out + 2 * stride, stride) != 0)
+      mismatches++;
+  }
+
+  for (k = 0; k < 3; k++)
+    g_free (frames[k]);
+  g_free (ref);
+  g_free (out);
+
+  if (mismatches)
+    g_print ("%-6s %2d bit: %u of %u lines differ from C\n", kernel->name,
+        depth, mismatches, N_CHECKS);
+
+  return mismatches == 0;
+}
+
+/* best of N_RUNS filtering of the HEIGHT / 2 lines of a field */
+static gdouble
+time_kernel (const Kernel * kernel, gint depth)
+{
+  gint stride = WIDTH * 2, y, run;
+  guint8 *frames[3], *out;
+  GstClockTime start, elapsed, best = GST_CLOCK_TIME_NONE;
+  guint k;
+
+  for (k = 0; k < 3; k++) {
+    frames[k] = g_malloc (HEIGHT * stride);
+    for (y = 0; y < HEIGHT * stride; y++)
+      frames[k][y] = depth > 8 && (y & 1) ? g_random_int () & 3 :
+          g_random_int ();
+  }
+  out = g_malloc (HEIGHT * stride);
+
+  for (run = 0; run < N_RUNS; run++) {
+    start = gst_util_get_timestamp ();
+    for (y = 3; y < HEIGHT - 3; y += 2) {
+      gint o = y * stride;
+
+      if (depth > 8)
+        kernel->filter_line_16bit ((guint16 *) (out + o) + 3,
+            (guint16 *) (frames[0] + o) + 3, (guint16 *) (frames[1] + o) + 3,
+            (guint16 *) (frames[2] + o) + 3, WIDTH - 6, stride, -stride, 0,
+            0);
+      else
+        kernel->filter_line (out + o + 3, frames[0] + o + 3,
+            frames[1] + o + 3, frames[2] + o + 3, WIDTH - 6, stride, -stride,
+            0, 0);
+    }
+    elapsed = gst_util_get_timestamp () - start;
+    best = MIN (best, elapsed);
+  }
+
+  for (k = 0; k < 3; k++)
+    g_free (frames[k]);
+  g_free (out);
+
+  return (gdouble) (WIDTH - 6) * ((HEIGHT - 6) / 2) * GST_SECOND / best;
+}
+
+static gdouble
+run_yadif (guint n_frames, guint n_threads)
+{
+  GstElement *pipeline;
+  GstMessage *msg;
+  GstBus *bus;
+  gchar *desc;
+  GstClockTime start, elapsed;
+
+  desc = g_strdup_printf ("videotestsrc num-buffers=%u pattern=ball ! "
+      "video/x-raw,format=I420,width=%u,height=%u,framerate=25/1,"
+      "interlace-mode=interleaved ! yadif mode=interlaced n-threads=%u ! "
+      "fakesink sync=false", n_frames, WIDTH, HEIGHT, n_threads);
+  pipeline = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  if (!pipeline)
+    g_error ("Could not create pipeline, check GST_PLUGIN_PATH");
+
+  gst_element_set_state (pipeline, GST_STATE_PAUSED);
+  gst_element_get_state (pipeline, NULL, NULL, GST_CLOCK_TIME_NONE);
+
+  start = gst_util_get_timestamp ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  elapsed = gst_util_get_timestamp () - start;
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR)
+    g_error ("Error while deinterlacing");
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return (gdouble) n_frames * GST_SECOND / elapsed;
+}
+
+gint
+main (gint argc, gchar * argv[])
+{
+  Kernel kernels[4];
+  guint n_kernels, n_frames = 200, n_threads, n_processors, i;
+  gboolean exact = TRUE;
+  gdouble fps, base_fps = 0;
+
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    n_frames = MAX (atoi (argv[1]), 1);
+
+  n_kernels = get_kernels (kernels);
+
+  for (i = 1; i < n_kernels; i++) {
+    exact &= check_kernel (&kernels[i], 8);
+    exact &= check_kernel (&kernels[i], 10);
+  }
+  g_print ("line filters %s filter_line_c\n", exact ? "match" : "DIFFER FROM");
+
+  g_print ("%ux%u field lines:\n", WIDTH, HEIGHT);
+  for (i = 0; i < n_kernels; i++) {
+    g_print ("%-6s  8 bit: %7.1f Mpixels/s, 10 bit: %7.1f Mpixels/s\n",
+        kernels[i].name, time_kernel (&kernels[i], 8) / 1e6,
+        time_kernel (&kernels[i], 10) / 1e6);
+  }
+
+  n_processors = g_get_num_processors ();
+  g_print ("%u frames of %ux%u I420, %u processors\n", n_frames, WIDTH,
+      HEIGHT, n_processors);
+  for (n_threads = 1; n_threads <= MAX (n_processors, 2); n_threads *= 2) {
+    fps = run_yadif (n_frames, n_threads);
+    if (n_threads == 1)
+      base_fps = fps;
+    g_print ("%2u threads: %7.1f frames/s (x%.2f)\n", n_threads, fps,
+        fps / base_fps);
+  }
+
+  return exact ? 0 : 1;
+}
@@ -33,6 +33,7 @@
 
 #include <gst/check/gstcheck.h>
 #include <gst/check/gstconsistencychecker.h>
+#include <gst/check/gstharness.h>
 #include <gst/audio/audio.h>
 #include <gst/base/gstbasesrc.h>
 #include <gst/controller/gstdirectcontrolbinding.h>
@@ -1911,6 +1912,67 @@ GST_START_TEST (test_sinkpad_property_controller)
 
 GST_END_TEST;
 
+GST_START_TEST (test_mix_many_pads)
+{
+  GstElement *audiomixer;
+  GstHarness *h[8];
+  GstBuffer *buffer;
+  GstMapInfo map;
+  GstPad *pad;
+  guint i, j, n_samples = 0;
+
+  audiomixer = gst_element_factory_make ("audiomixer", NULL);
+  g_object_set (audiomixer, "output-buffer-duration", 100 * GST_MSECOND, NULL);
+
+  for (i = 0; i < G_N_ELEMENTS (h); i++) {
+    gchar *name = g_strdup_printf ("sink_%u", i);
+
+    h[i] = gst_harness_new_with_element (audiomixer, name, i ? NULL : "src");
+    gst_harness_set_src_caps_str (h[i], "audio/x-raw, "
+        "format=" GST_AUDIO_NE (S16) ", channels=(int)1, "
+        "layout=interleaved, rate=1000");
+    g_free (name);
+  }
+
+  /* the third input is muted and the fourth one mixed at half volume */
+  pad = gst_element_get_static_pad (audiomixer, "sink_2");
+  g_object_set (pad, "mute", TRUE, NULL);
+  gst_object_unref (pad);
+  pad = gst_element_get_static_pad (audiomixer, "sink_3");
+  g_object_set (pad, "volume", 0.5, NULL);
+  gst_object_unref (pad);
+
+  for (i = 0; i < G_N_ELEMENTS (h); i++) {
+    buffer = gst_buffer_new_and_alloc (500 * sizeof (gint16));
+    gst_buffer_map (buffer, &map, GST_MAP_WRITE);
+    for (j = 0; j < 500; j++)
+      ((gint16 *) map.data)[j] = i + 1;
+    gst_buffer_unmap (buffer, &map);
+    GST_BUFFER_PTS (buffer) = 0;
+    GST_BUFFER_DURATION (buffer) = 500 * GST_MSECOND;
+    fail_unless_equals_int (gst_harness_push (h[i], buffer), GST_FLOW_OK);
+  }
+
+  /* 1 + 2 + 4 / 2 + 5 + 6 + 7 + 8 */
+  while (n_samples < 500) {
+    buffer = gst_harness_pull (h[0]);
+    fail_unless (buffer != NULL);
+    gst_buffer_map (buffer, &map, GST_MAP_READ);
+    for (j = 0; j < map.size / sizeof (gint16); j++)
+      fail_unless_equals_int (((gint16 *) map.data)[j], 31);
+    n_samples += map.size / sizeof (gint16);
+    gst_buffer_unmap (buffer, &map);
+    gst_buffer_unref (buffer);
+  }
+  fail_unless_equals_int (n_samples, 500);
+
+  for (i = G_N_ELEMENTS (h); i > 0; i--)
+    gst_harness_teardown (h[i - 1]);
+  gst_object_unref (audiomixer);
+}
+
+GST_END_TEST;
+
 static Suite *
 audiomixer_suite (void)
 {
@@ -1936,6 +1998,7 @@ audiomixer_suite (void)
   tcase_add_test (tc_chain, test_sync_unaligned);
   tcase_add_test (tc_chain, test_segment_base_handling);
   tcase_add_test (tc_chain, test_sinkpad_property_controller);
+  tcase_add_test (tc_chain, test_mix_many_pads);
 
   /* Use a longer timeout */
 #ifdef HAVE_VALGRIND
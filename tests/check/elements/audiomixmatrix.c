@@ -0,0 +1,281 @@
+/* GStreamer
+ *
+ * unit test for audiomixmatrix
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <math.h>
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+#define FORMAT(f) f "LE"
+#else
+#define FORMAT(f) f "BE"
+#endif
+
+#define N_FRAMES 101
+
+typedef enum
+{
+  SAMPLE_S16,
+  SAMPLE_S32,
+  SAMPLE_F32,
+  SAMPLE_F64
+} SampleType;
+
+static const struct
+{
+  const gchar *format;
+  guint width;
+  gdouble scale;
+} sample_types[] = {
+  {FORMAT ("S16"), 2, 32767.0},
+  {FORMAT ("S32"), 4, 2147483647.0},
+  {FORMAT ("F32"), 4, 1.0},
+  {FORMAT ("F64"), 8, 1.0}
+};
+
+static void
+write_sample (SampleType type, guint8 * data, guint i, gdouble value)
+{
+  switch (type) {
+    case SAMPLE_S16:
+      ((gint16 *) data)[i] = (gint16) value;
+      break;
+    case SAMPLE_S32:
+      ((gint32 *) data)[i] = (gint32) value;
+      break;
+    case SAMPLE_F32:
+      ((gfloat *) data)[i] = (gfloat) value;
+      break;
+    case SAMPLE_F64:
+      ((gdouble *) data)[i] = value;
+      break;
+  }
+}
+
+static gdouble
+read_sample (SampleType type, const guint8 * data, guint i)
+{
+  switch (type) {
+    case SAMPLE_S16:
+      return ((const gint16 *) data)[i];
+    case SAMPLE_S32:
+      return ((const gint32 *) data)[i];
+    case SAMPLE_F32:
+      return ((const gfloat *) data)[i];
+    case SAMPLE_F64:
+      return ((const gdouble *) data)[i];
+  }
+
+  g_assert_not_reached ();
+  return 0;
+}
+
+static void
+set_matrix (GstElement * element, const gdouble * matrix, guint in_channels,
+    guint out_channels)
+{
+  GValue value = G_VALUE_INIT;
+  GValue row = G_VALUE_INIT;
+  GValue item = G_VALUE_INIT;
+  guint in, out;
+
+  g_value_init (&value, GST_TYPE_ARRAY);
+  for (out = 0; out < out_channels; out++) {
+    g_value_init (&row, GST_TYPE_ARRAY);
+    for (in = 0; in < in_channels; in++) {
+      g_value_init (&item, G_TYPE_DOUBLE);
+      g_value_set_double (&item, matrix[out * in_channels + in]);
+      gst_value_array_append_and_take_value (&row, &item);
+    }
+    gst_value_array_append_and_take_value (&value, &row);
+  }
+
+  g_object_set (element, "in-channels", in_channels, "out-channels",
+      out_channels, NULL);
+  g_object_set_property (G_OBJECT (element), "matrix", &value);
+  g_value_unset (&value);
+}
+
+/* Mixes random full scale samples with @matrix and compares the output with
+ * the mix computed in double precision. The integer formats round the
+ * coefficients to a fixed point and truncate the sums, the float formats
+ * are only allowed rounding errors. With @resize the channels are changed
+ * to more than the matrix has and back after the matrix is set */
+static void
+check_matrix (SampleType type, const gdouble * matrix, guint in_channels,
+    guint out_channels, gboolean resize)
+{
+  GstHarness *h;
+  GstBuffer *inbuf, *outbuf;
+  GstMapInfo map;
+  GRand *rand;
+  gdouble *input;
+  guint8 *data;
+  gchar *caps;
+  guint frame, in, out, width = sample_types[type].width;
+
+  h = gst_harness_new ("audiomixmatrix");
+  set_matrix (h->element, matrix, in_channels, out_channels);
+  if (resize) {
+    g_object_set (h->element, "in-channels", in_channels + 2, NULL);
+    g_object_set (h->element, "out-channels", out_channels + 2, NULL);
+    g_object_set (h->element, "in-channels", in_channels, "out-channels",
+        out_channels, NULL);
+  }
+  caps = g_strdup_printf ("audio/x-raw, format=%s, rate=48000, channels=%u, "
+      "layout=interleaved, channel-mask=(bitmask)0x0",
+      sample_types[type].format, in_channels);
+  gst_harness_set_src_caps_str (h, caps);
+  g_free (caps);
+
+  rand = g_rand_new_with_seed (type);
+  input = g_new (gdouble, N_FRAMES * in_channels);
+  data = g_malloc (N_FRAMES * in_channels * width);
+  for (frame = 0; frame < N_FRAMES * in_channels; frame++) {
+    gdouble value = g_rand_double_range (rand, -1.0, 1.0);
+
+    /* use the extremes too */
+    if (frame < 2)
+      value = frame == 0 ? 1.0 : -1.0;
+    write_sample (type, data, frame, value * sample_types[type].scale);
+    input[frame] = read_sample (type, data, frame);
+  }
+  g_rand_free (rand);
+
+  inbuf = gst_buffer_new_wrapped (data, N_FRAMES * in_channels * width);
+  outbuf = gst_harness_push_and_pull (h, inbuf);
+  fail_unless (outbuf != NULL);
+  fail_unless (gst_buffer_map (outbuf, &map, GST_MAP_READ));
+  fail_unless_equals_int (map.size, N_FRAMES * out_channels * width);
+
+  for (frame = 0; frame < N_FRAMES; frame++) {
+    for (out = 0; out < out_channels; out++) {
+      gdouble expected = 0, magnitude = 0, tolerance, value;
+
+      for (in = 0; in < in_channels; in++) {
+        gdouble term = input[frame * in_channels + in] *
+            matrix[out * in_channels + in];
+
+        expected += term;
+        magnitude += fabs (term);
+      }
+
+      switch (type) {
+        case SAMPLE_S16:
+        case SAMPLE_S32:
+          tolerance = 16 * in_channels + 2;
+          break;
+        case SAMPLE_F32:
+          tolerance = 1e-6 * in_channels * magnitude;
+          break;
+        default:
+          tolerance = 1e-14 * in_channels * magnitude;
+          break;
+      }
+
+      value = read_sample (type, map.data, frame * out_channels + out);
+      if (fabs (value - expected) > tolerance)
+        fail ("%s frame %u output %u: got %f, expected %f",
+            sample_types[type].format, frame, out, value, expected);
+    }
+  }
+
+  gst_buffer_unmap (outbuf, &map);
+  gst_buffer_unref (outbuf);
+  g_free (input);
+  gst_harness_teardown (h);
+}
+
+/* every output is a copy of one input or silent */
+static const gdouble permutation_matrix[5 * 4] = {
+  0, 0, 1, 0,
+  1, 0, 0, 0,
+  0, 0, 0, 1,
+  0, 1, 0, 0,
+  0, 0, 0, 0
+};
+
+/* 6 of 24 coefficients are non-zero */
+static const gdouble sparse_matrix[3 * 8] = {
+  0.5, 0, 0, 0, 0, -0.25, 0, 0,
+  0, 0, 0.75, 0, 0, 0, 0, 0.125,
+  0, -0.5, 0, 0, 0.5, 0, 0, 0
+};
+
+/* all coefficients are non-zero, and 5 outputs don't fill the padded rows
+ * of the converted matrix */
+static const gdouble dense_matrix[5 * 6] = {
+  0.25, 0.125, -0.125, 0.25, 0.125, 0.125,
+  -0.5, 0.1, 0.1, 0.1, 0.1, 0.1,
+  0.2, 0.2, 0.2, -0.2, 0.1, 0.1,
+  0.05, 0.05, 0.05, 0.05, 0.05, -0.75,
+  1.0 / 6, 1.0 / 6, 1.0 / 6, 1.0 / 6, 1.0 / 6, -1.0 / 6
+};
+
+GST_START_TEST (test_permutation)
+{
+  check_matrix (__i__, permutation_matrix, 4, 5, FALSE);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_sparse)
+{
+  check_matrix (__i__, sparse_matrix, 8, 3, FALSE);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_dense)
+{
+  check_matrix (__i__, dense_matrix, 6, 5, FALSE);
+}
+
+GST_END_TEST;
+
+/* the matrix is only used again once the channels match it */
+GST_START_TEST (test_channels_change)
+{
+  check_matrix (__i__, dense_matrix, 6, 5, TRUE);
+}
+
+GST_END_TEST;
+
+static Suite *
+audiomixmatrix_suite (void)
+{
+  Suite *s = suite_create ("audiomixmatrix");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_loop_test (tc_chain, test_permutation, SAMPLE_S16, SAMPLE_F64 + 1);
+  tcase_add_loop_test (tc_chain, test_sparse, SAMPLE_S16, SAMPLE_F64 + 1);
+  tcase_add_loop_test (tc_chain, test_dense, SAMPLE_S16, SAMPLE_F64 + 1);
+  tcase_add_loop_test (tc_chain, test_channels_change, SAMPLE_S16,
+      SAMPLE_F64 + 1);
+
+  return s;
+}
+
+GST_CHECK_MAIN (audiomixmatrix);
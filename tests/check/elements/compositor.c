@@ -2069,6 +2069,182 @@ GST_START_TEST (test_start_time_first_live_drop_3_unlinked_1)
 
 GST_END_TEST;
 
+/* Composite a single frame of three overlapping inputs, some of them partly
+ * outside of the output frame, and return the output buffer */
+static GstBuffer *
+_composite_frame (const gchar * format, const gchar * const in_formats[3],
+    const gchar * properties)
+{
+  GstElement *pipeline, *sink;
+  GstSample *sample;
+  GstBuffer *buffer;
+  gchar *desc;
+
+  desc = g_strdup_printf ("compositor name=mix %s "
+      "sink_0::xpos=-7 sink_0::ypos=-5 "
+      "sink_1::xpos=40 sink_1::ypos=33 sink_1::alpha=0.6 "
+      "sink_2::xpos=150 sink_2::ypos=141 sink_2::alpha=0.3 ! "
+      "video/x-raw,format=%s,width=320,height=243 ! appsink name=sink "
+      "videotestsrc num-buffers=1 pattern=smpte ! "
+      "video/x-raw,format=%s,width=300,height=200 ! mix.sink_0 "
+      "videotestsrc num-buffers=1 pattern=snow ! "
+      "video/x-raw,format=%s,width=180,height=150 ! mix.sink_1 "
+      "videotestsrc num-buffers=1 pattern=ball ! "
+      "video/x-raw,format=%s,width=200,height=130 ! mix.sink_2",
+      properties, format, in_formats[0], in_formats[1], in_formats[2]);
+  pipeline = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  fail_unless (pipeline != NULL);
+
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  g_signal_emit_by_name (sink, "pull-sample", &sample);
+  fail_unless (sample != NULL);
+  buffer = gst_buffer_ref (gst_sample_get_buffer (sample));
+  gst_sample_unref (sample);
+  gst_object_unref (sink);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return buffer;
+}
+
+/* Band-parallel compositing must give the same output as a single thread */
+GST_START_TEST (test_n_threads)
+{
+  const gchar *formats[] = { "AYUV", "BGRA", "I420", "NV12", "Y41B", "YUY2",
+    "RGB", "xRGB"
+  };
+  const gchar *backgrounds[] = { "checker", "black", "transparent" };
+  const guint n_threads[] = { 2, 3, 8, 0 };
+  guint i, j, k;
+
+  for (i = 0; i < G_N_ELEMENTS (formats); i++) {
+    const gchar *in_formats[] = { formats[i], formats[i], formats[i] };
+
+    for (j = 0; j < G_N_ELEMENTS (backgrounds); j++) {
+      GstBuffer *expected;
+      GstMapInfo expected_map;
+      gchar *props;
+
+      props = g_strdup_printf ("background=%s n-threads=1", backgrounds[j]);
+      expected = _composite_frame (formats[i], in_formats, props);
+      g_free (props);
+      gst_buffer_map (expected, &expected_map, GST_MAP_READ);
+
+      for (k = 0; k < G_N_ELEMENTS (n_threads); k++) {
+        GstBuffer *buffer;
+        GstMapInfo map;
+
+        GST_INFO ("%s, %s background, %u threads", formats[i],
+            backgrounds[j], n_threads[k]);
+
+        props = g_strdup_printf ("background=%s n-threads=%u", backgrounds[j],
+            n_threads[k]);
+        buffer = _composite_frame (formats[i], in_formats, props);
+        g_free (props);
+        gst_buffer_map (buffer, &map, GST_MAP_READ);
+        fail_unless_equals_int (map.size, expected_map.size);
+        fail_unless (memcmp (map.data, expected_map.data, map.size) == 0,
+            "%s output with %u threads differs", formats[i], n_threads[k]);
+        gst_buffer_unmap (buffer, &map);
+        gst_buffer_unref (buffer);
+      }
+
+      gst_buffer_unmap (expected, &expected_map);
+      gst_buffer_unref (expected);
+    }
+  }
+}
+
+GST_END_TEST;
+
+/* Preparing the frames of the pads in parallel, with multi-threaded
+ * converters, must give the same output as doing it serially */
+GST_START_TEST (test_prepare_threads)
+{
+  const gchar *in_formats[] = { "I420", "BGRA", "NV12" };
+  const gchar *properties[] = {
+    "prepare-threads=2",
+    "prepare-threads=0",
+    "prepare-threads=3 sink_0::converter-threads=2 sink_1::converter-threads=4",
+  };
+  GstBuffer *expected;
+  GstMapInfo expected_map;
+  guint i;
+
+  expected = _composite_frame ("AYUV", in_formats, "prepare-threads=1");
+  gst_buffer_map (expected, &expected_map, GST_MAP_READ);
+
+  for (i = 0; i < G_N_ELEMENTS (properties); i++) {
+    GstBuffer *buffer;
+    GstMapInfo map;
+
+    GST_INFO ("compositing with %s", properties[i]);
+
+    buffer = _composite_frame ("AYUV", in_formats, properties[i]);
+    gst_buffer_map (buffer, &map, GST_MAP_READ);
+    fail_unless_equals_int (map.size, expected_map.size);
+    fail_unless (memcmp (map.data, expected_map.data, map.size) == 0,
+        "output with %s differs", properties[i]);
+    gst_buffer_unmap (buffer, &map);
+    gst_buffer_unref (buffer);
+  }
+
+  gst_buffer_unmap (expected, &expected_map);
+  gst_buffer_unref (expected);
+}
+
+GST_END_TEST;
+
+/* The frames converted for a pad are reused from a pool instead of being
+ * allocated for every output frame */
+GST_START_TEST (test_converted_buffer_pool)
+{
+  GstElement *pipeline, *mix;
+  GstMessage *msg;
+  GstBus *bus;
+  GstPad *sinkpad;
+  guint64 n_allocations;
+
+  pipeline = gst_parse_launch ("compositor name=mix ! "
+      "video/x-raw,format=AYUV ! fakesink "
+      "videotestsrc num-buffers=30 ! video/x-raw,format=I420 ! mix.sink_0 "
+      "videotestsrc num-buffers=30 ! video/x-raw,format=AYUV ! mix.sink_1",
+      NULL);
+  fail_unless (pipeline != NULL);
+
+  bus = gst_element_get_bus (pipeline);
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  mix = gst_bin_get_by_name (GST_BIN (pipeline), "mix");
+
+  /* the I420 input is converted, one buffer is enough for all the frames */
+  sinkpad = gst_element_get_static_pad (mix, "sink_0");
+  g_object_get (sinkpad, "n-converted-allocations", &n_allocations, NULL);
+  fail_unless (n_allocations >= 1 && n_allocations <= 2,
+      "%" G_GUINT64_FORMAT " converted buffers allocated", n_allocations);
+  gst_object_unref (sinkpad);
+
+  /* the AYUV input is not converted */
+  sinkpad = gst_element_get_static_pad (mix, "sink_1");
+  g_object_get (sinkpad, "n-converted-allocations", &n_allocations, NULL);
+  fail_unless_equals_uint64 (n_allocations, 0);
+  gst_object_unref (sinkpad);
+
+  gst_object_unref (mix);
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+}
+
+GST_END_TEST;
+
 static Suite *
 compositor_suite (void)
 {
@@ -2102,6 +2278,9 @@ compositor_suite (void)
   tcase_add_test (tc_chain, test_start_time_first_live_drop_0);
   tcase_add_test (tc_chain, test_start_time_first_live_drop_3);
   tcase_add_test (tc_chain, test_start_time_first_live_drop_3_unlinked_1);
+  tcase_add_test (tc_chain, test_n_threads);
+  tcase_add_test (tc_chain, test_prepare_threads);
+  tcase_add_test (tc_chain, test_converted_buffer_pool);
 
   return s;
 }
@@ -4843,6 +4843,295 @@ GST_START_TEST (dash_mpdparser_segment_timeline)
 
 GST_END_TEST;
 
+/*
+ * Test that the unchanged nodes of a dynamic MPD are shared with its update
+ *
+ */
+GST_START_TEST (dash_mpdparser_update_reuse_nodes)
+{
+  GstPeriodNode *period, *new_period;
+  GstAdaptationSetNode *video, *audio, *new_video, *new_audio;
+  GstRepresentationNode *representation, *new_representation;
+
+  const gchar *xml_template =
+      "<?xml version=\"1.0\"?>"
+      "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\""
+      "     profiles=\"urn:mpeg:dash:profile:isoff-live:2011\""
+      "     type=\"dynamic\""
+      "     availabilityStartTime=\"2015-03-24T0:0:0\">"
+      "  <Period id=\"Period0\" start=\"PT0S\">"
+      "    <AdaptationSet id=\"1\" mimeType=\"video/mp4\">"
+      "      <SegmentTemplate media=\"$Time$.m4s\">"
+      "        <SegmentTimeline>"
+      "          <S t=\"0\" d=\"2\" r=\"%d\"></S>"
+      "        </SegmentTimeline>"
+      "      </SegmentTemplate>"
+      "      <Representation id=\"1\" bandwidth=\"250000\"></Representation>"
+      "      <Representation id=\"2\" bandwidth=\"500000\"></Representation>"
+      "    </AdaptationSet>"
+      "    <AdaptationSet id=\"2\" mimeType=\"audio/mp4\">"
+      "      <SegmentTemplate media=\"audio_$Number$.m4s\" duration=\"2\">"
+      "      </SegmentTemplate>"
+      "      <Representation id=\"3\" bandwidth=\"64000\"></Representation>"
+      "    </AdaptationSet>" "  </Period></MPD>";
+
+  gboolean ret;
+  gchar *xml;
+  GstMpdClient *mpdclient, *new_mpdclient;
+
+  xml = g_strdup_printf (xml_template, 10);
+  mpdclient = gst_mpd_client_new ();
+  ret = gst_mpd_parse (mpdclient, xml, (gint) strlen (xml));
+  assert_equals_int (ret, TRUE);
+  assert_equals_uint64 (mpdclient->parsed_bytes, strlen (xml));
+  assert_equals_int (mpdclient->parsed_nodes, 6);
+  assert_equals_int (mpdclient->reused_nodes, 0);
+  g_free (xml);
+
+  /* only the timeline of the video AdaptationSet changed, so its
+   * Representations and the audio AdaptationSet are shared */
+  xml = g_strdup_printf (xml_template, 11);
+  new_mpdclient = gst_mpd_client_new ();
+  ret = gst_mpd_parse_update (new_mpdclient, mpdclient, xml,
+      (gint) strlen (xml));
+  assert_equals_int (ret, TRUE);
+  assert_equals_int (new_mpdclient->parsed_nodes, 2);
+  assert_equals_int (new_mpdclient->reused_nodes, 3);
+  g_free (xml);
+
+  period = (GstPeriodNode *) mpdclient->mpd_node->Periods->data;
+  new_period = (GstPeriodNode *) new_mpdclient->mpd_node->Periods->data;
+  fail_if (period == new_period);
+
+  video = (GstAdaptationSetNode *) g_list_nth_data (period->AdaptationSets, 0);
+  audio = (GstAdaptationSetNode *) g_list_nth_data (period->AdaptationSets, 1);
+  new_video =
+      (GstAdaptationSetNode *) g_list_nth_data (new_period->AdaptationSets, 0);
+  new_audio =
+      (GstAdaptationSetNode *) g_list_nth_data (new_period->AdaptationSets, 1);
+  fail_if (video == new_video);
+  fail_unless (audio == new_audio);
+  assert_equals_int (g_list_length (new_video->Representations), 2);
+  representation = (GstRepresentationNode *) video->Representations->data;
+  new_representation =
+      (GstRepresentationNode *) new_video->Representations->data;
+  fail_unless (representation == new_representation);
+  assert_equals_uint64 (new_video->SegmentTemplate->
+      MultSegBaseType->SegmentTimeline->S.length, 1);
+
+  /* the shared nodes stay valid after the previous MPD is freed */
+  gst_mpd_client_free (mpdclient);
+  assert_equals_string (new_representation->id, "1");
+  assert_equals_string (new_audio->SegmentTemplate->media,
+      "audio_$Number$.m4s");
+
+  /* an update that is the same shares the whole Period */
+  xml = g_strdup_printf (xml_template, 11);
+  mpdclient = gst_mpd_client_new ();
+  ret = gst_mpd_parse_update (mpdclient, new_mpdclient, xml,
+      (gint) strlen (xml));
+  assert_equals_int (ret, TRUE);
+  assert_equals_int (mpdclient->parsed_nodes, 0);
+  assert_equals_int (mpdclient->reused_nodes, 1);
+  fail_unless (mpdclient->mpd_node->Periods->data == new_period);
+  g_free (xml);
+
+  gst_mpd_client_free (new_mpdclient);
+  gst_mpd_client_free (mpdclient);
+}
+
+GST_END_TEST;
+
+/*
+ * Test that an update only changing the SegmentTimeline of the Period is
+ * seen by the Representations that inherit it through an AdaptationSet
+ * without segment information of its own
+ *
+ */
+GST_START_TEST (dash_mpdparser_update_reuse_period_timeline)
+{
+  GstPeriodNode *new_period;
+  GstAdaptationSetNode *new_adapt_set;
+  GstRepresentationNode *new_representation;
+  GstSNode *s_node;
+  GList *adaptationSets;
+  GstActiveStream *activeStream;
+  GstMediaSegment *segment;
+
+  const gchar *xml_template =
+      "<?xml version=\"1.0\"?>"
+      "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\""
+      "     profiles=\"urn:mpeg:dash:profile:isoff-live:2011\""
+      "     type=\"dynamic\""
+      "     availabilityStartTime=\"2015-03-24T0:0:0\">"
+      "  <Period id=\"Period0\" start=\"PT0S\">"
+      "    <SegmentTemplate media=\"$Time$.m4s\">"
+      "      <SegmentTimeline>"
+      "        <S t=\"0\" d=\"2\" r=\"%d\"></S>"
+      "      </SegmentTimeline>"
+      "    </SegmentTemplate>"
+      "    <AdaptationSet id=\"1\" mimeType=\"video/mp4\">"
+      "      <Representation id=\"1\" bandwidth=\"250000\">"
+      "        <SegmentTemplate media=\"video_$Time$.m4s\">"
+      "        </SegmentTemplate>"
+      "      </Representation>" "    </AdaptationSet>" "  </Period></MPD>";
+
+  gboolean ret;
+  gchar *xml;
+  GstMpdClient *mpdclient, *new_mpdclient;
+
+  xml = g_strdup_printf (xml_template, 10);
+  mpdclient = gst_mpd_client_new ();
+  ret = gst_mpd_parse (mpdclient, xml, (gint) strlen (xml));
+  assert_equals_int (ret, TRUE);
+  assert_equals_int (mpdclient->parsed_nodes, 3);
+  g_free (xml);
+
+  /* the Representation copied the timeline of the Period, so neither it nor
+   * its AdaptationSet can be shared */
+  xml = g_strdup_printf (xml_template, 11);
+  new_mpdclient = gst_mpd_client_new ();
+  ret = gst_mpd_parse_update (new_mpdclient, mpdclient, xml,
+      (gint) strlen (xml));
+  assert_equals_int (ret, TRUE);
+  assert_equals_int (new_mpdclient->parsed_nodes, 3);
+  assert_equals_int (new_mpdclient->reused_nodes, 0);
+  g_free (xml);
+  gst_mpd_client_free (mpdclient);
+
+  new_period = (GstPeriodNode *) new_mpdclient->mpd_node->Periods->data;
+  new_adapt_set = (GstAdaptationSetNode *) new_period->AdaptationSets->data;
+  new_representation =
+      (GstRepresentationNode *) new_adapt_set->Representations->data;
+  s_node = (GstSNode *) g_queue_peek_head (&new_representation->
+      SegmentTemplate->MultSegBaseType->SegmentTimeline->S);
+  assert_equals_int (s_node->r, 11);
+
+  /* and the new segments are streamed */
+  ret =
+      gst_mpd_client_setup_media_presentation (new_mpdclient,
+      GST_CLOCK_TIME_NONE, -1, NULL);
+  assert_equals_int (ret, TRUE);
+
+  adaptationSets = gst_mpd_client_get_adaptation_sets (new_mpdclient);
+  fail_if (adaptationSets == NULL);
+  ret = gst_mpd_client_setup_streaming (new_mpdclient,
+      (GstAdaptationSetNode *) adaptationSets->data);
+  assert_equals_int (ret, TRUE);
+
+  activeStream = gst_mpdparser_get_active_stream_by_index (new_mpdclient, 0);
+  fail_if (activeStream == NULL);
+  assert_equals_int (activeStream->segments->len, 1);
+  segment = g_ptr_array_index (activeStream->segments, 0);
+  assert_equals_int (segment->repeat, 11);
+
+  gst_mpd_client_free (new_mpdclient);
+}
+
+GST_END_TEST;
+
+/*
+ * Test seeking in a segment timeline with several runs of repeated segments
+ *
+ */
+GST_START_TEST (dash_mpdparser_segment_timeline_seek)
+{
+  GList *adaptationSets;
+  GstAdaptationSetNode *adapt_set;
+  GstActiveStream *activeStream;
+  GstClockTime final_ts;
+
+  const gchar *xml =
+      "<?xml version=\"1.0\"?>"
+      "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\""
+      "     profiles=\"urn:mpeg:dash:profile:isoff-on-demand:2011\""
+      "     mediaPresentationDuration=\"P0Y0M0DT0H0M20S\">"
+      "  <Period>"
+      "    <AdaptationSet mimeType=\"video/mp4\">"
+      "      <Representation id=\"1\" bandwidth=\"250000\">"
+      "        <SegmentTemplate media=\"TestMedia$Time$\">"
+      "          <SegmentTimeline>"
+      "            <S t=\"0\" d=\"2\" r=\"4\"></S>"
+      "            <S d=\"3\" r=\"2\"></S>"
+      "            <S d=\"1\"></S>"
+      "          </SegmentTimeline>"
+      "        </SegmentTemplate>"
+      "      </Representation></AdaptationSet></Period></MPD>";
+
+  gboolean ret;
+  GstMpdClient *mpdclient = gst_mpd_client_new ();
+
+  ret = gst_mpd_parse (mpdclient, xml, (gint) strlen (xml));
+  assert_equals_int (ret, TRUE);
+
+  /* process the xml data */
+  ret =
+      gst_mpd_client_setup_media_presentation (mpdclient, GST_CLOCK_TIME_NONE,
+      -1, NULL);
+  assert_equals_int (ret, TRUE);
+
+  adaptationSets = gst_mpd_client_get_adaptation_sets (mpdclient);
+  fail_if (adaptationSets == NULL);
+  adapt_set = (GstAdaptationSetNode *) g_list_nth_data (adaptationSets, 0);
+  fail_if (adapt_set == NULL);
+  ret = gst_mpd_client_setup_streaming (mpdclient, adapt_set);
+  assert_equals_int (ret, TRUE);
+
+  activeStream = gst_mpdparser_get_active_stream_by_index (mpdclient, 0);
+  fail_if (activeStream == NULL);
+  assert_equals_int (activeStream->segments->len, 3);
+
+  /* in the first repeat of the second run */
+  ret = gst_mpd_client_stream_seek (mpdclient, activeStream, TRUE, 0,
+      11 * GST_SECOND, &final_ts);
+  assert_equals_int (ret, TRUE);
+  assert_equals_int (activeStream->segment_index, 1);
+  assert_equals_int (activeStream->segment_repeat_index, 0);
+  assert_equals_uint64 (final_ts, 10 * GST_SECOND);
+
+  /* in the second repeat of the second run */
+  ret = gst_mpd_client_stream_seek (mpdclient, activeStream, TRUE, 0,
+      14 * GST_SECOND, &final_ts);
+  assert_equals_int (ret, TRUE);
+  assert_equals_int (activeStream->segment_index, 1);
+  assert_equals_int (activeStream->segment_repeat_index, 1);
+  assert_equals_uint64 (final_ts, 13 * GST_SECOND);
+
+  /* at the boundary between the first two runs */
+  ret = gst_mpd_client_stream_seek (mpdclient, activeStream, TRUE, 0,
+      10 * GST_SECOND, &final_ts);
+  assert_equals_int (ret, TRUE);
+  assert_equals_int (activeStream->segment_index, 1);
+  assert_equals_int (activeStream->segment_repeat_index, 0);
+  assert_equals_uint64 (final_ts, 10 * GST_SECOND);
+
+  /* in reverse mode the boundary belongs to the last repeat of the first run */
+  ret = gst_mpd_client_stream_seek (mpdclient, activeStream, FALSE, 0,
+      10 * GST_SECOND, &final_ts);
+  assert_equals_int (ret, TRUE);
+  assert_equals_int (activeStream->segment_index, 0);
+  assert_equals_int (activeStream->segment_repeat_index, 4);
+  assert_equals_uint64 (final_ts, 8 * GST_SECOND);
+
+  /* in the last segment */
+  ret = gst_mpd_client_stream_seek (mpdclient, activeStream, TRUE, 0,
+      19500 * GST_MSECOND, &final_ts);
+  assert_equals_int (ret, TRUE);
+  assert_equals_int (activeStream->segment_index, 2);
+  assert_equals_int (activeStream->segment_repeat_index, 0);
+  assert_equals_uint64 (final_ts, 19 * GST_SECOND);
+
+  /* after the last segment */
+  ret = gst_mpd_client_stream_seek (mpdclient, activeStream, TRUE, 0,
+      25 * GST_SECOND, NULL);
+  assert_equals_int (ret, FALSE);
+  assert_equals_int (activeStream->segment_index, 3);
+
+  gst_mpd_client_free (mpdclient);
+}
+
+GST_END_TEST;
+
 /*
  * Test SegmentList with multiple inherited segmentURLs
  *
@@ -5936,6 +6225,9 @@ dash_suite (void)
   tcase_add_test (tc_complexMPD, dash_mpdparser_segment_list);
   tcase_add_test (tc_complexMPD, dash_mpdparser_segment_template);
   tcase_add_test (tc_complexMPD, dash_mpdparser_segment_timeline);
+  tcase_add_test (tc_complexMPD, dash_mpdparser_segment_timeline_seek);
+  tcase_add_test (tc_complexMPD, dash_mpdparser_update_reuse_nodes);
+  tcase_add_test (tc_complexMPD, dash_mpdparser_update_reuse_period_timeline);
   tcase_add_test (tc_complexMPD, dash_mpdparser_multiple_inherited_segmentURL);
 
   /* tests checking the parsing of missing/incomplete attributes of xml */
@@ -0,0 +1,243 @@
+/* GStreamer
+ *
+ * unit test for fieldanalysis
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <gst/video/video.h>
+
+/* for the metrics of the last frames */
+#include "gstfieldanalysis.h"
+
+#define N_FRAMES 20
+
+static const gchar *configs[] = {
+  "field-metric=sad frame-metric=5-tap",
+  "field-metric=ssd frame-metric=5-tap",
+  "field-metric=3-tap frame-metric=5-tap",
+  "field-metric=sad frame-metric=windowed-comb comb-method=32-detect",
+  "field-metric=sad frame-metric=windowed-comb comb-method=isCombed",
+  "field-metric=sad frame-metric=windowed-comb comb-method=5-tap"
+};
+
+/* the field rows are split in bands of at least 16 rows, so all these are
+ * analysed in more than one band with 4 threads */
+static const struct
+{
+  gint width, height;
+} frame_sizes[] = {
+  {176, 144},
+  {97, 130},
+  {720, 96}
+};
+
+/* luma of progressive frame k: a checkerboard moving by 4 pixels per frame,
+ * with noise */
+static void
+fill_progressive (GstVideoFrame * frame, guint k, GRand * rand)
+{
+  gint x, y;
+
+  for (y = 0; y < GST_VIDEO_FRAME_HEIGHT (frame); y++) {
+    guint8 *line = (guint8 *) GST_VIDEO_FRAME_COMP_DATA (frame, 0) +
+        y * GST_VIDEO_FRAME_COMP_STRIDE (frame, 0);
+
+    for (x = 0; x < GST_VIDEO_FRAME_WIDTH (frame); x++)
+      line[x] = (((x + 4 * k) / 8 + y / 8) & 1 ? 200 : 40) +
+          g_rand_int_range (rand, 0, 8);
+  }
+}
+
+/* Returns N_FRAMES frames made of the fields of progressive frames with
+ * 3:2 pulldown: progressive frame k gives 2 fields when k is even and 3
+ * otherwise, which gives progressive, repeated field and mixed frames */
+static GstBuffer **
+create_frames (const GstVideoInfo * info, GRand * rand)
+{
+  GstBuffer **frames = g_new0 (GstBuffer *, N_FRAMES);
+  GstVideoFrame field_frames[2], dest;
+  GstBuffer *progressive[2];
+  guint k = 0, k_fields = 0, i;
+  gint y;
+
+  progressive[0] = gst_buffer_new_allocate (NULL, info->size, NULL);
+  progressive[1] = gst_buffer_new_allocate (NULL, info->size, NULL);
+
+  for (i = 0; i < N_FRAMES; i++) {
+    guint j;
+
+    frames[i] = gst_buffer_new_allocate (NULL, info->size, NULL);
+    gst_buffer_memset (frames[i], 0, 128, info->size);
+    GST_BUFFER_PTS (frames[i]) = gst_util_uint64_scale (i, GST_SECOND, 30);
+    GST_BUFFER_DURATION (frames[i]) = GST_SECOND / 30;
+    fail_unless (gst_video_frame_map (&dest, info, frames[i], GST_MAP_WRITE));
+
+    /* the top and the bottom field of this frame */
+    for (j = 0; j < 2; j++) {
+      GstVideoFrame *src = &field_frames[j];
+
+      if (k_fields == (k & 1 ? 3 : 2)) {
+        k++;
+        k_fields = 0;
+      }
+      if (k_fields++ == 0) {
+        fail_unless (gst_video_frame_map (src, info, progressive[k & 1],
+                GST_MAP_WRITE));
+        fill_progressive (src, k, rand);
+        gst_video_frame_unmap (src);
+      }
+
+      fail_unless (gst_video_frame_map (src, info, progressive[k & 1],
+              GST_MAP_READ));
+      for (y = j; y < GST_VIDEO_INFO_HEIGHT (info); y += 2)
+        memcpy ((guint8 *) GST_VIDEO_FRAME_COMP_DATA (&dest, 0) +
+            y * GST_VIDEO_FRAME_COMP_STRIDE (&dest, 0),
+            (guint8 *) GST_VIDEO_FRAME_COMP_DATA (src, 0) +
+            y * GST_VIDEO_FRAME_COMP_STRIDE (src, 0),
+            GST_VIDEO_INFO_WIDTH (info));
+      gst_video_frame_unmap (src);
+    }
+
+    gst_video_frame_unmap (&dest);
+  }
+
+  gst_buffer_unref (progressive[0]);
+  gst_buffer_unref (progressive[1]);
+
+  return frames;
+}
+
+static void
+check_results (const FieldAnalysis * single, const FieldAnalysis * multi,
+    guint frame)
+{
+  if (single->f != multi->f || single->t != multi->t ||
+      single->b != multi->b || single->t_b != multi->t_b ||
+      single->b_t != multi->b_t)
+    fail ("frame %u: metrics f %f t %f b %f t_b %f b_t %f with 1 thread, "
+        "f %f t %f b %f t_b %f b_t %f with 4", frame, single->f, single->t,
+        single->b, single->t_b, single->b_t, multi->f, multi->t, multi->b,
+        multi->t_b, multi->b_t);
+
+  fail_unless_equals_int (single->conclusion, multi->conclusion);
+  fail_unless_equals_int (single->holding, multi->holding);
+  fail_unless_equals_int (single->drop, multi->drop);
+}
+
+static GstHarness *
+create_harness (const gchar * config, guint n_threads, const gchar * caps)
+{
+  GstHarness *h;
+  gchar *desc;
+
+  desc = g_strdup_printf ("fieldanalysis %s n-threads=%u", config, n_threads);
+  h = gst_harness_new_parse (desc);
+  g_free (desc);
+  gst_harness_set_src_caps_str (h, caps);
+
+  return h;
+}
+
+/* The metrics are integer sums of the bands reduced in band order, so
+ * they must be the same for any number of threads, as must the
+ * conclusions and the flags of the output */
+GST_START_TEST (test_threads)
+{
+  GstHarness *single, *multi;
+  GstBuffer **frames, *sbuf, *mbuf;
+  GstVideoInfo info;
+  GstCaps *caps;
+  gchar *caps_str;
+  GRand *rand;
+  guint s, i, n_out = 0;
+
+  for (s = 0; s < G_N_ELEMENTS (frame_sizes); s++) {
+    caps_str = g_strdup_printf ("video/x-raw, format=I420, width=%d, "
+        "height=%d, framerate=30/1, interlace-mode=interleaved",
+        frame_sizes[s].width, frame_sizes[s].height);
+    caps = gst_caps_from_string (caps_str);
+    fail_unless (gst_video_info_from_caps (&info, caps));
+    gst_caps_unref (caps);
+
+    rand = g_rand_new_with_seed (s);
+    frames = create_frames (&info, rand);
+    g_rand_free (rand);
+
+    single = create_harness (configs[__i__], 1, caps_str);
+    multi = create_harness (configs[__i__], 4, caps_str);
+
+    for (i = 0; i < N_FRAMES; i++) {
+      GstFieldAnalysis *sfa = (GstFieldAnalysis *) single->element;
+      GstFieldAnalysis *mfa = (GstFieldAnalysis *) multi->element;
+
+      fail_unless_equals_int (gst_harness_push (single,
+              gst_buffer_copy (frames[i])), GST_FLOW_OK);
+      fail_unless_equals_int (gst_harness_push (multi,
+              gst_buffer_copy (frames[i])), GST_FLOW_OK);
+
+      check_results (&sfa->frames[0].results, &mfa->frames[0].results, i);
+      if (i > 0)
+        check_results (&sfa->frames[1].results, &mfa->frames[1].results,
+            i - 1);
+    }
+
+    fail_unless (gst_harness_push_event (single, gst_event_new_eos ()));
+    fail_unless (gst_harness_push_event (multi, gst_event_new_eos ()));
+
+    fail_unless_equals_int (gst_harness_buffers_in_queue (single),
+        gst_harness_buffers_in_queue (multi));
+    while ((sbuf = gst_harness_try_pull (single))) {
+      mbuf = gst_harness_pull (multi);
+      fail_unless_equals_uint64 (GST_BUFFER_PTS (sbuf), GST_BUFFER_PTS (mbuf));
+      fail_unless_equals_int (GST_BUFFER_FLAGS (sbuf), GST_BUFFER_FLAGS (mbuf));
+      gst_buffer_unref (sbuf);
+      gst_buffer_unref (mbuf);
+      n_out++;
+    }
+
+    gst_harness_teardown (single);
+    gst_harness_teardown (multi);
+    for (i = 0; i < N_FRAMES; i++)
+      gst_buffer_unref (frames[i]);
+    g_free (frames);
+    g_free (caps_str);
+  }
+
+  fail_unless (n_out > 0);
+}
+
+GST_END_TEST;
+
+static Suite *
+fieldanalysis_suite (void)
+{
+  Suite *s = suite_create ("fieldanalysis");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_loop_test (tc_chain, test_threads, 0, G_N_ELEMENTS (configs));
+
+  return s;
+}
+
+GST_CHECK_MAIN (fieldanalysis);
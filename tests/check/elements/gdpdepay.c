@@ -278,6 +278,95 @@ GST_START_TEST (test_audio_in_one_buffer)
 
 GST_END_TEST;
 
+/* a payload with a CRC split over two input buffers is validated and output
+ * without merging its two parts */
+GST_START_TEST (test_payload_crc_split)
+{
+  GstCaps *caps;
+  GstElement *gdpdepay;
+  GstBuffer *buffer, *inbuffer, *outbuffer;
+  GstBuffer *caps_buf, *streamstart_buf, *segment_buf, *data_buf;
+  GstEvent *event;
+  GstSegment segment;
+  GstMapInfo map;
+  guint8 data[4000];
+  gsize size;
+  guint i;
+
+  gdpdepay = setup_gdpdepay ();
+
+  fail_unless (gst_element_set_state (gdpdepay,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  caps = gst_caps_new_empty_simple ("application/x-gdp");
+  gst_check_setup_events (mysrcpad, gdpdepay, caps, GST_FORMAT_BYTES);
+  gst_caps_unref (caps);
+
+  event = gst_event_new_stream_start ("s-s-id-1234");
+  streamstart_buf = gst_dp_payload_event (event, GST_DP_HEADER_FLAG_CRC);
+  gst_event_unref (event);
+
+  caps = gst_caps_from_string (AUDIO_CAPS_STRING);
+  caps_buf = gst_dp_payload_caps (caps, GST_DP_HEADER_FLAG_CRC);
+  gst_caps_unref (caps);
+
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  event = gst_event_new_segment (&segment);
+  segment_buf = gst_dp_payload_event (event, GST_DP_HEADER_FLAG_CRC);
+  gst_event_unref (event);
+
+  for (i = 0; i < sizeof (data); i++)
+    data[i] = i * 7;
+  buffer = gst_buffer_new_and_alloc (sizeof (data));
+  gst_buffer_fill (buffer, 0, data, sizeof (data));
+  data_buf = gst_dp_payload_buffer (buffer, GST_DP_HEADER_FLAG_CRC);
+  gst_buffer_unref (buffer);
+
+  inbuffer = gst_buffer_append (streamstart_buf, caps_buf);
+  inbuffer = gst_buffer_append (inbuffer, segment_buf);
+  inbuffer = gst_buffer_append (inbuffer, gst_buffer_ref (data_buf));
+  size = gst_buffer_get_size (inbuffer);
+
+  /* split in the middle of the payload */
+  fail_unless_equals_int (gst_pad_push (mysrcpad,
+          gst_buffer_copy_region (inbuffer, GST_BUFFER_COPY_ALL, 0,
+              size - sizeof (data) / 2)), GST_FLOW_OK);
+  fail_unless_equals_int (g_list_length (buffers), 0);
+  fail_unless_equals_int (gst_pad_push (mysrcpad,
+          gst_buffer_copy_region (inbuffer, GST_BUFFER_COPY_ALL,
+              size - sizeof (data) / 2, -1)), GST_FLOW_OK);
+  gst_buffer_unref (inbuffer);
+
+  fail_unless_equals_int (g_list_length (buffers), 1);
+  outbuffer = GST_BUFFER (buffers->data);
+  fail_unless_equals_int (gst_buffer_get_size (outbuffer), sizeof (data));
+  fail_unless_equals_int (gst_buffer_n_memory (outbuffer), 2);
+  fail_unless (gst_buffer_memcmp (outbuffer, 0, data, sizeof (data)) == 0);
+
+  /* a corrupted payload does not validate, the payload memory is shared
+   * with the output buffer so corrupt a copy */
+  buffer = gst_buffer_copy_deep (data_buf);
+  gst_buffer_unref (data_buf);
+  data_buf = buffer;
+  gst_buffer_map_range (data_buf, 1, -1, &map, GST_MAP_WRITE);
+  map.data[100] ^= 0x01;
+  gst_buffer_unmap (data_buf, &map);
+  fail_unless_equals_int (gst_pad_push (mysrcpad, data_buf), GST_FLOW_ERROR);
+  fail_unless_equals_int (g_list_length (buffers), 1);
+
+  fail_unless (gst_element_set_state (gdpdepay,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS, "could not set to null");
+
+  g_list_foreach (buffers, (GFunc) gst_mini_object_unref, NULL);
+  g_list_free (buffers);
+  buffers = NULL;
+  ASSERT_OBJECT_REFCOUNT (gdpdepay, "gdpdepay", 1);
+  cleanup_gdpdepay (gdpdepay);
+}
+
+GST_END_TEST;
+
 static GstStaticPadTemplate shsinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
     GST_PAD_ALWAYS,
@@ -410,6 +499,7 @@ gdpdepay_suite (void)
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_audio_per_byte);
   tcase_add_test (tc_chain, test_audio_in_one_buffer);
+  tcase_add_test (tc_chain, test_payload_crc_split);
   tcase_add_test (tc_chain, test_streamheader);
 
   return s;
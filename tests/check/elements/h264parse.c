@@ -24,6 +24,7 @@
  */
 
 #include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
 #include "parser.h"
 
 #define SRC_CAPS_TMPL   "video/x-h264, parsed=(boolean)false"
@@ -463,6 +464,88 @@ h264parse_packetized_suite (void)
 }
 
 
+/* makes a byte-stream IDR frame with a slice of @size bytes */
+static GstBuffer *
+make_large_idrframe (gsize size)
+{
+  guint8 *data = g_malloc (size);
+
+  memcpy (data, h264_idrframe, sizeof (h264_idrframe));
+  memset (data + sizeof (h264_idrframe), 0x55, size - sizeof (h264_idrframe));
+
+  return gst_buffer_new_wrapped (data, size);
+}
+
+/* the large slices are referenced by the AUs converted to avc, in which the
+ * SPS and PPS are inserted */
+GST_START_TEST (test_parse_avc_au_shared_slice)
+{
+  GstHarness *h = gst_harness_new ("h264parse");
+  GstBuffer *buf, *idr;
+  const gsize idr_size = 64 * 1024;
+  gsize size;
+  guint8 *data;
+
+  g_object_set (h->element, "config-interval", -1, NULL);
+  gst_harness_set_src_caps_str (h,
+      "video/x-h264, stream-format=byte-stream, alignment=au");
+  gst_harness_set_sink_caps_str (h,
+      "video/x-h264, stream-format=avc, alignment=au");
+
+  /* SPS, PPS and IDR frame */
+  buf = gst_buffer_new_allocate (NULL, sizeof (h264_sps) + sizeof (h264_pps),
+      NULL);
+  gst_buffer_fill (buf, 0, h264_sps, sizeof (h264_sps));
+  gst_buffer_fill (buf, sizeof (h264_sps), h264_pps, sizeof (h264_pps));
+  buf = gst_buffer_append (buf, make_large_idrframe (idr_size));
+  fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+  buf = gst_harness_pull (h);
+  fail_unless (buf != NULL);
+  gst_buffer_unref (buf);
+
+  /* IDR frame, the SPS and PPS are inserted before it */
+  idr = make_large_idrframe (idr_size);
+  fail_unless_equals_int (gst_harness_push (h, gst_buffer_ref (idr)),
+      GST_FLOW_OK);
+  buf = gst_harness_pull (h);
+  fail_unless (buf != NULL);
+
+  size = gst_buffer_get_size (buf);
+  fail_unless_equals_int (size,
+      sizeof (h264_sps) + sizeof (h264_pps) + idr_size);
+  fail_unless (gst_buffer_n_memory (buf) > 1);
+
+  data = g_malloc (size);
+  gst_buffer_extract (buf, 0, data, size);
+  fail_unless_equals_int (GST_READ_UINT32_BE (data), sizeof (h264_sps) - 4);
+  fail_unless (memcmp (data + 4, h264_sps + 4, sizeof (h264_sps) - 4) == 0);
+  data += sizeof (h264_sps);
+  fail_unless_equals_int (GST_READ_UINT32_BE (data), sizeof (h264_pps) - 4);
+  fail_unless (memcmp (data + 4, h264_pps + 4, sizeof (h264_pps) - 4) == 0);
+  data += sizeof (h264_pps);
+  fail_unless_equals_int (GST_READ_UINT32_BE (data), idr_size - 4);
+  fail_unless (gst_buffer_memcmp (idr, 4, data + 4, idr_size - 4) == 0);
+  g_free (data - sizeof (h264_sps) - sizeof (h264_pps));
+
+  gst_buffer_unref (buf);
+  gst_buffer_unref (idr);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+static Suite *
+h264parse_sharing_suite (void)
+{
+  Suite *s = suite_create (ctx_suite);
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_parse_avc_au_shared_slice);
+
+  return s;
+}
+
 /*
  * TODO:
  *   - Both push- and pull-modes need to be tested
@@ -560,5 +643,9 @@ main (int argc, char **argv)
   s = h264parse_packetized_suite ();
   nf += gst_check_run_suite (s, ctx_suite, __FILE__ "_packetized.c");
 
+  ctx_suite = "h264parse_sharing";
+  s = h264parse_sharing_suite ();
+  nf += gst_check_run_suite (s, ctx_suite, __FILE__ "_sharing.c");
+
   return nf;
 }
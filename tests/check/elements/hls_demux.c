@@ -724,6 +724,88 @@ GST_START_TEST (testFragmentDownloadError)
 
 GST_END_TEST;
 
+static gboolean
+gst_hlsdemux_test_prefetch_src_start (GstTestHTTPSrc * src,
+    const gchar * uri, GstTestHTTPSrcInput * input_data, gpointer user_data)
+{
+  static GMutex lock;
+  gboolean ret;
+
+  /* the prefetched fragments are requested from several threads */
+  g_mutex_lock (&lock);
+  ret = gst_hlsdemux_test_src_start (src, uri, input_data, user_data);
+  g_mutex_unlock (&lock);
+
+  return ret;
+}
+
+static void
+testPrefetchPreTestCallback (GstAdaptiveDemuxTestEngine * engine,
+    gpointer user_data)
+{
+  g_object_set (engine->demux, "prefetch-fragments", 2, NULL);
+}
+
+/* Test downloading the next fragments ahead of the current one.
+ * All the data has to be pushed in order, and each fragment must only be
+ * requested once.
+ */
+GST_START_TEST (testPrefetchFragments)
+{
+  const guint segment_size = 30 * TS_PACKET_LEN;
+  const gchar *manifest =
+      "#EXTM3U \n"
+      "#EXT-X-TARGETDURATION:1\n"
+      "#EXTINF:1,Test\n" "001.ts\n"
+      "#EXTINF:1,Test\n" "002.ts\n"
+      "#EXTINF:1,Test\n" "003.ts\n"
+      "#EXTINF:1,Test\n" "004.ts\n" "#EXT-X-ENDLIST\n";
+  GstHlsDemuxTestInputData inputTestData[] = {
+    {"http://unit.test/media.m3u8", (guint8 *) manifest, 0},
+    {"http://unit.test/001.ts", NULL, segment_size},
+    {"http://unit.test/002.ts", NULL, segment_size},
+    {"http://unit.test/003.ts", NULL, segment_size},
+    {"http://unit.test/004.ts", NULL, segment_size},
+    {NULL, NULL, 0},
+  };
+  GstAdaptiveDemuxTestExpectedOutput outputTestData[] = {
+    {"src_0", 4 * segment_size, NULL},
+    {NULL, 0, NULL}
+  };
+  const GValue *requests;
+  guint i, j, count;
+  TESTCASE_INIT_BOILERPLATE (segment_size);
+
+  http_src_callbacks.src_start = gst_hlsdemux_test_prefetch_src_start;
+  http_src_callbacks.src_create = gst_hlsdemux_test_src_create;
+  engine_callbacks.pre_test = testPrefetchPreTestCallback;
+  engine_callbacks.appsink_received_data =
+      gst_adaptive_demux_test_check_received_data;
+  engine_callbacks.appsink_eos =
+      gst_adaptive_demux_test_check_size_of_received_data;
+
+  gst_test_http_src_install_callbacks (&http_src_callbacks, &hlsTestCase);
+  gst_adaptive_demux_test_run (DEMUX_ELEMENT_NAME,
+      inputTestData[0].uri, &engine_callbacks, engineTestData);
+
+  requests = gst_structure_get_value (hlsTestCase.state, "requests");
+  fail_unless (requests != NULL);
+  for (i = 1; inputTestData[i].uri; ++i) {
+    count = 0;
+    for (j = 0; j < gst_value_array_get_size (requests); j++) {
+      const GValue *uri = gst_value_array_get_value (requests, j);
+
+      if (strcmp (g_value_get_string (uri), inputTestData[i].uri) == 0)
+        count++;
+    }
+    assert_equals_int (count, 1);
+  }
+
+  TESTCASE_UNREF_BOILERPLATE;
+}
+
+GST_END_TEST;
+
 static Suite *
 hls_demux_suite (void)
 {
@@ -735,6 +817,7 @@ hls_demux_suite (void)
   tcase_add_test (tc_basicTest, testMediaPlaylistNotFound);
   tcase_add_test (tc_basicTest, testFragmentNotFound);
   tcase_add_test (tc_basicTest, testFragmentDownloadError);
+  tcase_add_test (tc_basicTest, testPrefetchFragments);
   tcase_add_test (tc_basicTest, testSeek);
   tcase_add_test (tc_basicTest, testSeekKeyUnitPosition);
   tcase_add_test (tc_basicTest, testSeekPosition);
@@ -353,7 +353,7 @@ GST_START_TEST (test_load_main_playlist_rendition)
   master = load_playlist (ON_DEMAND_PLAYLIST);
   variant = master->default_variant;
 
-  assert_equals_int (g_list_length (variant->m3u8->files), 4);
+  assert_equals_int (variant->m3u8->files->len, 4);
   assert_equals_int (master->version, 0);
 
   gst_hls_master_playlist_unref (master);
@@ -463,13 +463,14 @@ check_on_demand_playlist (const gchar * data)
   /* Check that we are not live */
   assert_equals_int (gst_m3u8_is_live (pl), FALSE);
   /* Check number of entries */
-  assert_equals_int (g_list_length (pl->files), 4);
+  assert_equals_int (pl->files->len, 4);
   /* Check first media segments */
-  file = GST_M3U8_MEDIA_FILE (g_list_first (pl->files)->data);
+  file = GST_M3U8_MEDIA_FILE (g_ptr_array_index (pl->files, 0));
   assert_equals_string (file->uri, "http://media.example.com/001.ts");
   assert_equals_int (file->sequence, 0);
   /* Check last media segments */
-  file = GST_M3U8_MEDIA_FILE (g_list_last (pl->files)->data);
+  file = GST_M3U8_MEDIA_FILE (g_ptr_array_index (pl->files,
+          pl->files->len - 1));
   assert_equals_string (file->uri, "http://media.example.com/004.ts");
   assert_equals_int (file->sequence, 3);
 
@@ -519,14 +520,15 @@ GST_START_TEST (test_live_playlist)
   assert_equals_int (gst_m3u8_is_live (pl), TRUE);
   assert_equals_int (pl->sequence, 2680);
   /* Check number of entries */
-  assert_equals_int (g_list_length (pl->files), 4);
+  assert_equals_int (pl->files->len, 4);
   /* Check first media segments */
-  file = GST_M3U8_MEDIA_FILE (g_list_first (pl->files)->data);
+  file = GST_M3U8_MEDIA_FILE (g_ptr_array_index (pl->files, 0));
   assert_equals_string (file->uri,
       "https://priv.example.com/fileSequence2680.ts");
   assert_equals_int (file->sequence, 2680);
   /* Check last media segments */
-  file = GST_M3U8_MEDIA_FILE (g_list_last (pl->files)->data);
+  file = GST_M3U8_MEDIA_FILE (g_ptr_array_index (pl->files,
+          pl->files->len - 1));
   assert_equals_string (file->uri,
       "https://priv.example.com/fileSequence2683.ts");
   assert_equals_int (file->sequence, 2683);
@@ -554,7 +556,7 @@ GST_START_TEST (test_live_playlist_rotated)
 
   assert_equals_int (pl->sequence, 2680);
   /* Check first media segments */
-  file = GST_M3U8_MEDIA_FILE (g_list_first (pl->files)->data);
+  file = GST_M3U8_MEDIA_FILE (g_ptr_array_index (pl->files, 0));
   assert_equals_int (file->sequence, 2680);
 
   ret = gst_m3u8_update (pl, g_strdup (LIVE_ROTATED_PLAYLIST));
@@ -566,7 +568,7 @@ GST_START_TEST (test_live_playlist_rotated)
   /* FIXME: Sequence should last - 3. Should it? */
   assert_equals_int (pl->sequence, 3001);
   /* Check first media segments */
-  file = GST_M3U8_MEDIA_FILE (g_list_first (pl->files)->data);
+  file = GST_M3U8_MEDIA_FILE (g_ptr_array_index (pl->files, 0));
   assert_equals_int (file->sequence, 3001);
 
   gst_hls_master_playlist_unref (master);
@@ -586,13 +588,13 @@ GST_START_TEST (test_playlist_with_doubles_duration)
   pl = master->default_variant->m3u8;
 
   /* Check first media segments */
-  file = GST_M3U8_MEDIA_FILE (g_list_nth_data (pl->files, 0));
+  file = GST_M3U8_MEDIA_FILE (g_ptr_array_index (pl->files, 0));
   assert_equals_float (file->duration / (double) GST_SECOND, 10.321);
-  file = GST_M3U8_MEDIA_FILE (g_list_nth_data (pl->files, 1));
+  file = GST_M3U8_MEDIA_FILE (g_ptr_array_index (pl->files, 1));
   assert_equals_float (file->duration / (double) GST_SECOND, 9.6789);
-  file = GST_M3U8_MEDIA_FILE (g_list_nth_data (pl->files, 2));
+  file = GST_M3U8_MEDIA_FILE (g_ptr_array_index (pl->files, 2));
   assert_equals_float (file->duration / (double) GST_SECOND, 10.2344);
-  file = GST_M3U8_MEDIA_FILE (g_list_nth_data (pl->files, 3));
+  file = GST_M3U8_MEDIA_FILE (g_ptr_array_index (pl->files, 3));
   assert_equals_float (file->duration / (double) GST_SECOND, 9.92);
   fail_unless (gst_m3u8_get_seek_range (pl, &start, &stop));
   assert_equals_int64 (start, 0);
@@ -618,26 +620,26 @@ GST_START_TEST (test_playlist_with_encryption)
   master = load_playlist (AES_128_ENCRYPTED_PLAYLIST);
   pl = master->default_variant->m3u8;
 
-  assert_equals_int (g_list_length (pl->files), 5);
+  assert_equals_int (pl->files->len, 5);
 
   /* Check all media segments */
-  file = GST_M3U8_MEDIA_FILE (g_list_nth_data (pl->files, 0));
+  file = GST_M3U8_MEDIA_FILE (g_ptr_array_index (pl->files, 0));
   fail_unless (file->key == NULL);
 
-  file = GST_M3U8_MEDIA_FILE (g_list_nth_data (pl->files, 1));
+  file = GST_M3U8_MEDIA_FILE (g_ptr_array_index (pl->files, 1));
   fail_unless (file->key == NULL);
 
-  file = GST_M3U8_MEDIA_FILE (g_list_nth_data (pl->files, 2));
+  file = GST_M3U8_MEDIA_FILE (g_ptr_array_index (pl->files, 2));
   fail_unless (file->key != NULL);
   assert_equals_string (file->key, "https://priv.example.com/key.bin");
   fail_unless (memcmp (&file->iv, iv2, 16) == 0);
 
-  file = GST_M3U8_MEDIA_FILE (g_list_nth_data (pl->files, 3));
+  file = GST_M3U8_MEDIA_FILE (g_ptr_array_index (pl->files, 3));
   fail_unless (file->key != NULL);
   assert_equals_string (file->key, "https://priv.example.com/key2.bin");
   fail_unless (memcmp (&file->iv, iv1, 16) == 0);
 
-  file = GST_M3U8_MEDIA_FILE (g_list_nth_data (pl->files, 4));
+  file = GST_M3U8_MEDIA_FILE (g_ptr_array_index (pl->files, 4));
   fail_unless (file->key != NULL);
   assert_equals_string (file->key, "https://priv.example.com/key2.bin");
   fail_unless (memcmp (&file->iv, iv1, 16) == 0);
@@ -657,7 +659,7 @@ GST_START_TEST (test_update_invalid_playlist)
   /* Test updates in on-demand playlists */
   master = load_playlist (ON_DEMAND_PLAYLIST);
   pl = master->default_variant->m3u8;
-  assert_equals_int (g_list_length (pl->files), 4);
+  assert_equals_int (pl->files->len, 4);
   ret = gst_m3u8_update (pl, g_strdup ("#INVALID"));
   assert_equals_int (ret, FALSE);
 
@@ -676,26 +678,102 @@ GST_START_TEST (test_update_playlist)
   /* Test updates in on-demand playlists */
   master = load_playlist (ON_DEMAND_PLAYLIST);
   pl = master->default_variant->m3u8;
-  assert_equals_int (g_list_length (pl->files), 4);
+  assert_equals_int (pl->files->len, 4);
   ret = gst_m3u8_update (pl, g_strdup (ON_DEMAND_PLAYLIST));
   assert_equals_int (ret, TRUE);
-  assert_equals_int (g_list_length (pl->files), 4);
+  assert_equals_int (pl->files->len, 4);
   gst_hls_master_playlist_unref (master);
 
   /* Test updates in live playlists */
   master = load_playlist (LIVE_PLAYLIST);
   pl = master->default_variant->m3u8;
-  assert_equals_int (g_list_length (pl->files), 4);
+  assert_equals_int (pl->files->len, 4);
   /* Add a new entry to the playlist and check the update */
   live_pl = g_strdup_printf ("%s\n%s\n%s", LIVE_PLAYLIST, "#EXTINF:8",
       "https://priv.example.com/fileSequence2683.ts");
   ret = gst_m3u8_update (pl, live_pl);
   assert_equals_int (ret, TRUE);
-  assert_equals_int (g_list_length (pl->files), 5);
+  assert_equals_int (pl->files->len, 5);
   /* Test sliding window */
   ret = gst_m3u8_update (pl, g_strdup (LIVE_PLAYLIST));
   assert_equals_int (ret, TRUE);
-  assert_equals_int (g_list_length (pl->files), 4);
+  assert_equals_int (pl->files->len, 4);
+  gst_hls_master_playlist_unref (master);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_update_playlist_incremental)
+{
+  GstHLSMasterPlaylist *master;
+  GstM3U8 *pl;
+  GstM3U8MediaFile *old_files[5], *file;
+  gchar *live_pl;
+  gboolean ret;
+  gint i;
+
+  /* The last URI line has to be complete to reuse the media files */
+  live_pl = g_strconcat (LIVE_PLAYLIST, "\n", NULL);
+  master = load_playlist (live_pl);
+  g_free (live_pl);
+  pl = master->default_variant->m3u8;
+  assert_equals_int (pl->files->len, 4);
+  for (i = 0; i < 4; i++)
+    old_files[i] = g_ptr_array_index (pl->files, i);
+
+  /* Append a new entry, the previous ones are kept */
+  live_pl = g_strconcat (LIVE_PLAYLIST, "\n#EXTINF:8,\n"
+      "https://priv.example.com/fileSequence2684.ts\n", NULL);
+  ret = gst_m3u8_update (pl, live_pl);
+  assert_equals_int (ret, TRUE);
+  assert_equals_int (pl->files->len, 5);
+  for (i = 0; i < 4; i++)
+    fail_unless (g_ptr_array_index (pl->files, i) == old_files[i]);
+  file = GST_M3U8_MEDIA_FILE (g_ptr_array_index (pl->files, 4));
+  assert_equals_string (file->uri,
+      "https://priv.example.com/fileSequence2684.ts");
+  assert_equals_int (file->sequence, 2684);
+  assert_equals_uint64 (file->start, 32 * GST_SECOND);
+  assert_equals_uint64 (pl->duration, 40 * GST_SECOND);
+  for (i = 0; i < 5; i++)
+    old_files[i] = g_ptr_array_index (pl->files, i);
+
+  /* Slide the window, the entries that are still there are kept */
+  ret = gst_m3u8_update (pl, g_strdup ("#EXTM3U\n"
+          "#EXT-X-TARGETDURATION:8\n"
+          "#EXT-X-MEDIA-SEQUENCE:2681\n"
+          "\n"
+          "#EXTINF:8,\n"
+          "https://priv.example.com/fileSequence2681.ts\n"
+          "#EXTINF:8,\n"
+          "https://priv.example.com/fileSequence2682.ts\n"
+          "#EXTINF:8,\n"
+          "https://priv.example.com/fileSequence2683.ts\n"
+          "#EXTINF:8,\n"
+          "https://priv.example.com/fileSequence2684.ts\n"
+          "#EXTINF:8,\n"
+          "https://priv.example.com/fileSequence2685.ts\n"));
+  assert_equals_int (ret, TRUE);
+  assert_equals_int (pl->files->len, 5);
+  file = GST_M3U8_MEDIA_FILE (g_ptr_array_index (pl->files, 0));
+  assert_equals_string (file->uri,
+      "https://priv.example.com/fileSequence2681.ts");
+  assert_equals_int (file->sequence, 2681);
+  assert_equals_uint64 (file->start, old_files[1]->start);
+  for (i = 1; i < 4; i++)
+    fail_unless (g_ptr_array_index (pl->files, i) == old_files[i + 1]);
+  file = GST_M3U8_MEDIA_FILE (g_ptr_array_index (pl->files, 4));
+  assert_equals_string (file->uri,
+      "https://priv.example.com/fileSequence2685.ts");
+  assert_equals_int (file->sequence, 2685);
+  assert_equals_uint64 (pl->duration, 40 * GST_SECOND);
+
+  /* Look up the entries by position in the updated playlist */
+  assert_equals_int (gst_m3u8_find_fragment_at (pl, 0), 0);
+  assert_equals_int (gst_m3u8_find_fragment_at (pl, 8 * GST_SECOND), 1);
+  assert_equals_int (gst_m3u8_find_fragment_at (pl, 39 * GST_SECOND), 4);
+  assert_equals_int (gst_m3u8_find_fragment_at (pl, 40 * GST_SECOND), -1);
+
   gst_hls_master_playlist_unref (master);
 }
 
@@ -711,9 +789,9 @@ GST_START_TEST (test_playlist_media_files)
   pl = master->default_variant->m3u8;
 
   /* Check number of entries */
-  assert_equals_int (g_list_length (pl->files), 4);
+  assert_equals_int (pl->files->len, 4);
   /* Check first media segments */
-  file = GST_M3U8_MEDIA_FILE (g_list_first (pl->files)->data);
+  file = GST_M3U8_MEDIA_FILE (g_ptr_array_index (pl->files, 0));
   assert_equals_string (file->uri, "http://media.example.com/001.ts");
   assert_equals_int (file->sequence, 0);
   assert_equals_float (file->duration, 10 * (double) GST_SECOND);
@@ -736,16 +814,17 @@ GST_START_TEST (test_playlist_byte_range_media_files)
   pl = master->default_variant->m3u8;
 
   /* Check number of entries */
-  assert_equals_int (g_list_length (pl->files), 4);
+  assert_equals_int (pl->files->len, 4);
   /* Check first media segments */
-  file = GST_M3U8_MEDIA_FILE (g_list_first (pl->files)->data);
+  file = GST_M3U8_MEDIA_FILE (g_ptr_array_index (pl->files, 0));
   assert_equals_string (file->uri, "http://media.example.com/all.ts");
   assert_equals_int (file->sequence, 0);
   assert_equals_float (file->duration, 10 * (double) GST_SECOND);
   assert_equals_int (file->offset, 100);
   assert_equals_int (file->size, 1000);
   /* Check last media segments */
-  file = GST_M3U8_MEDIA_FILE (g_list_last (pl->files)->data);
+  file = GST_M3U8_MEDIA_FILE (g_ptr_array_index (pl->files,
+          pl->files->len - 1));
   assert_equals_string (file->uri, "http://media.example.com/all.ts");
   assert_equals_int (file->sequence, 3);
   assert_equals_float (file->duration, 10 * (double) GST_SECOND);
@@ -759,16 +838,17 @@ GST_START_TEST (test_playlist_byte_range_media_files)
   pl = master->default_variant->m3u8;
 
   /* Check number of entries */
-  assert_equals_int (g_list_length (pl->files), 4);
+  assert_equals_int (pl->files->len, 4);
   /* Check first media segments */
-  file = GST_M3U8_MEDIA_FILE (g_list_first (pl->files)->data);
+  file = GST_M3U8_MEDIA_FILE (g_ptr_array_index (pl->files, 0));
   assert_equals_string (file->uri, "http://media.example.com/all.ts");
   assert_equals_int (file->sequence, 0);
   assert_equals_float (file->duration, 10 * (double) GST_SECOND);
   assert_equals_int (file->offset, 0);
   assert_equals_int (file->size, 1000);
   /* Check last media segments */
-  file = GST_M3U8_MEDIA_FILE (g_list_last (pl->files)->data);
+  file = GST_M3U8_MEDIA_FILE (g_ptr_array_index (pl->files,
+          pl->files->len - 1));
   assert_equals_string (file->uri, "http://media.example.com/all.ts");
   assert_equals_int (file->sequence, 3);
   assert_equals_float (file->duration, 10 * (double) GST_SECOND);
@@ -1421,6 +1501,7 @@ hlsdemux_suite (void)
   tcase_add_test (tc_m3u8, test_playlist_with_encryption);
   tcase_add_test (tc_m3u8, test_update_invalid_playlist);
   tcase_add_test (tc_m3u8, test_update_playlist);
+  tcase_add_test (tc_m3u8, test_update_playlist_incremental);
   tcase_add_test (tc_m3u8, test_playlist_media_files);
   tcase_add_test (tc_m3u8, test_playlist_byte_range_media_files);
   tcase_add_test (tc_m3u8, test_get_next_fragment);
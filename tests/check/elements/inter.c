@@ -0,0 +1,130 @@
+/* GStreamer
+ *
+ * unit test for intervideosink and intervideosrc
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+
+#define FRAME_SIZE (64 * 48 * 3 / 2)
+
+/* Waits until intervideosrc created its next frame and waits for the clock
+ * to push it, then pushes @n_push frames numbered from @next to
+ * intervideosink, which are only seen by the frames created afterwards.
+ * Returns the number of the frame intervideosrc pushed, 0 for a black
+ * frame */
+static guint8
+step (GstHarness * src, GstHarness * sink, guint8 * next, guint n_push)
+{
+  GstBuffer *buf;
+  guint8 value;
+
+  fail_unless (gst_harness_wait_for_clock_id_waits (src, 1, 60));
+
+  for (; n_push > 0; n_push--) {
+    buf = gst_harness_create_buffer (sink, FRAME_SIZE);
+    gst_buffer_memset (buf, 0, *next, FRAME_SIZE);
+    GST_BUFFER_PTS (buf) = gst_util_uint64_scale (*next, GST_SECOND, 30);
+    (*next)++;
+    fail_unless_equals_int (gst_harness_push (sink, buf), GST_FLOW_OK);
+  }
+
+  fail_unless (gst_harness_crank_single_clock_wait (src));
+  buf = gst_harness_pull (src);
+  fail_unless (buf != NULL);
+  fail_unless_equals_int (gst_buffer_extract (buf, 0, &value, 1), 1);
+  gst_buffer_unref (buf);
+
+  return value;
+}
+
+GST_START_TEST (test_video_ring)
+{
+  GstHarness *sink, *src;
+  guint64 dropped, duplicated;
+  guint ring_size;
+  guint8 next = 1;
+
+  sink = gst_harness_new_parse ("intervideosink channel=ring-test "
+      "ring-size=4 sync=false");
+  gst_harness_set_src_caps_str (sink, "video/x-raw, format=I420, "
+      "width=64, height=48, framerate=30/1");
+  g_object_get (sink->element, "ring-size", &ring_size, NULL);
+  fail_unless_equals_int (ring_size, 4);
+
+  /* the ring is indexed with a mask, other sizes are ignored */
+  g_object_set (sink->element, "ring-size", 3, NULL);
+  g_object_get (sink->element, "ring-size", &ring_size, NULL);
+  fail_unless_equals_int (ring_size, 4);
+
+  src = gst_harness_new_parse ("intervideosrc channel=ring-test");
+
+  /* the first frame is black, the reader starts after the latest frame of
+   * the sink, then follows every frame */
+  step (src, sink, &next, 2);
+  fail_unless_equals_int (step (src, sink, &next, 0), 1);
+  fail_unless_equals_int (step (src, sink, &next, 0), 2);
+
+  /* a reader faster than the sink repeats the last frame */
+  fail_unless_equals_int (step (src, sink, &next, 7), 2);
+
+  /* a reader slower than the sink skips to the oldest frame left in the
+   * ring: frames 3 to 9 were pushed, only the last 4 are kept. The counters
+   * are only read while intervideosrc waits for the clock */
+  fail_unless (gst_harness_wait_for_clock_id_waits (src, 1, 60));
+  g_object_get (src->element, "dropped", &dropped, "duplicated", &duplicated,
+      NULL);
+  fail_unless_equals_uint64 (dropped, 3);
+  fail_unless_equals_uint64 (duplicated, 1);
+
+  fail_unless_equals_int (step (src, sink, &next, 0), 6);
+  fail_unless_equals_int (step (src, sink, &next, 0), 7);
+  fail_unless_equals_int (step (src, sink, &next, 0), 8);
+  fail_unless_equals_int (step (src, sink, &next, 0), 9);
+  fail_unless_equals_int (step (src, sink, &next, 0), 9);
+
+  /* the frame created after the last one pulled repeats it too */
+  fail_unless (gst_harness_wait_for_clock_id_waits (src, 1, 60));
+  g_object_get (src->element, "dropped", &dropped, "duplicated", &duplicated,
+      NULL);
+  fail_unless_equals_uint64 (dropped, 3);
+  fail_unless_equals_uint64 (duplicated, 3);
+
+  gst_harness_teardown (src);
+  gst_harness_teardown (sink);
+}
+
+GST_END_TEST;
+
+static Suite *
+inter_suite (void)
+{
+  Suite *s = suite_create ("inter");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_video_ring);
+
+  return s;
+}
+
+GST_CHECK_MAIN (inter);
@@ -0,0 +1,149 @@
+/* GStreamer
+ *
+ * unit test for interlace
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <gst/video/video.h>
+
+#define WIDTH 16
+#define HEIGHT 8
+#define FRAME_SIZE (WIDTH * HEIGHT * 3 / 2)
+#define N_FRAMES 6
+
+/* Pushes N_FRAMES frames filled with their number through interlace with
+ * one field per frame, so that every output frame weaves the stored frame
+ * with the next one. The input frames carry offsets, flags and a meta which
+ * must not make it to the output. When @keep_input is TRUE the test holds
+ * on to the input frames, so both fields are copied into new frames,
+ * otherwise the stored frames are reused. Returns the output frames. */
+static GList *
+run_interlace (gboolean keep_input, guint64 * bytes_copied)
+{
+  GstHarness *h;
+  GstBuffer *buf;
+  GList *inputs = NULL, *outputs = NULL;
+  guint64 copied;
+  guint i;
+
+  h = gst_harness_new_parse ("interlace field-pattern=1:1");
+  gst_harness_set_src_caps_str (h, "video/x-raw, format=I420, "
+      "width=16, height=8, framerate=50/1");
+
+  for (i = 0; i < N_FRAMES; i++) {
+    buf = gst_harness_create_buffer (h, FRAME_SIZE);
+    gst_buffer_memset (buf, 0, i + 1, FRAME_SIZE);
+    GST_BUFFER_PTS (buf) = gst_util_uint64_scale (i, GST_SECOND, 50);
+    GST_BUFFER_OFFSET (buf) = i;
+    GST_BUFFER_OFFSET_END (buf) = i + 1;
+    GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT |
+        GST_BUFFER_FLAG_GAP);
+    gst_buffer_add_video_crop_meta (buf);
+
+    if (keep_input)
+      inputs = g_list_prepend (inputs, gst_buffer_ref (buf));
+    fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+  }
+
+  while ((buf = gst_harness_try_pull (h)))
+    outputs = g_list_append (outputs, buf);
+  fail_unless_equals_int (g_list_length (outputs), N_FRAMES / 2);
+
+  g_object_get (h->element, "bytes-copied", bytes_copied, NULL);
+
+  /* the counter starts again from 0 in NULL */
+  gst_element_set_state (h->element, GST_STATE_NULL);
+  g_object_get (h->element, "bytes-copied", &copied, NULL);
+  fail_unless_equals_uint64 (copied, 0);
+
+  g_list_free_full (inputs, (GDestroyNotify) gst_buffer_unref);
+  gst_harness_teardown (h);
+
+  return outputs;
+}
+
+GST_START_TEST (test_weave_reuse)
+{
+  GList *reused, *copied, *r, *c;
+  guint64 reused_bytes, copied_bytes;
+  GstMapInfo map;
+  guint i;
+
+  reused = run_interlace (FALSE, &reused_bytes);
+  copied = run_interlace (TRUE, &copied_bytes);
+
+  /* only one field is copied into a reused frame */
+  fail_unless (reused_bytes > 0);
+  fail_unless_equals_uint64 (reused_bytes * 2, copied_bytes);
+
+  for (r = reused, c = copied, i = 0; r && c; r = r->next, c = c->next, i++) {
+    GstBuffer *rbuf = r->data, *cbuf = c->data;
+    guint8 even, odd;
+
+    /* the lines alternate between the two woven frames */
+    fail_unless (gst_buffer_map (rbuf, &map, GST_MAP_READ));
+    fail_unless_equals_int (map.size, FRAME_SIZE);
+    even = map.data[0];
+    odd = map.data[WIDTH];
+    fail_unless (MIN (even, odd) == 2 * i + 1 && MAX (even, odd) == 2 * i + 2);
+    gst_buffer_unmap (rbuf, &map);
+
+    fail_unless (gst_buffer_map (cbuf, &map, GST_MAP_READ));
+    fail_unless_equals_int (gst_buffer_memcmp (rbuf, 0, map.data, map.size),
+        0);
+    gst_buffer_unmap (cbuf, &map);
+
+    fail_unless_equals_uint64 (GST_BUFFER_PTS (rbuf), GST_BUFFER_PTS (cbuf));
+    fail_unless_equals_uint64 (GST_BUFFER_DURATION (rbuf),
+        GST_BUFFER_DURATION (cbuf));
+    fail_unless_equals_int (GST_BUFFER_FLAGS (rbuf), GST_BUFFER_FLAGS (cbuf));
+    fail_if (GST_BUFFER_FLAG_IS_SET (rbuf, GST_BUFFER_FLAG_DELTA_UNIT));
+    fail_if (GST_BUFFER_FLAG_IS_SET (rbuf, GST_BUFFER_FLAG_GAP));
+    fail_unless_equals_uint64 (GST_BUFFER_OFFSET (rbuf),
+        GST_BUFFER_OFFSET_NONE);
+    fail_unless_equals_uint64 (GST_BUFFER_OFFSET_END (rbuf),
+        GST_BUFFER_OFFSET_NONE);
+    fail_unless (gst_buffer_get_video_crop_meta (rbuf) == NULL);
+    fail_unless (gst_buffer_get_video_crop_meta (cbuf) == NULL);
+  }
+  fail_unless (r == NULL && c == NULL);
+
+  g_list_free_full (reused, (GDestroyNotify) gst_buffer_unref);
+  g_list_free_full (copied, (GDestroyNotify) gst_buffer_unref);
+}
+
+GST_END_TEST;
+
+static Suite *
+interlace_suite (void)
+{
+  Suite *s = suite_create ("interlace");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_weave_reuse);
+
+  return s;
+}
+
+GST_CHECK_MAIN (interlace);
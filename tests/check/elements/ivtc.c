@@ -0,0 +1,304 @@
+/* GStreamer
+ *
+ * unit test for ivtc
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <gst/video/video.h>
+
+/* for the queued fields and their cached scores */
+#include "gstivtc.h"
+/* the comb metric is not exported by the plugin */
+#include "ivtccomb.c"
+
+#define N_FRAMES 24
+
+/* widths that are not a multiple of the 16 pixels of the SIMD rows */
+static const gint widths[] = { 16, 17, 31, 33, 47, 100, 255, 721, 2048 };
+
+/* get_comb_score() before ivtccomb.c, on @height lines that alternate
+ * between @top and @bottom */
+static int
+comb_score_ref (const guint8 * top, const guint8 * bottom, gint stride,
+    gint width, gint height)
+{
+  int *thisline = g_new0 (int, width);
+  int score = 0;
+  int i, j;
+
+  for (j = 2; j < height - 2; j++) {
+    const guint8 *src1 = ((j - 1) & 1 ? bottom : top) + (j - 1) * stride;
+    const guint8 *src2 = (j & 1 ? bottom : top) + j * stride;
+    const guint8 *src3 = ((j + 1) & 1 ? bottom : top) + (j + 1) * stride;
+
+    for (i = 0; i < width; i++) {
+      if (src2[i] < MIN (src1[i], src3[i]) - 5 ||
+          src2[i] > MAX (src1[i], src3[i]) + 5) {
+        if (i > 0)
+          thisline[i] += thisline[i - 1];
+        thisline[i]++;
+        if (thisline[i] > 1000)
+          thisline[i] = 1000;
+      } else {
+        thisline[i] = 0;
+      }
+      if (thisline[i] > 100)
+        score++;
+    }
+  }
+
+  g_free (thisline);
+
+  return score;
+}
+
+/* A textured background with a box at @x that moves between the frames
+ * of the two fields, so the box edges comb, with a little noise */
+static void
+fill_lines (guint8 * data, gint stride, gint width, gint height, gint x,
+    GRand * rand)
+{
+  gint i, j;
+
+  for (j = 0; j < height; j++) {
+    for (i = 0; i < width; i++) {
+      guint v = 64 + ((i / 8 + j / 8) & 1) * 32;
+
+      if (i >= x && i < x + width / 2 && j >= height / 4
+          && j < 3 * height / 4)
+        v = 220;
+      data[j * stride + i] = v + g_rand_int_range (rand, 0, 4);
+    }
+  }
+}
+
+GST_START_TEST (test_comb_rows)
+{
+  const gint height = 64;
+  gint stride = 2048 + 32;
+  guint8 *top, *bottom, *mask;
+  guint16 *thisline;
+  GRand *rand;
+  guint i, run;
+  gint j;
+
+  rand = g_rand_new_with_seed (0);
+  top = g_malloc (stride * height);
+  bottom = g_malloc (stride * height);
+  mask = g_malloc (stride);
+  thisline = g_new (guint16, stride);
+
+  for (i = 0; i < G_N_ELEMENTS (widths); i++) {
+    gint width = widths[i];
+
+    for (run = 0; run < 3; run++) {
+      int score = 0, ref;
+
+      /* without motion, with a little and with a lot */
+      fill_lines (top, stride, width, height, width / 8, rand);
+      fill_lines (bottom, stride, width, height, width / 8 + run * width / 8,
+          rand);
+
+      memset (thisline, 0, stride * sizeof (guint16));
+      for (j = 2; j < height - 2; j++) {
+        ivtc_comb_mask_row (mask,
+            ((j - 1) & 1 ? bottom : top) + (j - 1) * stride,
+            (j & 1 ? bottom : top) + j * stride,
+            ((j + 1) & 1 ? bottom : top) + (j + 1) * stride, width);
+        score += ivtc_comb_accumulate_row (thisline, mask, width);
+      }
+
+      ref = comb_score_ref (top, bottom, stride, width, height);
+      if (score != ref)
+        fail ("width %d, run %u: comb score %d, expected %d", width, run,
+            score, ref);
+    }
+  }
+
+  g_free (top);
+  g_free (bottom);
+  g_free (mask);
+  g_free (thisline);
+  g_rand_free (rand);
+}
+
+GST_END_TEST;
+
+static const struct
+{
+  gint width, height;
+} frame_sizes[] = {
+  {97, 130},
+  {721, 68},
+  {176, 144}
+};
+
+/* Returns N_FRAMES frames of a 3:2 pulldown of a box moving by 6 pixels
+ * per film frame: film frame k gives 2 fields when k is even and 3
+ * otherwise, the frames with 3 fields have the RFF flag */
+static GstBuffer **
+create_frames (const GstVideoInfo * info, GRand * rand)
+{
+  GstBuffer **frames = g_new0 (GstBuffer *, N_FRAMES);
+  gint width = GST_VIDEO_INFO_WIDTH (info);
+  gint height = GST_VIDEO_INFO_HEIGHT (info);
+  gint stride = GST_VIDEO_INFO_COMP_STRIDE (info, 0);
+  guint8 *film = g_malloc (stride * height);
+  GstVideoFrame dest;
+  guint i, k = 0, parity = 0;
+  gint j;
+
+  for (i = 0; i < N_FRAMES; i++) {
+    guint n_fields = k & 1 ? 3 : 2;
+    guint8 *data;
+
+    frames[i] = gst_buffer_new_allocate (NULL, info->size, NULL);
+    gst_buffer_memset (frames[i], 0, 128, info->size);
+    GST_BUFFER_PTS (frames[i]) = gst_util_uint64_scale (i, GST_SECOND, 30);
+    GST_BUFFER_DURATION (frames[i]) = GST_SECOND / 30;
+    if (parity == 0)
+      GST_BUFFER_FLAG_SET (frames[i], GST_VIDEO_BUFFER_FLAG_TFF);
+    if (n_fields == 3)
+      GST_BUFFER_FLAG_SET (frames[i], GST_VIDEO_BUFFER_FLAG_RFF);
+
+    fail_unless (gst_video_frame_map (&dest, info, frames[i], GST_MAP_WRITE));
+    data = GST_VIDEO_FRAME_COMP_DATA (&dest, 0);
+    fill_lines (film, stride, width, height, 6 * k, rand);
+    for (j = 0; j < height; j++)
+      memcpy (data + j * stride, film + j * stride, width);
+    gst_video_frame_unmap (&dest);
+
+    parity ^= n_fields & 1;
+    k++;
+  }
+
+  g_free (film);
+
+  return frames;
+}
+
+/* Checks the cached score of each queued field with the next one against
+ * the score of the two fields computed from scratch, returns the number of
+ * cached scores */
+static guint
+check_cached_scores (GstIvtc * ivtc)
+{
+  guint n = 0;
+  gint i;
+
+  for (i = 0; i + 1 < ivtc->n_fields; i++) {
+    GstIvtcField *f1 = &ivtc->fields[i];
+    GstIvtcField *f2 = &ivtc->fields[i + 1];
+    GstVideoFrame *top, *bottom;
+    int ref;
+
+    if (f1->next_score < 0)
+      continue;
+
+    top = f1->parity == 0 ? &f1->frame : &f2->frame;
+    bottom = f1->parity == 0 ? &f2->frame : &f1->frame;
+    ref = comb_score_ref (GST_VIDEO_FRAME_COMP_DATA (top, 0),
+        GST_VIDEO_FRAME_COMP_DATA (bottom, 0),
+        GST_VIDEO_FRAME_COMP_STRIDE (top, 0),
+        GST_VIDEO_FRAME_COMP_WIDTH (top, 0),
+        GST_VIDEO_FRAME_COMP_HEIGHT (top, 0));
+    if (f1->next_score != ref)
+      fail ("field %d at %" GST_TIME_FORMAT ": cached score %d, expected %d",
+          i, GST_TIME_ARGS (f1->ts), f1->next_score, ref);
+    n++;
+  }
+
+  return n;
+}
+
+/* The fields that are not retired keep the scores cached with their next
+ * field, which must match the scores of the scalar per pixel loop for
+ * widths that are not a multiple of 16, with one thread and with the rows
+ * split in bands */
+GST_START_TEST (test_cached_scores)
+{
+  static const guint n_threads[] = { 1, 4 };
+  GstBuffer **frames;
+  GstVideoInfo info;
+  GstCaps *caps;
+  gchar *caps_str;
+  GRand *rand;
+  guint s, t, i, n_cached = 0;
+
+  for (s = 0; s < G_N_ELEMENTS (frame_sizes); s++) {
+    caps_str = g_strdup_printf ("video/x-raw, format=I420, width=%d, "
+        "height=%d, framerate=30/1", frame_sizes[s].width,
+        frame_sizes[s].height);
+    caps = gst_caps_from_string (caps_str);
+    fail_unless (gst_video_info_from_caps (&info, caps));
+    gst_caps_unref (caps);
+
+    rand = g_rand_new_with_seed (s);
+    frames = create_frames (&info, rand);
+    g_rand_free (rand);
+
+    for (t = 0; t < G_N_ELEMENTS (n_threads); t++) {
+      GstHarness *h;
+      gchar *desc;
+
+      desc = g_strdup_printf ("ivtc n-threads=%u", n_threads[t]);
+      h = gst_harness_new_parse (desc);
+      g_free (desc);
+      gst_harness_set_src_caps_str (h, caps_str);
+
+      for (i = 0; i < N_FRAMES; i++) {
+        fail_unless_equals_int (gst_harness_push (h,
+                gst_buffer_ref (frames[i])), GST_FLOW_OK);
+        n_cached += check_cached_scores ((GstIvtc *) h->element);
+      }
+      fail_unless (gst_harness_buffers_received (h) > 0);
+
+      gst_harness_teardown (h);
+    }
+
+    for (i = 0; i < N_FRAMES; i++)
+      gst_buffer_unref (frames[i]);
+    g_free (frames);
+    g_free (caps_str);
+  }
+
+  /* some scores were cached across gst_ivtc_retire_fields() */
+  fail_unless (n_cached > 0);
+}
+
+GST_END_TEST;
+
+static Suite *
+ivtc_suite (void)
+{
+  Suite *s = suite_create ("ivtc");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_comb_rows);
+  tcase_add_test (tc_chain, test_cached_scores);
+
+  return s;
+}
+
+GST_CHECK_MAIN (ivtc);
@@ -803,6 +803,33 @@ GST_START_TEST (test_keyframe_flag_propagation)
 
 GST_END_TEST;
 
+static void
+test_packet_batching_check_output (GList * bufs)
+{
+  guint n_bufs = 0, n_packets = 0;
+
+  while (bufs != NULL) {
+    GstBuffer *buf = bufs->data;
+
+    n_packets += gst_buffer_get_size (buf) / 188;
+    n_bufs++;
+    bufs = bufs->next;
+  }
+  GST_LOG ("%u packets in %u buffers", n_packets, n_bufs);
+
+  /* the packets of a PES are output together, only PAT and PMT come
+   * in separate buffers */
+  fail_unless (n_bufs < n_packets / 10);
+}
+
+GST_START_TEST (test_packet_batching)
+{
+  check_tsmux_pad (&video_src_template, VIDEO_CAPS_STRING, 0xE0, 0x1b,
+      "sink_%d", test_packet_batching_check_output, 20, 20000, 0);
+}
+
+GST_END_TEST;
+
 static Suite *
 mpegtsmux_suite (void)
 {
@@ -819,6 +846,7 @@ mpegtsmux_suite (void)
   tcase_add_test (tc_chain, test_multiple_state_change);
   tcase_add_test (tc_chain, test_align);
   tcase_add_test (tc_chain, test_keyframe_flag_propagation);
+  tcase_add_test (tc_chain, test_packet_batching);
 
   return s;
 }
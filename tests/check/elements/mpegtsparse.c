@@ -0,0 +1,243 @@
+/* GStreamer
+ *
+ * unit test for tsparse
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <string.h>
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+
+#define TS_CAPS "video/mpegts, systemstream=(boolean)true"
+#define N_PACKETS 120
+/* not a multiple of any packet size, the packets straddle input buffers */
+#define CHUNK_SIZE 1000
+#define GARBAGE_SIZE 100
+/* 3 PIDs that are neither PSI nor PCR, so the base class skips them */
+#define PID(i) (0x100 + (i) % 3)
+
+static const guint packet_sizes[] = { 188, 192, 204, 208 };
+
+/* Writes packet @i of @packet_size bytes: a 4 byte timecode before the TS
+ * packet for 192 byte packets, FEC bytes after it for 204 and 208 byte
+ * packets. None of the bytes after the sync byte is a sync byte */
+static void
+write_packet (guint8 * data, guint packet_size, guint i)
+{
+  guint8 *ts = data;
+
+  memset (data, 0xff, packet_size);
+  if (packet_size == 192) {
+    GST_WRITE_UINT32_BE (data, i & 0x3f);
+    ts += 4;
+  }
+
+  ts[0] = 0x47;
+  ts[1] = PID (i) >> 8;
+  ts[2] = PID (i) & 0xff;
+  ts[3] = 0x10 | (i & 0x0f);
+  memset (ts + 4, i & 0x3f, 184);
+}
+
+/* Returns the stream of N_PACKETS packets, with GARBAGE_SIZE bytes between
+ * the two halves when @garbage is TRUE, in @size. Also appends the packets
+ * of the PIDs @pid_a and @pid_b to @expected */
+static guint8 *
+create_stream (guint packet_size, gboolean garbage, guint pid_a, guint pid_b,
+    gsize * size, GByteArray * expected)
+{
+  guint8 *data, *p;
+  guint i;
+
+  *size = N_PACKETS * packet_size + (garbage ? GARBAGE_SIZE : 0);
+  p = data = g_malloc (*size);
+
+  for (i = 0; i < N_PACKETS; i++) {
+    if (garbage && i == N_PACKETS / 2) {
+      /* a lone sync byte that doesn't start a packet */
+      memset (p, 0, GARBAGE_SIZE);
+      p[10] = 0x47;
+      p += GARBAGE_SIZE;
+    }
+
+    write_packet (p, packet_size, i);
+    if (PID (i) == pid_a || PID (i) == pid_b)
+      g_byte_array_append (expected, p, packet_size);
+    p += packet_size;
+  }
+
+  return data;
+}
+
+/* Pushes @size bytes of @data in CHUNK_SIZE buffers, or in buffers of
+ * @chunk_size bytes if not 0, and appends the output to @output */
+static void
+push_stream (GstHarness * h, const guint8 * data, gsize size,
+    gsize chunk_size, GByteArray * output)
+{
+  GstBuffer *buf;
+  GstMapInfo map;
+  gsize offset, len;
+
+  if (chunk_size == 0)
+    chunk_size = CHUNK_SIZE;
+
+  for (offset = 0; offset < size; offset += len) {
+    len = MIN (chunk_size, size - offset);
+    buf = gst_buffer_new_allocate (NULL, len, NULL);
+    gst_buffer_fill (buf, 0, data + offset, len);
+    fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+  }
+
+  while ((buf = gst_harness_try_pull (h))) {
+    fail_unless (gst_buffer_map (buf, &map, GST_MAP_READ));
+    g_byte_array_append (output, map.data, map.size);
+    gst_buffer_unmap (buf, &map);
+    gst_buffer_unref (buf);
+  }
+}
+
+static void
+check_filter (guint packet_size, gboolean garbage)
+{
+  GstHarness *h;
+  GByteArray *expected, *output;
+  guint8 *data;
+  gsize size;
+  gchar *pids;
+
+  h = gst_harness_new ("tsparse");
+  pids = g_strdup_printf ("%u:%u", PID (0), PID (2));
+  g_object_set (h->element, "pids", pids, NULL);
+  g_free (pids);
+  gst_harness_set_src_caps_str (h, TS_CAPS);
+
+  expected = g_byte_array_new ();
+  output = g_byte_array_new ();
+  data = create_stream (packet_size, garbage, PID (0), PID (2), &size,
+      expected);
+  push_stream (h, data, size, 0, output);
+
+  fail_unless_equals_int (output->len, expected->len);
+  fail_unless (memcmp (output->data, expected->data, output->len) == 0,
+      "%u byte packets: wrong output", packet_size);
+
+  g_free (data);
+  g_byte_array_unref (expected);
+  g_byte_array_unref (output);
+  gst_harness_teardown (h);
+}
+
+GST_START_TEST (test_pids_filter)
+{
+  check_filter (packet_sizes[__i__], FALSE);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_pids_resync)
+{
+  check_filter (packet_sizes[__i__], TRUE);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_pids_unset)
+{
+  GstHarness *h;
+  GByteArray *output;
+  guint8 *data;
+  gsize size;
+
+  h = gst_harness_new ("tsparse");
+  gst_harness_set_src_caps_str (h, TS_CAPS);
+
+  /* without a filter the output is the input */
+  output = g_byte_array_new ();
+  data = create_stream (188, FALSE, G_MAXUINT, G_MAXUINT, &size, NULL);
+  push_stream (h, data, size, 0, output);
+
+  fail_unless_equals_int (output->len, size);
+  fail_unless (memcmp (output->data, data, size) == 0);
+
+  g_free (data);
+  g_byte_array_unref (output);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_pids_change)
+{
+  GstHarness *h;
+  GByteArray *expected, *output;
+  guint8 *data;
+  gsize size, half;
+  guint i;
+
+  h = gst_harness_new ("tsparse");
+  g_object_set (h->element, "pids", "256", NULL);
+  gst_harness_set_src_caps_str (h, TS_CAPS);
+
+  expected = g_byte_array_new ();
+  output = g_byte_array_new ();
+  data = create_stream (188, FALSE, G_MAXUINT, G_MAXUINT, &size, NULL);
+  half = N_PACKETS / 2 * 188;
+
+  /* the new filter applies from the next buffer on */
+  for (i = 0; i < N_PACKETS; i++) {
+    if (PID (i) == (i < N_PACKETS / 2 ? 0x100 : 0x101))
+      g_byte_array_append (expected, data + i * 188, 188);
+  }
+
+  push_stream (h, data, half, 10 * 188, output);
+  g_object_set (h->element, "pids", "257", NULL);
+  push_stream (h, data + half, size - half, 10 * 188, output);
+
+  fail_unless_equals_int (output->len, expected->len);
+  fail_unless (memcmp (output->data, expected->data, output->len) == 0);
+
+  g_free (data);
+  g_byte_array_unref (expected);
+  g_byte_array_unref (output);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+static Suite *
+mpegtsparse_suite (void)
+{
+  Suite *s = suite_create ("mpegtsparse");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_loop_test (tc_chain, test_pids_filter, 0,
+      G_N_ELEMENTS (packet_sizes));
+  tcase_add_loop_test (tc_chain, test_pids_resync, 0,
+      G_N_ELEMENTS (packet_sizes));
+  tcase_add_test (tc_chain, test_pids_unset);
+  tcase_add_test (tc_chain, test_pids_change);
+
+  return s;
+}
+
+GST_CHECK_MAIN (mpegtsparse);
@@ -21,6 +21,7 @@
  */
 
 #include <gst/check/gstcheck.h>
+#include <glib/gstdio.h>
 #include <string.h>
 #include "mxfdemux.h"
 
@@ -28,6 +29,7 @@ static GstPad *mysrcpad, *mysinkpad;
 static GMainLoop *loop = NULL;
 static gboolean have_eos = FALSE;
 static gboolean have_data = FALSE;
+static guint rip_pulls = 0;
 
 static GstStaticPadTemplate mysrctemplate =
 GST_STATIC_PAD_TEMPLATE ("src", GST_PAD_SRC, GST_PAD_ALWAYS,
@@ -137,6 +139,10 @@ _src_getrange (GstPad * pad, GstObject * parent, guint64 offset, guint length,
   if (offset + length > sizeof (mxf_file))
     return GST_FLOW_EOS;
 
+  /* the size of the random index pack at the end of the file */
+  if (offset == sizeof (mxf_file) - 4 && length == 4)
+    rip_pulls++;
+
   *buffer = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
       (guint8 *) (mxf_file + offset), length, 0, length, NULL, NULL);
 
@@ -184,7 +190,8 @@ _create_src_pad_pull (void)
   return mysrcpad;
 }
 
-GST_START_TEST (test_pull)
+static void
+run_pull (const gchar * index_cache_location)
 {
   GstStateChangeReturn sret;
   GstElement *mxfdemux;
@@ -192,10 +199,12 @@ GST_START_TEST (test_pull)
 
   have_eos = FALSE;
   have_data = FALSE;
+  rip_pulls = 0;
   loop = g_main_loop_new (NULL, FALSE);
 
   mxfdemux = gst_element_factory_make ("mxfdemux", NULL);
   fail_unless (mxfdemux != NULL);
+  g_object_set (mxfdemux, "index-cache-location", index_cache_location, NULL);
   g_signal_connect (mxfdemux, "pad-added", G_CALLBACK (_pad_added), NULL);
   sinkpad = gst_element_get_static_pad (mxfdemux, "sink");
   fail_unless (sinkpad != NULL);
@@ -230,6 +239,186 @@ GST_START_TEST (test_pull)
   loop = NULL;
 }
 
+GST_START_TEST (test_pull)
+{
+  run_pull (NULL);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_pull_index_cache)
+{
+  gchar *dir, *location, *contents;
+  gsize size;
+
+  dir = g_build_filename (g_get_tmp_dir (), "mxfdemux-test-XXXXXX", NULL);
+  fail_unless (g_mkdtemp (dir) != NULL);
+  location = g_build_filename (dir, "index", NULL);
+
+  /* The index tables are stored in the cache by the first run and read
+   * from it instead of the file by the second one, which then doesn't pull
+   * the random index pack */
+  run_pull (location);
+  fail_unless (rip_pulls > 0);
+  fail_unless (g_file_get_contents (location, &contents, &size, NULL));
+  fail_unless (size > 8 + 8 + 8 + 20);
+  fail_unless (memcmp (contents, "GstMXFI2", 8) == 0);
+
+  run_pull (location);
+  fail_unless_equals_int (rip_pulls, 0);
+
+  /* a cache with the same file size and run-in but another fingerprint is
+   * for another file */
+  contents[8 + 8 + 8] ^= 0xff;
+  fail_unless (g_file_set_contents (location, contents, size, NULL));
+  g_free (contents);
+
+  run_pull (location);
+  fail_unless (rip_pulls > 0);
+
+  g_unlink (location);
+  g_rmdir (dir);
+  g_free (location);
+  g_free (dir);
+}
+
+GST_END_TEST;
+
+#define GOP_N_FRAMES 40
+#define GOP_SIZE 8
+#define GOP_FRAME_SIZE (16 * 16 * 3)
+#define GOP_FRAME_DURATION (GST_SECOND / 25)
+
+/* Writes GOP_N_FRAMES RGB frames filled with their number to an MXF file,
+ * with a keyframe every GOP_SIZE frames in the index table */
+static void
+write_gop_file (const gchar * location)
+{
+  GstElement *pipeline, *src;
+  GstFlowReturn flow;
+  GstMessage *msg;
+  GstBus *bus;
+  gchar *desc;
+  guint i;
+
+  desc = g_strdup_printf ("appsrc name=src format=time "
+      "caps=\"video/x-raw, format=RGB, width=16, height=16, "
+      "framerate=25/1\" ! mxfmux ! filesink location=\"%s\"", location);
+  pipeline = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  fail_unless (pipeline != NULL);
+  src = gst_bin_get_by_name (GST_BIN (pipeline), "src");
+  fail_unless (src != NULL);
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+
+  for (i = 0; i < GOP_N_FRAMES; i++) {
+    GstBuffer *buf = gst_buffer_new_allocate (NULL, GOP_FRAME_SIZE, NULL);
+
+    gst_buffer_memset (buf, 0, i, GOP_FRAME_SIZE);
+    GST_BUFFER_PTS (buf) = i * GOP_FRAME_DURATION;
+    GST_BUFFER_DURATION (buf) = GOP_FRAME_DURATION;
+    if (i % GOP_SIZE != 0)
+      GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT);
+    g_signal_emit_by_name (src, "push-buffer", buf, &flow);
+    gst_buffer_unref (buf);
+    fail_unless_equals_int (flow, GST_FLOW_OK);
+  }
+  g_signal_emit_by_name (src, "end-of-stream", &flow);
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (src);
+  gst_object_unref (pipeline);
+}
+
+/* Seeks to @frame and checks where playback resumes. The data always
+ * starts with the keyframe at or before @frame, the sink then drops the
+ * frames before the segment start. A key unit seek starts the segment at
+ * the keyframe, an accurate one at @frame. Each frame has its number in
+ * its bytes. */
+static void
+check_seek (GstElement * pipeline, GstElement * sink, guint frame,
+    GstSeekFlags flags)
+{
+  guint keyframe = frame - frame % GOP_SIZE;
+  guint expected = (flags & GST_SEEK_FLAG_KEY_UNIT) ? keyframe : frame;
+  const GstSegment *segment;
+  GstSample *sample;
+  GstBuffer *buf;
+  guint8 data;
+
+  fail_unless (gst_element_seek_simple (pipeline, GST_FORMAT_TIME,
+          GST_SEEK_FLAG_FLUSH | flags, frame * GOP_FRAME_DURATION));
+  fail_unless_equals_int (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE), GST_STATE_CHANGE_SUCCESS);
+
+  g_signal_emit_by_name (sink, "pull-preroll", &sample);
+  fail_unless (sample != NULL);
+  buf = gst_sample_get_buffer (sample);
+  segment = gst_sample_get_segment (sample);
+
+  fail_unless_equals_uint64 (segment->start, expected * GOP_FRAME_DURATION);
+  fail_unless_equals_uint64 (GST_BUFFER_PTS (buf),
+      expected * GOP_FRAME_DURATION);
+  fail_unless_equals_int (! !GST_BUFFER_FLAG_IS_SET (buf,
+          GST_BUFFER_FLAG_DELTA_UNIT), expected != keyframe);
+  fail_unless_equals_int (gst_buffer_extract (buf, 0, &data, 1), 1);
+  fail_unless_equals_int (data, expected);
+
+  gst_sample_unref (sample);
+}
+
+GST_START_TEST (test_seek_keyframes)
+{
+  /* keyframes, the frames around them and the last frame */
+  static const guint frames[] = { 1, 7, 8, 9, 15, 16, 23, 31, 33, 39, 0 };
+  GstElement *pipeline, *sink;
+  gchar *dir, *location, *desc;
+  guint i;
+
+  dir = g_build_filename (g_get_tmp_dir (), "mxfdemux-test-XXXXXX", NULL);
+  fail_unless (g_mkdtemp (dir) != NULL);
+  location = g_build_filename (dir, "gop.mxf", NULL);
+  write_gop_file (location);
+
+  desc = g_strdup_printf ("filesrc location=\"%s\" ! mxfdemux ! "
+      "appsink name=sink sync=false", location);
+  pipeline = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  fail_unless (pipeline != NULL);
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  fail_unless (sink != NULL);
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_PAUSED) != GST_STATE_CHANGE_FAILURE);
+  fail_unless_equals_int (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE), GST_STATE_CHANGE_SUCCESS);
+
+  /* the keyframes are found in the index tables of the file, so the seeks
+   * don't depend on the frames played before */
+  for (i = 0; i < G_N_ELEMENTS (frames); i++) {
+    check_seek (pipeline, sink, frames[i], GST_SEEK_FLAG_KEY_UNIT);
+    check_seek (pipeline, sink, frames[i], GST_SEEK_FLAG_ACCURATE);
+  }
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (sink);
+  gst_object_unref (pipeline);
+
+  g_unlink (location);
+  g_rmdir (dir);
+  g_free (location);
+  g_free (dir);
+}
+
 GST_END_TEST;
 
 GST_START_TEST (test_push)
@@ -301,6 +490,8 @@ mxfdemux_suite (void)
   suite_add_tcase (s, tc_chain);
   tcase_set_timeout (tc_chain, 180);
   tcase_add_test (tc_chain, test_pull);
+  tcase_add_test (tc_chain, test_pull_index_cache);
+  tcase_add_test (tc_chain, test_seek_keyframes);
   tcase_add_test (tc_chain, test_push);
 
   return s;
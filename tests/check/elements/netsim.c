@@ -49,6 +49,163 @@ GST_START_TEST (netsim_stress_delayed)
 
 GST_END_TEST;
 
+GST_START_TEST (netsim_seed_replay)
+{
+  GstHarness *h[2];
+  GstBuffer *buf;
+  guint64 received[2];
+  guint32 dropped[2] = { 0, 0 };
+  gint i, j;
+
+  for (i = 0; i < 2; i++) {
+    h[i] = gst_harness_new_parse ("netsim seed=42 drop-probability=0.5 "
+        "gilbert-elliott-p=0.1 gilbert-elliott-r=0.5");
+    gst_harness_set_src_caps_str (h[i], "mycaps");
+
+    for (j = 0; j < 32; j++) {
+      fail_unless_equals_int (GST_FLOW_OK,
+          gst_harness_push (h[i], gst_harness_create_buffer (h[i], 100)));
+      if (gst_harness_buffers_in_queue (h[i]) == 0)
+        dropped[i] |= 1u << j;
+      while ((buf = gst_harness_try_pull (h[i])))
+        gst_buffer_unref (buf);
+    }
+    received[i] = gst_harness_buffers_received (h[i]);
+  }
+
+  /* the same seed drops the same buffers */
+  fail_unless (received[0] > 0 && received[0] < 32);
+  fail_unless_equals_uint64 (received[0], received[1]);
+  fail_unless_equals_uint64 (dropped[0], dropped[1]);
+
+  gst_harness_teardown (h[0]);
+  gst_harness_teardown (h[1]);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (netsim_max_kbps)
+{
+  GstHarness *h = gst_harness_new_parse ("netsim max-kbps=1 "
+      "max-queue-size=2000");
+  gint i;
+
+  gst_harness_set_src_caps_str (h, "mycaps");
+
+  /* 1000 bytes take 8 s at 1 kbps: the first buffer is sent at once from
+   * the chain function, the queue holds the next two and the others are
+   * dropped. Nothing else leaves the link before the end of the test */
+  for (i = 0; i < 10; i++) {
+    fail_unless_equals_int (GST_FLOW_OK,
+        gst_harness_push (h, gst_harness_create_buffer (h, 1000)));
+  }
+
+  fail_unless_equals_uint64 (1, gst_harness_buffers_received (h));
+  gst_buffer_unref (gst_harness_pull (h));
+  fail_unless_equals_int (0, gst_harness_buffers_in_queue (h));
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+typedef struct
+{
+  GMutex lock;
+  GCond cond;
+  gboolean blocked;
+  gboolean released;
+} BlockData;
+
+/* blocks the task of netsim in the push of the first buffer until the test
+ * releases it */
+static GstPadProbeReturn
+block_first_buffer (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  BlockData *data = user_data;
+
+  g_mutex_lock (&data->lock);
+  if (!data->blocked) {
+    data->blocked = TRUE;
+    g_cond_signal (&data->cond);
+    while (!data->released)
+      g_cond_wait (&data->cond, &data->lock);
+  }
+  g_mutex_unlock (&data->lock);
+
+  return GST_PAD_PROBE_OK;
+}
+
+static GstBuffer *
+create_numbered_buffer (GstHarness * h, guint8 n)
+{
+  GstBuffer *buf = gst_harness_create_buffer (h, 100);
+
+  gst_buffer_memset (buf, 0, n, 100);
+
+  return buf;
+}
+
+GST_START_TEST (netsim_delayed_order)
+{
+  GstHarness *h = gst_harness_new_parse ("netsim max-kbps=8000 "
+      "delay-probability=1 min-delay=10 max-delay=10");
+  BlockData data = { {0}, {0}, FALSE, FALSE };
+  static const guint8 expected[] = { 0, 1, 3, 2 };
+  GstBuffer *buf;
+  guint8 n;
+  guint i;
+
+  g_mutex_init (&data.lock);
+  g_cond_init (&data.cond);
+  gst_pad_add_probe (h->sinkpad, GST_PAD_PROBE_TYPE_BUFFER,
+      block_first_buffer, &data, NULL);
+  gst_harness_set_src_caps_str (h, "mycaps");
+
+  /* buffer 0 is delayed, wait until the task is pushing it */
+  fail_unless_equals_int (GST_FLOW_OK,
+      gst_harness_push (h, create_numbered_buffer (h, 0)));
+  g_mutex_lock (&data.lock);
+  while (!data.blocked)
+    g_cond_wait (&data.cond, &data.lock);
+  g_mutex_unlock (&data.lock);
+
+  /* buffer 1 is due at once, the bucket filled up during the delay of
+   * buffer 0, but must not overtake it */
+  g_object_set (h->element, "delay-probability", 0.0, NULL);
+  fail_unless_equals_int (GST_FLOW_OK,
+      gst_harness_push (h, create_numbered_buffer (h, 1)));
+
+  /* buffer 3 leaves the link after buffer 2, which is then delayed by much
+   * more than the 100 us buffer 3 waits for the tokens: they cross */
+  g_object_set (h->element, "delay-probability", 1.0, "max-delay", 200,
+      "min-delay", 200, NULL);
+  fail_unless_equals_int (GST_FLOW_OK,
+      gst_harness_push (h, create_numbered_buffer (h, 2)));
+  g_object_set (h->element, "delay-probability", 0.0, NULL);
+  fail_unless_equals_int (GST_FLOW_OK,
+      gst_harness_push (h, create_numbered_buffer (h, 3)));
+
+  g_mutex_lock (&data.lock);
+  data.released = TRUE;
+  g_cond_signal (&data.cond);
+  g_mutex_unlock (&data.lock);
+
+  for (i = 0; i < G_N_ELEMENTS (expected); i++) {
+    buf = gst_harness_pull (h);
+    fail_unless (buf != NULL);
+    fail_unless_equals_int (gst_buffer_extract (buf, 0, &n, 1), 1);
+    fail_unless_equals_int (n, expected[i]);
+    gst_buffer_unref (buf);
+  }
+
+  gst_harness_teardown (h);
+  g_cond_clear (&data.cond);
+  g_mutex_clear (&data.lock);
+}
+
+GST_END_TEST;
+
 static Suite *
 netsim_suite (void)
 {
@@ -58,6 +215,9 @@ netsim_suite (void)
   suite_add_tcase (s, (tc_chain = tcase_create ("general")));
   tcase_add_test (tc_chain, netsim_stress);
   tcase_add_test (tc_chain, netsim_stress_delayed);
+  tcase_add_test (tc_chain, netsim_seed_replay);
+  tcase_add_test (tc_chain, netsim_max_kbps);
+  tcase_add_test (tc_chain, netsim_delayed_order);
 
   return s;
 }
@@ -42,7 +42,7 @@ GstElement *src, *sink;
 GstPad *sinkpad, *srcpad;
 
 static void
-setup_shm (void)
+setup_shm_with_ring (guint ring_size)
 {
   gchar *socket_path = NULL;
 
@@ -52,7 +52,8 @@ setup_shm (void)
   srcpad = gst_check_setup_src_pad (sink, &src_template);
   sinkpad = gst_check_setup_sink_pad (src, &sink_template);
 
-  g_object_set (sink, "socket-path", "shm-unit-test", NULL);
+  g_object_set (sink, "socket-path", "shm-unit-test", "ring-size", ring_size,
+      NULL);
 
   fail_unless (gst_element_set_state (sink, GST_STATE_PLAYING) ==
       GST_STATE_CHANGE_ASYNC);
@@ -69,6 +70,19 @@ setup_shm (void)
       GST_STATE_CHANGE_SUCCESS);
 }
 
+static void
+setup_shm (void)
+{
+  setup_shm_with_ring (0);
+}
+
+static void
+setup_shm_ring (void)
+{
+  /* fewer slots than buffers pushed by the tests */
+  setup_shm_with_ring (2);
+}
+
 static void
 teardown_shm (void)
 {
@@ -169,6 +183,61 @@ GST_START_TEST (test_shm_alloc)
 
 GST_END_TEST;
 
+GST_START_TEST (test_shm_ring)
+{
+  GstBuffer *buf;
+  GstSegment segment;
+  guint8 value;
+  guint i;
+
+  gst_pad_push_event (srcpad, gst_event_new_stream_start ("test"));
+  gst_segment_init (&segment, GST_FORMAT_BYTES);
+  gst_pad_push_event (srcpad, gst_event_new_segment (&segment));
+
+  /* each buffer takes a slot of the ring until it gets released, which
+   * only works if the acks reach shmsink while shmsrc waits */
+  for (i = 0; i < 10; i++) {
+    buf = gst_buffer_new_allocate (NULL, 1000, NULL);
+    gst_buffer_memset (buf, 0, i, 1000);
+    fail_unless (gst_pad_push (srcpad, buf) == GST_FLOW_OK);
+
+    g_mutex_lock (&check_mutex);
+    while (buffers == NULL)
+      g_cond_wait (&check_cond, &check_mutex);
+    g_mutex_unlock (&check_mutex);
+    fail_unless (g_list_length (buffers) == 1);
+
+    buf = buffers->data;
+    fail_unless (gst_buffer_get_size (buf) == 1000);
+    fail_unless (gst_buffer_extract (buf, 999, &value, 1) == 1);
+    fail_unless_equals_int (value, i);
+    gst_check_drop_buffers ();
+  }
+
+  teardown_shm ();
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_shm_ring_size)
+{
+  guint ring_size;
+
+  /* the slot counters wrap around, the ring can only have a power of 2
+   * number of slots */
+  g_object_set (sink, "ring-size", 3, NULL);
+  g_object_get (sink, "ring-size", &ring_size, NULL);
+  fail_unless_equals_int (ring_size, 2);
+
+  g_object_set (sink, "ring-size", 4, NULL);
+  g_object_get (sink, "ring-size", &ring_size, NULL);
+  fail_unless_equals_int (ring_size, 4);
+
+  teardown_shm ();
+}
+
+GST_END_TEST;
+
 static Suite *
 shm_suite (void)
 {
@@ -181,6 +250,13 @@ shm_suite (void)
   tcase_add_test (tc, test_shm_alloc);
   suite_add_tcase (s, tc);
 
+  tc = tcase_create ("shm-ring");
+  tcase_add_checked_fixture (tc, setup_shm_ring, NULL);
+  tcase_add_test (tc, test_shm_ring);
+  tcase_add_test (tc, test_shm_ring_size);
+  tcase_add_test (tc, test_shm_alloc);
+  suite_add_tcase (s, tc);
+
   return s;
 }
 
@@ -0,0 +1,352 @@
+/* GStreamer
+ *
+ * unit test for scenechange and videodiff
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <gst/video/video.h>
+
+/* for the last frame score */
+#include "gstscenechange.h"
+/* the SAD line functions are static */
+#include "videosad.c"
+
+#define N_FRAMES 8
+
+typedef struct
+{
+  const gchar *name;
+  VideoSadLineFunc sad_line;
+} Kernel;
+
+/* the SIMD line functions the CPU supports, which includes the one
+ * video_sad_line_select() picks */
+static guint
+get_kernels (Kernel * kernels)
+{
+  guint n = 0;
+
+#if defined (__SSE2__)
+  kernels[n].name = "sse2";
+  kernels[n++].sad_line = video_sad_line_sse2;
+#ifdef HAVE_VIDEO_SAD_AVX2
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("avx2")) {
+    kernels[n].name = "avx2";
+    kernels[n++].sad_line = video_sad_line_avx2;
+  }
+#endif
+#endif
+
+  return n;
+}
+
+/* widths around the 16, 32 and 64 pixel steps of the SIMD functions, on
+ * lines that don't start on a 16 byte boundary */
+GST_START_TEST (test_sad_line)
+{
+  static const gint widths[] =
+      { 1, 7, 15, 16, 17, 31, 33, 47, 63, 65, 97, 129, 255, 1001 };
+  Kernel kernels[2];
+  guint8 *s1, *s2;
+  guint n_kernels, i, j, run;
+  GRand *rand;
+  gint k;
+
+  n_kernels = get_kernels (kernels);
+  if (n_kernels == 0)
+    return;
+
+  rand = g_rand_new_with_seed (0);
+  s1 = g_malloc (1024 + 3);
+  s2 = g_malloc (1024 + 5);
+
+  for (run = 0; run < 2; run++) {
+    /* random lines, and lines with the largest differences, which must not
+     * overflow the lanes */
+    for (k = 0; k < 1024; k++) {
+      s1[3 + k] = run ? 0 : g_rand_int (rand);
+      s2[5 + k] = run ? 255 : g_rand_int (rand);
+    }
+
+    for (i = 0; i < G_N_ELEMENTS (widths); i++) {
+      guint64 ref = video_sad_line_c (s1 + 3, s2 + 5, widths[i]);
+
+      for (j = 0; j < n_kernels; j++) {
+        guint64 sad = kernels[j].sad_line (s1 + 3, s2 + 5, widths[i]);
+
+        if (sad != ref)
+          fail ("%s: width %d, SAD %" G_GUINT64_FORMAT ", expected %"
+              G_GUINT64_FORMAT, kernels[j].name, widths[i], sad, ref);
+      }
+    }
+  }
+
+  g_free (s1);
+  g_free (s2);
+  g_rand_free (rand);
+}
+
+GST_END_TEST;
+
+static const struct
+{
+  gint width, height;
+} frame_sizes[] = {
+  {97, 61},
+  {1001, 17},
+  {16, 16}
+};
+
+/* Returns N_FRAMES I420 frames of random luma around a level that changes
+ * from frame to frame, with a cut in the middle */
+static GstBuffer **
+create_frames (const GstVideoInfo * info, GRand * rand)
+{
+  GstBuffer **frames = g_new0 (GstBuffer *, N_FRAMES);
+  GstVideoFrame frame;
+  guint i;
+  gint x, y;
+
+  for (i = 0; i < N_FRAMES; i++) {
+    gint level = i < N_FRAMES / 2 ? 60 + 4 * i : 180 - 4 * i;
+
+    frames[i] = gst_buffer_new_allocate (NULL, info->size, NULL);
+    gst_buffer_memset (frames[i], 0, 128, info->size);
+    GST_BUFFER_PTS (frames[i]) = gst_util_uint64_scale (i, GST_SECOND, 25);
+    GST_BUFFER_DURATION (frames[i]) = GST_SECOND / 25;
+
+    fail_unless (gst_video_frame_map (&frame, info, frames[i],
+            GST_MAP_WRITE));
+    for (y = 0; y < GST_VIDEO_FRAME_HEIGHT (&frame); y++) {
+      guint8 *line = (guint8 *) GST_VIDEO_FRAME_COMP_DATA (&frame, 0) +
+          y * GST_VIDEO_FRAME_COMP_STRIDE (&frame, 0);
+
+      for (x = 0; x < GST_VIDEO_FRAME_WIDTH (&frame); x++) {
+        /* a static half, so that videodiff has blocks to skip */
+        if (y < GST_VIDEO_FRAME_HEIGHT (&frame) / 2)
+          line[x] = (x * 7 + y * 3) & 0xff;
+        else
+          line[x] = level + g_rand_int_range (rand, 0, 24);
+      }
+    }
+    gst_video_frame_unmap (&frame);
+  }
+
+  return frames;
+}
+
+static void
+free_frames (GstBuffer ** frames)
+{
+  guint i;
+
+  for (i = 0; i < N_FRAMES; i++)
+    gst_buffer_unref (frames[i]);
+  g_free (frames);
+}
+
+/* get_frame_score() before videosad.c */
+static double
+frame_score_ref (GstBuffer * b1, GstBuffer * b2, const GstVideoInfo * info)
+{
+  GstVideoFrame f1, f2;
+  int score = 0;
+  int i, j;
+
+  fail_unless (gst_video_frame_map (&f1, info, b1, GST_MAP_READ));
+  fail_unless (gst_video_frame_map (&f2, info, b2, GST_MAP_READ));
+
+  for (j = 0; j < info->height; j++) {
+    guint8 *s1 = (guint8 *) f1.data[0] + f1.info.stride[0] * j;
+    guint8 *s2 = (guint8 *) f2.data[0] + f2.info.stride[0] * j;
+
+    for (i = 0; i < info->width; i++)
+      score += ABS (s1[i] - s2[i]);
+  }
+
+  gst_video_frame_unmap (&f1);
+  gst_video_frame_unmap (&f2);
+
+  return ((double) score) / (info->width * info->height);
+}
+
+static gchar *
+make_caps (gint width, gint height, GstVideoInfo * info)
+{
+  gchar *caps_str;
+  GstCaps *caps;
+
+  caps_str = g_strdup_printf ("video/x-raw, format=I420, width=%d, "
+      "height=%d, framerate=25/1", width, height);
+  caps = gst_caps_from_string (caps_str);
+  fail_unless (gst_video_info_from_caps (info, caps));
+  gst_caps_unref (caps);
+
+  return caps_str;
+}
+
+/* with sample-step=1 every pixel is compared, so the score of each frame
+ * must be the one of the original per pixel loop */
+GST_START_TEST (test_scenechange_full_score)
+{
+  GstSceneChange *scenechange;
+  GstBuffer **frames;
+  GstVideoInfo info;
+  GstHarness *h;
+  gchar *caps_str;
+  GRand *rand;
+  guint i;
+
+  caps_str = make_caps (frame_sizes[__i__].width, frame_sizes[__i__].height,
+      &info);
+  rand = g_rand_new_with_seed (__i__);
+  frames = create_frames (&info, rand);
+  g_rand_free (rand);
+
+  h = gst_harness_new_parse ("scenechange sample-step=1");
+  gst_harness_set_src_caps_str (h, caps_str);
+  scenechange = (GstSceneChange *) h->element;
+
+  for (i = 0; i < N_FRAMES; i++) {
+    fail_unless_equals_int (gst_harness_push (h, gst_buffer_ref (frames[i])),
+        GST_FLOW_OK);
+    if (i > 0) {
+      double score = scenechange->diffs[SC_N_DIFFS - 1];
+      double ref = frame_score_ref (frames[i - 1], frames[i], &info);
+
+      if (score != ref)
+        fail ("frame %u: score %g, expected %g", i, score, ref);
+    }
+  }
+  fail_unless_equals_int (gst_harness_buffers_received (h), N_FRAMES);
+
+  gst_harness_teardown (h);
+  free_frames (frames);
+  g_free (caps_str);
+}
+
+GST_END_TEST;
+
+/* the luma of gst_video_diff_transform_frame_ip_planarY() before the
+ * unchanged blocks were skipped */
+static void
+diff_luma_ref (GstBuffer * old, GstBuffer * in, const GstVideoInfo * info,
+    guint8 * out)
+{
+  GstVideoFrame f1, f2;
+  int threshold = 10;
+  int t = 0;
+  int i, j;
+
+  fail_unless (gst_video_frame_map (&f1, info, old, GST_MAP_READ));
+  fail_unless (gst_video_frame_map (&f2, info, in, GST_MAP_READ));
+
+  for (j = 0; j < info->height; j++) {
+    guint8 *d = out + info->width * j;
+    guint8 *s1 = (guint8 *) f1.data[0] + f1.info.stride[0] * j;
+    guint8 *s2 = (guint8 *) f2.data[0] + f2.info.stride[0] * j;
+
+    for (i = 0; i < info->width; i++) {
+      if ((s2[i] < s1[i] - threshold) || (s2[i] > s1[i] + threshold)) {
+        if ((i + j + t) & 0x4) {
+          d[i] = 16;
+        } else {
+          d[i] = 240;
+        }
+      } else {
+        d[i] = s2[i];
+      }
+    }
+  }
+
+  gst_video_frame_unmap (&f1);
+  gst_video_frame_unmap (&f2);
+}
+
+/* skipping the blocks whose SAD is at most the threshold must not change
+ * any pixel of the output */
+GST_START_TEST (test_videodiff_blocks)
+{
+  GstBuffer **frames, *outbuf;
+  GstVideoFrame out;
+  GstVideoInfo info;
+  GstHarness *h;
+  gchar *caps_str;
+  guint8 *ref;
+  GRand *rand;
+  guint i;
+  gint j;
+
+  caps_str = make_caps (frame_sizes[__i__].width, frame_sizes[__i__].height,
+      &info);
+  rand = g_rand_new_with_seed (__i__);
+  frames = create_frames (&info, rand);
+  g_rand_free (rand);
+  ref = g_malloc (info.width * info.height);
+
+  h = gst_harness_new ("videodiff");
+  gst_harness_set_src_caps_str (h, caps_str);
+
+  for (i = 0; i < N_FRAMES; i++) {
+    outbuf = gst_harness_push_and_pull (h, gst_buffer_ref (frames[i]));
+    fail_unless (outbuf != NULL);
+
+    if (i > 0) {
+      diff_luma_ref (frames[i - 1], frames[i], &info, ref);
+      fail_unless (gst_video_frame_map (&out, &info, outbuf, GST_MAP_READ));
+      for (j = 0; j < info.height; j++) {
+        if (memcmp ((guint8 *) out.data[0] + out.info.stride[0] * j,
+                ref + info.width * j, info.width) != 0)
+          fail ("frame %u: line %d differs", i, j);
+      }
+      gst_video_frame_unmap (&out);
+    }
+    gst_buffer_unref (outbuf);
+  }
+
+  gst_harness_teardown (h);
+  g_free (ref);
+  free_frames (frames);
+  g_free (caps_str);
+}
+
+GST_END_TEST;
+
+static Suite *
+videofilters_suite (void)
+{
+  Suite *s = suite_create ("videofilters");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_sad_line);
+  tcase_add_loop_test (tc_chain, test_scenechange_full_score, 0,
+      G_N_ELEMENTS (frame_sizes));
+  tcase_add_loop_test (tc_chain, test_videodiff_blocks, 0,
+      G_N_ELEMENTS (frame_sizes));
+
+  return s;
+}
+
+GST_CHECK_MAIN (videofilters);
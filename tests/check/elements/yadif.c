@@ -0,0 +1,288 @@
+/* GStreamer
+ *
+ * unit test for yadif
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+
+/* the line filters are static */
+#include "../../../gst/yadif/vf_yadif.c"
+#undef CHECK
+#undef FILTER
+#include "../../../gst/yadif/yadif.c"
+
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+#define FORMAT_10BIT(f) f "_10LE"
+#else
+#define FORMAT_10BIT(f) f "_10BE"
+#endif
+
+#define MAX_WIDTH 1024
+
+typedef struct
+{
+  const gchar *name;
+  GstYadifFilterLineFunc filter_line;
+  GstYadifFilterLine16Func filter_line_16bit;
+} Kernel;
+
+/* the SIMD line filters the CPU supports, which includes the one
+ * yadif_filter_line_select() picks */
+static guint
+get_kernels (Kernel * kernels)
+{
+  guint n = 0;
+
+#if defined (__SSE2__)
+  kernels[n].name = "sse2";
+  kernels[n].filter_line = yadif_filter_line_sse2;
+  kernels[n++].filter_line_16bit = yadif_filter_line_16bit_sse2;
+#ifdef HAVE_YADIF_AVX2
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("ssse3")) {
+    kernels[n].name = "ssse3";
+    kernels[n].filter_line = yadif_filter_line_ssse3;
+    kernels[n++].filter_line_16bit = yadif_filter_line_16bit_ssse3;
+  }
+  if (__builtin_cpu_supports ("avx2")) {
+    kernels[n].name = "avx2";
+    kernels[n].filter_line = yadif_filter_line_avx2;
+    kernels[n++].filter_line_16bit = yadif_filter_line_16bit_avx2;
+  }
+#endif
+#endif
+
+  return n;
+}
+
+/* 5 lines of random samples of depth bits, or of a gradient so that the
+ * spatial checks find directions */
+static void
+fill_lines (GRand * rand, guint8 * data, gint stride, gint depth,
+    gboolean smooth)
+{
+  gint i, y;
+
+  for (y = 0; y < 5; y++) {
+    guint8 *line = data + y * stride;
+
+    for (i = 0; i < stride / 2; i++) {
+      guint v;
+
+      if (smooth)
+        v = (i + 2 * y) * 3 / 2 + g_rand_int_range (rand, 0, 2);
+      else
+        v = g_rand_int (rand);
+      v &= (1 << depth) - 1;
+
+      if (depth > 8)
+        ((guint16 *) line)[i] = v;
+      else
+        line[i] = line[stride / 2 + i] = v;
+    }
+  }
+}
+
+/* filters the middle one of 5 lines with filter_line_c() or
+ * filter_line_c_16bit() and with each SIMD line filter, for widths that are
+ * not a multiple of the SIMD step, all parities and modes */
+static void
+check_kernels (gint depth)
+{
+  static const gint widths[] = { 16, 17, 23, 31, 33, 47, 101, 255, 1001 };
+  Kernel kernels[4];
+  gint stride = (MAX_WIDTH + 64) * 2;
+  gint o = 2 * stride + 3 * (depth > 8 ? 2 : 1);
+  guint8 *frames[3], *ref, *out;
+  guint n_kernels, i, j, k, run;
+  gint parity, mode;
+  GRand *rand;
+
+  n_kernels = get_kernels (kernels);
+  if (n_kernels == 0)
+    return;
+
+  rand = g_rand_new_with_seed (depth);
+  for (k = 0; k < 3; k++)
+    frames[k] = g_malloc (5 * stride);
+  ref = g_malloc0 (5 * stride);
+  out = g_malloc0 (5 * stride);
+
+  for (run = 0; run < 2; run++) {
+    for (k = 0; k < 3; k++)
+      fill_lines (rand, frames[k], stride, depth, run);
+
+    for (i = 0; i < G_N_ELEMENTS (widths); i++) {
+      gint w = widths[i];
+      gint n = w * (depth > 8 ? 2 : 1);
+
+      for (parity = 0; parity < 2; parity++) {
+        for (mode = 0; mode < 3; mode++) {
+          if (depth > 8)
+            filter_line_c_16bit ((guint16 *) (ref + o),
+                (guint16 *) (frames[0] + o), (guint16 *) (frames[1] + o),
+                (guint16 *) (frames[2] + o), w, stride, -stride, parity,
+                mode);
+          else
+            filter_line_c (ref + o, frames[0] + o, frames[1] + o,
+                frames[2] + o, w, stride, -stride, parity, mode);
+
+          for (j = 0; j < n_kernels; j++) {
+            memset (out + o, 0, n);
+            if (depth > 8)
+              kernels[j].filter_line_16bit ((guint16 *) (out + o),
+                  (guint16 *) (frames[0] + o), (guint16 *) (frames[1] + o),
+                  (guint16 *) (frames[2] + o), w, stride, -stride, parity,
+                  mode);
+            else
+              kernels[j].filter_line (out + o, frames[0] + o, frames[1] + o,
+                  frames[2] + o, w, stride, -stride, parity, mode);
+
+            if (memcmp (out + o, ref + o, n) != 0)
+              fail ("%s, %d bits: width %d, parity %d, mode %d differs from "
+                  "the C line filter", kernels[j].name, depth, w, parity,
+                  mode);
+          }
+        }
+      }
+    }
+  }
+
+  for (k = 0; k < 3; k++)
+    g_free (frames[k]);
+  g_free (ref);
+  g_free (out);
+  g_rand_free (rand);
+}
+
+GST_START_TEST (test_line_filters_8bit)
+{
+  check_kernels (8);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_line_filters_10bit)
+{
+  check_kernels (10);
+}
+
+GST_END_TEST;
+
+/* Returns the frame deinterlaced by yadif with @n_threads threads */
+static GstBuffer *
+run_yadif (const gchar * caps, GstBuffer * inbuf, guint n_threads)
+{
+  GstHarness *h;
+  GstBuffer *outbuf;
+  gchar *desc;
+
+  desc = g_strdup_printf ("yadif mode=interlaced n-threads=%u", n_threads);
+  h = gst_harness_new_parse (desc);
+  g_free (desc);
+  gst_harness_set_src_caps_str (h, caps);
+
+  outbuf = gst_harness_push_and_pull (h, gst_buffer_ref (inbuf));
+  fail_unless (outbuf != NULL);
+
+  gst_harness_teardown (h);
+
+  return outbuf;
+}
+
+static const struct
+{
+  const gchar *format;
+  gint width, height;
+} frame_sizes[] = {
+  {"I420", 67, 131},
+  {"Y42B", 35, 97},
+  {"Y444", 19, 65},
+  {FORMAT_10BIT ("I420"), 67, 131},
+  {FORMAT_10BIT ("Y444"), 101, 53}
+};
+
+/* the rows are split in bands of at least 16 rows, so each frame is
+ * filtered in more than one band, and the odd sizes give bands and lines
+ * that don't line up with the subsampling or the SIMD steps */
+GST_START_TEST (test_threads)
+{
+  GstBuffer *inbuf, *single, *multi;
+  GstVideoInfo info;
+  GstMapInfo map;
+  GstCaps *caps;
+  gchar *caps_str;
+  GRand *rand;
+  gsize i;
+
+  caps_str = g_strdup_printf ("video/x-raw, format=%s, width=%d, height=%d, "
+      "framerate=25/1, interlace-mode=interleaved", frame_sizes[__i__].format,
+      frame_sizes[__i__].width, frame_sizes[__i__].height);
+  caps = gst_caps_from_string (caps_str);
+  fail_unless (gst_video_info_from_caps (&info, caps));
+  gst_caps_unref (caps);
+
+  rand = g_rand_new_with_seed (__i__);
+  inbuf = gst_buffer_new_allocate (NULL, GST_VIDEO_INFO_SIZE (&info), NULL);
+  fail_unless (gst_buffer_map (inbuf, &map, GST_MAP_WRITE));
+  for (i = 0; i < map.size; i++)
+    map.data[i] = g_rand_int (rand);
+  /* keep the 10 bit samples in range */
+  if (GST_VIDEO_INFO_COMP_DEPTH (&info, 0) > 8) {
+    for (i = 0; i < map.size / 2; i++)
+      ((guint16 *) map.data)[i] &= 0x3ff;
+  }
+  gst_buffer_unmap (inbuf, &map);
+  g_rand_free (rand);
+
+  single = run_yadif (caps_str, inbuf, 1);
+  multi = run_yadif (caps_str, inbuf, 4);
+
+  fail_unless (gst_buffer_map (single, &map, GST_MAP_READ));
+  fail_unless_equals_int (gst_buffer_memcmp (multi, 0, map.data, map.size),
+      0);
+  gst_buffer_unmap (single, &map);
+
+  gst_buffer_unref (single);
+  gst_buffer_unref (multi);
+  gst_buffer_unref (inbuf);
+  g_free (caps_str);
+}
+
+GST_END_TEST;
+
+static Suite *
+yadif_suite (void)
+{
+  Suite *s = suite_create ("yadif");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_line_filters_8bit);
+  tcase_add_test (tc_chain, test_line_filters_10bit);
+  tcase_add_loop_test (tc_chain, test_threads, 0, G_N_ELEMENTS (frame_sizes));
+
+  return s;
+}
+
+GST_CHECK_MAIN (yadif);
@@ -211,6 +211,127 @@ GST_START_TEST (test_h264_parse_slice_eoseq_slice)
 
 GST_END_TEST;
 
+/* start codes at all positions relative to the blocks of a vectorized scan,
+ * surrounded by bytes that look like the start of a start code */
+GST_START_TEST (test_h264_identify_nalu_start_code_positions)
+{
+  GstH264ParserResult res;
+  GstH264NalUnit nalu;
+  GstH264NalParser *const parser = gst_h264_nal_parser_new ();
+  guint8 buf[128];
+  guint sc, size;
+
+  for (sc = 0; sc < 64; sc++) {
+    for (size = sc + 4; size <= 100; size++) {
+      memset (buf, 0x80, sc);
+      buf[sc] = 0x00;
+      buf[sc + 1] = 0x00;
+      buf[sc + 2] = 0x01;
+      buf[sc + 3] = 0x09;     /* access unit delimiter */
+      /* 00 01 and 00 00 02 are not start codes */
+      buf[sc + 4] = 0x00;
+      buf[sc + 5] = 0x01;
+      buf[sc + 6] = 0x00;
+      memset (buf + sc + 7, 0xff, sizeof (buf) - sc - 7);
+      buf[sc + 30] = 0x00;
+      buf[sc + 31] = 0x00;
+      buf[sc + 32] = 0x02;
+
+      res = gst_h264_parser_identify_nalu_unchecked (parser, buf, 0, size,
+          &nalu);
+      assert_equals_int (res, GST_H264_PARSER_OK);
+      assert_equals_int (nalu.sc_offset, sc);
+      assert_equals_int (nalu.offset, sc + 3);
+
+      /* the start code must be followed by a byte */
+      res = gst_h264_parser_identify_nalu_unchecked (parser, buf, 0, sc + 3,
+          &nalu);
+      fail_unless (res == GST_H264_PARSER_NO_NAL
+          || res == GST_H264_PARSER_ERROR);
+    }
+
+    /* the next start code ends the NAL unit */
+    buf[sc + 40] = 0x00;
+    buf[sc + 41] = 0x00;
+    buf[sc + 42] = 0x01;
+    buf[sc + 43] = 0x09;
+    res = gst_h264_parser_identify_nalu (parser, buf, 0, sc + 44, &nalu);
+    assert_equals_int (res, GST_H264_PARSER_OK);
+    assert_equals_int (nalu.offset, sc + 3);
+    assert_equals_int (nalu.size, 37);
+  }
+
+  gst_h264_nal_parser_free (parser);
+}
+
+GST_END_TEST;
+
+/* SPS of a 1920x1088 baseline profile stream */
+static const guint8 sps_1080p[] = {
+  0x00, 0x00, 0x00, 0x01, 0x67, 0x42, 0x00, 0x28, 0xda, 0x01, 0xe0, 0x08,
+  0x99
+};
+
+/* a SEI message longer than the window of the bit reader, with an emulation
+ * prevention byte every 5 bytes, followed by a recovery point */
+GST_START_TEST (test_h264_parse_sei_emulation_prevention)
+{
+  GstH264ParserResult res;
+  GstH264NalUnit nalu;
+  GstH264SEIMessage *sei;
+  GArray *messages;
+  GstH264NalParser *const parser = gst_h264_nal_parser_new ();
+  guint8 buf[256];
+  guint i, size = 0;
+
+  res = gst_h264_parser_identify_nalu_unchecked (parser, sps_1080p, 0,
+      sizeof (sps_1080p), &nalu);
+  assert_equals_int (res, GST_H264_PARSER_OK);
+  res = gst_h264_parser_parse_nal (parser, &nalu);
+  assert_equals_int (res, GST_H264_PARSER_OK);
+
+  buf[size++] = 0x00;
+  buf[size++] = 0x00;
+  buf[size++] = 0x01;
+  buf[size++] = 0x06;
+  /* user_data_unregistered of 100 bytes */
+  buf[size++] = 0x05;
+  buf[size++] = 100;
+  for (i = 0; i < 25; i++) {
+    buf[size++] = 0x00;
+    buf[size++] = 0x00;
+    buf[size++] = 0x03;
+    buf[size++] = 0x01;
+    buf[size++] = 0x40 + i;
+  }
+  /* recovery point with recovery_frame_cnt 3 and exact_match_flag 1 */
+  buf[size++] = 0x06;
+  buf[size++] = 0x02;
+  buf[size++] = 0x24;
+  buf[size++] = 0x40;
+  buf[size++] = 0x80;
+
+  res = gst_h264_parser_identify_nalu_unchecked (parser, buf, 0, size, &nalu);
+  assert_equals_int (res, GST_H264_PARSER_OK);
+  assert_equals_int (nalu.type, GST_H264_NAL_SEI);
+
+  res = gst_h264_parser_parse_sei (parser, &nalu, &messages);
+  assert_equals_int (res, GST_H264_PARSER_OK);
+  assert_equals_int (messages->len, 2);
+
+  sei = &g_array_index (messages, GstH264SEIMessage, 1);
+  assert_equals_int (sei->payloadType, GST_H264_SEI_RECOVERY_POINT);
+  assert_equals_int (sei->payload.recovery_point.recovery_frame_cnt, 3);
+  assert_equals_int (sei->payload.recovery_point.exact_match_flag, 1);
+  assert_equals_int (sei->payload.recovery_point.broken_link_flag, 0);
+  assert_equals_int (sei->payload.recovery_point.changing_slice_group_idc, 0);
+
+  g_array_unref (messages);
+  gst_h264_nal_parser_free (parser);
+}
+
+GST_END_TEST;
+
 static Suite *
 h264parser_suite (void)
 {
@@ -221,6 +342,8 @@ h264parser_suite (void)
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_h264_parse_slice_dpa);
   tcase_add_test (tc_chain, test_h264_parse_slice_eoseq_slice);
+  tcase_add_test (tc_chain, test_h264_identify_nalu_start_code_positions);
+  tcase_add_test (tc_chain, test_h264_parse_sei_emulation_prevention);
 
   return s;
 }
@@ -0,0 +1,274 @@
+/* GStreamer
+ *
+ * unit test for the H.265 parser library
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <gst/check/gstcheck.h>
+#include <gst/codecparsers/gsth265parser.h>
+
+#define N_LONG_TERM_REF_PICS 32
+
+typedef struct
+{
+  guint8 data[256];
+  guint bit;
+} BitWriter;
+
+static void
+put_bits (BitWriter * bw, guint32 value, guint n)
+{
+  while (n--) {
+    if ((value >> n) & 1)
+      bw->data[bw->bit / 8] |= 0x80 >> (bw->bit % 8);
+    bw->bit++;
+  }
+}
+
+static void
+put_ue (BitWriter * bw, guint32 value)
+{
+  guint n = g_bit_storage (value + 1);
+
+  put_bits (bw, 0, n - 1);
+  put_bits (bw, value + 1, n);
+}
+
+static guint16
+lt_ref_pic_poc_lsb (guint i)
+{
+  return i % 5 == 0 ? i : 0;
+}
+
+/* Writes the RBSP of a 1920x1080 main profile SPS with the 32 long term
+ * reference pictures of 16 bits, mostly zeros, and a VUI with an extended
+ * SAR, a colour description and the timing of 59.94 fps. Returns the size */
+static guint
+write_sps (guint8 * data)
+{
+  BitWriter bw;
+  guint i;
+
+  memset (&bw, 0, sizeof (bw));
+
+  put_bits (&bw, 0, 4);         /* sps_video_parameter_set_id */
+  put_bits (&bw, 0, 3);         /* sps_max_sub_layers_minus1 */
+  put_bits (&bw, 1, 1);         /* sps_temporal_id_nesting_flag */
+
+  /* profile_tier_level */
+  put_bits (&bw, 0, 2);         /* general_profile_space */
+  put_bits (&bw, 0, 1);         /* general_tier_flag */
+  put_bits (&bw, 1, 5);         /* general_profile_idc */
+  put_bits (&bw, 0x60000000, 32);       /* general_profile_compatibility_flag */
+  put_bits (&bw, 1, 1);         /* general_progressive_source_flag */
+  put_bits (&bw, 0, 1);         /* general_interlaced_source_flag */
+  put_bits (&bw, 0, 1);         /* general_non_packed_constraint_flag */
+  put_bits (&bw, 1, 1);         /* general_frame_only_constraint_flag */
+  put_bits (&bw, 0, 32);        /* general_reserved_zero_44bits */
+  put_bits (&bw, 0, 12);
+  put_bits (&bw, 123, 8);       /* general_level_idc */
+
+  put_ue (&bw, 0);              /* sps_seq_parameter_set_id */
+  put_ue (&bw, 1);              /* chroma_format_idc */
+  put_ue (&bw, 1920);           /* pic_width_in_luma_samples */
+  put_ue (&bw, 1080);           /* pic_height_in_luma_samples */
+  put_bits (&bw, 0, 1);         /* conformance_window_flag */
+  put_ue (&bw, 0);              /* bit_depth_luma_minus8 */
+  put_ue (&bw, 0);              /* bit_depth_chroma_minus8 */
+  put_ue (&bw, 12);             /* log2_max_pic_order_cnt_lsb_minus4 */
+  put_bits (&bw, 1, 1);         /* sps_sub_layer_ordering_info_present_flag */
+  put_ue (&bw, 4);              /* sps_max_dec_pic_buffering_minus1 */
+  put_ue (&bw, 2);              /* sps_max_num_reorder_pics */
+  put_ue (&bw, 0);              /* sps_max_latency_increase_plus1 */
+  put_ue (&bw, 0);              /* log2_min_luma_coding_block_size_minus3 */
+  put_ue (&bw, 3);              /* log2_diff_max_min_luma_coding_block_size */
+  put_ue (&bw, 0);              /* log2_min_transform_block_size_minus2 */
+  put_ue (&bw, 3);              /* log2_diff_max_min_transform_block_size */
+  put_ue (&bw, 1);              /* max_transform_hierarchy_depth_inter */
+  put_ue (&bw, 1);              /* max_transform_hierarchy_depth_intra */
+  put_bits (&bw, 0, 1);         /* scaling_list_enabled_flag */
+  put_bits (&bw, 1, 1);         /* amp_enabled_flag */
+  put_bits (&bw, 1, 1);         /* sample_adaptive_offset_enabled_flag */
+  put_bits (&bw, 0, 1);         /* pcm_enabled_flag */
+  put_ue (&bw, 0);              /* num_short_term_ref_pic_sets */
+
+  put_bits (&bw, 1, 1);         /* long_term_ref_pics_present_flag */
+  put_ue (&bw, N_LONG_TERM_REF_PICS);
+  for (i = 0; i < N_LONG_TERM_REF_PICS; i++) {
+    put_bits (&bw, lt_ref_pic_poc_lsb (i), 16);
+    put_bits (&bw, i % 3 == 0, 1);
+  }
+
+  put_bits (&bw, 1, 1);         /* sps_temporal_mvp_enabled_flag */
+  put_bits (&bw, 1, 1);         /* strong_intra_smoothing_enabled_flag */
+  put_bits (&bw, 1, 1);         /* vui_parameters_present_flag */
+
+  /* vui_parameters */
+  put_bits (&bw, 1, 1);         /* aspect_ratio_info_present_flag */
+  put_bits (&bw, 255, 8);       /* aspect_ratio_idc, EXTENDED_SAR */
+  put_bits (&bw, 1, 16);        /* sar_width */
+  put_bits (&bw, 1, 16);        /* sar_height */
+  put_bits (&bw, 0, 1);         /* overscan_info_present_flag */
+  put_bits (&bw, 1, 1);         /* video_signal_type_present_flag */
+  put_bits (&bw, 5, 3);         /* video_format */
+  put_bits (&bw, 0, 1);         /* video_full_range_flag */
+  put_bits (&bw, 1, 1);         /* colour_description_present_flag */
+  put_bits (&bw, 1, 8);         /* colour_primaries */
+  put_bits (&bw, 1, 8);         /* transfer_characteristics */
+  put_bits (&bw, 1, 8);         /* matrix_coeffs */
+  put_bits (&bw, 0, 1);         /* chroma_loc_info_present_flag */
+  put_bits (&bw, 0, 1);         /* neutral_chroma_indication_flag */
+  put_bits (&bw, 0, 1);         /* field_seq_flag */
+  put_bits (&bw, 0, 1);         /* frame_field_info_present_flag */
+  put_bits (&bw, 0, 1);         /* default_display_window_flag */
+  put_bits (&bw, 1, 1);         /* vui_timing_info_present_flag */
+  put_bits (&bw, 1001, 32);     /* vui_num_units_in_tick */
+  put_bits (&bw, 60000, 32);    /* vui_time_scale */
+  put_bits (&bw, 0, 1);         /* vui_poc_proportional_to_timing_flag */
+  put_bits (&bw, 0, 1);         /* vui_hrd_parameters_present_flag */
+  put_bits (&bw, 0, 1);         /* bitstream_restriction_flag */
+
+  put_bits (&bw, 0, 1);         /* sps_extension_present_flag */
+
+  /* rbsp_trailing_bits */
+  put_bits (&bw, 1, 1);
+  while (bw.bit % 8)
+    put_bits (&bw, 0, 1);
+
+  memcpy (data, bw.data, bw.bit / 8);
+
+  return bw.bit / 8;
+}
+
+/* Appends @rbsp to @nal with the emulation prevention bytes, returns the
+ * new size of @nal. Appends the positions in @rbsp of the bytes following
+ * an emulation prevention byte to @epb */
+static guint
+escape_rbsp (guint8 * nal, guint size, const guint8 * rbsp, guint rbsp_size,
+    GArray * epb)
+{
+  guint i, zeros = 0, start = size;
+
+  for (i = 0; i < rbsp_size; i++) {
+    if (zeros == 2 && rbsp[i] <= 0x03) {
+      g_array_append_val (epb, i);
+      nal[size++] = 0x03;
+      zeros = 0;
+    }
+    nal[size++] = rbsp[i];
+    zeros = rbsp[i] == 0x00 ? zeros + 1 : 0;
+  }
+  fail_unless (size - start == rbsp_size + epb->len);
+
+  return size;
+}
+
+/* The long term reference pictures give a run of zeros longer than the
+ * window of the bit reader, escaped with emulation prevention bytes on
+ * both sides of the window boundaries, the VUI after it must be read from
+ * the right positions */
+GST_START_TEST (test_h265_parse_sps_emulation_prevention)
+{
+  GstH265ParserResult res;
+  GstH265NalUnit nalu;
+  GstH265SPS sps;
+  GstH265Parser *const parser = gst_h265_parser_new ();
+  guint8 rbsp[256], nal[512];
+  GArray *epb = g_array_new (FALSE, FALSE, sizeof (guint));
+  guint i, rbsp_size, size = 0;
+  gboolean before = FALSE, after = FALSE;
+
+  nal[size++] = 0x00;
+  nal[size++] = 0x00;
+  nal[size++] = 0x00;
+  nal[size++] = 0x01;
+  /* nal_unit_type 33 (SPS), nuh_temporal_id_plus1 1 */
+  nal[size++] = 0x42;
+  nal[size++] = 0x01;
+
+  rbsp_size = write_sps (rbsp);
+  size = escape_rbsp (nal, size, rbsp, rbsp_size, epb);
+
+  /* the window holds the first 64 bytes after the NAL header */
+  for (i = 0; i < epb->len; i++) {
+    if (g_array_index (epb, guint, i) < 64)
+      before = TRUE;
+    else
+      after = TRUE;
+  }
+  fail_unless (before && after);
+
+  res = gst_h265_parser_identify_nalu_unchecked (parser, nal, 0, size, &nalu);
+  assert_equals_int (res, GST_H265_PARSER_OK);
+  assert_equals_int (nalu.type, GST_H265_NAL_SPS);
+  assert_equals_int (nalu.size, size - 4);
+
+  res = gst_h265_parser_parse_sps (parser, &nalu, &sps, TRUE);
+  assert_equals_int (res, GST_H265_PARSER_OK);
+
+  assert_equals_int (sps.profile_tier_level.profile_idc, 1);
+  assert_equals_int (sps.profile_tier_level.level_idc, 123);
+  assert_equals_int (sps.width, 1920);
+  assert_equals_int (sps.height, 1080);
+  assert_equals_int (sps.log2_max_pic_order_cnt_lsb_minus4, 12);
+  assert_equals_int (sps.max_dec_pic_buffering_minus1[0], 4);
+  assert_equals_int (sps.max_num_reorder_pics[0], 2);
+  assert_equals_int (sps.log2_diff_max_min_luma_coding_block_size, 3);
+  assert_equals_int (sps.amp_enabled_flag, 1);
+  assert_equals_int (sps.sample_adaptive_offset_enabled_flag, 1);
+
+  assert_equals_int (sps.long_term_ref_pics_present_flag, 1);
+  assert_equals_int (sps.num_long_term_ref_pics_sps, N_LONG_TERM_REF_PICS);
+  for (i = 0; i < N_LONG_TERM_REF_PICS; i++) {
+    assert_equals_int (sps.lt_ref_pic_poc_lsb_sps[i], lt_ref_pic_poc_lsb (i));
+    assert_equals_int (sps.used_by_curr_pic_lt_sps_flag[i], i % 3 == 0);
+  }
+  assert_equals_int (sps.temporal_mvp_enabled_flag, 1);
+  assert_equals_int (sps.strong_intra_smoothing_enabled_flag, 1);
+
+  assert_equals_int (sps.vui_parameters_present_flag, 1);
+  assert_equals_int (sps.vui_params.par_n, 1);
+  assert_equals_int (sps.vui_params.par_d, 1);
+  assert_equals_int (sps.vui_params.video_format, 5);
+  assert_equals_int (sps.vui_params.colour_primaries, 1);
+  assert_equals_int (sps.vui_params.transfer_characteristics, 1);
+  assert_equals_int (sps.vui_params.matrix_coefficients, 1);
+  assert_equals_int (sps.vui_params.num_units_in_tick, 1001);
+  assert_equals_int (sps.vui_params.time_scale, 60000);
+  assert_equals_int (sps.sps_extension_flag, 0);
+  assert_equals_int (sps.fps_num, 60000);
+  assert_equals_int (sps.fps_den, 1001);
+
+  g_array_unref (epb);
+  gst_h265_parser_free (parser);
+}
+
+GST_END_TEST;
+
+static Suite *
+h265parser_suite (void)
+{
+  Suite *s = suite_create ("H265 Parser library");
+
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_h265_parse_sps_emulation_prevention);
+
+  return s;
+}
+
+GST_CHECK_MAIN (h265parser);